@@ -10,6 +10,7 @@
 
 //AutomaticArchiving
 #define ACO_AUTOMATIC_SERVERARCHIVE                    500
+#define ACO_AUTOMATIC_MAMARCHIVE                       1000
 
 //ArchiveManagement
 #define ACO_MANAGE_FILEARCHIVE                         500
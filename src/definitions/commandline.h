@@ -16,4 +16,7 @@
 // -logtypes <Logger::Type>
 #define CLO_LOG_TYPES               "-lt"
 
+// -cap <CaptureDir>
+#define CLO_CAPTURE_DIR             "-cap"
+
 #endif //DEF_COMMANDLINE_H
@@ -5,5 +5,8 @@
 #define FADP_COMPATIBLE_VERSION               "CompatibleVersion"
 #define FADP_LAST_SYNC_TIME                   "LastSyncTime"
 #define FADP_DATABASE_NOT_CLOSED              "DatabaseNotClosed"
+#define FADP_MAM_LAST_ID                      "MamLastId"
+#define FADP_MAM_LAST_TIME                    "MamLastTime"
+#define FADP_MAM_LIVE_IDS                     "MamLiveIds"
 
 #endif // DEF_FILEARCHIVEDATABASEPROPERTIES_H
@@ -91,6 +91,9 @@
 #define IERR_STARTTLS_INVALID_RESPONCE                       "starttls-invalid-responce"
 #define IERR_STARTTLS_NEGOTIATION_FAILED                     "starttls-negotiation-failed"
 
+// StreamManagement
+#define IERR_SM_RESUME_FAILED                                "sm-resume-failed"
+
 // XmppStreams
 #define IERR_XMPPSTREAM_DESTROYED                            "xmppstream-destroyed"
 #define IERR_XMPPSTREAM_NOT_SECURE                           "xmppstream-not-secure"
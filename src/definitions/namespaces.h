@@ -41,6 +41,8 @@
 #define NS_FEATURE_STARTTLS                     "urn:ietf:params:xml:ns:xmpp-tls"
 #define NS_FEATURE_REGISTER                     "http://jabber.org/features/iq-register"
 #define NS_FEATURE_ROSTER_VER                   "urn:xmpp:features:rosterver"
+#define NS_FEATURE_SM                           "urn:xmpp:sm:3"
+#define NS_FEATURE_CSI                          "urn:xmpp:csi:0"
 
 #define NS_MUC                                  "http://jabber.org/protocol/muc"
 #define NS_MUC_USER                             "http://jabber.org/protocol/muc#user"
@@ -91,6 +93,10 @@
 #define NS_MESSAGE_CARBONS                      "urn:xmpp:carbons:2"
 #define NS_MESSAGE_FORWARD                      "urn:xmpp:forward:0"
 
+#define NS_MAM_1                                "urn:xmpp:mam:1"
+#define NS_MAM_2                                "urn:xmpp:mam:2"
+#define NS_STANZA_ID                            "urn:xmpp:sid:0"
+
 #define NS_VACUUM_PRIVATESTORAGE_UPDATE         "vacuum:privatestorage:update"
 
 #endif
@@ -19,6 +19,9 @@
 #define OPV_ACCOUNT_CONNECTION_SSLPROTOCOL              "accounts.account.connection.ssl-protocol"
 #define OPV_ACCOUNT_CONNECTION_USELEGACYSSL             "accounts.account.connection.use-legacy-ssl"
 #define OPV_ACCOUNT_CONNECTION_CERTVERIFYMODE           "accounts.account.connection.cert-verify-mode"
+// ReplayConnection
+#define OPV_ACCOUNT_CONNECTION_REPLAYFILE               "accounts.account.connection.replay-file"
+#define OPV_ACCOUNT_CONNECTION_REPLAYSPEED              "accounts.account.connection.replay-speed"
 // Registration
 #define OPV_ACCOUNT_REGISTER                            "accounts.account.register-on-server"
 // StatusChanger
@@ -30,6 +33,8 @@
 #define OPV_ACCOUNT_IGNOREAUTOJOIN                      "accounts.account.ignore-autojoin"
 // Compress
 #define OPV_ACCOUNT_STREAMCOMPRESS                      "accounts.account.stream-compress"
+// StreamManagement
+#define OPV_ACCOUNT_STREAMMANAGEMENT                    "accounts.account.stream-management"
 
 // BirthdayReminder
 #define OPV_BIRTHDAYREMINDER_STARTTIME                  "birthdayreminder.start-time"
@@ -140,6 +145,9 @@
 #define OPV_FILEARCHIVE_COLLECTION_CRITICALSIZE         "filearchive.collection.critical-size"
 // ServerMessageArchive
 #define OPV_SERVERARCHIVE_MAXUPLOADSIZE                 "serverarchive.max-upload-size"
+#define OPV_SERVERARCHIVE_MAXPIPELINEDREQUESTS          "serverarchive.max-pipelined-requests"
+// MamMessageArchive
+#define OPV_MAMARCHIVE_PAGESIZE                         "mamarchive.page-size"
 
 // MessageStyles
 #define OPV_MESSAGESTYLE_ROOT                           "message-styles"
@@ -240,6 +248,10 @@
 #define OPV_AUTOSTARTUS_RULE_TEXT                       "statuses.autostatus.rule.text"
 #define OPV_AUTOSTARTUS_RULE_PRIORITY                   "statuses.autostatus.rule.priority"
 
+// ClientState
+#define OPV_CLIENTSTATE_ENABLED                         "clientstate.enabled"
+#define OPV_CLIENTSTATE_IDLETIME                        "clientstate.idle-time"
+
 // StatusIcons
 #define OPV_STATUSICONS                                 "statusicons"
 #define OPV_STATUSICONS_DEFAULT                         "statusicons.default-iconset"
@@ -6,6 +6,7 @@
 #define OWO_ACCOUNT_CONNECTION                    600
 #define OWO_ACCOUNT_REQUIRE_ENCRYPTION            700
 #define OWO_ACCOUNT_COMPRESS                      750
+#define OWO_ACCOUNT_STREAMMANAGEMENT              760
 #define OWO_ACCOUNT_REGISTER                      800
 #define OWO_ACCOUNT_STATUS                        900
 #define OWO_ACCOUNT_BOOKMARKS                     1000
@@ -3,6 +3,7 @@
 
 //Message In
 #define SHO_MI_REMOTECONTROL          10
+#define SHO_MI_MAMMESSAGEARCHIVE      200
 #define SHO_MI_PRIVATESTORAGE         300
 #define SHO_MI_CAPTCHAFORMS           300
 #define SHO_MI_CHATSTATES             500
@@ -2,5 +2,6 @@
 #define DEF_XMPPDATAHANDLERORDERS_H
 
 #define XDHO_FEATURE_COMPRESS     1000
+#define XDHO_REPLAY_CAPTURE       2000
 
 #endif //DEF_XMPPDATAHANDLERORDERS_H
@@ -6,7 +6,9 @@
 #define XFO_REGISTER        300
 #define XFO_SASL            400
 #define XFO_IQAUTH          500
+#define XFO_SM              550
 #define XFO_BIND            600
 #define XFO_SESSION         700
+#define XFO_CSI             800
 
 #endif //DEF_XMPPFEATUREORDERS_H
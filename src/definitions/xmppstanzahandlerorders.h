@@ -2,10 +2,12 @@
 #define DEF_XMPPSTANZAHANDLERORDERS_H
 
 #define XSHO_STANZAPROCESSOR        300
+#define XSHO_STREAMMANAGEMENT       400
 #define XSHO_XMPP_STREAM            500
 #define XSHO_SASL_VERSION           700
 #define XSHO_XMPP_FEATURE           900
 #define XSHO_BITSOFBINARY           5000
 #define XSHO_CONSOLE                10000
+#define XSHO_REPLAY_CAPTURE         20000
 
 #endif //DEF_XMPPSTANZAHANDLERORDERS_H
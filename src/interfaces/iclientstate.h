@@ -0,0 +1,22 @@
+#ifndef ICLIENTSTATE_H
+#define ICLIENTSTATE_H
+
+#include <utils/jid.h>
+
+#define CLIENTSTATE_UUID "{2E7A4C19-6B3D-4F85-A0C2-9D1E5B7F3A64}"
+
+class IClientState
+{
+public:
+	virtual QObject *instance() =0;
+	virtual bool isActive() const =0;
+	virtual bool isSupported(const Jid &AStreamJid) const =0;
+	virtual bool isStreamActive(const Jid &AStreamJid) const =0;
+protected:
+	virtual void activeChanged(bool AActive) =0;
+	virtual void streamActiveChanged(const Jid &AStreamJid, bool AActive) =0;
+};
+
+Q_DECLARE_INTERFACE(IClientState,"Vacuum.Plugin.IClientState/1.0")
+
+#endif // ICLIENTSTATE_H
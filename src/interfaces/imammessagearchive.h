@@ -0,0 +1,24 @@
+#ifndef IMAMMESSAGEARCHIVE_H
+#define IMAMMESSAGEARCHIVE_H
+
+#include <interfaces/imessagearchiver.h>
+
+#define MAMMESSAGEARCHIVE_UUID "{8C3F2A61-4E9B-4D7A-B5C0-71E2D9A4F386}"
+
+class IMamMessageArchive :
+	public IArchiveEngine
+{
+public:
+	virtual QObject *instance() =0;
+	virtual bool isSupported(const Jid &AStreamJid) const =0;
+	virtual bool isSynchronizing(const Jid &AStreamJid) const =0;
+	virtual QString lastSyncedId(const Jid &AStreamJid) const =0;
+	virtual bool startSynchronization(const Jid &AStreamJid) =0;
+protected:
+	virtual void synchronizationStarted(const Jid &AStreamJid) =0;
+	virtual void synchronizationFinished(const Jid &AStreamJid, int ASaved) =0;
+};
+
+Q_DECLARE_INTERFACE(IMamMessageArchive,"Vacuum.Plugin.IMamMessageArchive/1.0")
+
+#endif //IMAMMESSAGEARCHIVE_H
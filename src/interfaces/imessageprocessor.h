@@ -28,7 +28,9 @@ public:
 class IMessageWriter
 {
 public:
+	virtual bool checkMessageToText(int AOrder, const Message &AMessage, const QString &ALang) =0;
 	virtual void writeMessageToText(int AOrder, Message &AMessage, QTextDocument *ADocument, const QString &ALang) =0;
+	virtual bool checkTextToMessage(int AOrder, const QTextDocument *ADocument, const QString &ALang) =0;
 	virtual void writeTextToMessage(int AOrder, Message &AMessage, QTextDocument *ADocument, const QString &ALang) =0;
 };
 
@@ -82,7 +84,7 @@ protected:
 };
 
 Q_DECLARE_INTERFACE(IMessageHandler,"Vacuum.Plugin.IMessageHandler/1.2")
-Q_DECLARE_INTERFACE(IMessageWriter,"Vacuum.Plugin.IMessageWriter/1.1")
+Q_DECLARE_INTERFACE(IMessageWriter,"Vacuum.Plugin.IMessageWriter/1.2")
 Q_DECLARE_INTERFACE(IMessageEditor,"Vacuum.Plugin.IMessageEditor/1.0")
 Q_DECLARE_INTERFACE(IMessageProcessor,"Vacuum.Plugin.IMessageProcessor/1.3")
 
@@ -0,0 +1,39 @@
+#ifndef IREPLAYCONNECTION_H
+#define IREPLAYCONNECTION_H
+
+#define REPLAYCONNECTION_UUID "{2c28ed7b-614f-47d6-b65a-705ff453d965}"
+
+#include <interfaces/iconnectionmanager.h>
+
+class IReplayConnection :
+	public IConnection
+{
+public:
+	enum OptionRole {
+		CaptureFile,
+		ReplaySpeed
+	};
+	enum ReplaySpeedMode {
+		OriginalSpeed,
+		MaximumSpeed
+	};
+public:
+	virtual QObject *instance() =0;
+	virtual QVariant option(int ARole) const =0;
+	virtual void setOption(int ARole, const QVariant &AValue) =0;
+protected:
+	virtual void replayFinished() =0;
+};
+
+class IReplayConnectionPlugin
+{
+public:
+	virtual QObject *instance() =0;
+	virtual bool isCaptureEnabled() const =0;
+	virtual QString captureDirectory() const =0;
+};
+
+Q_DECLARE_INTERFACE(IReplayConnection,"Vacuum.Plugin.IReplayConnection/1.0")
+Q_DECLARE_INTERFACE(IReplayConnectionPlugin,"Vacuum.Plugin.IReplayConnectionPlugin/1.0")
+
+#endif // IREPLAYCONNECTION_H
@@ -14,6 +14,30 @@
 #define VCARD_GENDER_MALE        "Male"
 #define VCARD_GENDER_FEMALE      "Female"
 
+struct IVCardFetchCounters
+{
+	IVCardFetchCounters() {
+		queued = 0;
+		inFlight = 0;
+		window = 0;
+		sent = 0;
+		retried = 0;
+		failed = 0;
+		waitAvg = 0;
+		latencyAvg = 0;
+		latencyMax = 0;
+	}
+	int queued;
+	int inFlight;
+	int window;
+	quint32 sent;
+	quint32 retried;
+	quint32 failed;
+	qint64 waitAvg;
+	qint64 latencyAvg;
+	qint64 latencyMax;
+};
+
 class IVCard 
 {
 public:
@@ -41,9 +65,9 @@ class IVCardPlugin
 {
 public:
 	virtual QObject *instance() =0;
-	virtual QString vcardFileName(const Jid &AContactJid) const =0;
 	virtual bool hasVCard(const Jid &AContactJid) const =0;
 	virtual bool requestVCard(const Jid &AStreamJid, const Jid &AContactJid) =0;
+	virtual IVCardFetchCounters vcardFetchCounters() const =0;
 	virtual IVCard *getVCard(const Jid &AContactJid) =0;
 	virtual bool publishVCard(IVCard *AVCard, const Jid &AStreamJid) =0;
 	virtual void showVCardDialog(const Jid &AStreamJid, const Jid &AContactJid) =0;
@@ -54,6 +78,6 @@ protected:
 };
 
 Q_DECLARE_INTERFACE(IVCard,"Vacuum.Plugin.IVCard/1.3")
-Q_DECLARE_INTERFACE(IVCardPlugin,"Vacuum.Plugin.IVCardPlugin/1.3")
+Q_DECLARE_INTERFACE(IVCardPlugin,"Vacuum.Plugin.IVCardPlugin/1.4")
 
 #endif //IVCARD_H
@@ -75,6 +75,10 @@ public:
 	virtual bool isKeepAliveTimerActive() const =0;
 	virtual void setKeepAliveTimerActive(bool AActive) =0;
 	virtual qint64 sendStanza(Stanza &AStanza) =0;
+	virtual bool isSuspended() const =0;
+	virtual int resumeTimeout() const =0;
+	virtual void setResumeTimeout(int ATimeout) =0;
+	virtual bool completeResume() =0;
 	virtual void insertXmppDataHandler(int AOrder, IXmppDataHandler *AHandler) =0;
 	virtual void removeXmppDataHandler(int AOrder, IXmppDataHandler *AHandler) =0;
 	virtual void insertXmppStanzaHandler(int AOrder, IXmppStanzaHadler *AHandler) =0;
@@ -84,6 +88,8 @@ protected:
 	virtual void aboutToClose() =0;
 	virtual void closed() =0;
 	virtual void error(const XmppError &AError) =0;
+	virtual void suspended() =0;
+	virtual void resumed() =0;
 	virtual void jidAboutToBeChanged(const Jid &AAfter) =0;
 	virtual void jidChanged(const Jid &ABefore) =0;
 	virtual void connectionChanged(IConnection *AConnection) =0;
@@ -129,7 +135,7 @@ Q_DECLARE_INTERFACE(IXmppDataHandler,"Vacuum.Plugin.IXmppDataHandler/1.0");
 Q_DECLARE_INTERFACE(IXmppStanzaHadler,"Vacuum.Plugin.IXmppStanzaHadler/1.0");
 Q_DECLARE_INTERFACE(IXmppFeature,"Vacuum.Plugin.IXmppFeature/1.1");
 Q_DECLARE_INTERFACE(IXmppFeaturesPlugin,"Vacuum.Plugin.IXmppFeaturesPlugin/1.0");
-Q_DECLARE_INTERFACE(IXmppStream, "Vacuum.Plugin.IXmppStream/1.3")
+Q_DECLARE_INTERFACE(IXmppStream, "Vacuum.Plugin.IXmppStream/1.4")
 Q_DECLARE_INTERFACE(IXmppStreams,"Vacuum.Plugin.IXmppStreams/1.3")
 
 #endif
@@ -594,31 +594,16 @@ bool Avatars::saveToFile(const QString &AFileName, const QByteArray &AData) cons
 
 QByteArray Avatars::loadAvatarFromVCard(const Jid &AContactJid) const
 {
-	if (FVCardPlugin)
+	QByteArray data;
+	if (FVCardPlugin && FVCardPlugin->hasVCard(AContactJid.bare()))
 	{
-		QFile file(FVCardPlugin->vcardFileName(AContactJid.bare()));
-		if (file.open(QFile::ReadOnly))
-		{
-			QString xmlError;
-			QDomDocument doc;
-			if (doc.setContent(&file,true,&xmlError))
-			{
-				QDomElement binElem = doc.documentElement().firstChildElement("vCard").firstChildElement("PHOTO").firstChildElement("BINVAL");
-				if (!binElem.isNull())
-					return QByteArray::fromBase64(binElem.text().toLatin1());
-			}
-			else
-			{
-				REPORT_ERROR(QString("Failed to load avatar from vCard file content: %1").arg(xmlError));
-				file.remove();
-			}
-		}
-		else if (file.exists())
-		{
-			REPORT_ERROR(QString("Failed to load avatar from vCard file: %1").arg(file.errorString()));
-		}
+		IVCard *vcard = FVCardPlugin->getVCard(AContactJid.bare());
+		QDomElement binElem = vcard->vcardElem().firstChildElement("PHOTO").firstChildElement("BINVAL");
+		if (!binElem.isNull())
+			data = QByteArray::fromBase64(binElem.text().toLatin1());
+		vcard->unlock();
 	}
-	return QByteArray();
+	return data;
 }
 
 void Avatars::updatePresence(const Jid &AStreamJid) const
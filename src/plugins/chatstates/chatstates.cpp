@@ -50,8 +50,7 @@ ChatStates::ChatStates()
 	FSessionNegotiation = NULL;
 	FMultiUserChatPlugin = NULL;
 
-	FUpdateTimer.setSingleShot(false);
-	FUpdateTimer.setInterval(5000);
+	FUpdateTimer.setSingleShot(true);
 	connect(&FUpdateTimer,SIGNAL(timeout()),SLOT(onUpdateSelfStates()));
 }
 
@@ -202,7 +201,6 @@ bool ChatStates::initSettings()
 
 bool ChatStates::startPlugin()
 {
-	FUpdateTimer.start();
 	return true;
 }
 
@@ -569,6 +567,53 @@ void ChatStates::setSelfState(const Jid &AStreamJid, const Jid &AContactJid, int
 				sendStateMessage(AStreamJid,AContactJid,AState);
 			emit selfChatStateChanged(AStreamJid,AContactJid,AState);
 		}
+		updateSelfStateDeadline(AStreamJid,AContactJid,selfStateDeadline(params));
+	}
+}
+
+uint ChatStates::selfStateDeadline(const ChatParams &AParams) const
+{
+	switch (AParams.selfState)
+	{
+	case IChatStates::StateComposing:
+		return AParams.selfLastActive + PAUSED_TIMEOUT;
+	case IChatStates::StateActive:
+	case IChatStates::StatePaused:
+		return AParams.selfLastActive + INACTIVE_TIMEOUT;
+	case IChatStates::StateInactive:
+		return AParams.selfLastActive + GONE_TIMEOUT;
+	}
+	return 0;
+}
+
+void ChatStates::updateSelfStateDeadline(const Jid &AStreamJid, const Jid &AContactJid, uint ADeadline)
+{
+	QMap<Jid, QMap<Jid, ChatParams> >::iterator streamIt = FChatParams.find(AStreamJid);
+	QMap<Jid, ChatParams>::iterator it = streamIt!=FChatParams.end() ? streamIt->find(AContactJid) : QMap<Jid, ChatParams>::iterator();
+	if (streamIt!=FChatParams.end() && it!=streamIt->end() && it->selfDeadline!=ADeadline)
+	{
+		QPair<Jid,Jid> chat = qMakePair(AStreamJid,AContactJid);
+		if (it->selfDeadline > 0)
+			FSelfDeadlines.remove(it->selfDeadline,chat);
+		if (ADeadline > 0)
+			FSelfDeadlines.insertMulti(ADeadline,chat);
+		it->selfDeadline = ADeadline;
+		startUpdateTimer();
+	}
+}
+
+void ChatStates::startUpdateTimer()
+{
+	if (!FSelfDeadlines.isEmpty())
+	{
+		// Timer is armed only for the nearest deadline of all chats
+		uint curTime = QDateTime::currentDateTime().toTime_t();
+		uint nextTime = FSelfDeadlines.constBegin().key();
+		FUpdateTimer.start(nextTime>curTime ? (nextTime-curTime)*1000 : 0);
+	}
+	else
+	{
+		FUpdateTimer.stop();
 	}
 }
 
@@ -636,6 +681,8 @@ void ChatStates::onPresenceOpened(IPresence *APresence)
 	}
 
 	FNotSupported[APresence->streamJid()].clear();
+	foreach(const Jid &contactJid, FChatParams.value(APresence->streamJid()).keys())
+		updateSelfStateDeadline(APresence->streamJid(),contactJid,0);
 	FChatParams[APresence->streamJid()].clear();
 }
 
@@ -700,6 +747,9 @@ void ChatStates::onChatWindowCreated(IMessageChatWindow *AWindow)
 	widget->setPopupMode(QToolButton::InstantPopup);
 
 	FChatByEditor.insert(AWindow->editWidget()->textEdit(),AWindow);
+	if (FChatParams.value(AWindow->streamJid()).contains(AWindow->contactJid()))
+		updateSelfStateDeadline(AWindow->streamJid(),AWindow->contactJid(),selfStateDeadline(FChatParams[AWindow->streamJid()][AWindow->contactJid()]));
+
 	connect(AWindow->instance(),SIGNAL(tabPageActivated()),SLOT(onChatWindowActivated()));
 	connect(AWindow->instance(),SIGNAL(tabPageClosed()),SLOT(onChatWindowClosed()));
 	connect(AWindow->editWidget()->textEdit(),SIGNAL(textChanged()),SLOT(onChatWindowTextChanged()));
@@ -748,31 +798,31 @@ void ChatStates::onChatWindowDestroyed(IMessageChatWindow *AWindow)
 
 void ChatStates::onUpdateSelfStates()
 {
-	QList<IMessageChatWindow *> windows = FMessageWidgets!=NULL ? FMessageWidgets->chatWindows() : QList<IMessageChatWindow *>();
-	foreach (IMessageChatWindow *window, windows)
-	{
-		if (FChatParams.value(window->streamJid()).contains(window->contactJid()))
-		{
-			ChatParams &params = FChatParams[window->streamJid()][window->contactJid()];
-			uint timePassed = QDateTime::currentDateTime().toTime_t() - params.selfLastActive;
-			if (params.selfState==IChatStates::StateActive && window->isActiveTabPage())
-			{
-				setSelfState(window->streamJid(),window->contactJid(),IChatStates::StateActive);
-			}
-			else if (params.selfState==IChatStates::StateComposing && timePassed>PAUSED_TIMEOUT)
-			{
-				setSelfState(window->streamJid(),window->contactJid(),IChatStates::StatePaused);
-			}
-			else if ((params.selfState==IChatStates::StateActive || params.selfState==IChatStates::StatePaused) && timePassed>INACTIVE_TIMEOUT)
-			{
-				setSelfState(window->streamJid(),window->contactJid(),IChatStates::StateInactive);
-			}
-			else if (params.selfState==IChatStates::StateInactive && timePassed>GONE_TIMEOUT)
-			{
-				setSelfState(window->streamJid(),window->contactJid(),IChatStates::StateGone);
-			}
-		}
+	QList< QPair<Jid,Jid> > dueChats;
+	uint curTime = QDateTime::currentDateTime().toTime_t();
+	for (QMultiMap<uint, QPair<Jid,Jid> >::const_iterator it=FSelfDeadlines.constBegin(); it!=FSelfDeadlines.constEnd() && it.key()<=curTime; ++it)
+		dueChats.append(it.value());
+
+	for (QList< QPair<Jid,Jid> >::const_iterator it=dueChats.constBegin(); it!=dueChats.constEnd(); ++it)
+	{
+		const Jid &streamJid = it->first;
+		const Jid &contactJid = it->second;
+		IMessageChatWindow *window = FMessageWidgets!=NULL ? FMessageWidgets->findChatWindow(streamJid,contactJid,true) : NULL;
+		int state = selfChatState(streamJid,contactJid);
+		if (window == NULL)
+			updateSelfStateDeadline(streamJid,contactJid,0);
+		else if (state==IChatStates::StateActive && window->isActiveTabPage())
+			setSelfState(streamJid,contactJid,IChatStates::StateActive);
+		else if (state == IChatStates::StateComposing)
+			setSelfState(streamJid,contactJid,IChatStates::StatePaused);
+		else if (state==IChatStates::StateActive || state==IChatStates::StatePaused)
+			setSelfState(streamJid,contactJid,IChatStates::StateInactive);
+		else if (state == IChatStates::StateInactive)
+			setSelfState(streamJid,contactJid,IChatStates::StateGone);
+		else
+			updateSelfStateDeadline(streamJid,contactJid,0);
 	}
+	startUpdateTimer();
 }
 
 void ChatStates::onOptionsOpened()
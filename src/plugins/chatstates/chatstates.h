@@ -24,12 +24,14 @@ struct ChatParams
 		selfState = IChatStates::StateUnknown;
 		notifyId = 0;
 		selfLastActive = 0;
+		selfDeadline = 0;
 		canSendStates = false;
 	}
 	int userState;
 	int selfState;
 	int notifyId;
 	uint selfLastActive;
+	uint selfDeadline;
 	bool canSendStates;
 };
 
@@ -85,6 +87,9 @@ protected:
 	void setSupported(const Jid &AStreamJid, const Jid &AContactJid, bool ASupported);
 	void setUserState(const Jid &AStreamJid, const Jid &AContactJid, int AState);
 	void setSelfState(const Jid &AStreamJid, const Jid &AContactJid, int AState, bool ASend = true);
+	uint selfStateDeadline(const ChatParams &AParams) const;
+	void updateSelfStateDeadline(const Jid &AStreamJid, const Jid &AContactJid, uint ADeadline);
+	void startUpdateTimer();
 	void notifyUserState(const Jid &AStreamJid, const Jid &AContactJid);
 	void registerDiscoFeatures();
 protected slots:
@@ -122,6 +127,7 @@ private:
 	QMap<Jid, int> FPermitStatus;
 	QMap<Jid, QList<Jid> > FNotSupported;
 	QMap<Jid, QMap<Jid, ChatParams> > FChatParams;
+	QMultiMap<uint, QPair<Jid,Jid> > FSelfDeadlines;
 	QMap<Jid, QMap<Jid, QString> > FStanzaSessions;
 	QMap<QTextEdit *, IMessageChatWindow *> FChatByEditor;
 };
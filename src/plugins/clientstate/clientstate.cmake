@@ -0,0 +1,2 @@
+set(SOURCES clientstate.cpp )
+set(HEADERS clientstate.h )
@@ -0,0 +1,234 @@
+#include "clientstate.h"
+
+#include <QEvent>
+#include <definitions/namespaces.h>
+#include <definitions/optionvalues.h>
+#include <definitions/xmppfeatureorders.h>
+#include <definitions/xmppfeaturepluginorders.h>
+#include <utils/systemmanager.h>
+#include <utils/stanza.h>
+#include <utils/logger.h>
+
+#define STATE_UPDATE_DELAY   1000
+
+ClientState::ClientState()
+{
+	FXmppStreams = NULL;
+	FMainWindowPlugin = NULL;
+	FActive = true;
+
+	FUpdateTimer.setSingleShot(true);
+	FUpdateTimer.setInterval(STATE_UPDATE_DELAY);
+	connect(&FUpdateTimer,SIGNAL(timeout()),SLOT(onUpdateTimerTimeout()));
+}
+
+ClientState::~ClientState()
+{
+
+}
+
+void ClientState::pluginInfo(IPluginInfo *APluginInfo)
+{
+	APluginInfo->name = tr("Client State Indication");
+	APluginInfo->description = tr("Allows to inform the server when the user is not using the client to reduce traffic");
+	APluginInfo->version = "1.0";
+	APluginInfo->author = "Potapov S.A. aka Lion";
+	APluginInfo->homePage = "http://www.vacuum-im.org";
+	APluginInfo->dependences.append(XMPPSTREAMS_UUID);
+}
+
+bool ClientState::initConnections(IPluginManager *APluginManager, int &AInitOrder)
+{
+	Q_UNUSED(AInitOrder);
+	IPlugin *plugin = APluginManager->pluginInterface("IXmppStreams").value(0,NULL);
+	if (plugin)
+	{
+		FXmppStreams = qobject_cast<IXmppStreams *>(plugin->instance());
+		if (FXmppStreams)
+		{
+			connect(FXmppStreams->instance(),SIGNAL(created(IXmppStream *)),SLOT(onXmppStreamCreated(IXmppStream *)));
+			connect(FXmppStreams->instance(),SIGNAL(opened(IXmppStream *)),SLOT(onXmppStreamOpened(IXmppStream *)));
+			connect(FXmppStreams->instance(),SIGNAL(closed(IXmppStream *)),SLOT(onXmppStreamClosed(IXmppStream *)));
+			connect(FXmppStreams->instance(),SIGNAL(streamDestroyed(IXmppStream *)),SLOT(onXmppStreamDestroyed(IXmppStream *)));
+		}
+	}
+
+	plugin = APluginManager->pluginInterface("IMainWindowPlugin").value(0,NULL);
+	if (plugin)
+	{
+		FMainWindowPlugin = qobject_cast<IMainWindowPlugin *>(plugin->instance());
+	}
+
+	connect(Options::instance(),SIGNAL(optionsChanged(const OptionsNode &)),SLOT(onOptionsChanged(const OptionsNode &)));
+
+	return FXmppStreams!=NULL;
+}
+
+bool ClientState::initObjects()
+{
+	if (FXmppStreams)
+	{
+		FXmppStreams->registerXmppFeature(XFO_CSI,NS_FEATURE_CSI);
+		FXmppStreams->registerXmppFeaturePlugin(XFPO_DEFAULT,NS_FEATURE_CSI,this);
+	}
+	return true;
+}
+
+bool ClientState::initSettings()
+{
+	Options::setDefaultValue(OPV_CLIENTSTATE_ENABLED,true);
+	Options::setDefaultValue(OPV_CLIENTSTATE_IDLETIME,300);
+	return true;
+}
+
+bool ClientState::startPlugin()
+{
+	SystemManager::startSystemIdle();
+	connect(SystemManager::instance(),SIGNAL(systemIdleChanged(int)),SLOT(onSystemIdleChanged(int)));
+	if (FMainWindowPlugin)
+		FMainWindowPlugin->mainWindow()->instance()->installEventFilter(this);
+	return true;
+}
+
+QList<QString> ClientState::xmppFeatures() const
+{
+	return QList<QString>() << NS_FEATURE_CSI;
+}
+
+IXmppFeature *ClientState::newXmppFeature(const QString &AFeatureNS, IXmppStream *AXmppStream)
+{
+	// Nothing to negotiate, the feature only tells that state notifications are accepted
+	if (AFeatureNS == NS_FEATURE_CSI)
+	{
+		LOG_STRM_INFO(AXmppStream->streamJid(),"Client state indication is supported by server");
+		FSupported += AXmppStream;
+	}
+	return NULL;
+}
+
+bool ClientState::isActive() const
+{
+	return FActive;
+}
+
+bool ClientState::isSupported(const Jid &AStreamJid) const
+{
+	IXmppStream *stream = FXmppStreams->xmppStream(AStreamJid);
+	return stream!=NULL && FSupported.contains(stream);
+}
+
+bool ClientState::isStreamActive(const Jid &AStreamJid) const
+{
+	IXmppStream *stream = FXmppStreams->xmppStream(AStreamJid);
+	return stream==NULL || !FInactive.contains(stream);
+}
+
+bool ClientState::isMainWindowVisible() const
+{
+	QWidget *window = FMainWindowPlugin!=NULL ? FMainWindowPlugin->mainWindow()->instance() : NULL;
+	return window==NULL || (window->isVisible() && !window->isMinimized());
+}
+
+void ClientState::updateActiveState()
+{
+	bool active = true;
+	if (Options::node(OPV_CLIENTSTATE_ENABLED).value().toBool())
+	{
+		int idleTime = Options::node(OPV_CLIENTSTATE_IDLETIME).value().toInt();
+		active = isMainWindowVisible() && (idleTime<=0 || SystemManager::systemIdle()<idleTime);
+	}
+
+	if (FActive != active)
+	{
+		LOG_INFO(QString("Client state changed to=%1").arg(active ? "active" : "inactive"));
+		FActive = active;
+
+		foreach(IXmppStream *stream, FSupported)
+			if (stream->isOpen() && !stream->isSuspended())
+				sendClientState(stream);
+
+		emit activeChanged(active);
+	}
+}
+
+void ClientState::sendClientState(IXmppStream *AXmppStream)
+{
+	Stanza state(FActive ? "active" : "inactive");
+	state.setAttribute("xmlns",NS_FEATURE_CSI);
+	if (AXmppStream->sendStanza(state) >= 0)
+	{
+		LOG_STRM_DEBUG(AXmppStream->streamJid(),QString("Client state sent, state=%1").arg(state.tagName()));
+		if (!FActive && !FInactive.contains(AXmppStream))
+		{
+			FInactive += AXmppStream;
+			emit streamActiveChanged(AXmppStream->streamJid(),false);
+		}
+		else if (FActive && FInactive.contains(AXmppStream))
+		{
+			FInactive -= AXmppStream;
+			emit streamActiveChanged(AXmppStream->streamJid(),true);
+		}
+	}
+}
+
+bool ClientState::eventFilter(QObject *AObject, QEvent *AEvent)
+{
+	// Window state is changed in several steps when hiding to tray, so the state is updated after a while
+	if (AEvent->type()==QEvent::Show || AEvent->type()==QEvent::Hide || AEvent->type()==QEvent::WindowStateChange)
+		FUpdateTimer.start();
+	return QObject::eventFilter(AObject,AEvent);
+}
+
+void ClientState::onXmppStreamCreated(IXmppStream *AXmppStream)
+{
+	connect(AXmppStream->instance(),SIGNAL(resumed()),SLOT(onXmppStreamResumed()));
+}
+
+void ClientState::onXmppStreamOpened(IXmppStream *AXmppStream)
+{
+	// Server assumes the client is active on a new session
+	if (!FActive && FSupported.contains(AXmppStream))
+		sendClientState(AXmppStream);
+}
+
+void ClientState::onXmppStreamResumed()
+{
+	IXmppStream *stream = qobject_cast<IXmppStream *>(sender());
+	if (stream && FSupported.contains(stream))
+		sendClientState(stream);
+}
+
+void ClientState::onXmppStreamClosed(IXmppStream *AXmppStream)
+{
+	FSupported -= AXmppStream;
+	if (FInactive.contains(AXmppStream))
+	{
+		FInactive -= AXmppStream;
+		emit streamActiveChanged(AXmppStream->streamJid(),true);
+	}
+}
+
+void ClientState::onXmppStreamDestroyed(IXmppStream *AXmppStream)
+{
+	FSupported -= AXmppStream;
+	FInactive -= AXmppStream;
+}
+
+void ClientState::onSystemIdleChanged(int ASeconds)
+{
+	Q_UNUSED(ASeconds);
+	updateActiveState();
+}
+
+void ClientState::onOptionsChanged(const OptionsNode &ANode)
+{
+	if (ANode.path()==OPV_CLIENTSTATE_ENABLED || ANode.path()==OPV_CLIENTSTATE_IDLETIME)
+		updateActiveState();
+}
+
+void ClientState::onUpdateTimerTimeout()
+{
+	updateActiveState();
+}
+
+Q_EXPORT_PLUGIN2(plg_clientstate, ClientState)
@@ -0,0 +1,68 @@
+#ifndef CLIENTSTATE_H
+#define CLIENTSTATE_H
+
+#include <QTimer>
+#include <interfaces/ipluginmanager.h>
+#include <interfaces/iclientstate.h>
+#include <interfaces/ixmppstreams.h>
+#include <interfaces/imainwindow.h>
+#include <utils/options.h>
+
+class ClientState :
+	public QObject,
+	public IPlugin,
+	public IClientState,
+	public IXmppFeaturesPlugin
+{
+	Q_OBJECT;
+	Q_INTERFACES(IPlugin IClientState IXmppFeaturesPlugin);
+public:
+	ClientState();
+	~ClientState();
+	//IPlugin
+	virtual QObject *instance() { return this; }
+	virtual QUuid pluginUuid() const { return CLIENTSTATE_UUID; }
+	virtual void pluginInfo(IPluginInfo *APluginInfo);
+	virtual bool initConnections(IPluginManager *APluginManager, int &AInitOrder);
+	virtual bool initObjects();
+	virtual bool initSettings();
+	virtual bool startPlugin();
+	//IXmppFeaturesPlugin
+	virtual QList<QString> xmppFeatures() const;
+	virtual IXmppFeature *newXmppFeature(const QString &AFeatureNS, IXmppStream *AXmppStream);
+	//IClientState
+	virtual bool isActive() const;
+	virtual bool isSupported(const Jid &AStreamJid) const;
+	virtual bool isStreamActive(const Jid &AStreamJid) const;
+signals:
+	void featureCreated(IXmppFeature *AFeature);
+	void featureDestroyed(IXmppFeature *AFeature);
+	void activeChanged(bool AActive);
+	void streamActiveChanged(const Jid &AStreamJid, bool AActive);
+protected:
+	bool isMainWindowVisible() const;
+	void updateActiveState();
+	void sendClientState(IXmppStream *AXmppStream);
+protected:
+	bool eventFilter(QObject *AObject, QEvent *AEvent);
+protected slots:
+	void onXmppStreamCreated(IXmppStream *AXmppStream);
+	void onXmppStreamOpened(IXmppStream *AXmppStream);
+	void onXmppStreamResumed();
+	void onXmppStreamClosed(IXmppStream *AXmppStream);
+	void onXmppStreamDestroyed(IXmppStream *AXmppStream);
+protected slots:
+	void onSystemIdleChanged(int ASeconds);
+	void onOptionsChanged(const OptionsNode &ANode);
+	void onUpdateTimerTimeout();
+private:
+	IXmppStreams *FXmppStreams;
+	IMainWindowPlugin *FMainWindowPlugin;
+private:
+	bool FActive;
+	QTimer FUpdateTimer;
+	QSet<IXmppStream *> FSupported;
+	QSet<IXmppStream *> FInactive;
+};
+
+#endif // CLIENTSTATE_H
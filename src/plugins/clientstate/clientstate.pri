@@ -0,0 +1,3 @@
+HEADERS = clientstate.h
+
+SOURCES = clientstate.cpp
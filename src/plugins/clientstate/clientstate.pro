@@ -0,0 +1,3 @@
+TARGET = clientstate
+include(clientstate.pri)
+include(../plugins.inc)
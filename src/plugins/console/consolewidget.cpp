@@ -2,7 +2,10 @@
 
 #include <QRegExp>
 #include <QLineEdit>
+#include <QFileDialog>
 #include <QInputDialog>
+#include <QtConcurrentRun>
+#include <definitions/namespaces.h>
 #include <definitions/optionvalues.h>
 #include <definitions/resources.h>
 #include <definitions/menuicons.h>
@@ -15,6 +18,10 @@
 #define MAX_HILIGHT_ITEMS            10
 #define TEXT_SEARCH_TIMEOUT          500
 
+#define CONSOLE_BUFFER_ITEMS         5000
+#define CONSOLE_VIEW_ITEMS           1000
+#define FORMAT_STANZAS_TIMEOUT       100
+
 ConsoleWidget::ConsoleWidget(IPluginManager *APluginManager, QWidget *AParent) : QWidget(AParent)
 {
 	REPORT_VIEW;
@@ -25,8 +32,15 @@ ConsoleWidget::ConsoleWidget(IPluginManager *APluginManager, QWidget *AParent) :
 	FXmppStreams = NULL;
 	FStanzaProcessor = NULL;
 	
+	FCaptureFile = NULL;
 	FSearchMoveCursor = false;
 
+	FFormatGeneration = 0;
+	FFormatTimer.setSingleShot(true);
+	FFormatTimer.setInterval(FORMAT_STANZAS_TIMEOUT);
+	connect(&FFormatTimer,SIGNAL(timeout()),SLOT(onFormatTimerTimeout()));
+	connect(&FFormatWatcher,SIGNAL(finished()),SLOT(onFormatStanzasFinished()));
+
 	ui.cmbStreamJid->addItem(tr("<All Streams>"));
 	initialize(APluginManager);
 
@@ -40,6 +54,9 @@ ConsoleWidget::ConsoleWidget(IPluginManager *APluginManager, QWidget *AParent) :
 	palette.setColor(QPalette::Inactive,QPalette::HighlightedText,palette.color(QPalette::Active,QPalette::HighlightedText));
 	ui.tbrConsole->setPalette(palette);
 
+	// Each stanza takes caption and body blocks
+	ui.tbrConsole->document()->setMaximumBlockCount(CONSOLE_VIEW_ITEMS*2);
+
 	FTextHilightTimer.setSingleShot(true);
 	connect(&FTextHilightTimer,SIGNAL(timeout()),SLOT(onTextHilightTimerTimeout()));
 	connect(ui.tbrConsole,SIGNAL(visiblePositionBoundaryChanged()),SLOT(onTextVisiblePositionBoundaryChanged()));
@@ -57,13 +74,18 @@ ConsoleWidget::ConsoleWidget(IPluginManager *APluginManager, QWidget *AParent) :
 	connect(ui.tlbRemoveCondition,SIGNAL(clicked()),SLOT(onRemoveConditionClicked()));
 	connect(ui.tlbClearCondition,SIGNAL(clicked()),ui.ltwConditions,SLOT(clear()));
 	connect(ui.cmbCondition->lineEdit(),SIGNAL(returnPressed()),SLOT(onAddConditionClicked()));
+	connect(ui.ltwConditions->model(),SIGNAL(rowsInserted(const QModelIndex &, int, int)),SLOT(onFilterChanged()));
+	connect(ui.ltwConditions->model(),SIGNAL(rowsRemoved(const QModelIndex &, int, int)),SLOT(onFilterChanged()));
+	connect(ui.ltwConditions->model(),SIGNAL(modelReset()),SLOT(onFilterChanged()));
+	connect(ui.cmbStreamJid,SIGNAL(currentIndexChanged(int)),SLOT(onFilterChanged()));
 
 	connect(ui.tlbAddContext,SIGNAL(clicked()),SLOT(onAddContextClicked()));
 	connect(ui.tlbRemoveContext,SIGNAL(clicked()),SLOT(onRemoveContextClicked()));
 	connect(ui.cmbContext,SIGNAL(currentIndexChanged(int)),SLOT(onContextChanged(int)));
 
 	connect(ui.tlbSendXML,SIGNAL(clicked()),SLOT(onSendXMLClicked()));
-	connect(ui.tlbClearConsole,SIGNAL(clicked()),ui.tbrConsole,SLOT(clear()));
+	connect(ui.tlbCapture,SIGNAL(toggled(bool)),SLOT(onCaptureButtonToggled(bool)));
+	connect(ui.tlbClearConsole,SIGNAL(clicked()),SLOT(onClearConsoleClicked()));
 	connect(ui.tlbClearConsole,SIGNAL(clicked()),SLOT(onTextSearchStart()));
 	connect(ui.chbWordWrap,SIGNAL(toggled(bool)),SLOT(onWordWrapButtonToggled(bool)));
 }
@@ -74,19 +96,21 @@ ConsoleWidget::~ConsoleWidget()
 		stream->removeXmppStanzaHandler(XSHO_CONSOLE,this);
 	if (!Options::isNull())
 		onOptionsClosed();
+	stopCapture();
+	FFormatWatcher.waitForFinished();
 }
 
 bool ConsoleWidget::xmppStanzaIn(IXmppStream *AXmppStream, Stanza &AStanza, int AOrder)
 {
 	if (AOrder == XSHO_CONSOLE)
-		showElement(AXmppStream,AStanza.element(),false);
+		appendStanza(AXmppStream,AStanza,false);
 	return false;
 }
 
 bool ConsoleWidget::xmppStanzaOut(IXmppStream *AXmppStream, Stanza &AStanza, int AOrder)
 {
 	if (AOrder == XSHO_CONSOLE)
-		showElement(AXmppStream,AStanza.element(),true);
+		appendStanza(AXmppStream,AStanza,true);
 	return false;
 }
 
@@ -167,7 +191,84 @@ void ConsoleWidget::saveContext(const QUuid &AContextId)
 	Options::setFileValue(ui.sptVSplitter->saveState(),"console.context.vsplitter-state",AContextId.toString());
 }
 
-void ConsoleWidget::colorXml(QString &AXml) const
+void ConsoleWidget::appendStanza(IXmppStream *AXmppStream, const Stanza &AStanza, bool ASended)
+{
+	ConsoleStanza item;
+	item.time = QDateTime::currentDateTime();
+	item.streamJid = AXmppStream->streamJid();
+	item.sended = ASended;
+	item.xml = AStanza.toByteArray();
+
+	if (FCaptureFile != NULL)
+	{
+		ConsoleStanza capture = item;
+		capture.xml = hideCredentials(AStanza);
+		writeCapture(capture);
+	}
+
+	FStanzaBuffer.append(item);
+	if (FStanzaBuffer.count() > CONSOLE_BUFFER_ITEMS)
+		FStanzaBuffer.removeFirst();
+
+	FPendingStanzas.append(item);
+	if (FPendingStanzas.count() > CONSOLE_BUFFER_ITEMS)
+		FPendingStanzas.removeFirst();
+
+	if (!FFormatTimer.isActive())
+		FFormatTimer.start();
+}
+
+void ConsoleWidget::writeCapture(const ConsoleStanza &AStanza)
+{
+	QByteArray xml = AStanza.xml;
+	if (xml.contains("<password"))
+	{
+		QString text = QString::fromUtf8(xml);
+		hidePasswords(text);
+		xml = text.toUtf8();
+	}
+
+	// <msecs> <in|out> <stream jid> <size>\n<xml>\n
+	QByteArray header = QString("%1 %2 %3 %4\n").arg(AStanza.time.toMSecsSinceEpoch()).arg(AStanza.sended ? "out" : "in").arg(AStanza.streamJid.pFull()).arg(xml.size()).toUtf8();
+	if (FCaptureFile->write(header)<0 || FCaptureFile->write(xml)<0 || FCaptureFile->write("\n")<0)
+	{
+		LOG_WARNING(QString("Failed to write console capture to file=%1: %2").arg(FCaptureFile->fileName(),FCaptureFile->errorString()));
+		ui.tlbCapture->setChecked(false);
+	}
+}
+
+bool ConsoleWidget::startCapture(const QString &AFileName)
+{
+	stopCapture();
+
+	FCaptureFile = new QFile(AFileName,this);
+	if (FCaptureFile->open(QFile::WriteOnly|QFile::Append))
+	{
+		// Stanza log has no stream header and can not be replayed as traffic capture
+		if (FCaptureFile->size() == 0)
+			FCaptureFile->write("# vacuum-im console stanza log\n");
+		LOG_INFO(QString("Console capture started to file=%1").arg(AFileName));
+		return true;
+	}
+	
+	LOG_WARNING(QString("Failed to start console capture to file=%1: %2").arg(AFileName,FCaptureFile->errorString()));
+	delete FCaptureFile;
+	FCaptureFile = NULL;
+	return false;
+}
+
+void ConsoleWidget::stopCapture()
+{
+	if (FCaptureFile != NULL)
+	{
+		LOG_INFO(QString("Console capture stopped, file=%1").arg(FCaptureFile->fileName()));
+		FCaptureFile->close();
+		delete FCaptureFile;
+		FCaptureFile = NULL;
+	}
+}
+
+void ConsoleWidget::colorXml(QString &AXml)
 {
 	static const struct { const char *regexp ; const char *replace; bool minimal;} changes[] =
 	{
@@ -192,45 +293,118 @@ void ConsoleWidget::colorXml(QString &AXml) const
 	}
 }
 
-void ConsoleWidget::hidePasswords(QString &AXml) const
+void ConsoleWidget::hidePasswords(QString &AXml)
 {
-	static const QRegExp passRegExp("<password>.*</password>", Qt::CaseInsensitive);
+	// Called from console formatting thread too
+	const QRegExp passRegExp("<password>.*</password>", Qt::CaseInsensitive);
 	static const QString passNewStr = "<password>[password]</password>";
 	AXml.replace(passRegExp,passNewStr);
 }
 
-void ConsoleWidget::showElement(IXmppStream *AXmppStream, const QDomElement &AElem, bool ASended)
+QByteArray ConsoleWidget::hideCredentials(const Stanza &AStanza)
+{
+	// SASL payloads and legacy auth or register fields may contain the password in clear
+	QDomElement elem = AStanza.element();
+	bool isSasl = elem.namespaceURI()==NS_FEATURE_SASL || elem.attribute("xmlns")==NS_FEATURE_SASL;
+	bool isQuery = !AStanza.firstElement("query",NS_JABBER_IQ_AUTH).isNull() || !AStanza.firstElement("query",NS_JABBER_REGISTER).isNull();
+	if (isSasl || isQuery)
+	{
+		Stanza stanza = AStanza;
+		stanza.detach();
+
+		QList<QDomElement> secretElems;
+		if (isSasl)
+		{
+			secretElems.append(stanza.element());
+		}
+		else
+		{
+			QDomElement queryElem = stanza.firstElement("query",NS_JABBER_IQ_AUTH);
+			if (queryElem.isNull())
+				queryElem = stanza.firstElement("query",NS_JABBER_REGISTER);
+			for (QDomElement fieldElem = queryElem.firstChildElement(); !fieldElem.isNull(); fieldElem = fieldElem.nextSiblingElement())
+				secretElems.append(fieldElem);
+		}
+
+		foreach(QDomElement secretElem, secretElems)
+		{
+			if (secretElem.hasChildNodes())
+			{
+				while (secretElem.hasChildNodes())
+					secretElem.removeChild(secretElem.firstChild());
+				secretElem.appendChild(stanza.createTextNode("[hidden]"));
+			}
+		}
+		return stanza.toByteArray();
+	}
+	return AStanza.toByteArray();
+}
+
+ConsoleFormatResult ConsoleWidget::formatStanzas(const ConsoleFormatTask &ATask, IStanzaProcessor *AProcessor)
 {
-	Jid streamJid = ui.cmbStreamJid->currentIndex()>0 ? ui.cmbStreamJid->itemData(ui.cmbStreamJid->currentIndex()).toString() : QString::null;
-	if (streamJid.isEmpty() || streamJid==AXmppStream->streamJid())
+	const QString sended =   Qt::escape(">>>>") + " <b>%1</b> %2 +%3 " + Qt::escape(">>>>");
+	const QString received = Qt::escape("<<<<") + " <b>%1</b> %2 +%3 " + Qt::escape("<<<<");
+
+	ConsoleFormatResult result;
+	result.generation = ATask.generation;
+	result.lastTime = ATask.lastTime;
+
+	// Only the newest stanzas will fit into the console, so go backwards
+	bool truncated = false;
+	QList<int> accepted;
+	QStringList bodies;
+	for (int index=ATask.stanzas.count()-1; index>=0; index--)
 	{
-		Stanza stanza(AElem);
-		bool accepted = FStanzaProcessor==NULL || ui.ltwConditions->count()==0;
-		for (int i=0; !accepted && i<ui.ltwConditions->count(); i++)
-			accepted = FStanzaProcessor->checkStanza(stanza,ui.ltwConditions->item(i)->text());
+		if (accepted.count() >= CONSOLE_VIEW_ITEMS)
+		{
+			truncated = true;
+			break;
+		}
 
-		if (accepted)
+		const ConsoleStanza &item = ATask.stanzas.at(index);
+		if (ATask.streamJid.isEmpty() || ATask.streamJid==item.streamJid)
 		{
-			static QString sended =   Qt::escape(">>>>") + " <b>%1</b> %2 +%3 " + Qt::escape(">>>>");
-			static QString received = Qt::escape("<<<<") + " <b>%1</b> %2 +%3 " + Qt::escape("<<<<");
-
-			int delta = FTimePoint.isValid() ? FTimePoint.msecsTo(QTime::currentTime()) : 0;
-			FTimePoint = QTime::currentTime();
-			QString caption = (ASended ? sended : received).arg(Qt::escape(AXmppStream->streamJid().uFull())).arg(FTimePoint.toString()).arg(delta);
-			ui.tbrConsole->append(caption);
-
-			QString xml = stanza.toString(2);
-			hidePasswords(xml);
-			xml = "<pre>"+Qt::escape(xml).replace('\n',"<br>")+"</pre>";
-			if (ui.chbHilightXML->checkState() == Qt::Checked)
-				colorXml(xml);
-			else if (ui.chbHilightXML->checkState()==Qt::PartiallyChecked && xml.size()<5000)
-				colorXml(xml);
-			ui.tbrConsole->append(xml);
-
-			ui.lneTextSearch->restartTimeout(ui.lneTextSearch->startSearchTimeout());
+			QDomDocument doc;
+			if (doc.setContent(item.xml,true))
+			{
+				Stanza stanza(doc.documentElement());
+				bool accept = AProcessor==NULL || ATask.conditions.isEmpty();
+				for (int i=0; !accept && i<ATask.conditions.count(); i++)
+					accept = AProcessor->checkStanza(stanza,ATask.conditions.at(i));
+
+				if (accept)
+				{
+					QString xml = stanza.toString(2);
+					hidePasswords(xml);
+					xml = "<pre>"+Qt::escape(xml).replace('\n',"<br>")+"</pre>";
+					if (ATask.highlight == Qt::Checked)
+						colorXml(xml);
+					else if (ATask.highlight==Qt::PartiallyChecked && xml.size()<5000)
+						colorXml(xml);
+
+					accepted.prepend(index);
+					bodies.prepend(xml);
+				}
+			}
 		}
 	}
+
+	QDateTime timePoint = ATask.lastTime;
+	if (truncated && !accepted.isEmpty() && accepted.first()>0)
+		timePoint = ATask.stanzas.at(accepted.first()-1).time;
+
+	for (int i=0; i<accepted.count(); i++)
+	{
+		const ConsoleStanza &item = ATask.stanzas.at(accepted.at(i));
+		qint64 delta = timePoint.isValid() ? timePoint.msecsTo(item.time) : 0;
+		timePoint = item.time;
+
+		result.html.append((item.sended ? sended : received).arg(Qt::escape(item.streamJid.uFull())).arg(item.time.time().toString()).arg(delta));
+		result.html.append(bodies.at(i));
+	}
+	result.lastTime = timePoint;
+
+	return result;
 }
 
 void ConsoleWidget::onAddConditionClicked()
@@ -309,6 +483,75 @@ void ConsoleWidget::onWordWrapButtonToggled(bool AChecked)
 	ui.tbrConsole->setLineWrapMode(AChecked ? QTextEdit::WidgetWidth : QTextEdit::NoWrap);
 }
 
+void ConsoleWidget::onCaptureButtonToggled(bool AChecked)
+{
+	if (AChecked && FCaptureFile==NULL)
+	{
+		QString fileName = QFileDialog::getSaveFileName(this,tr("Capture Stanzas to File"),QString::null,"*.xlog");
+		if (fileName.isEmpty() || !startCapture(fileName))
+			ui.tlbCapture->setChecked(false);
+	}
+	else if (!AChecked)
+	{
+		stopCapture();
+	}
+}
+
+void ConsoleWidget::onClearConsoleClicked()
+{
+	FFormatGeneration++;
+	FStanzaBuffer.clear();
+	FPendingStanzas.clear();
+	FLastShownTime = QDateTime();
+	ui.tbrConsole->clear();
+}
+
+void ConsoleWidget::onFilterChanged()
+{
+	// Show buffered stanzas again with the new filter
+	FFormatGeneration++;
+	FPendingStanzas = FStanzaBuffer;
+	FLastShownTime = QDateTime();
+	ui.tbrConsole->clear();
+	FFormatTimer.start();
+}
+
+void ConsoleWidget::onFormatTimerTimeout()
+{
+	if (FCaptureFile != NULL)
+		FCaptureFile->flush();
+
+	if (!FPendingStanzas.isEmpty() && !FFormatWatcher.isRunning())
+	{
+		ConsoleFormatTask task;
+		task.generation = FFormatGeneration;
+		task.streamJid = ui.cmbStreamJid->currentIndex()>0 ? ui.cmbStreamJid->itemData(ui.cmbStreamJid->currentIndex()).toString() : QString::null;
+		task.highlight = ui.chbHilightXML->checkState();
+		for (int i=0; i<ui.ltwConditions->count(); i++)
+			task.conditions.append(ui.ltwConditions->item(i)->text());
+		task.lastTime = FLastShownTime;
+		task.stanzas = FPendingStanzas;
+		FPendingStanzas.clear();
+
+		FFormatWatcher.setFuture(QtConcurrent::run(formatStanzas,task,FStanzaProcessor));
+	}
+}
+
+void ConsoleWidget::onFormatStanzasFinished()
+{
+	ConsoleFormatResult result = FFormatWatcher.result();
+	if (result.generation==FFormatGeneration && !result.html.isEmpty())
+	{
+		FLastShownTime = result.lastTime;
+		foreach(const QString &html, result.html)
+			ui.tbrConsole->append(html);
+		ui.lneTextSearch->restartTimeout(ui.lneTextSearch->startSearchTimeout());
+	}
+
+	if (!FPendingStanzas.isEmpty())
+		FFormatTimer.start();
+}
+
 void ConsoleWidget::onTextHilightTimerTimeout()
 {
 	if (FSearchResults.count() > MAX_HILIGHT_ITEMS)
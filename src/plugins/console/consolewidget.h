@@ -1,12 +1,40 @@
 #ifndef CONSOLEWIDGET_H
 #define CONSOLEWIDGET_H
 
+#include <QFile>
 #include <QWidget>
+#include <QDateTime>
+#include <QFutureWatcher>
 #include <interfaces/ipluginmanager.h>
 #include <interfaces/ixmppstreams.h>
 #include <interfaces/istanzaprocessor.h>
 #include "ui_consolewidget.h"
 
+struct ConsoleStanza
+{
+	QDateTime time;
+	Jid streamJid;
+	bool sended;
+	QByteArray xml;
+};
+
+struct ConsoleFormatTask
+{
+	int generation;
+	Jid streamJid;
+	int highlight;
+	QStringList conditions;
+	QDateTime lastTime;
+	QList<ConsoleStanza> stanzas;
+};
+
+struct ConsoleFormatResult
+{
+	int generation;
+	QDateTime lastTime;
+	QStringList html;
+};
+
 class ConsoleWidget :
 	public QWidget,
 	public IXmppStanzaHadler
@@ -23,9 +51,15 @@ protected:
 	void initialize(IPluginManager *APluginManager);
 	void loadContext(const QUuid &AContextId);
 	void saveContext(const QUuid &AContextId);
-	void colorXml(QString &AXml) const;
-	void hidePasswords(QString &AXml) const;
-	void showElement(IXmppStream *AXmppStream, const QDomElement &AElem, bool ASended);
+	void appendStanza(IXmppStream *AXmppStream, const Stanza &AStanza, bool ASended);
+	void writeCapture(const ConsoleStanza &AStanza);
+	bool startCapture(const QString &AFileName);
+	void stopCapture();
+protected:
+	static void colorXml(QString &AXml);
+	static void hidePasswords(QString &AXml);
+	static QByteArray hideCredentials(const Stanza &AStanza);
+	static ConsoleFormatResult formatStanzas(const ConsoleFormatTask &ATask, IStanzaProcessor *AProcessor);
 protected slots:
 	void onAddConditionClicked();
 	void onRemoveConditionClicked();
@@ -34,6 +68,12 @@ protected slots:
 	void onRemoveContextClicked();
 	void onContextChanged(int AIndex);
 	void onWordWrapButtonToggled(bool AChecked);
+	void onCaptureButtonToggled(bool AChecked);
+	void onClearConsoleClicked();
+protected slots:
+	void onFilterChanged();
+	void onFormatTimerTimeout();
+	void onFormatStanzasFinished();
 protected slots:
 	void onTextHilightTimerTimeout();
 	void onTextVisiblePositionBoundaryChanged();
@@ -55,7 +95,14 @@ private:
 	IStanzaProcessor *FStanzaProcessor;
 private:
 	QUuid FContext;
-	QTime FTimePoint;
+	QFile *FCaptureFile;
+private:
+	int FFormatGeneration;
+	QTimer FFormatTimer;
+	QDateTime FLastShownTime;
+	QList<ConsoleStanza> FStanzaBuffer;
+	QList<ConsoleStanza> FPendingStanzas;
+	QFutureWatcher<ConsoleFormatResult> FFormatWatcher;
 private:
 	bool FSearchMoveCursor;
 	QTimer FTextHilightTimer;
@@ -100,11 +100,16 @@ bool Emoticons::initSettings()
 	return true;
 }
 
-void Emoticons::writeTextToMessage(int AOrder, Message &AMessage, QTextDocument *ADocument, const QString &ALang)
+bool Emoticons::checkMessageToText(int AOrder, const Message &AMessage, const QString &ALang)
 {
-	Q_UNUSED(AMessage); Q_UNUSED(ALang);
 	if (AOrder == MWO_EMOTICONS)
-		replaceImageToText(ADocument);
+	{
+		QString body = AMessage.body(ALang);
+		for (const QChar *ch = body.constData(), *end = ch+body.length(); ch<end; ++ch)
+			if (FRootTreeItem.childs.contains(*ch))
+				return true;
+	}
+	return false;
 }
 
 void Emoticons::writeMessageToText(int AOrder, Message &AMessage, QTextDocument *ADocument, const QString &ALang)
@@ -114,6 +119,25 @@ void Emoticons::writeMessageToText(int AOrder, Message &AMessage, QTextDocument
 		replaceTextToImage(ADocument);
 }
 
+bool Emoticons::checkTextToMessage(int AOrder, const QTextDocument *ADocument, const QString &ALang)
+{
+	Q_UNUSED(ALang);
+	if (AOrder == MWO_EMOTICONS)
+	{
+		foreach(const QTextFormat &format, ADocument->allFormats())
+			if (format.isImageFormat())
+				return true;
+	}
+	return false;
+}
+
+void Emoticons::writeTextToMessage(int AOrder, Message &AMessage, QTextDocument *ADocument, const QString &ALang)
+{
+	Q_UNUSED(AMessage); Q_UNUSED(ALang);
+	if (AOrder == MWO_EMOTICONS)
+		replaceImageToText(ADocument);
+}
+
 QMultiMap<int, IOptionsWidget *> Emoticons::optionsWidgets(const QString &ANodeId, QWidget *AParent)
 {
 	QMultiMap<int, IOptionsWidget *> widgets;
@@ -38,8 +38,10 @@ public:
 	virtual bool initSettings();
 	virtual bool startPlugin() { return true; }
 	//IMessageWriter
-	virtual void writeTextToMessage(int AOrder, Message &AMessage, QTextDocument *ADocument, const QString &ALang);
+	virtual bool checkMessageToText(int AOrder, const Message &AMessage, const QString &ALang);
 	virtual void writeMessageToText(int AOrder, Message &AMessage, QTextDocument *ADocument, const QString &ALang);
+	virtual bool checkTextToMessage(int AOrder, const QTextDocument *ADocument, const QString &ALang);
+	virtual void writeTextToMessage(int AOrder, Message &AMessage, QTextDocument *ADocument, const QString &ALang);
 	//IOptionsHolder
 	virtual QMultiMap<int, IOptionsWidget *> optionsWidgets(const QString &ANodeId, QWidget *AParent);
 	//IMessageEditContentsHandler
@@ -2,9 +2,22 @@
 
 #include <QMutexLocker>
 #include <QDirIterator>
+#include <QElapsedTimer>
+#include <QtConcurrentMap>
 #include <definitions/statisticsparams.h>
 #include <utils/logger.h>
 
+#define SYNC_HEADERS_BATCH        1000
+#define SYNC_PROGRESS_INTERVAL    10*1000
+
+struct LoadFileHeader
+{
+	typedef IArchiveHeader result_type;
+	LoadFileHeader(IFileMessageArchive *AFileArchive) : FFileArchive(AFileArchive) {}
+	IArchiveHeader operator()(const QString &AFilePath) const { return FFileArchive->loadFileHeader(AFilePath); }
+	IFileMessageArchive *FFileArchive;
+};
+
 DatabaseSynchronizer::DatabaseSynchronizer(IFileMessageArchive *AFileArchive, DatabaseWorker *ADatabaseWorker, QObject *AParent) : QThread(AParent)
 {
 	FQuit = false;
@@ -79,8 +92,18 @@ void DatabaseSynchronizer::run()
 			}
 			delete loadTask;
 
+			int dirsCount = 0;
+			int filesCount = 0;
+			int parsedCount = 0;
+			int changedCount = 0;
+			QElapsedTimer progressTimer;
+			progressTimer.start();
+
+			QStringList newGateTypes;
+			QList<IArchiveHeader> newHeaders;
+			QList<IArchiveHeader> difHeaders;
+			QList<IArchiveHeader> oldHeaders;
 
-			QHash<Jid, QList<IArchiveHeader> > fileHeadersMap;
 			QDirIterator bareIt(archivePath,QDir::Dirs|QDir::NoDotAndDotDot);
 			while (!FQuit && !syncFailed && bareIt.hasNext())
 			{
@@ -90,131 +113,106 @@ void DatabaseSynchronizer::run()
 				bool isGated = bareWith.pDomain().endsWith(".gateway");
 				int pathLength = bareIt.filePath().length()-bareIt.fileName().length();
 
+				QStringList loadFiles;
 				while (filesIt.hasNext())
 				{
 					filesIt.next();
+					filesCount++;
 					QDateTime fileLastModified = filesIt.fileInfo().lastModified();
 					if (fileLastModified < syncTime)
 					{
 						QString fileName = filesIt.filePath().mid(pathLength).toLower();
 						QHash<QString, DatabaseArchiveHeader>::iterator dbHeaderIt = databaseFileHeaders.find(fileName);
 						if (dbHeaderIt==databaseFileHeaders.end() || dbHeaderIt->timestamp<fileLastModified)
-						{
-							IArchiveHeader header = FFileArchive->loadFileHeader(filesIt.filePath());
-							if (header.with.isValid() && header.start.isValid() && !fileHeadersMap.value(header.with).contains(header))
-							{
-								if (!isGated && header.with.pBare()==bareWith.pBare())
-									fileHeadersMap[header.with].append(header);
-								else if (isGated && header.with.pNode()==bareWith.pNode())
-									fileHeadersMap[header.with].append(header);
-							}
-						}
+							loadFiles.append(filesIt.filePath());
 						else
-						{
 							databaseFileHeaders.erase(dbHeaderIt);
-						}
 					}
 				}
-			}
-
 
-			for (QHash<Jid, QList<IArchiveHeader> >::iterator it=fileHeadersMap.begin(); !FQuit && !syncFailed && it!=fileHeadersMap.end(); ++it)
-			{
-				Jid with = it.key();
-
-				QList<IArchiveHeader> newHeaders;
-				QList<IArchiveHeader> difHeaders;
-				QList<IArchiveHeader> oldHeaders;
-
-				QList<IArchiveHeader> &fileHeaders = it.value();
-				qSort(fileHeaders.begin(),fileHeaders.end());
+				// Headers of changed files are parsed by global thread pool
+				QList<IArchiveHeader> loadedHeaders = QtConcurrent::blockingMapped<QList<IArchiveHeader> >(loadFiles,LoadFileHeader(FFileArchive));
+				parsedCount += loadedHeaders.count();
 
-				QList<IArchiveHeader> databaseHeaders;
-				foreach(const QString &fileName, databaseHeadersMap.take(with))
+				QHash<Jid, QList<IArchiveHeader> > fileHeadersMap;
+				foreach(const IArchiveHeader &header, loadedHeaders)
 				{
-					QHash<QString, DatabaseArchiveHeader>::const_iterator dbHeaderIt = databaseFileHeaders.constFind(fileName);
-					if (dbHeaderIt != databaseFileHeaders.constEnd())
-						databaseHeaders.append(dbHeaderIt.value());
+					if (header.with.isValid() && header.start.isValid() && !fileHeadersMap.value(header.with).contains(header))
+					{
+						if (!isGated && header.with.pBare()==bareWith.pBare())
+							fileHeadersMap[header.with].append(header);
+						else if (isGated && header.with.pNode()==bareWith.pNode())
+							fileHeadersMap[header.with].append(header);
+					}
 				}
-				qSort(databaseHeaders.begin(),databaseHeaders.end());
 
-				if (databaseHeaders.isEmpty())
+				for (QHash<Jid, QList<IArchiveHeader> >::iterator it=fileHeadersMap.begin(); it!=fileHeadersMap.end(); ++it)
 				{
-					newHeaders = fileHeaders;
-				}
-				else if (fileHeaders.isEmpty())
-				{
-					oldHeaders = databaseHeaders;
-				}
-				else while (!fileHeaders.isEmpty() || !databaseHeaders.isEmpty())
-				{
-					if (fileHeaders.isEmpty())
-					{
-						oldHeaders += databaseHeaders.takeFirst();
-					}
-					else if (databaseHeaders.isEmpty())
-					{
-						newHeaders += fileHeaders.takeFirst();
-					}
-					else if (fileHeaders.first() < databaseHeaders.first())
-					{
-						newHeaders += fileHeaders.takeFirst();
-					}
-					else if (databaseHeaders.first() < fileHeaders.first())
-					{
-						oldHeaders += databaseHeaders.takeFirst();
-					}
-					else if (fileHeaders.first().version != databaseHeaders.first().version)
-					{
-						difHeaders += fileHeaders.takeFirst();
-						databaseHeaders.removeFirst();
-					}
-					else
+					Jid with = it.key();
+
+					QList<IArchiveHeader> &fileHeaders = it.value();
+					qSort(fileHeaders.begin(),fileHeaders.end());
+
+					QList<IArchiveHeader> databaseHeaders;
+					foreach(const QString &fileName, databaseHeadersMap.take(with))
 					{
-						fileHeaders.removeFirst();
-						databaseHeaders.removeFirst();
+						QHash<QString, DatabaseArchiveHeader>::const_iterator dbHeaderIt = databaseFileHeaders.constFind(fileName);
+						if (dbHeaderIt != databaseFileHeaders.constEnd())
+							databaseHeaders.append(dbHeaderIt.value());
 					}
-				}
+					qSort(databaseHeaders.begin(),databaseHeaders.end());
 
-				if (!syncFailed && !newHeaders.isEmpty())
-				{
 					QString gateType = !with.node().isEmpty() ? FFileArchive->contactGateType(with) : QString::null;
-					DatabaseTaskInsertHeaders *insertTask = new DatabaseTaskInsertHeaders(streamJid,newHeaders,gateType);
-					if (!FDatabaseWorker->execTask(insertTask) || insertTask->isFailed())
+					while (!fileHeaders.isEmpty() || !databaseHeaders.isEmpty())
 					{
-						syncFailed = true;
-						REPORT_ERROR("Failed to synchronize file archive database: New headers not inserted");
+						if (fileHeaders.isEmpty())
+						{
+							oldHeaders += databaseHeaders.takeFirst();
+						}
+						else if (databaseHeaders.isEmpty())
+						{
+							newHeaders += fileHeaders.takeFirst();
+							newGateTypes += gateType;
+						}
+						else if (fileHeaders.first() < databaseHeaders.first())
+						{
+							newHeaders += fileHeaders.takeFirst();
+							newGateTypes += gateType;
+						}
+						else if (databaseHeaders.first() < fileHeaders.first())
+						{
+							oldHeaders += databaseHeaders.takeFirst();
+						}
+						else if (fileHeaders.first().version != databaseHeaders.first().version)
+						{
+							difHeaders += fileHeaders.takeFirst();
+							databaseHeaders.removeFirst();
+						}
+						else
+						{
+							fileHeaders.removeFirst();
+							databaseHeaders.removeFirst();
+						}
 					}
-					delete insertTask;
 				}
 
-				if (!syncFailed && !difHeaders.isEmpty())
+				dirsCount++;
+				if (newHeaders.count()+difHeaders.count()+oldHeaders.count() >= SYNC_HEADERS_BATCH)
 				{
-					DatabaseTaskUpdateHeaders *updateTask = new DatabaseTaskUpdateHeaders(streamJid,difHeaders);
-					if (!FDatabaseWorker->execTask(updateTask) || updateTask->isFailed())
-					{
-						syncFailed = true;
-						REPORT_ERROR("Failed to synchronize file archive database: Changed headers not updated");
-					}
-					delete updateTask;
+					changedCount += newHeaders.count()+difHeaders.count()+oldHeaders.count();
+					syncFailed = !saveHeaders(streamJid,newHeaders,newGateTypes,difHeaders,oldHeaders);
 				}
 
-				if (!syncFailed && !oldHeaders.isEmpty())
+				if (progressTimer.elapsed() >= SYNC_PROGRESS_INTERVAL)
 				{
-					DatabaseTaskRemoveHeaders *removeTask = new DatabaseTaskRemoveHeaders(streamJid,oldHeaders);
-					if (!FDatabaseWorker->execTask(removeTask) || removeTask->isFailed())
-					{
-						syncFailed = true;
-						REPORT_ERROR("Failed to synchronize file archive database: Old headers not removed");
-					}
-					delete removeTask;
+					LOG_STRM_INFO(streamJid,QString("Database synchronization progress, dirs=%1, files=%2, parsed=%3, changed=%4").arg(dirsCount).arg(filesCount).arg(parsedCount).arg(changedCount));
+					progressTimer.restart();
 				}
 			}
 
 
 			for (QHash<Jid, QList<QString> >::const_iterator it=databaseHeadersMap.constBegin(); !FQuit && !syncFailed && it!=databaseHeadersMap.constEnd(); ++it)
 			{
-				QList<IArchiveHeader> oldHeaders;
 				foreach(const QString &fileName, it.value())
 				{
 					QHash<QString, DatabaseArchiveHeader>::const_iterator dbHeaderIt = databaseFileHeaders.constFind(fileName);
@@ -222,17 +220,20 @@ void DatabaseSynchronizer::run()
 						oldHeaders.append(dbHeaderIt.value());
 				}
 
-				if (!oldHeaders.isEmpty())
+				if (oldHeaders.count() >= SYNC_HEADERS_BATCH)
 				{
-					DatabaseTaskRemoveHeaders *removeTask = new DatabaseTaskRemoveHeaders(streamJid,oldHeaders);
-					if (!FDatabaseWorker->execTask(removeTask) || removeTask->isFailed())
-					{
-						syncFailed = true;
-						REPORT_ERROR("Failed to synchronize file archive database: Old headers not removed");
-					}
-					delete removeTask;
+					changedCount += oldHeaders.count();
+					syncFailed = !saveHeaders(streamJid,newHeaders,newGateTypes,difHeaders,oldHeaders);
 				}
 			}
+
+			if (!FQuit && !syncFailed)
+			{
+				changedCount += newHeaders.count()+difHeaders.count()+oldHeaders.count();
+				syncFailed = !saveHeaders(streamJid,newHeaders,newGateTypes,difHeaders,oldHeaders);
+			}
+
+			LOG_STRM_INFO(streamJid,QString("Database synchronization processed, dirs=%1, files=%2, parsed=%3, changed=%4").arg(dirsCount).arg(filesCount).arg(parsedCount).arg(changedCount));
 		}
 		else
 		{
@@ -249,3 +250,48 @@ void DatabaseSynchronizer::run()
 		locker.relock();
 	}
 }
+
+bool DatabaseSynchronizer::saveHeaders(const Jid &AStreamJid, QList<IArchiveHeader> &ANewHeaders, QStringList &ANewGateTypes, QList<IArchiveHeader> &ADifHeaders, QList<IArchiveHeader> &AOldHeaders)
+{
+	bool saved = true;
+
+	if (saved && !ANewHeaders.isEmpty())
+	{
+		DatabaseTaskInsertHeaders *insertTask = new DatabaseTaskInsertHeaders(AStreamJid,ANewHeaders,ANewGateTypes);
+		if (!FDatabaseWorker->execTask(insertTask) || insertTask->isFailed())
+		{
+			saved = false;
+			REPORT_ERROR("Failed to synchronize file archive database: New headers not inserted");
+		}
+		delete insertTask;
+	}
+
+	if (saved && !ADifHeaders.isEmpty())
+	{
+		DatabaseTaskUpdateHeaders *updateTask = new DatabaseTaskUpdateHeaders(AStreamJid,ADifHeaders);
+		if (!FDatabaseWorker->execTask(updateTask) || updateTask->isFailed())
+		{
+			saved = false;
+			REPORT_ERROR("Failed to synchronize file archive database: Changed headers not updated");
+		}
+		delete updateTask;
+	}
+
+	if (saved && !AOldHeaders.isEmpty())
+	{
+		DatabaseTaskRemoveHeaders *removeTask = new DatabaseTaskRemoveHeaders(AStreamJid,AOldHeaders);
+		if (!FDatabaseWorker->execTask(removeTask) || removeTask->isFailed())
+		{
+			saved = false;
+			REPORT_ERROR("Failed to synchronize file archive database: Old headers not removed");
+		}
+		delete removeTask;
+	}
+
+	ANewHeaders.clear();
+	ANewGateTypes.clear();
+	ADifHeaders.clear();
+	AOldHeaders.clear();
+
+	return saved;
+}
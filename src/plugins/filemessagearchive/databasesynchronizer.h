@@ -22,6 +22,7 @@ signals:
 	void syncFinished(const Jid &AStreamJid, bool AFailed);
 protected:
 	void run();
+	bool saveHeaders(const Jid &AStreamJid, QList<IArchiveHeader> &ANewHeaders, QStringList &ANewGateTypes, QList<IArchiveHeader> &ADifHeaders, QList<IArchiveHeader> &AOldHeaders);
 private:
 	bool FQuit;
 	QMutex FMutex;
@@ -441,6 +441,12 @@ DatabaseTaskInsertHeaders::DatabaseTaskInsertHeaders(const Jid &AStreamJid, cons
 	FGateType = AGateType;
 }
 
+DatabaseTaskInsertHeaders::DatabaseTaskInsertHeaders(const Jid &AStreamJid, const QList<IArchiveHeader> &AHeaders, const QStringList &AGateTypes) : DatabaseTask(AStreamJid,InsertHeaders)
+{
+	FHeaders = AHeaders;
+	FGateTypes = AGateTypes;
+}
+
 QList<IArchiveHeader> DatabaseTaskInsertHeaders::headers() const
 {
 	return FHeaders;
@@ -468,8 +474,9 @@ void DatabaseTaskInsertHeaders::run()
 		else if (!FHeaders.isEmpty())
 		{
 			db.transaction();
-			foreach(const IArchiveHeader &header, FHeaders)
+			for (int i=0; i<FHeaders.count(); i++)
 			{
+				const IArchiveHeader &header = FHeaders.at(i);
 				QString timestamp = DateTime(QDateTime::currentDateTime()).toX85UTC();
 
 				bindQueryValue(insertQuery,":with_n",header.with.pNode());
@@ -479,7 +486,7 @@ void DatabaseTaskInsertHeaders::run()
 				bindQueryValue(insertQuery,":subject",header.subject);
 				bindQueryValue(insertQuery,":thread",header.threadId);
 				bindQueryValue(insertQuery,":version",header.version);
-				bindQueryValue(insertQuery,":gateway",FGateType);
+				bindQueryValue(insertQuery,":gateway",FGateTypes.value(i,FGateType));
 				bindQueryValue(insertQuery,":timestamp",timestamp);
 
 				bindQueryValue(modifyQuery,":timestamp",timestamp);
@@ -518,6 +525,13 @@ DatabaseTaskUpdateHeaders::DatabaseTaskUpdateHeaders(const Jid &AStreamJid, cons
 	FInsertIfNotExist = AInsertIfNotExist;
 }
 
+DatabaseTaskUpdateHeaders::DatabaseTaskUpdateHeaders(const Jid &AStreamJid, const QList<IArchiveHeader> &AHeaders, const QStringList &AGateTypes) : DatabaseTask(AStreamJid,UpdateHeaders)
+{
+	FHeaders = AHeaders;
+	FGateTypes = AGateTypes;
+	FInsertIfNotExist = true;
+}
+
 QList<IArchiveHeader> DatabaseTaskUpdateHeaders::headers() const
 {
 	return FHeaders;
@@ -552,8 +566,9 @@ void DatabaseTaskUpdateHeaders::run()
 		else if (!FHeaders.isEmpty())
 		{
 			db.transaction();
-			foreach(const IArchiveHeader &header, FHeaders)
+			for (int i=0; i<FHeaders.count(); i++)
 			{
+				const IArchiveHeader &header = FHeaders.at(i);
 				QString timestamp = DateTime(QDateTime::currentDateTime()).toX85UTC();
 
 				bindQueryValue(updateQuery,":subject",header.subject);
@@ -588,7 +603,7 @@ void DatabaseTaskUpdateHeaders::run()
 						bindQueryValue(insertQuery,":subject",header.subject);
 						bindQueryValue(insertQuery,":thread",header.threadId);
 						bindQueryValue(insertQuery,":version",header.version);
-						bindQueryValue(insertQuery,":gateway",FGateType);
+						bindQueryValue(insertQuery,":gateway",FGateTypes.value(i,FGateType));
 						bindQueryValue(insertQuery,":timestamp",timestamp);
 
 						if (!insertQuery.exec())
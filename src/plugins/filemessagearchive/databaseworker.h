@@ -117,11 +117,13 @@ class DatabaseTaskInsertHeaders :
 {
 public:
 	DatabaseTaskInsertHeaders(const Jid &AStreamJid, const QList<IArchiveHeader> &AHeaders, const QString &AGateType);
+	DatabaseTaskInsertHeaders(const Jid &AStreamJid, const QList<IArchiveHeader> &AHeaders, const QStringList &AGateTypes);
 	QList<IArchiveHeader> headers() const;
 protected:
 	void run();
 private:
 	QString FGateType;
+	QStringList FGateTypes;
 	QList<IArchiveHeader> FHeaders;
 };
 
@@ -130,11 +132,13 @@ class DatabaseTaskUpdateHeaders :
 {
 public:
 	DatabaseTaskUpdateHeaders(const Jid &AStreamJid, const QList<IArchiveHeader> &AHeaders, bool AInsertIfNotExist=false, const QString &AGateType=QString::null);
+	DatabaseTaskUpdateHeaders(const Jid &AStreamJid, const QList<IArchiveHeader> &AHeaders, const QStringList &AGateTypes);
 	QList<IArchiveHeader> headers() const;
 protected:
 	void run();
 private:
 	QString FGateType;
+	QStringList FGateTypes;
 	bool FInsertIfNotExist;
 	QList<IArchiveHeader> FHeaders;
 };
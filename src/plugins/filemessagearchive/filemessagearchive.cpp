@@ -21,6 +21,8 @@
 
 #define CATEGORY_GATEWAY      "gateway"
 
+#define FLUSH_WRITERS_TIMEOUT 2000
+
 FileMessageArchive::FileMessageArchive() : FMutex(QMutex::Recursive)
 {
 	FPluginManager = NULL;
@@ -28,6 +30,15 @@ FileMessageArchive::FileMessageArchive() : FMutex(QMutex::Recursive)
 	FDiscovery = NULL;
 	FAccountManager = NULL;
 
+	FWrittenRecords = 0;
+	FFlushedFiles = 0;
+	FHeadersTransactions = 0;
+	FUpdatedHeaders = 0;
+
+	FFlushWritersTimer.setSingleShot(true);
+	FFlushWritersTimer.setInterval(FLUSH_WRITERS_TIMEOUT);
+	connect(&FFlushWritersTimer,SIGNAL(timeout()),SLOT(onFlushWritersTimerTimeout()));
+
 	FFileWorker = new FileWorker(this);
 	connect(FFileWorker,SIGNAL(taskFinished(FileTask *)),SLOT(onFileTaskFinished(FileTask *)));
 
@@ -224,6 +235,8 @@ bool FileMessageArchive::saveMessage(const Jid &AStreamJid, const Message &AMess
 		{
 			IArchiveItemPrefs prefs = FArchiver->archiveItemPrefs(AStreamJid,itemJid,AMessage.threadId());
 			written = writer->writeMessage(AMessage,prefs.save,ADirectionIn);
+			if (written)
+				startFileWritersFlush();
 		}
 	}
 	else
@@ -252,6 +265,8 @@ bool FileMessageArchive::saveNote(const Jid &AStreamJid, const Message &AMessage
 		if (writer)
 		{
 			written = writer->writeNote(AMessage.body());
+			if (written)
+				startFileWritersFlush();
 		}
 	}
 	else
@@ -482,8 +497,13 @@ IArchiveHeader FileMessageArchive::loadFileHeader(const QString &AFilePath) cons
 	IArchiveHeader header;
 	if (!AFilePath.isEmpty())
 	{
-		QMutexLocker locker(&FMutex);
+		FMutex.lock();
 		FileWriter *writer = FWritingFiles.value(AFilePath,NULL);
+		if (writer != NULL)
+			header = writer->header();
+		FMutex.unlock();
+
+		// Files are parsed without lock, headers may be loaded from several threads
 		if (writer == NULL)
 		{
 			QFile file(AFilePath);
@@ -514,10 +534,6 @@ IArchiveHeader FileMessageArchive::loadFileHeader(const QString &AFilePath) cons
 				LOG_ERROR(QString("Failed to load file header from file=%1: %2").arg(file.fileName(),file.errorString()));
 			}
 		}
-		else
-		{
-			header = writer->header();
-		}
 	}
 	else
 	{
@@ -536,6 +552,9 @@ IArchiveCollection FileMessageArchive::loadFileCollection(const Jid &AStreamJid,
 		FileWriter *writer = FWritingFiles.value(filePath,NULL);
 		if (writer==NULL || writer->recordsCount()>0)
 		{
+			if (writer != NULL)
+				writer->flushRecords();
+
 			QFile file(filePath);
 			if (file.open(QFile::ReadOnly))
 			{
@@ -720,6 +739,7 @@ bool FileMessageArchive::removeFileCollection(const Jid &AStreamJid, const IArch
 		if (QFile::exists(filePath))
 		{
 			removeFileWriter(findFileWriter(AStreamJid,AHeader));
+			removePendingHeader(AStreamJid,AHeader);
 			if (QFile::remove(filePath))
 			{
 				saveModification(AStreamJid,AHeader,IArchiveModification::Removed);
@@ -827,9 +847,26 @@ QList<IArchiveHeader> FileMessageArchive::loadDatabaseHeaders(const Jid &AStream
 				if (writer->messagesCount()>0 && checkRequestHeader(writer->header(),ARequest))
 				{
 					if (ARequest.text.isEmpty())
+					{
 						headers.append(writer->header());
-					else if (checkRequestFile(writer->fileName(),ARequest))
-						headers.append(writer->header());
+					}
+					else
+					{
+						// Buffered records are not in the file until the next group flush
+						writer->flushRecords();
+						if (checkRequestFile(writer->fileName(),ARequest))
+							headers.append(writer->header());
+					}
+				}
+			}
+			foreach(const IArchiveHeader &header, FPendingHeaders.value(AStreamJid))
+			{
+				if (!headers.contains(header) && checkRequestHeader(header,ARequest))
+				{
+					if (ARequest.text.isEmpty())
+						headers.append(header);
+					else if (checkRequestFile(collectionFilePath(AStreamJid,header.with,header.start),ARequest))
+						headers.append(header);
 				}
 			}
 
@@ -1128,6 +1165,7 @@ bool FileMessageArchive::checkRequestFile(const QString &AFileName, const IArchi
 bool FileMessageArchive::saveModification(const Jid &AStreamJid, const IArchiveHeader &AHeader, IArchiveModification::ModifyAction AAction)
 {
 	bool saved = false;
+	removePendingHeader(AStreamJid,AHeader);
 	if (FDatabaseProperties.contains(AStreamJid.bare()) && AHeader.with.isValid() && AHeader.start.isValid())
 	{
 		if (AAction == IArchiveModification::Removed)
@@ -1231,11 +1269,101 @@ void FileMessageArchive::removeFileWriter(FileWriter *AWriter)
 		AWriter->closeAndDeleteLater();
 		FWritingFiles.remove(AWriter->fileName());
 		FFileWriters[AWriter->streamJid()].remove(AWriter->header().with,AWriter);
+		FWrittenRecords += AWriter->flushRecords();
 		if (AWriter->messagesCount() > 0)
-			saveModification(AWriter->streamJid(),AWriter->header(),IArchiveModification::Changed);
+		{
+			removePendingHeader(AWriter->streamJid(),AWriter->header());
+			FPendingHeaders[AWriter->streamJid()].append(AWriter->header());
+			startFileWritersFlush();
+		}
 		else
+		{
 			QFile::remove(AWriter->fileName());
+		}
+	}
+}
+
+void FileMessageArchive::startFileWritersFlush()
+{
+	// Timer is not restarted to keep flush delay bounded
+	if (!FFlushWritersTimer.isActive())
+	{
+		if (QThread::currentThread() == thread())
+			FFlushWritersTimer.start();
+		else
+			QMetaObject::invokeMethod(&FFlushWritersTimer,"start",Qt::QueuedConnection);
+	}
+}
+
+void FileMessageArchive::flushFileWriters()
+{
+	QMutexLocker locker(&FMutex);
+	FFlushWritersTimer.stop();
+
+	int records = 0;
+	int files = 0;
+	foreach(FileWriter *writer, FWritingFiles.values())
+	{
+		int writerRecords = writer->flushRecords();
+		if (writerRecords > 0)
+		{
+			files++;
+			records += writerRecords;
+		}
 	}
+	FFlushedFiles += files;
+	FWrittenRecords += records;
+
+	QMap<Jid, QList<IArchiveHeader> > pendingHeaders = FPendingHeaders;
+	FPendingHeaders.clear();
+
+	for (QMap<Jid, QList<IArchiveHeader> >::const_iterator it=pendingHeaders.constBegin(); it!=pendingHeaders.constEnd(); ++it)
+	{
+		if (FDatabaseProperties.contains(it.key().bare()))
+		{
+			QStringList gateTypes;
+			foreach(const IArchiveHeader &header, it.value())
+				gateTypes.append(contactGateType(header.with));
+
+			DatabaseTaskUpdateHeaders *task = new DatabaseTaskUpdateHeaders(it.key(),it.value(),gateTypes);
+			if (FDatabaseWorker->execTask(task) && !task->isFailed())
+			{
+				FHeadersTransactions++;
+				FUpdatedHeaders += it.value().count();
+			}
+			else if (task->isFailed())
+			{
+				LOG_STRM_ERROR(it.key(),QString("Failed to save writers modifications: %1").arg(task->error().condition()));
+			}
+			else
+			{
+				LOG_STRM_WARNING(it.key(),QString("Failed to save writers modifications: Task not started"));
+			}
+			delete task;
+		}
+		else
+		{
+			REPORT_ERROR("Failed to save writers modifications: Database not ready");
+		}
+
+		foreach(const IArchiveHeader &header, it.value())
+			emit fileCollectionChanged(it.key(),header);
+	}
+
+	LOG_DEBUG(QString("File writers flushed, files=%1, records=%2, streams=%3").arg(files).arg(records).arg(pendingHeaders.count()));
+}
+
+bool FileMessageArchive::removePendingHeader(const Jid &AStreamJid, const IArchiveHeader &AHeader)
+{
+	QMutexLocker locker(&FMutex);
+	QMap<Jid, QList<IArchiveHeader> >::iterator it = FPendingHeaders.find(AStreamJid);
+	if (it!=FPendingHeaders.end() && it->removeAll(AHeader)>0)
+	{
+		if (it->isEmpty())
+			FPendingHeaders.erase(it);
+		return true;
+	}
+	return false;
 }
 
 void FileMessageArchive::onFileTaskFinished(FileTask *ATask)
@@ -1329,6 +1457,11 @@ void FileMessageArchive::onFileWriterDestroyed(FileWriter *AWriter)
 	removeFileWriter(AWriter);
 }
 
+void FileMessageArchive::onFlushWritersTimerTimeout()
+{
+	flushFileWriters();
+}
+
 void FileMessageArchive::onDatabaseSyncFinished(const Jid &AStreamJid, bool AFailed)
 {
 	if (!AFailed)
@@ -1391,6 +1524,9 @@ void FileMessageArchive::onAccountHidden(IAccount *AAccount)
 	Jid bareStreamJid = AAccount->streamJid().bare();
 	if (FDatabaseProperties.contains(bareStreamJid))
 	{
+		flushFileWriters();
+		LOG_INFO(QString("File archive write statistics, records=%1, file-flushes=%2, header-transactions=%3, headers=%4").arg(FWrittenRecords).arg(FFlushedFiles).arg(FHeadersTransactions).arg(FUpdatedHeaders));
+
 		emit databaseAboutToClose(bareStreamJid);
 		setDatabaseProperty(bareStreamJid,FADP_DATABASE_NOT_CLOSED,"false");
 		DatabaseTaskCloseDatabase *task = new DatabaseTaskCloseDatabase(bareStreamJid);
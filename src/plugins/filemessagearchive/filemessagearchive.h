@@ -2,6 +2,7 @@
 #define FILEMESSAGEARCHIVE_H
 
 #include <QMutex>
+#include <QTimer>
 #include <interfaces/ipluginmanager.h>
 #include <interfaces/ifilemessagearchive.h>
 #include <interfaces/imessagearchiver.h>
@@ -96,12 +97,16 @@ protected:
 	FileWriter *findFileWriter(const Jid &AStreamJid, const Jid &AWith, const QString &AThreadId) const;
 	FileWriter *newFileWriter(const Jid &AStreamJid, const IArchiveHeader &AHeader, const QString &AFileName);
 	void removeFileWriter(FileWriter *AWriter);
+	void startFileWritersFlush();
+	void flushFileWriters();
+	bool removePendingHeader(const Jid &AStreamJid, const IArchiveHeader &AHeader);
 protected slots:
 	void onFileTaskFinished(FileTask *ATask);
 	void onDatabaseTaskFinished(DatabaseTask *ATask);
 	void onArchivePrefsOpened(const Jid &AStreamJid);
 	void onArchivePrefsClosed(const Jid &AStreamJid);
 	void onFileWriterDestroyed(FileWriter *AWriter);
+	void onFlushWritersTimerTimeout();
 	void onDatabaseSyncFinished(const Jid &AStreamJid, bool AFailed);
 protected slots:
 	void onOptionsOpened();
@@ -119,6 +124,13 @@ private:
 	FileWorker *FFileWorker;
 	DatabaseWorker *FDatabaseWorker;
 	DatabaseSynchronizer *FDatabaseSyncWorker;
+private:
+	QTimer FFlushWritersTimer;
+	quint64 FWrittenRecords;
+	quint64 FFlushedFiles;
+	quint64 FHeadersTransactions;
+	quint64 FUpdatedHeaders;
+	QMap<Jid, QList<IArchiveHeader> > FPendingHeaders;
 private:
 	QString FArchiveHomePath;
 	mutable QString FArchiveRootPath;
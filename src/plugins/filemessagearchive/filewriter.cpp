@@ -20,6 +20,7 @@ FileWriter::FileWriter(const Jid &AStreamJid, const QString &AFileName, const IA
 	FGroupchat = false;
 	FNotesCount = 0;
 	FMessagesCount = 0;
+	FUnflushedCount = 0;
 
 	FStreamJid = AStreamJid;
 	FFileName = AFileName;
@@ -116,7 +117,7 @@ bool FileWriter::writeMessage(const Message &AMessage, const QString &ASaveMode,
 				writeElementChilds(AMessage.stanza().document().documentElement());
 
 			FXmlWriter->writeEndElement();
-			FXmlFile->flush();
+			FUnflushedCount++;
 
 			checkLimits();
 			return true;
@@ -134,13 +135,22 @@ bool FileWriter::writeNote(const QString &ANote)
 		FXmlWriter->writeAttribute("utc",DateTime(QDateTime::currentDateTime()).toX85UTC());
 		FXmlWriter->writeCharacters(ANote);
 		FXmlWriter->writeEndElement();
-		FXmlFile->flush();
+		FUnflushedCount++;
 		checkLimits();
 		return true;
 	}
 	return false;
 }
 
+int FileWriter::flushRecords()
+{
+	int records = FUnflushedCount;
+	if (FXmlFile && FUnflushedCount>0)
+		FXmlFile->flush();
+	FUnflushedCount = 0;
+	return records;
+}
+
 void FileWriter::closeAndDeleteLater()
 {
 	stopCollection();
@@ -215,11 +225,13 @@ void FileWriter::writeElementChilds(const QDomElement &AElem)
 
 void FileWriter::checkLimits()
 {
-	if (FXmlFile->size() > Options::node(OPV_FILEARCHIVE_COLLECTION_CRITICALSIZE).value().toInt())
+	// QFile::size() flushes write buffer, file is written sequentially so position is the same
+	qint64 fileSize = FXmlFile->pos();
+	if (fileSize > Options::node(OPV_FILEARCHIVE_COLLECTION_CRITICALSIZE).value().toInt())
 		FCloseTimer.start(CRITICAL_SIZE_CLOSE_TIMEOUT);
-	else if (FXmlFile->size() > Options::node(OPV_FILEARCHIVE_COLLECTION_MAXSIZE).value().toInt())
+	else if (fileSize > Options::node(OPV_FILEARCHIVE_COLLECTION_MAXSIZE).value().toInt())
 		FCloseTimer.start(MAX_SIZE_CLOSE_TIMEOUT);
-	else if (FXmlFile->size() > Options::node(OPV_FILEARCHIVE_COLLECTION_MINSIZE).value().toInt())
+	else if (fileSize > Options::node(OPV_FILEARCHIVE_COLLECTION_MINSIZE).value().toInt())
 		FCloseTimer.start(NORMAL_SIZE_CLOSE_TIMEOUT);
 	else
 		FCloseTimer.start(MIN_SIZE_CLOSE_TIMEOUT);
@@ -22,6 +22,7 @@ public:
 	int recordsCount() const;
 	bool writeMessage(const Message &AMessage, const QString &ASaveMode, bool ADirectionIn);
 	bool writeNote(const QString &ANote);
+	int flushRecords();
 	void closeAndDeleteLater();
 signals:
 	void writerDestroyed(FileWriter *AWriter);
@@ -38,6 +39,7 @@ private:
 	bool FGroupchat;
 	int FNotesCount;
 	int FMessagesCount;
+	int FUnflushedCount;
 	Jid FStreamJid;
 	QString FFileName;
 	IArchiveHeader FHeader;
@@ -0,0 +1,2 @@
+set(SOURCES mammessagearchive.cpp)
+set(HEADERS mammessagearchive.h)
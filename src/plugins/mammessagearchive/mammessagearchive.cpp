@@ -0,0 +1,597 @@
+#include "mammessagearchive.h"
+
+#include <definitions/namespaces.h>
+#include <definitions/optionvalues.h>
+#include <definitions/archivehandlerorders.h>
+#include <definitions/stanzahandlerorders.h>
+#include <definitions/archivecapabilityorders.h>
+#include <definitions/filearchivedatabaseproperties.h>
+#include <utils/datetime.h>
+#include <utils/options.h>
+#include <utils/logger.h>
+
+#define MAM_REQUEST_TIMEOUT       30000
+#define LIVE_SYNC_DELAY           30000
+#define COLLECTION_GAP_SECS       (30*60)
+#define MAX_LIVE_IDS              1000
+
+#define SHC_MAM_RESULT            "/message/result"
+
+MamMessageArchive::MamMessageArchive()
+{
+	FXmppStreams = NULL;
+	FArchiver = NULL;
+	FDiscovery = NULL;
+	FStanzaProcessor = NULL;
+	FFileArchive = NULL;
+
+	FLiveSyncTimer.setSingleShot(true);
+	FLiveSyncTimer.setInterval(LIVE_SYNC_DELAY);
+	connect(&FLiveSyncTimer,SIGNAL(timeout()),SLOT(onLiveSyncTimerTimeout()));
+}
+
+MamMessageArchive::~MamMessageArchive()
+{
+
+}
+
+void MamMessageArchive::pluginInfo(IPluginInfo *APluginInfo)
+{
+	APluginInfo->name = tr("Message Archive Management");
+	APluginInfo->description = tr("Allows to synchronize the local history with the message archive on the server");
+	APluginInfo->version = "1.0";
+	APluginInfo->author = "Potapov S.A. aka Lion";
+	APluginInfo->homePage = "http://www.vacuum-im.org";
+	APluginInfo->dependences.append(XMPPSTREAMS_UUID);
+	APluginInfo->dependences.append(MESSAGEARCHIVER_UUID);
+	APluginInfo->dependences.append(STANZAPROCESSOR_UUID);
+	APluginInfo->dependences.append(SERVICEDISCOVERY_UUID);
+	APluginInfo->dependences.append(FILEMESSAGEARCHIVE_UUID);
+}
+
+bool MamMessageArchive::initConnections(IPluginManager *APluginManager, int &AInitOrder)
+{
+	Q_UNUSED(AInitOrder);
+	IPlugin *plugin = APluginManager->pluginInterface("IXmppStreams").value(0,NULL);
+	if (plugin)
+	{
+		FXmppStreams = qobject_cast<IXmppStreams *>(plugin->instance());
+		if (FXmppStreams)
+		{
+			connect(FXmppStreams->instance(),SIGNAL(opened(IXmppStream *)),SLOT(onXmppStreamOpened(IXmppStream *)));
+			connect(FXmppStreams->instance(),SIGNAL(closed(IXmppStream *)),SLOT(onXmppStreamClosed(IXmppStream *)));
+		}
+	}
+
+	plugin = APluginManager->pluginInterface("IMessageArchiver").value(0,NULL);
+	if (plugin)
+	{
+		FArchiver = qobject_cast<IMessageArchiver *>(plugin->instance());
+		if (FArchiver)
+		{
+			connect(FArchiver->instance(),SIGNAL(archivePrefsOpened(const Jid &)),SLOT(onArchivePrefsOpened(const Jid &)));
+			connect(FArchiver->instance(),SIGNAL(archiveEngineEnableChanged(const QUuid &, bool)),SLOT(onArchiveEngineEnableChanged(const QUuid &, bool)));
+		}
+	}
+
+	plugin = APluginManager->pluginInterface("IServiceDiscovery").value(0,NULL);
+	if (plugin)
+	{
+		FDiscovery = qobject_cast<IServiceDiscovery *>(plugin->instance());
+		if (FDiscovery)
+			connect(FDiscovery->instance(),SIGNAL(discoInfoReceived(const IDiscoInfo &)),SLOT(onDiscoInfoReceived(const IDiscoInfo &)));
+	}
+
+	plugin = APluginManager->pluginInterface("IStanzaProcessor").value(0,NULL);
+	if (plugin)
+	{
+		FStanzaProcessor = qobject_cast<IStanzaProcessor *>(plugin->instance());
+	}
+
+	plugin = APluginManager->pluginInterface("IFileMessageArchive").value(0,NULL);
+	if (plugin)
+	{
+		FFileArchive = qobject_cast<IFileMessageArchive *>(plugin->instance());
+		if (FFileArchive)
+		{
+			connect(FFileArchive->instance(),SIGNAL(databaseOpened(const Jid &)),SLOT(onFileArchiveDatabaseOpened(const Jid &)));
+			connect(FFileArchive->instance(),SIGNAL(databaseAboutToClose(const Jid &)),SLOT(onFileArchiveDatabaseAboutToClose(const Jid &)));
+			// Database properties may be changed from the database worker thread
+			connect(FFileArchive->instance(),SIGNAL(databasePropertyChanged(const Jid &, const QString &)),
+				SLOT(onFileArchiveDatabasePropertyChanged(const Jid &, const QString &)),Qt::QueuedConnection);
+		}
+	}
+
+	return FXmppStreams!=NULL && FArchiver!=NULL && FDiscovery!=NULL && FStanzaProcessor!=NULL && FFileArchive!=NULL;
+}
+
+bool MamMessageArchive::initObjects()
+{
+	if (FArchiver)
+	{
+		FArchiver->registerArchiveEngine(this);
+		FArchiver->insertArchiveHandler(AHO_DEFAULT,this);
+	}
+	return true;
+}
+
+bool MamMessageArchive::initSettings()
+{
+	Options::setDefaultValue(OPV_MAMARCHIVE_PAGESIZE,100);
+	return true;
+}
+
+bool MamMessageArchive::stanzaReadWrite(int AHandleId, const Jid &AStreamJid, Stanza &AStanza, bool &AAccept)
+{
+	if (FSHIResults.value(AStreamJid)==AHandleId && FSyncs.contains(AStreamJid))
+	{
+		// Only our own account is allowed to send archived messages
+		Jid fromJid = AStanza.from();
+		QDomElement resultElem = AStanza.firstElement("result",FNamespaces.value(AStreamJid));
+		MamSync &sync = FSyncs[AStreamJid];
+		if ((fromJid.isEmpty() || fromJid.pFull()==AStreamJid.pBare()) && resultElem.attribute("queryid")==sync.queryId)
+		{
+			AAccept = true;
+			QDomElement forwardElem = Stanza::findElement(resultElem,"forwarded",NS_MESSAGE_FORWARD);
+			QDomElement messageElem = forwardElem.firstChildElement("message");
+			if (!messageElem.isNull() && !sync.anchor)
+			{
+				Message message(Stanza(messageElem));
+				QDomElement delayElem = Stanza::findElement(forwardElem,"delay",NS_XMPP_DELAY);
+				if (!delayElem.isNull())
+					message.setDateTime(DateTime(delayElem.attribute("stamp")).toLocal());
+				sync.page.append(qMakePair(resultElem.attribute("id"),message));
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+void MamMessageArchive::stanzaRequestResult(const Jid &AStreamJid, const Stanza &AStanza)
+{
+	if (FQueryRequests.contains(AStanza.id()))
+	{
+		FQueryRequests.remove(AStanza.id());
+		if (!FSyncs.contains(AStreamJid) || FSyncs.value(AStreamJid).queryId!=AStanza.id())
+			return;
+
+		MamSync &sync = FSyncs[AStreamJid];
+		if (AStanza.type() == "result")
+		{
+			QDomElement finElem = AStanza.firstElement("fin",FNamespaces.value(AStreamJid));
+			QDomElement setElem = Stanza::findElement(finElem,"set",NS_RESULTSET);
+			QString last = setElem.firstChildElement("last").text();
+			bool complete = sync.anchor || last.isEmpty() || finElem.attribute("complete")=="true";
+
+			LOG_STRM_DEBUG(AStreamJid,QString("Archive page received, id=%1, messages=%2, last=%3").arg(AStanza.id()).arg(sync.page.count()).arg(last));
+
+			if (sync.anchor)
+				sync.lastTime = QDateTime::currentDateTime();
+			else
+				saveQueryPage(AStreamJid,sync);
+
+			if (!last.isEmpty())
+			{
+				sync.lastId = last;
+				FFileArchive->setDatabaseProperty(AStreamJid,FADP_MAM_LAST_ID,sync.lastId);
+			}
+			if (sync.lastTime.isValid())
+				FFileArchive->setDatabaseProperty(AStreamJid,FADP_MAM_LAST_TIME,DateTime(sync.lastTime).toX85UTC());
+
+			if (complete || !sendQueryRequest(AStreamJid,sync))
+				finishSynchronization(AStreamJid);
+		}
+		else
+		{
+			XmppStanzaError err(AStanza);
+			sync.page.clear();
+			if (!sync.anchor && !sync.start.isValid() && err.condition()=="item-not-found")
+			{
+				// Server no longer knows the last synchronized id, continue from the last synchronized time
+				sync.lastId = QString::null;
+				sync.start = DateTime(FFileArchive->databaseProperty(AStreamJid,FADP_MAM_LAST_TIME)).toLocal();
+				sync.anchor = !sync.start.isValid();
+				LOG_STRM_INFO(AStreamJid,QString("Last synchronized archive id not found, continuing from time=%1").arg(sync.start.toString(Qt::ISODate)));
+				if (!sendQueryRequest(AStreamJid,sync))
+					finishSynchronization(AStreamJid);
+			}
+			else
+			{
+				LOG_STRM_WARNING(AStreamJid,QString("Failed to load archive page, id=%1: %2").arg(AStanza.id(),err.condition()));
+				finishSynchronization(AStreamJid);
+			}
+		}
+	}
+}
+
+bool MamMessageArchive::archiveMessageEdit(int AOrder, const Jid &AStreamJid, Message &AMessage, bool ADirectionIn)
+{
+	Q_UNUSED(AOrder);
+	if (ADirectionIn)
+	{
+		// Messages archived on arrival should not be saved again by the next synchronization, even before support is discovered
+		QDomElement idElem = AMessage.stanza().firstElement("stanza-id",NS_STANZA_ID);
+		while (!idElem.isNull())
+		{
+			if (idElem.namespaceURI()==NS_STANZA_ID && Jid(idElem.attribute("by")).pFull()==AStreamJid.pBare())
+			{
+				QString id = idElem.attribute("id");
+				if (FSyncedIds[AStreamJid.bare()].remove(id))
+				{
+					LOG_STRM_DEBUG(AStreamJid,QString("Message already saved by archive synchronization, id=%1").arg(id));
+					return true;
+				}
+
+				FLiveIds[AStreamJid.bare()].insert(id);
+				if (isSupported(AStreamJid))
+				{
+					if (!FLiveSyncStreams.contains(AStreamJid))
+						FLiveSyncStreams.append(AStreamJid);
+					if (!FLiveSyncTimer.isActive())
+						FLiveSyncTimer.start();
+				}
+				break;
+			}
+			idElem = idElem.nextSiblingElement("stanza-id");
+		}
+	}
+	return false;
+}
+
+QUuid MamMessageArchive::engineId() const
+{
+	return MAMMESSAGEARCHIVE_UUID;
+}
+
+QString MamMessageArchive::engineName() const
+{
+	return tr("Message Archive Management");
+}
+
+QString MamMessageArchive::engineDescription() const
+{
+	return tr("History of conversations stored on your jabber server is downloaded to the local archive");
+}
+
+IOptionsWidget *MamMessageArchive::engineSettingsWidget(QWidget *AParent)
+{
+	Q_UNUSED(AParent);
+	return NULL;
+}
+
+quint32 MamMessageArchive::capabilities(const Jid &AStreamJid) const
+{
+	return isSupported(AStreamJid) ? AutomaticArchiving : 0;
+}
+
+bool MamMessageArchive::isCapable(const Jid &AStreamJid, quint32 ACapability) const
+{
+	return (capabilities(AStreamJid) & ACapability) == ACapability;
+}
+
+int MamMessageArchive::capabilityOrder(quint32 ACapability, const Jid &AStreamJid) const
+{
+	if (isCapable(AStreamJid,ACapability))
+	{
+		switch (ACapability)
+		{
+		case AutomaticArchiving:
+			return ACO_AUTOMATIC_MAMARCHIVE;
+		default:
+			break;
+		}
+	}
+	return -1;
+}
+
+bool MamMessageArchive::saveMessage(const Jid &AStreamJid, const Message &AMessage, bool ADirectionIn)
+{
+	Q_UNUSED(AStreamJid); Q_UNUSED(AMessage); Q_UNUSED(ADirectionIn);
+	return false;
+}
+
+bool MamMessageArchive::saveNote(const Jid &AStreamJid, const Message &AMessage, bool ADirectionIn)
+{
+	Q_UNUSED(AStreamJid); Q_UNUSED(AMessage); Q_UNUSED(ADirectionIn);
+	return false;
+}
+
+QString MamMessageArchive::saveCollection(const Jid &AStreamJid, const IArchiveCollection &ACollection)
+{
+	Q_UNUSED(AStreamJid); Q_UNUSED(ACollection);
+	return QString::null;
+}
+
+QString MamMessageArchive::loadHeaders(const Jid &AStreamJid, const IArchiveRequest &ARequest)
+{
+	Q_UNUSED(AStreamJid); Q_UNUSED(ARequest);
+	return QString::null;
+}
+
+QString MamMessageArchive::loadCollection(const Jid &AStreamJid, const IArchiveHeader &AHeader)
+{
+	Q_UNUSED(AStreamJid); Q_UNUSED(AHeader);
+	return QString::null;
+}
+
+QString MamMessageArchive::removeCollections(const Jid &AStreamJid, const IArchiveRequest &ARequest)
+{
+	Q_UNUSED(AStreamJid); Q_UNUSED(ARequest);
+	return QString::null;
+}
+
+QString MamMessageArchive::loadModifications(const Jid &AStreamJid, const QDateTime &AStart, int ACount, const QString &ANextRef)
+{
+	Q_UNUSED(AStreamJid); Q_UNUSED(AStart); Q_UNUSED(ACount); Q_UNUSED(ANextRef);
+	return QString::null;
+}
+
+bool MamMessageArchive::isSupported(const Jid &AStreamJid) const
+{
+	return FNamespaces.contains(AStreamJid);
+}
+
+bool MamMessageArchive::isSynchronizing(const Jid &AStreamJid) const
+{
+	return FSyncs.contains(AStreamJid);
+}
+
+QString MamMessageArchive::lastSyncedId(const Jid &AStreamJid) const
+{
+	return FFileArchive->databaseProperty(AStreamJid,FADP_MAM_LAST_ID);
+}
+
+bool MamMessageArchive::startSynchronization(const Jid &AStreamJid)
+{
+	if (isSupported(AStreamJid) && !isSynchronizing(AStreamJid) && FArchiver->isArchiveEngineEnabled(engineId()))
+	{
+		if (FFileArchive->isDatabaseReady(AStreamJid) && FFileArchive->isCapable(AStreamJid,IArchiveEngine::ManualArchiving))
+		{
+			// Without the last synchronized id only the newest id is requested to start the next synchronization from
+			MamSync sync;
+			sync.lastId = lastSyncedId(AStreamJid);
+			sync.anchor = sync.lastId.isEmpty();
+
+			MamSync &newSync = FSyncs[AStreamJid];
+			newSync = sync;
+			FSyncedIds.remove(AStreamJid.bare());
+			FLiveSyncStreams.removeAll(AStreamJid);
+			if (sendQueryRequest(AStreamJid,newSync))
+			{
+				LOG_STRM_INFO(AStreamJid,QString("Archive synchronization started, after=%1").arg(sync.lastId));
+				emit synchronizationStarted(AStreamJid);
+				return true;
+			}
+			FSyncs.remove(AStreamJid);
+		}
+	}
+	return false;
+}
+
+bool MamMessageArchive::sendQueryRequest(const Jid &AStreamJid, MamSync &ASync)
+{
+	QString ns = FNamespaces.value(AStreamJid);
+
+	Stanza request("iq");
+	request.setType("set").setId(FStanzaProcessor->newId());
+
+	QDomElement queryElem = request.addElement("query",ns);
+	queryElem.setAttribute("queryid",request.id());
+
+	if (ASync.start.isValid())
+	{
+		QDomElement formElem = queryElem.appendChild(request.createElement("x",NS_JABBER_DATA)).toElement();
+		formElem.setAttribute("type","submit");
+
+		QDomElement typeElem = formElem.appendChild(request.createElement("field")).toElement();
+		typeElem.setAttribute("var","FORM_TYPE");
+		typeElem.setAttribute("type","hidden");
+		typeElem.appendChild(request.createElement("value")).appendChild(request.createTextNode(ns));
+
+		QDomElement startElem = formElem.appendChild(request.createElement("field")).toElement();
+		startElem.setAttribute("var","start");
+		startElem.appendChild(request.createElement("value")).appendChild(request.createTextNode(DateTime(ASync.start).toX85UTC()));
+	}
+
+	int pageSize = ASync.anchor ? 1 : qMax(Options::node(OPV_MAMARCHIVE_PAGESIZE).value().toInt(),10);
+	QDomElement setElem = queryElem.appendChild(request.createElement("set",NS_RESULTSET)).toElement();
+	setElem.appendChild(request.createElement("max")).appendChild(request.createTextNode(QString::number(pageSize)));
+	if (ASync.anchor)
+		setElem.appendChild(request.createElement("before"));
+	else if (!ASync.lastId.isEmpty())
+		setElem.appendChild(request.createElement("after")).appendChild(request.createTextNode(ASync.lastId));
+
+	if (FStanzaProcessor->sendStanzaRequest(this,AStreamJid,request,MAM_REQUEST_TIMEOUT))
+	{
+		LOG_STRM_DEBUG(AStreamJid,QString("Archive query request sent, id=%1, after=%2").arg(request.id(),ASync.lastId));
+		ASync.queryId = request.id();
+		FQueryRequests.insert(request.id(),AStreamJid);
+		return true;
+	}
+	else
+	{
+		LOG_STRM_WARNING(AStreamJid,"Failed to send archive query request");
+	}
+	return false;
+}
+
+void MamMessageArchive::saveQueryPage(const Jid &AStreamJid, MamSync &ASync)
+{
+	QSet<QString> &liveIds = FLiveIds[AStreamJid.bare()];
+	QSet<QString> &syncedIds = FSyncedIds[AStreamJid.bare()];
+	int liveCount = liveIds.count();
+
+	// Consecutive messages with the same contact are appended to one collection, even across pages
+	QMap<Jid, IArchiveCollection> collections;
+	for (int i=0; i<ASync.page.count(); i++)
+	{
+		const QString &id = ASync.page.at(i).first;
+		const Message &message = ASync.page.at(i).second;
+		ASync.lastTime = message.dateTime();
+
+		Jid fromJid = !message.from().isEmpty() ? Jid(message.from()) : AStreamJid.bare();
+		if (liveIds.remove(id) || fromJid.pFull()==AStreamJid.pFull())
+			continue;
+		if (message.type()==Message::GroupChat || message.type()==Message::Error || message.body().isEmpty())
+			continue;
+
+		bool directionIn = !(AStreamJid && fromJid);
+		Jid with = (directionIn ? fromJid : Jid(message.to())).bare();
+		if (!FArchiver->isArchivingAllowed(AStreamJid,with,message.threadId()))
+			continue;
+
+		MamCollection &collection = ASync.collections[with];
+		if (!collection.header.start.isValid() || collection.last.secsTo(message.dateTime())>COLLECTION_GAP_SECS)
+		{
+			if (collections.contains(with))
+				FFileArchive->saveCollection(AStreamJid,collections.take(with));
+
+			collection.header = IArchiveHeader();
+			collection.header.engineId = FFileArchive->engineId();
+			collection.header.with = with;
+			collection.header.start = message.dateTime();
+			collection.header.threadId = message.threadId();
+		}
+		collection.last = message.dateTime();
+
+		IArchiveCollection &pageCollection = collections[with];
+		pageCollection.header = collection.header;
+		pageCollection.body.messages.append(message);
+		syncedIds += id;
+		ASync.saved++;
+	}
+	ASync.page.clear();
+
+	if (liveIds.count() != liveCount)
+		saveLiveIds(AStreamJid);
+
+	foreach(const IArchiveCollection &collection, collections)
+	{
+		if (FFileArchive->saveCollection(AStreamJid,collection).isEmpty())
+			LOG_STRM_WARNING(AStreamJid,QString("Failed to save synchronized collection with=%1").arg(collection.header.with.full()));
+	}
+}
+
+void MamMessageArchive::finishSynchronization(const Jid &AStreamJid)
+{
+	MamSync sync = FSyncs.take(AStreamJid);
+	LOG_STRM_INFO(AStreamJid,QString("Archive synchronization finished, last=%1, saved=%2").arg(sync.lastId).arg(sync.saved));
+	emit synchronizationFinished(AStreamJid,sync.saved);
+
+	if (FLiveSyncStreams.contains(AStreamJid) && !FLiveSyncTimer.isActive())
+		FLiveSyncTimer.start();
+}
+
+void MamMessageArchive::startAllSynchronizations(const Jid &AStreamJid)
+{
+	foreach(const Jid &streamJid, FNamespaces.keys())
+	{
+		if (AStreamJid.isEmpty() || (AStreamJid && streamJid))
+			startSynchronization(streamJid);
+	}
+}
+
+void MamMessageArchive::saveLiveIds(const Jid &AStreamJid)
+{
+	// Live messages not yet seen by synchronization are skipped by the synchronization after reconnect
+	QStringList ids = FLiveIds.value(AStreamJid.bare()).toList();
+	if (ids.count() > MAX_LIVE_IDS)
+	{
+		LOG_STRM_WARNING(AStreamJid,QString("Too many unsynchronized live message ids, dropped=%1").arg(ids.count()-MAX_LIVE_IDS));
+		ids = ids.mid(0,MAX_LIVE_IDS);
+		FLiveIds[AStreamJid.bare()] = ids.toSet();
+	}
+	FFileArchive->setDatabaseProperty(AStreamJid,FADP_MAM_LIVE_IDS,ids.join(" "));
+}
+
+void MamMessageArchive::onXmppStreamOpened(IXmppStream *AXmppStream)
+{
+	IStanzaHandle shandle;
+	shandle.handler = this;
+	shandle.order = SHO_MI_MAMMESSAGEARCHIVE;
+	shandle.direction = IStanzaHandle::DirectionIn;
+	shandle.streamJid = AXmppStream->streamJid();
+	shandle.conditions.append(SHC_MAM_RESULT);
+	FSHIResults.insert(shandle.streamJid,FStanzaProcessor->insertStanzaHandle(shandle));
+
+	FDiscovery->requestDiscoInfo(AXmppStream->streamJid(),AXmppStream->streamJid().bare());
+}
+
+void MamMessageArchive::onXmppStreamClosed(IXmppStream *AXmppStream)
+{
+	Jid streamJid = AXmppStream->streamJid();
+	FStanzaProcessor->removeStanzaHandle(FSHIResults.take(streamJid));
+
+	foreach(const QString &id, FQueryRequests.keys(streamJid))
+		FQueryRequests.remove(id);
+	FSyncs.remove(streamJid);
+	FSyncedIds.remove(streamJid.bare());
+	FLiveSyncStreams.removeAll(streamJid);
+	saveLiveIds(streamJid);
+
+	if (FNamespaces.contains(streamJid))
+	{
+		FNamespaces.remove(streamJid);
+		emit capabilitiesChanged(streamJid);
+	}
+}
+
+void MamMessageArchive::onDiscoInfoReceived(const IDiscoInfo &AInfo)
+{
+	if (AInfo.node.isEmpty() && AInfo.contactJid.pFull()==AInfo.streamJid.pBare() && FSHIResults.contains(AInfo.streamJid) && !FNamespaces.contains(AInfo.streamJid))
+	{
+		QString ns;
+		if (AInfo.features.contains(NS_MAM_2))
+			ns = NS_MAM_2;
+		else if (AInfo.features.contains(NS_MAM_1))
+			ns = NS_MAM_1;
+
+		if (!ns.isEmpty())
+		{
+			LOG_STRM_INFO(AInfo.streamJid,QString("Message archive management supported, namespace=%1").arg(ns));
+			FNamespaces.insert(AInfo.streamJid,ns);
+			emit capabilitiesChanged(AInfo.streamJid);
+			startSynchronization(AInfo.streamJid);
+		}
+	}
+}
+
+void MamMessageArchive::onArchivePrefsOpened(const Jid &AStreamJid)
+{
+	startSynchronization(AStreamJid);
+}
+
+void MamMessageArchive::onArchiveEngineEnableChanged(const QUuid &AId, bool AEnabled)
+{
+	if (AEnabled && AId==engineId())
+		startAllSynchronizations();
+}
+
+void MamMessageArchive::onFileArchiveDatabaseOpened(const Jid &AStreamJid)
+{
+	FLiveIds[AStreamJid.bare()] += FFileArchive->databaseProperty(AStreamJid,FADP_MAM_LIVE_IDS).split(" ",QString::SkipEmptyParts).toSet();
+}
+
+void MamMessageArchive::onFileArchiveDatabaseAboutToClose(const Jid &AStreamJid)
+{
+	saveLiveIds(AStreamJid);
+	FLiveIds.remove(AStreamJid.bare());
+}
+
+void MamMessageArchive::onFileArchiveDatabasePropertyChanged(const Jid &AStreamJid, const QString &AProperty)
+{
+	if (AProperty == FADP_LAST_SYNC_TIME)
+		startAllSynchronizations(AStreamJid);
+}
+
+void MamMessageArchive::onLiveSyncTimerTimeout()
+{
+	foreach(const Jid &streamJid, FLiveSyncStreams)
+	{
+		if (!isSynchronizing(streamJid))
+			startSynchronization(streamJid);
+	}
+}
+
+Q_EXPORT_PLUGIN2(plg_mammessagearchive, MamMessageArchive)
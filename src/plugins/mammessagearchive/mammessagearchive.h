@@ -0,0 +1,129 @@
+#ifndef MAMMESSAGEARCHIVE_H
+#define MAMMESSAGEARCHIVE_H
+
+#include <QSet>
+#include <QPair>
+#include <QTimer>
+#include <interfaces/ipluginmanager.h>
+#include <interfaces/imammessagearchive.h>
+#include <interfaces/imessagearchiver.h>
+#include <interfaces/ifilemessagearchive.h>
+#include <interfaces/istanzaprocessor.h>
+#include <interfaces/iservicediscovery.h>
+#include <interfaces/ixmppstreams.h>
+
+struct MamCollection {
+	IArchiveHeader header;
+	QDateTime last;
+};
+
+struct MamSync {
+	MamSync() {
+		anchor = false;
+		saved = 0;
+	}
+	bool anchor;
+	int saved;
+	QString queryId;
+	QString lastId;
+	QDateTime start;
+	QDateTime lastTime;
+	QMap<Jid, MamCollection> collections;
+	QList< QPair<QString,Message> > page;
+};
+
+class MamMessageArchive :
+	public QObject,
+	public IPlugin,
+	public IStanzaHandler,
+	public IStanzaRequestOwner,
+	public IArchiveHandler,
+	public IMamMessageArchive
+{
+	Q_OBJECT;
+	Q_INTERFACES(IPlugin IStanzaHandler IStanzaRequestOwner IArchiveHandler IArchiveEngine IMamMessageArchive);
+public:
+	MamMessageArchive();
+	~MamMessageArchive();
+	//IPlugin
+	virtual QObject *instance() { return this; }
+	virtual QUuid pluginUuid() const { return MAMMESSAGEARCHIVE_UUID; }
+	virtual void pluginInfo(IPluginInfo *APluginInfo);
+	virtual bool initConnections(IPluginManager *APluginManager, int &AInitOrder);
+	virtual bool initObjects();
+	virtual bool initSettings();
+	virtual bool startPlugin() { return true; }
+	//IStanzaHandler
+	virtual bool stanzaReadWrite(int AHandleId, const Jid &AStreamJid, Stanza &AStanza, bool &AAccept);
+	//IStanzaRequestOwner
+	virtual void stanzaRequestResult(const Jid &AStreamJid, const Stanza &AStanza);
+	//IArchiveHandler
+	virtual bool archiveMessageEdit(int AOrder, const Jid &AStreamJid, Message &AMessage, bool ADirectionIn);
+	//IArchiveEngine
+	virtual QUuid engineId() const;
+	virtual QString engineName() const;
+	virtual QString engineDescription() const;
+	virtual IOptionsWidget *engineSettingsWidget(QWidget *AParent);
+	virtual quint32 capabilities(const Jid &AStreamJid = Jid::null) const;
+	virtual bool isCapable(const Jid &AStreamJid, quint32 ACapability) const;
+	virtual int capabilityOrder(quint32 ACapability, const Jid &AStreamJid = Jid::null) const;
+	virtual bool saveMessage(const Jid &AStreamJid, const Message &AMessage, bool ADirectionIn);
+	virtual bool saveNote(const Jid &AStreamJid, const Message &AMessage, bool ADirectionIn);
+	virtual QString saveCollection(const Jid &AStreamJid, const IArchiveCollection &ACollection);
+	virtual QString loadHeaders(const Jid &AStreamJid, const IArchiveRequest &ARequest);
+	virtual QString loadCollection(const Jid &AStreamJid, const IArchiveHeader &AHeader);
+	virtual QString removeCollections(const Jid &AStreamJid, const IArchiveRequest &ARequest);
+	virtual QString loadModifications(const Jid &AStreamJid, const QDateTime &AStart, int ACount, const QString &ANextRef);
+	//IMamMessageArchive
+	virtual bool isSupported(const Jid &AStreamJid) const;
+	virtual bool isSynchronizing(const Jid &AStreamJid) const;
+	virtual QString lastSyncedId(const Jid &AStreamJid) const;
+	virtual bool startSynchronization(const Jid &AStreamJid);
+signals:
+	//IArchiveEngine
+	void capabilitiesChanged(const Jid &AStreamJid);
+	void requestFailed(const QString &AId, const XmppError &AError);
+	void headersLoaded(const QString &AId, const QList<IArchiveHeader> &AHeaders);
+	void collectionSaved(const QString &AId, const IArchiveCollection &ACollection);
+	void collectionLoaded(const QString &AId, const IArchiveCollection &ACollection);
+	void collectionsRemoved(const QString &AId, const IArchiveRequest &ARequest);
+	void modificationsLoaded(const QString &AId, const IArchiveModifications &AModifications);
+	//IMamMessageArchive
+	void synchronizationStarted(const Jid &AStreamJid);
+	void synchronizationFinished(const Jid &AStreamJid, int ASaved);
+protected:
+	bool sendQueryRequest(const Jid &AStreamJid, MamSync &ASync);
+	void saveQueryPage(const Jid &AStreamJid, MamSync &ASync);
+	void finishSynchronization(const Jid &AStreamJid);
+	void startAllSynchronizations(const Jid &AStreamJid = Jid::null);
+	void saveLiveIds(const Jid &AStreamJid);
+protected slots:
+	void onXmppStreamOpened(IXmppStream *AXmppStream);
+	void onXmppStreamClosed(IXmppStream *AXmppStream);
+	void onDiscoInfoReceived(const IDiscoInfo &AInfo);
+	void onArchivePrefsOpened(const Jid &AStreamJid);
+	void onArchiveEngineEnableChanged(const QUuid &AId, bool AEnabled);
+	void onFileArchiveDatabaseOpened(const Jid &AStreamJid);
+	void onFileArchiveDatabaseAboutToClose(const Jid &AStreamJid);
+	void onFileArchiveDatabasePropertyChanged(const Jid &AStreamJid, const QString &AProperty);
+	void onLiveSyncTimerTimeout();
+private:
+	IXmppStreams *FXmppStreams;
+	IMessageArchiver *FArchiver;
+	IServiceDiscovery *FDiscovery;
+	IStanzaProcessor *FStanzaProcessor;
+	IFileMessageArchive *FFileArchive;
+private:
+	QMap<Jid, int> FSHIResults;
+	QMap<Jid, QString> FNamespaces;
+private:
+	QMap<Jid, MamSync> FSyncs;
+	QMap<QString, Jid> FQueryRequests;
+	QTimer FLiveSyncTimer;
+	QList<Jid> FLiveSyncStreams;
+	// bareStreamJid->ids
+	QMap<Jid, QSet<QString> > FLiveIds;
+	QMap<Jid, QSet<QString> > FSyncedIds;
+};
+
+#endif // MAMMESSAGEARCHIVE_H
@@ -0,0 +1,2 @@
+HEADERS = mammessagearchive.h
+SOURCES = mammessagearchive.cpp
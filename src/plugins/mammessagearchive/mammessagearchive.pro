@@ -0,0 +1,3 @@
+TARGET = mammessagearchive 
+include(mammessagearchive.pri) 
+include(../plugins.inc) 
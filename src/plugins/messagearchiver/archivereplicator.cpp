@@ -11,11 +11,16 @@
 #define REPLICATE_START_TIMEOUT         10*1000
 #define REPLICATE_RESTART_TIMEOUT       5*60*1000
 #define REPLICATE_MODIFICATIONS_COUNT   50
+#define REPLICATE_ACTIVE_MODIFICATIONS  8
+#define REPLICATE_VERSIONS_BATCH        50
+#define REPLICATE_VERSIONS_TIMEOUT      2*1000
 
 ArchiveReplicator::ArchiveReplicator(IMessageArchiver *AArchiver, const Jid &AStreamJid, QObject *AParent) : QObject(AParent)
 {
 	FWorker = NULL;
 	FDestroy = false;
+	FModificationId = 0;
+	FReplicatedCount = 0;
 
 	FArchiver = AArchiver;
 	FStreamJid = AStreamJid;
@@ -23,6 +28,10 @@ ArchiveReplicator::ArchiveReplicator(IMessageArchiver *AArchiver, const Jid &ASt
 	FStartReplicateTimer.setSingleShot(true);
 	connect(&FStartReplicateTimer,SIGNAL(timeout()),SLOT(onStartReplicateTimerTimeout()));
 
+	FUpdateVersionsTimer.setSingleShot(true);
+	FUpdateVersionsTimer.setInterval(REPLICATE_VERSIONS_TIMEOUT);
+	connect(&FUpdateVersionsTimer,SIGNAL(timeout()),SLOT(onUpdateVersionsTimerTimeout()));
+
 	FStartReplicateTimer.start(REPLICATE_START_TIMEOUT);
 }
 
@@ -138,26 +147,31 @@ void ArchiveReplicator::startSyncCollections()
 
 void ArchiveReplicator::startNextModification()
 {
-	while(FDestinations.isEmpty() && !FModifications.isEmpty())
+	while(FActiveModifications.count()<REPLICATE_ACTIVE_MODIFICATIONS && !FModifications.isEmpty())
 	{
-		FModification = FModifications.takeFirst();
-		if (FModification.action == IArchiveModification::Changed)
+		QList<QUuid> destinations;
+		quint32 modificationId = ++FModificationId;
+		ReplicateModification modification = FModifications.takeFirst();
+		if (modification.action == IArchiveModification::Changed)
 		{
-			foreach(const QUuid &engineId, FModification.destinations)
+			foreach(const QUuid &engineId, modification.destinations)
 			{
 				if (FEngines.contains(engineId) && Options::node(OPV_HISTORY_ENGINE_ITEM,engineId.toString()).value("replicate-append").toBool())
-					FDestinations.append(engineId);
+					destinations.append(engineId);
 			}
-			for (int i=0; !FDestinations.isEmpty() && FLoadCollectionRequests.isEmpty() && i<FSourceOrder.count(); i++)
+			bool loadSent = false;
+			for (int i=0; !destinations.isEmpty() && !loadSent && i<FSourceOrder.count(); i++)
 			{
-				IArchiveEngine *engine = FModification.sources.contains(FSourceOrder.at(i)) ? FArchiver->findArchiveEngine(FSourceOrder.at(i)) : NULL;
+				IArchiveEngine *engine = modification.sources.contains(FSourceOrder.at(i)) ? FArchiver->findArchiveEngine(FSourceOrder.at(i)) : NULL;
 				if (engine)
 				{
-					QString requestId = engine->loadCollection(FStreamJid,FModification.header);
+					QString requestId = engine->loadCollection(FStreamJid,modification.header);
 					if (!requestId.isEmpty())
 					{
-						LOG_STRM_DEBUG(FStreamJid,QString("Load collection request sent, engine=%1, with=%2, start=%3, id=%4").arg(engine->engineId().toString(),FModification.header.with.full(),FModification.header.start.toString(Qt::ISODate),requestId));
+						LOG_STRM_DEBUG(FStreamJid,QString("Load collection request sent, engine=%1, with=%2, start=%3, id=%4").arg(engine->engineId().toString(),modification.header.with.full(),modification.header.start.toString(Qt::ISODate),requestId));
 						FLoadCollectionRequests.insert(requestId,engine->engineId());
+						FRequestModifications.insert(requestId,modificationId);
+						loadSent = true;
 					}
 					else
 					{
@@ -165,25 +179,26 @@ void ArchiveReplicator::startNextModification()
 					}
 				}
 			}
-			if (FLoadCollectionRequests.isEmpty())
-				FDestinations.clear();
+			if (!loadSent)
+				destinations.clear();
 		}
-		else if (FModification.action == IArchiveModification::Removed)
+		else if (modification.action == IArchiveModification::Removed)
 		{
-			foreach(const QUuid &engineId, FModification.destinations)
+			foreach(const QUuid &engineId, modification.destinations)
 			{
 				IArchiveEngine *engine = FEngines.value(engineId);
 				if (engine!=NULL && Options::node(OPV_HISTORY_ENGINE_ITEM,engineId.toString()).value("replicate-remove").toBool())
 				{
 					IArchiveRequest request;
-					request.with = FModification.header.with;
-					request.start = FModification.header.start;
+					request.with = modification.header.with;
+					request.start = modification.header.start;
 					QString requestId = engine->removeCollections(FStreamJid,request);
 					if (!requestId.isEmpty())
 					{
 						LOG_STRM_DEBUG(FStreamJid,QString("Remove collection request sent, engine=%1, with=%2, start=%3, id=%4").arg(engineId.toString(),request.with.full(),request.start.toString(Qt::ISODate),requestId));
-						FDestinations.append(engineId);
+						destinations.append(engineId);
 						FRemoveCollectionRequests.insert(requestId,engineId);
+						FRequestModifications.insert(requestId,modificationId);
 					}
 					else
 					{
@@ -192,16 +207,96 @@ void ArchiveReplicator::startNextModification()
 				}
 			}
 		}
+
+		// Active modification destinations are engines with pending save or remove requests
+		if (!destinations.isEmpty())
+		{
+			modification.destinations = destinations;
+			FActiveModifications.insert(modificationId,modification);
+		}
 	}
 
-	if (FDestinations.isEmpty() && FModifications.isEmpty())
+	if (FActiveModifications.isEmpty())
 	{
-		LOG_STRM_DEBUG(FStreamJid,"Finishing replication");
-		foreach(const QUuid &engineId, FEngines.keys())
-			stopReplication(engineId);
+		if (!FPendingVersions.isEmpty())
+		{
+			startUpdateVersions();
+		}
+		else if (FModifications.isEmpty() && FUpdateVersionTasks.isEmpty())
+		{
+			LOG_STRM_DEBUG(FStreamJid,"Finishing replication");
+			foreach(const QUuid &engineId, FEngines.keys())
+				stopReplication(engineId);
+		}
+	}
+}
+
+void ArchiveReplicator::startUpdateVersions()
+{
+	FUpdateVersionsTimer.stop();
+	if (FWorker && !FPendingVersions.isEmpty())
+	{
+		QList<ReplicateVersion> versions = FPendingVersions;
+		FPendingVersions.clear();
+
+		QList<QUuid> engines;
+		foreach(const ReplicateVersion &version, versions)
+		{
+			if (!engines.contains(version.engineId))
+				engines.append(version.engineId);
+		}
+
+		ReplicateTaskUpdateVersion *task = new ReplicateTaskUpdateVersion(versions);
+		if (FWorker->startTask(task))
+		{
+			LOG_STRM_DEBUG(FStreamJid,QString("Update replication modifications version task started, versions=%1, id=%2").arg(versions.count()).arg(task->taskId()));
+			FUpdateVersionTasks.insert(task->taskId(),engines);
+		}
+		else
+		{
+			LOG_STRM_WARNING(FStreamJid,QString("Failed to start update replication modifications version task, versions=%1").arg(versions.count()));
+			foreach(const QUuid &engineId, engines)
+				stopReplication(engineId);
+		}
+	}
+}
+
+void ArchiveReplicator::appendVersion(quint32 AModificationId, const QUuid &AEngineId, quint32 AVersion)
+{
+	if (FEngines.contains(AEngineId) && FActiveModifications.contains(AModificationId))
+	{
+		ReplicateVersion version;
+		version.engineId = AEngineId;
+		version.version = AVersion;
+		version.modification = FActiveModifications.value(AModificationId);
+		FPendingVersions.append(version);
+
+		if (FPendingVersions.count() >= REPLICATE_VERSIONS_BATCH)
+			startUpdateVersions();
+		else if (!FUpdateVersionsTimer.isActive())
+			FUpdateVersionsTimer.start();
+	}
+}
+
+void ArchiveReplicator::removeDestination(quint32 AModificationId, const QUuid &AEngineId)
+{
+	QMap<quint32, ReplicateModification>::iterator it = FActiveModifications.find(AModificationId);
+	if (it != FActiveModifications.end())
+	{
+		it->destinations.removeAll(AEngineId);
+		if (it->destinations.isEmpty())
+			FActiveModifications.erase(it);
 	}
 }
 
+void ArchiveReplicator::reportProgress() const
+{
+	qint64 elapsed = FReplicateClock.elapsed();
+	double rate = elapsed>0 ? FReplicatedCount*1000.0/elapsed : 0.0;
+	int remaining = FModifications.count() + FActiveModifications.count();
+	LOG_STRM_INFO(FStreamJid,QString("Replication progress, replicated=%1, remaining=%2, rate=%3/s").arg(FReplicatedCount).arg(remaining).arg(rate,0,'f',1));
+}
+
 void ArchiveReplicator::stopReplication(const QUuid &AEngineId)
 {
 	IArchiveEngine *engine = FEngines.take(AEngineId);
@@ -210,7 +305,10 @@ void ArchiveReplicator::stopReplication(const QUuid &AEngineId)
 		LOG_STRM_DEBUG(FStreamJid,QString("Stopping replication of engine=%1").arg(AEngineId.toString()));
 
 		if (FWorker && FEngines.isEmpty())
+		{
+			startUpdateVersions();
 			FWorker->quit();
+		}
 
 		for (QList<ReplicateModification>::iterator it=FModifications.begin(); it!=FModifications.end(); )
 		{
@@ -221,7 +319,8 @@ void ArchiveReplicator::stopReplication(const QUuid &AEngineId)
 				++it;
 		}
 
-		FDestinations.removeAll(AEngineId);
+		foreach(quint32 modificationId, FActiveModifications.keys())
+			removeDestination(modificationId,AEngineId);
 	}
 }
 
@@ -270,6 +369,11 @@ void ArchiveReplicator::onStartReplicateTimerTimeout()
 	}
 }
 
+void ArchiveReplicator::onUpdateVersionsTimerTimeout()
+{
+	startUpdateVersions();
+}
+
 void ArchiveReplicator::onReplicateWorkerReady()
 {
 	startSyncModifications();
@@ -285,10 +389,13 @@ void ArchiveReplicator::onReplicateWorkerFinished()
 	FLoadCollectionRequests.clear();
 	FSaveCollectionRequests.clear();
 	FRemoveCollectionRequests.clear();
+	FRequestModifications.clear();
 
+	FUpdateVersionsTimer.stop();
 	FSourceOrder.clear();
-	FDestinations.clear();
 	FModifications.clear();
+	FPendingVersions.clear();
+	FActiveModifications.clear();
 
 	foreach(IArchiveEngine *engine, FConnectedEngines)
 		disconnectEngine(engine);
@@ -389,6 +496,8 @@ void ArchiveReplicator::onReplicateWorkerTaskFinished(ReplicateTask *ATask)
 			QList<QUuid> engines = FLoadModifsTasks.take(task->taskId());
 			if (!task->isFailed() && !engines.isEmpty())
 			{
+				FReplicatedCount = 0;
+				FReplicateClock.start();
 				FModifications = task->modifications();
 				LOG_STRM_DEBUG(FStreamJid,QString("Replication modifications loaded, modifications=%1, engines=%2, id=%3").arg(FModifications.count()).arg(engines.count()).arg(task->taskId()));
 
@@ -420,16 +529,18 @@ void ArchiveReplicator::onReplicateWorkerTaskFinished(ReplicateTask *ATask)
 	case ReplicateTask::UpdateVersion:
 		{
 			ReplicateTaskUpdateVersion *task = static_cast<ReplicateTaskUpdateVersion *>(ATask);
-			IArchiveEngine *engine = FEngines.value(FUpdateVersionTasks.take(task->taskId()));
-			if (!task->isFailed() && engine!=NULL)
+			QList<QUuid> engines = FUpdateVersionTasks.take(task->taskId());
+			if (!task->isFailed())
 			{
-				LOG_STRM_DEBUG(FStreamJid,QString("Replication modification version updated, engine=%1, id=%2").arg(engine->engineId().toString(),task->taskId()));
-				FDestinations.removeAll(engine->engineId());
+				LOG_STRM_DEBUG(FStreamJid,QString("Replication modifications version updated, versions=%1, id=%2").arg(task->versions().count()).arg(task->taskId()));
+				FReplicatedCount += task->versions().count();
+				reportProgress();
 			}
-			else if (engine != NULL)
+			else
 			{
-				LOG_STRM_ERROR(FStreamJid,QString("Failed to update replication modification version, engine=%1, id=%2: %3").arg(engine->engineId().toString(),task->taskId(),task->error().databaseText()));
-				stopReplication(engine->engineId());
+				LOG_STRM_ERROR(FStreamJid,QString("Failed to update replication modifications version, versions=%1, id=%2: %3").arg(task->versions().count()).arg(task->taskId(),task->error().databaseText()));
+				foreach(const QUuid &engineId, engines)
+					stopReplication(engineId);
 			}
 			startNextModification();
 		}
@@ -452,14 +563,14 @@ void ArchiveReplicator::onEngineRequestFailed(const QString &AId, const XmppErro
 	{
 		QUuid engineId = FLoadCollectionRequests.take(AId);
 		LOG_STRM_WARNING(FStreamJid,QString("Failed to load collection, engine=%1, id=%2: %3").arg(engineId.toString(),AId,AError.condition()));
-		FDestinations.clear();
+		FActiveModifications.remove(FRequestModifications.take(AId));
 		startNextModification();
 	}
 	else if (FSaveCollectionRequests.contains(AId))
 	{
 		QUuid engineId = FSaveCollectionRequests.take(AId);
 		LOG_STRM_WARNING(FStreamJid,QString("Failed to save collection, engine=%1, id=%2: %3").arg(engineId.toString(),AId,AError.condition()));
-		FDestinations.removeAll(engineId);
+		removeDestination(FRequestModifications.take(AId),engineId);
 		startNextModification();
 	}
 	else if (FRemoveCollectionRequests.contains(AId))
@@ -468,7 +579,7 @@ void ArchiveReplicator::onEngineRequestFailed(const QString &AId, const XmppErro
 		{
 			QUuid engineId = FRemoveCollectionRequests.take(AId);
 			LOG_STRM_WARNING(FStreamJid,QString("Failed to remove collection, engine=%1, id=%2: %3").arg(engineId.toString(),AId,AError.condition()));
-			FDestinations.removeAll(engineId);
+			removeDestination(FRequestModifications.take(AId),engineId);
 			startNextModification();
 		}
 		else
@@ -485,10 +596,15 @@ void ArchiveReplicator::onEngineCollectionLoaded(const QString &AId, const IArch
 	if (FLoadCollectionRequests.contains(AId))
 	{
 		QUuid engineId =  FLoadCollectionRequests.take(AId);
-		if (ACollection.header == FModification.header)
+		quint32 modificationId = FRequestModifications.take(AId);
+		if (!FActiveModifications.contains(modificationId))
+		{
+			LOG_STRM_DEBUG(FStreamJid,QString("Collection loaded for canceled modification, engine=%1, id=%2").arg(engineId.toString(),AId));
+		}
+		else if (ACollection.header == FActiveModifications.value(modificationId).header)
 		{
 			LOG_STRM_DEBUG(FStreamJid,QString("Collection loaded, engine=%1, id=%2").arg(engineId.toString(),AId));
-			foreach(const QUuid &engineId, FDestinations)
+			foreach(const QUuid &engineId, FActiveModifications.value(modificationId).destinations)
 			{
 				IArchiveEngine *engine = FArchiver->findArchiveEngine(engineId);
 				if (engine)
@@ -498,11 +614,12 @@ void ArchiveReplicator::onEngineCollectionLoaded(const QString &AId, const IArch
 					{
 						LOG_STRM_DEBUG(FStreamJid,QString("Save collection request sent, engine=%1, with=%2, start=%3, id=%4").arg(engineId.toString(),ACollection.header.with.full(),ACollection.header.start.toString(Qt::ISODate),requestId));
 						FSaveCollectionRequests.insert(requestId,engineId);
+						FRequestModifications.insert(requestId,modificationId);
 					}
 					else
 					{
 						LOG_STRM_WARNING(FStreamJid,QString("Failed to send save collection request, engine=%1").arg(engineId.toString()));
-						FDestinations.removeAll(engineId);
+						removeDestination(modificationId,engineId);
 					}
 				}
 				else
@@ -515,7 +632,7 @@ void ArchiveReplicator::onEngineCollectionLoaded(const QString &AId, const IArch
 		else
 		{
 			REPORT_ERROR("Failed to load collection: Invalid header");
-			FDestinations.clear();
+			FActiveModifications.remove(modificationId);
 		}
 		startNextModification();
 	}
@@ -528,17 +645,10 @@ void ArchiveReplicator::onEngineCollectionSaved(const QString &AId, const IArchi
 		QUuid engineId = FSaveCollectionRequests.take(AId);
 		LOG_STRM_DEBUG(FStreamJid,QString("Collection saved, engine=%1, id=%2").arg(engineId.toString(),AId));
 
-		ReplicateTaskUpdateVersion *task = new ReplicateTaskUpdateVersion(engineId,FModification,ACollection.header.version);
-		if (FWorker->startTask(task))
-		{
-			LOG_STRM_DEBUG(FStreamJid,QString("Update replication modification version task started, engine=%1, version=%2, id=%3").arg(engineId.toString()).arg(ACollection.header.version).arg(task->taskId()));
-			FUpdateVersionTasks.insert(task->taskId(),engineId);
-		}
-		else
-		{
-			LOG_STRM_WARNING(FStreamJid,QString("Failed to start update replication modification version task, engine=%1").arg(engineId.toString()));
-			stopReplication(engineId);
-		}
+		quint32 modificationId = FRequestModifications.take(AId);
+		appendVersion(modificationId,engineId,ACollection.header.version);
+		removeDestination(modificationId,engineId);
+		startNextModification();
 	}
 }
 
@@ -550,17 +660,10 @@ void ArchiveReplicator::onEngineCollectionsRemoved(const QString &AId, const IAr
 		QUuid engineId = FRemoveCollectionRequests.take(AId);
 		LOG_STRM_DEBUG(FStreamJid,QString("Collection removed, engine=%1, id=%2").arg(engineId.toString(),AId));
 
-		ReplicateTaskUpdateVersion *task = new ReplicateTaskUpdateVersion(engineId,FModification,0);
-		if (FWorker->startTask(task))
-		{
-			LOG_STRM_DEBUG(FStreamJid,QString("Update replication modification version task started, engine=%1, version=%2, id=%3").arg(engineId.toString()).arg(0).arg(task->taskId()));
-			FUpdateVersionTasks.insert(task->taskId(),engineId);
-		}
-		else
-		{
-			LOG_STRM_WARNING(FStreamJid,QString("Failed to start update replication modification version task, engine=%1").arg(engineId.toString()));
-			stopReplication(engineId);
-		}
+		quint32 modificationId = FRequestModifications.take(AId);
+		appendVersion(modificationId,engineId,0);
+		removeDestination(modificationId,engineId);
+		startNextModification();
 	}
 }
 
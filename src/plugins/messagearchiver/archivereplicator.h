@@ -2,6 +2,7 @@
 #define ARCHIVEREPLICATOR_H
 
 #include <QTimer>
+#include <QElapsedTimer>
 #include <interfaces/imessagearchiver.h>
 #include "replicateworker.h"
 
@@ -22,9 +23,14 @@ protected:
 	void startSyncModifications();
 	void startSyncCollections();
 	void startNextModification();
+	void startUpdateVersions();
+	void appendVersion(quint32 AModificationId, const QUuid &AEngineId, quint32 AVersion);
+	void removeDestination(quint32 AModificationId, const QUuid &AEngineId);
+	void reportProgress() const;
 	void stopReplication(const QUuid &AEngineId);
 protected slots:
 	void onStartReplicateTimerTimeout();
+	void onUpdateVersionsTimerTimeout();
 protected slots:
 	void onReplicateWorkerReady();
 	void onReplicateWorkerFinished();
@@ -42,6 +48,7 @@ private:
 	Jid FStreamJid;
 	ReplicateWorker *FWorker;
 	QTimer FStartReplicateTimer;
+	QTimer FUpdateVersionsTimer;
 	QMap<QUuid, IArchiveEngine *> FEngines;
 	QList<IArchiveEngine *> FConnectedEngines;
 private:
@@ -52,12 +59,16 @@ private:
 	QMap<QString, QUuid> FSaveCollectionRequests;
 	QMap<QString, QUuid> FLoadCollectionRequests;
 	QMap<QString, QUuid> FRemoveCollectionRequests;
-	QMap<QString, QUuid> FUpdateVersionTasks;
+	QMap<QString, quint32> FRequestModifications;
+	QMap<QString, QList<QUuid> > FUpdateVersionTasks;
 private:
+	int FReplicatedCount;
+	quint32 FModificationId;
+	QElapsedTimer FReplicateClock;
 	QList<QUuid> FSourceOrder;
-	QList<QUuid> FDestinations;
-	ReplicateModification FModification;
+	QList<ReplicateVersion> FPendingVersions;
 	QList<ReplicateModification> FModifications;
+	QMap<quint32, ReplicateModification> FActiveModifications;
 };
 
 #endif // ARCHIVEREPLICATOR_H
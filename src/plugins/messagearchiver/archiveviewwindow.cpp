@@ -1,6 +1,7 @@
 #include "archiveviewwindow.h"
 
 #include <QLocale>
+#include <QScrollBar>
 #include <QMessageBox>
 #include <QItemSelectionModel>
 #include <QNetworkAccessManager>
@@ -21,6 +22,7 @@
 #define MIN_LOAD_HEADERS             50
 #define MAX_HILIGHT_ITEMS            10
 #define LOAD_COLLECTION_TIMEOUT      100
+#define SHOW_COLLECTION_ITEMS        100
 
 enum HistoryItemType {
 	HIT_CONTACT,
@@ -93,6 +95,8 @@ ArchiveViewWindow::ArchiveViewWindow(IPluginManager *APluginManager, IMessageArc
 
 	FFocusWidget = NULL;
 	FArchiver = AArchiver;
+	FCanLoadMoreHeaders = false;
+	FLoadingMoreHeaders = false;
 
 	FStatusIcons = NULL;
 	FUrlProcessor = NULL;
@@ -158,6 +162,7 @@ ArchiveViewWindow::ArchiveViewWindow(IPluginManager *APluginManager, IMessageArc
 	connect(ui.trvHeaders->selectionModel(),SIGNAL(currentChanged(const QModelIndex &, const QModelIndex &)),
 		SLOT(onCurrentItemChanged(const QModelIndex &, const QModelIndex &)));
 	connect(ui.trvHeaders,SIGNAL(customContextMenuRequested(const QPoint &)),SLOT(onHeaderContextMenuRequested(const QPoint &)));
+	connect(ui.trvHeaders->verticalScrollBar(),SIGNAL(actionTriggered(int)),SLOT(onHeadersScrollBarActionTriggered(int)));
 	
 	FHeadersRequestTimer.setSingleShot(true);
 	connect(&FHeadersRequestTimer,SIGNAL(timeout()),SLOT(onHeadersRequestTimerTimeout()));
@@ -529,7 +534,10 @@ void ArchiveViewWindow::setHeaderStatus(RequestStatus AStatus, const QString &AM
 	else
 		FHeadersLoaded = 0;
 
-	ui.trvHeaders->setEnabled(AStatus != RequestStarted);
+	FCanLoadMoreHeaders = AStatus==RequestFinished && FHistoryTime<HistoryTimeCount;
+
+	// Headers fetched on scrolling must not interrupt work with already loaded ones
+	ui.trvHeaders->setEnabled(AStatus!=RequestStarted || FLoadingMoreHeaders);
 	ui.wdtArchiveSearch->setEnabled(AStatus!=RequestStarted && FArchiveSearchEnabled);
 
 	FHeaderActionLabel->disconnect(this);
@@ -553,8 +561,11 @@ void ArchiveViewWindow::setHeaderStatus(RequestStatus AStatus, const QString &AM
 		else
 			ui.stbStatusBar->showMessage(tr("Conversation headers are not found"));
 
-		ui.trvHeaders->selectionModel()->clearSelection();
-		ui.trvHeaders->setCurrentIndex(QModelIndex());
+		if (!FLoadingMoreHeaders)
+		{
+			ui.trvHeaders->selectionModel()->clearSelection();
+			ui.trvHeaders->setCurrentIndex(QModelIndex());
+		}
 	}
 	else if(AStatus == RequestStarted)
 	{
@@ -707,8 +718,13 @@ void ArchiveViewWindow::clearMessages()
 {
 	FSearchResults.clear();
 	ui.tbrMessages->clear();
+	removeCollectionBodies(FSelectedHeaders);
 	FSelectedHeaders.clear();
 	FSelectedHeaderIndex = 0;
+	FShownMessages = 0;
+	FShownNotes = 0;
+	FShownHeader = ArchiveHeader();
+	FCollectionsRequests.clear();
 	FCollectionsProcessTimer.stop();
 	setMessageStatus(RequestFinished);
 }
@@ -746,46 +762,64 @@ ArchiveHeader ArchiveViewWindow::loadingCollectionHeader() const
 
 void ArchiveViewWindow::showCollection(const ArchiveCollection &ACollection)
 {
-	if (FSelectedHeaderIndex == 0)
+	// Shown parts are counted for one collection only, it may be replaced or removed while rendering
+	if (FShownHeader != ACollection.header)
 	{
-		ui.tbrMessages->clear();
+		FShownHeader = ACollection.header;
+		FShownMessages = 0;
+		FShownNotes = 0;
+	}
+	FShownMessages = qMin(FShownMessages,ACollection.body.messages.count());
+	FShownNotes = qMin(FShownNotes,ACollection.body.notes.count());
 
-		FViewOptions.isPrivateChat = isConferencePrivateChat(ACollection.header.with);
+	QString html;
+	if (FShownMessages==0 && FShownNotes==0)
+	{
+		if (FSelectedHeaderIndex == 0)
+		{
+			ui.tbrMessages->clear();
 
-		FViewOptions.isGroupChat = false;
-		if (!FViewOptions.isPrivateChat)
-			for (int i=0; !FViewOptions.isGroupChat && i<ACollection.body.messages.count(); i++)
-				FViewOptions.isGroupChat = ACollection.body.messages.at(i).type()==Message::GroupChat;
+			FViewOptions.isPrivateChat = isConferencePrivateChat(ACollection.header.with);
 
-		if (FMessageStyles)
-		{
-			IMessageStyleOptions soptions = FMessageStyles->styleOptions(FViewOptions.isGroupChat ? Message::GroupChat : Message::Chat);
-			FViewOptions.style = FViewOptions.isGroupChat ? FMessageStyles->styleForOptions(soptions) : NULL;
-		}
-		else
-		{
-			FViewOptions.style = NULL;
+			FViewOptions.isGroupChat = false;
+			if (!FViewOptions.isPrivateChat)
+				for (int i=0; !FViewOptions.isGroupChat && i<ACollection.body.messages.count(); i++)
+					FViewOptions.isGroupChat = ACollection.body.messages.at(i).type()==Message::GroupChat;
+
+			if (FMessageStyles)
+			{
+				IMessageStyleOptions soptions = FMessageStyles->styleOptions(FViewOptions.isGroupChat ? Message::GroupChat : Message::Chat);
+				FViewOptions.style = FViewOptions.isGroupChat ? FMessageStyles->styleForOptions(soptions) : NULL;
+			}
+			else
+			{
+				FViewOptions.style = NULL;
+			}
+
+			FViewOptions.lastInfo = QString::null;
+			FViewOptions.lastSubject = QString::null;
 		}
 
-		FViewOptions.lastInfo = QString::null;
-		FViewOptions.lastSubject = QString::null;
-	}
+		FViewOptions.lastTime = QDateTime();
+		FViewOptions.lastSenderId = QString::null;
 
-	FViewOptions.lastTime = QDateTime();
-	FViewOptions.lastSenderId = QString::null;
+		if (!FViewOptions.isPrivateChat)
+			FViewOptions.senderName = Qt::escape(FMessageStyles!=NULL ? FMessageStyles->contactName(ACollection.header.stream,ACollection.header.with) : contactName(ACollection.header.stream,ACollection.header.with));
+		else
+			FViewOptions.senderName = Qt::escape(ACollection.header.with.resource());
+		FViewOptions.selfName = Qt::escape(FMessageStyles!=NULL ? FMessageStyles->contactName(ACollection.header.stream) : ACollection.header.stream.uBare());
 
-	if (!FViewOptions.isPrivateChat)
-		FViewOptions.senderName = Qt::escape(FMessageStyles!=NULL ? FMessageStyles->contactName(ACollection.header.stream,ACollection.header.with) : contactName(ACollection.header.stream,ACollection.header.with));
-	else
-		FViewOptions.senderName = Qt::escape(ACollection.header.with.resource());
-	FViewOptions.selfName = Qt::escape(FMessageStyles!=NULL ? FMessageStyles->contactName(ACollection.header.stream) : ACollection.header.stream.uBare());
+		html += showInfo(ACollection);
+	}
 
-	QString html = showInfo(ACollection);
+	// Large collections are shown by parts to keep window responsive
+	QList<Message>::const_iterator messageIt = ACollection.body.messages.constBegin()+FShownMessages;
+	QMultiMap<QDateTime,QString>::const_iterator noteIt = ACollection.body.notes.constBegin();
+	for (int i=0; i<FShownNotes; i++)
+		++noteIt;
 
 	IMessageContentOptions options;
-	QList<Message>::const_iterator messageIt = ACollection.body.messages.constBegin();
-	QMultiMap<QDateTime,QString>::const_iterator noteIt = ACollection.body.notes.constBegin();
-	while (noteIt!=ACollection.body.notes.constEnd() || messageIt!=ACollection.body.messages.constEnd())
+	for (int shown=0; shown<SHOW_COLLECTION_ITEMS && (noteIt!=ACollection.body.notes.constEnd() || messageIt!=ACollection.body.messages.constEnd()); shown++)
 	{
 		if (messageIt!=ACollection.body.messages.constEnd() && (noteIt==ACollection.body.notes.constEnd() || messageIt->dateTime()<noteIt.key()))
 		{
@@ -820,6 +854,7 @@ void ArchiveViewWindow::showCollection(const ArchiveCollection &ACollection)
 
 			html += showMessage(*messageIt,options);
 			++messageIt;
+			FShownMessages++;
 		}
 		else if (noteIt != ACollection.body.notes.constEnd())
 		{
@@ -832,6 +867,7 @@ void ArchiveViewWindow::showCollection(const ArchiveCollection &ACollection)
 
 			html += showNote(*noteIt,options);
 			++noteIt;
+			FShownNotes++;
 		}
 	}
 
@@ -839,10 +875,25 @@ void ArchiveViewWindow::showCollection(const ArchiveCollection &ACollection)
 	cursor.movePosition(QTextCursor::End);
 	cursor.insertHtml(html);
 
-	FSelectedHeaderIndex++;
+	if (noteIt==ACollection.body.notes.constEnd() && messageIt==ACollection.body.messages.constEnd())
+	{
+		FShownNotes = 0;
+		FShownMessages = 0;
+		FSelectedHeaderIndex++;
+	}
 	setMessageStatus(RequestStarted);
 }
 
+void ArchiveViewWindow::removeCollectionBodies(const QList<ArchiveHeader> &AHeaders)
+{
+	foreach(const ArchiveHeader &header, AHeaders)
+	{
+		QMap<ArchiveHeader,ArchiveCollection>::iterator it = FCollections.find(header);
+		if (it != FCollections.end())
+			it->body = IArchiveCollectionBody();
+	}
+}
+
 QString ArchiveViewWindow::showInfo(const ArchiveCollection &ACollection)
 {
 	static const QString infoTmpl =
@@ -1254,6 +1305,7 @@ void ArchiveViewWindow::onHeadersRequestTimerTimeout()
 		}
 		request.order = Qt::DescendingOrder;
 		request.text = ui.lneArchiveSearch->text().trimmed();
+		FLoadingMoreHeaders = !FCollections.isEmpty();
 
 		for(QMultiMap<Jid,Jid>::const_iterator it=FAddresses.constBegin(); it!=FAddresses.constEnd(); ++it)
 		{
@@ -1285,6 +1337,17 @@ void ArchiveViewWindow::onHeadersLoadMoreLinkClicked()
 	}
 }
 
+void ArchiveViewWindow::onHeadersScrollBarActionTriggered(int AAction)
+{
+	// Next history period is loaded only when the user scrolls to the end of the tree
+	QScrollBar *scrollBar = ui.trvHeaders->verticalScrollBar();
+	if (FCanLoadMoreHeaders && AAction!=QAbstractSlider::SliderNoAction && scrollBar->maximum()>0 && scrollBar->sliderPosition()>=scrollBar->maximum())
+	{
+		FCanLoadMoreHeaders = false;
+		onHeadersLoadMoreLinkClicked();
+	}
+}
+
 void ArchiveViewWindow::onCollectionsRequestTimerTimeout()
 {
 	QModelIndex index = FProxyModel->mapToSource(ui.trvHeaders->selectionModel()->currentIndex());
@@ -1338,6 +1401,8 @@ void ArchiveViewWindow::onArchiveRequestFailed(const QString &AId, const XmppErr
 		ArchiveHeader header = FCollectionsRequests.take(AId);
 		if (loadingCollectionHeader() == header)
 		{
+			FShownMessages = 0;
+			FShownNotes = 0;
 			FSelectedHeaders.removeAt(FSelectedHeaderIndex);
 			if (FSelectedHeaders.isEmpty())
 				setMessageStatus(RequestError, AError.errorMessage());
@@ -1387,11 +1452,11 @@ void ArchiveViewWindow::onArchiveCollectionLoaded(const QString &AId, const IArc
 		ArchiveHeader header = FCollectionsRequests.take(AId);
 		ArchiveCollection collection = convertCollection(header.stream,ACollection);
 
-		FCollections.insert(header,collection);
 		if (loadingCollectionHeader() == header)
 		{
+			FCollections.insert(header,collection);
 			showCollection(collection);
-			processCollectionsLoad();
+			FCollectionsProcessTimer.start(0);
 		}
 	}
 }
@@ -112,6 +112,7 @@ protected:
 	void processCollectionsLoad();
 	ArchiveHeader loadingCollectionHeader() const;
 	void showCollection(const ArchiveCollection &ACollection);
+	void removeCollectionBodies(const QList<ArchiveHeader> &AHeaders);
 	QString showInfo(const ArchiveCollection &ACollection);
 	QString showNote(const QString &ANote, const IMessageContentOptions &AOptions);
 	QString showMessage(const Message &AMessage, const IMessageContentOptions &AOptions);
@@ -129,6 +130,7 @@ protected slots:
 protected slots:
 	void onHeadersRequestTimerTimeout();
 	void onHeadersLoadMoreLinkClicked();
+	void onHeadersScrollBarActionTriggered(int AAction);
 	void onCollectionsRequestTimerTimeout();
 	void onCollectionsProcessTimerTimeout();
 	void onCurrentItemChanged(const QModelIndex &ACurrent, const QModelIndex &ABefore);
@@ -164,12 +166,17 @@ private:
 private:
 	int FHistoryTime;
 	int FHeadersLoaded;
+	bool FCanLoadMoreHeaders;
+	bool FLoadingMoreHeaders;
 	QWidget *FFocusWidget;
 	QTimer FHeadersRequestTimer;
 	QMap<QString, Jid> FRemoveRequests;
 	QMap<QString, Jid> FHeadersRequests;
 private:
 	int FSelectedHeaderIndex;
+	int FShownMessages;
+	int FShownNotes;
+	ArchiveHeader FShownHeader;
 	ViewOptions FViewOptions;
 	QTimer FCollectionsRequestTimer;
 	QTimer FCollectionsProcessTimer;
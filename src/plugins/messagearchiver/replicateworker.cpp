@@ -375,56 +375,58 @@ void ReplicateTaskLoadModifications::run(QSqlDatabase &ADatabase)
 }
 
 // ReplicateTaskUpdateVersion
-ReplicateTaskUpdateVersion::ReplicateTaskUpdateVersion(const QUuid &AEngineId, const ReplicateModification &AModification, quint32 AVersion) : ReplicateTask(ReplicateTask::UpdateVersion)
+ReplicateTaskUpdateVersion::ReplicateTaskUpdateVersion(const QList<ReplicateVersion> &AVersions) : ReplicateTask(ReplicateTask::UpdateVersion)
 {
-	FEngineId = AEngineId;
-	FVersion = AVersion;
-	FModification = AModification;
+	FVersions = AVersions;
 }
 
-QUuid ReplicateTaskUpdateVersion::engineId() const
+QList<ReplicateVersion> ReplicateTaskUpdateVersion::versions() const
 {
-	return FEngineId;
+	return FVersions;
 }
 
 void ReplicateTaskUpdateVersion::run(QSqlDatabase &ADatabase)
 {
 	if (ADatabase.isOpen())
 	{
+		ADatabase.transaction();
+
 		QSqlQuery getHeaderParamsQuery(ADatabase);
 		if (!getHeaderParamsQuery.prepare("SELECT hid, aid FROM (SELECT id AS hid FROM headers WHERE with==:with AND start==:start) JOIN (SELECT id AS aid FROM archives WHERE engine_id==:engine_id)"))
+			SET_ERROR_AND_EXIT(getHeaderParamsQuery);
+
+		QSqlQuery updateVersionQuery(ADatabase);
+		if (!updateVersionQuery.prepare("INSERT OR REPLACE INTO versions (header_id, archive_id, version, modification) VALUES (:header_id, :archive_id, :version, :modification)"))
+			SET_ERROR_AND_EXIT(updateVersionQuery);
+
+		foreach(const ReplicateVersion &version, FVersions)
 		{
-			setSQLError(getHeaderParamsQuery.lastError());
-		}
-		else
-		{
-			getHeaderParamsQuery.bindValue(":engine_id",FEngineId.toString());
-			getHeaderParamsQuery.bindValue(":with",FModification.header.with.pFull());
-			getHeaderParamsQuery.bindValue(":start",DateTime(FModification.header.start).toX85UTC());
+			getHeaderParamsQuery.bindValue(":engine_id",version.engineId.toString());
+			getHeaderParamsQuery.bindValue(":with",version.modification.header.with.pFull());
+			getHeaderParamsQuery.bindValue(":start",DateTime(version.modification.header.start).toX85UTC());
 
-			if (!getHeaderParamsQuery.exec() || !getHeaderParamsQuery.next())
+			if (!getHeaderParamsQuery.exec())
+				SET_ERROR_AND_EXIT(getHeaderParamsQuery);
+
+			if (!getHeaderParamsQuery.next())
 			{
-				setSQLError(getHeaderParamsQuery.lastError());
+				LOG_WARNING(QString("Skipping replication version update, header not found: with=%1, start=%2, engine=%3").arg(version.modification.header.with.full(),version.modification.header.start.toString(Qt::ISODate),version.engineId.toString()));
+				getHeaderParamsQuery.finish();
+				continue;
 			}
-			else
-			{
-				QSqlQuery updateVersionQuery(ADatabase);
-				if (!updateVersionQuery.prepare("INSERT OR REPLACE INTO versions (header_id, archive_id, version, modification) VALUES (:header_id, :archive_id, :version, :modification)"))
-				{
-					setSQLError(updateVersionQuery.lastError());
-				}
-				else
-				{
-					updateVersionQuery.bindValue(":header_id",getHeaderParamsQuery.value(0));
-					updateVersionQuery.bindValue(":archive_id",getHeaderParamsQuery.value(1));
-					updateVersionQuery.bindValue(":version",FModification.action!=IArchiveModification::Removed ? (qint64)FVersion : DELETED_HEADER_VERSION);
-					updateVersionQuery.bindValue(":modification",FModification.number);
 
-					if (!updateVersionQuery.exec())
-						setSQLError(updateVersionQuery.lastError());
-				}
-			}
+			updateVersionQuery.bindValue(":header_id",getHeaderParamsQuery.value(0));
+			updateVersionQuery.bindValue(":archive_id",getHeaderParamsQuery.value(1));
+			updateVersionQuery.bindValue(":version",version.modification.action!=IArchiveModification::Removed ? (qint64)version.version : DELETED_HEADER_VERSION);
+			updateVersionQuery.bindValue(":modification",version.modification.number);
+
+			if (!updateVersionQuery.exec())
+				SET_ERROR_AND_EXIT(updateVersionQuery);
+
+			getHeaderParamsQuery.finish();
 		}
+
+		ADatabase.commit();
 	}
 	else
 	{
@@ -17,6 +17,12 @@ struct ReplicateModification {
 	IArchiveModification::ModifyAction action;
 };
 
+struct ReplicateVersion {
+	QUuid engineId;
+	quint32 version;
+	ReplicateModification modification;
+};
+
 class ReplicateTask
 {
 	friend class ReplicateWorker;
@@ -96,14 +102,12 @@ class ReplicateTaskUpdateVersion :
 	public ReplicateTask
 {
 public:
-	ReplicateTaskUpdateVersion(const QUuid &AEngineId, const ReplicateModification &AModification, quint32 AVersion);
-	QUuid engineId() const;
+	ReplicateTaskUpdateVersion(const QList<ReplicateVersion> &AVersions);
+	QList<ReplicateVersion> versions() const;
 protected:
 	void run(QSqlDatabase &ADatabase);
 private:
-	QUuid FEngineId;
-	quint32 FVersion;
-	ReplicateModification FModification;
+	QList<ReplicateVersion> FVersions;
 };
 
 class ReplicateWorker :
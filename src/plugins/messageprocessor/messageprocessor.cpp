@@ -84,12 +84,19 @@ bool MessageProcessor::stanzaReadWrite(int AHandlerId, const Jid &AStreamJid, St
 	return false;
 }
 
-void MessageProcessor::writeTextToMessage(int AOrder, Message &AMessage, QTextDocument *ADocument, const QString &ALang)
+bool MessageProcessor::checkMessageToText(int AOrder, const Message &AMessage, const QString &ALang)
 {
 	if (AOrder == MWO_MESSAGEPROCESSOR)
 	{
-		AMessage.setBody(prepareBodyForSend(ADocument->toPlainText()),ALang);
+		return true;
+	}
+	else if (AOrder == MWO_MESSAGEPROCESSOR_ANCHORS)
+	{
+		// Every link prefix except "www." contains a colon
+		QString body = AMessage.body(ALang);
+		return body.contains(':') || body.contains("www.",Qt::CaseInsensitive);
 	}
+	return false;
 }
 
 void MessageProcessor::writeMessageToText(int AOrder, Message &AMessage, QTextDocument *ADocument, const QString &ALang)
@@ -97,7 +104,11 @@ void MessageProcessor::writeMessageToText(int AOrder, Message &AMessage, QTextDo
 	if (AOrder == MWO_MESSAGEPROCESSOR)
 	{
 		QTextCursor cursor(ADocument);
-		cursor.insertHtml(prepareBodyForReceive(AMessage.body(ALang)));
+		QString body = AMessage.body(ALang);
+		if (isPlainTextBody(body))
+			cursor.insertText(body,QTextCharFormat());
+		else
+			cursor.insertHtml(prepareBodyForReceive(body));
 	}
 	else if (AOrder == MWO_MESSAGEPROCESSOR_ANCHORS)
 	{
@@ -117,6 +128,20 @@ void MessageProcessor::writeMessageToText(int AOrder, Message &AMessage, QTextDo
 	}
 }
 
+bool MessageProcessor::checkTextToMessage(int AOrder, const QTextDocument *ADocument, const QString &ALang)
+{
+	Q_UNUSED(ADocument); Q_UNUSED(ALang);
+	return AOrder == MWO_MESSAGEPROCESSOR;
+}
+
+void MessageProcessor::writeTextToMessage(int AOrder, Message &AMessage, QTextDocument *ADocument, const QString &ALang)
+{
+	if (AOrder == MWO_MESSAGEPROCESSOR)
+	{
+		AMessage.setBody(prepareBodyForSend(ADocument->toPlainText()),ALang);
+	}
+}
+
 QList<Jid> MessageProcessor::activeStreams() const
 {
 	return FActiveStreams.keys();
@@ -261,15 +286,32 @@ void MessageProcessor::removeMessageNotify(int AMessageId)
 
 void MessageProcessor::textToMessage(Message &AMessage, const QTextDocument *ADocument, const QString &ALang) const
 {
-	QTextDocument *documentCopy = ADocument->clone();
+	bool cloneRequired = false;
+	QList< QPair<int,IMessageWriter *> > writers;
 	QMapIterator<int,IMessageWriter *> it(FMessageWriters);
 	it.toBack();
 	while (it.hasPrevious())
 	{
 		it.previous();
-		it.value()->writeTextToMessage(it.key(),AMessage,documentCopy,ALang);
+		if (it.value()->checkTextToMessage(it.key(),ADocument,ALang))
+		{
+			writers.append(qMakePair(it.key(),it.value()));
+			cloneRequired = cloneRequired || it.key()!=MWO_MESSAGEPROCESSOR || it.value()!=static_cast<const IMessageWriter *>(this);
+		}
+	}
+
+	// Document is cloned only if some writer is going to modify it
+	if (cloneRequired)
+	{
+		QTextDocument *documentCopy = ADocument->clone();
+		for (int i=0; i<writers.count(); i++)
+			writers.at(i).second->writeTextToMessage(writers.at(i).first,AMessage,documentCopy,ALang);
+		delete documentCopy;
+	}
+	else if (!writers.isEmpty())
+	{
+		AMessage.setBody(prepareBodyForSend(ADocument->toPlainText()),ALang);
 	}
-	delete documentCopy;
 }
 
 void MessageProcessor::messageToText(QTextDocument *ADocument, const Message &AMessage, const QString &ALang) const
@@ -280,7 +322,8 @@ void MessageProcessor::messageToText(QTextDocument *ADocument, const Message &AM
 	while (it.hasNext())
 	{
 		it.next();
-		it.value()->writeMessageToText(it.key(),messageCopy,ADocument,ALang);
+		if (it.value()->checkMessageToText(it.key(),messageCopy,ALang))
+			it.value()->writeMessageToText(it.key(),messageCopy,ADocument,ALang);
 	}
 }
 
@@ -391,6 +434,32 @@ QString MessageProcessor::prepareBodyForReceive(const QString &AString) const
 	return result;
 }
 
+bool MessageProcessor::isPlainTextBody(const QString &AString) const
+{
+	if (AString.isEmpty() || AString.at(0).isSpace() || AString.at(AString.length()-1).isSpace())
+		return false;
+
+	bool space = false;
+	for (const QChar *ch = AString.constData(), *end = ch+AString.length(); ch<end; ++ch)
+	{
+		if (ch->isSpace())
+		{
+			if (space || *ch!=QChar(' '))
+				return false;
+			space = true;
+		}
+		else if (*ch==QChar::Null || *ch==QChar::ObjectReplacementCharacter)
+		{
+			return false;
+		}
+		else
+		{
+			space = false;
+		}
+	}
+	return true;
+}
+
 void MessageProcessor::onNotificationActivated(int ANotifyId)
 {
 	if (FNotifyId2MessageId.contains(ANotifyId))
@@ -30,8 +30,10 @@ public:
 	//IStanzaHandler
 	virtual bool stanzaReadWrite(int AHandlerId, const Jid &AStreamJid, Stanza &AStanza, bool &AAccept);
 	//IMessageWriter
-	virtual void writeTextToMessage(int AOrder, Message &AMessage, QTextDocument *ADocument, const QString &ALang);
+	virtual bool checkMessageToText(int AOrder, const Message &AMessage, const QString &ALang);
 	virtual void writeMessageToText(int AOrder, Message &AMessage, QTextDocument *ADocument, const QString &ALang);
+	virtual bool checkTextToMessage(int AOrder, const QTextDocument *ADocument, const QString &ALang);
+	virtual void writeTextToMessage(int AOrder, Message &AMessage, QTextDocument *ADocument, const QString &ALang);
 	//IMessageProcessor
 	virtual QList<Jid> activeStreams() const;
 	virtual bool isActiveStream(const Jid &AStreamJid) const;
@@ -71,6 +73,7 @@ protected:
 	void notifyMessage(IMessageHandler *AHandler, const Message &AMessage, int ADirection);
 	QString prepareBodyForSend(const QString &AString) const;
 	QString prepareBodyForReceive(const QString &AString) const;
+	bool isPlainTextBody(const QString &AString) const;
 protected slots:
 	void onNotificationActivated(int ANotifyId);
 	void onNotificationRemoved(int ANotifyId);
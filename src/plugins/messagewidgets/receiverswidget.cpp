@@ -14,6 +14,7 @@
 #define ADR_ITEMS                  Action::DR_Parametr1
 
 #define RIDR_ITEM_COLLAPSED        RDR_USER_ROLE+111
+#define RIDR_ITEM_FETCHED          RDR_USER_ROLE+112
 
 ReceiversSortSearchProxyModel::ReceiversSortSearchProxyModel(QObject *AParent) : QSortFilterProxyModel(AParent)
 {
@@ -64,7 +65,11 @@ bool ReceiversSortSearchProxyModel::lessThan(const QModelIndex &ALeft, const QMo
 bool ReceiversSortSearchProxyModel::filterAcceptsRow(int AModelRow, const QModelIndex &AModelParent) const
 {
 	QModelIndex index = sourceModel()->index(AModelRow,0,AModelParent);
-	if (sourceModel()->hasChildren(index))
+	if (filterRegExp().isEmpty() && sourceModel()->canFetchMore(index))
+	{
+		return true;
+	}
+	else if (sourceModel()->hasChildren(index))
 	{
 		for (int childRow = 0; index.child(childRow,0).isValid(); childRow++)
 			if (filterAcceptsRow(childRow,index))
@@ -80,6 +85,28 @@ bool ReceiversSortSearchProxyModel::filterAcceptsRow(int AModelRow, const QModel
 	return QSortFilterProxyModel::filterAcceptsRow(AModelRow,AModelParent);
 }
 
+ReceiversItemModel::ReceiversItemModel(QObject *AParent) : AdvancedItemModel(AParent)
+{
+
+}
+
+bool ReceiversItemModel::hasChildren(const QModelIndex &AParent) const
+{
+	return canFetchMore(AParent) || AdvancedItemModel::hasChildren(AParent);
+}
+
+bool ReceiversItemModel::canFetchMore(const QModelIndex &AParent) const
+{
+	QStandardItem *item = AParent.isValid() ? itemFromIndex(AParent) : NULL;
+	return item!=NULL && item->data(RDR_KIND).toInt()==RIK_GROUP && !item->data(RIDR_ITEM_FETCHED).toBool();
+}
+
+void ReceiversItemModel::fetchMore(const QModelIndex &AParent)
+{
+	if (canFetchMore(AParent))
+		emit itemFetchRequested(itemFromIndex(AParent));
+}
+
 ReceiversWidget::ReceiversWidget(IMessageWidgets *AMessageWidgets, IMessageWindow *AWindow, QWidget *AParent) : QWidget(AParent)
 {
 	ui.setupUi(this);
@@ -95,12 +122,15 @@ ReceiversWidget::ReceiversWidget(IMessageWidgets *AMessageWidgets, IMessageWindo
 	FAccountManager = NULL;
 	FMessageProcessor = NULL;
 
+	FFetchingItems = false;
+
 	AdvancedItemDelegate *itemDelegate = new AdvancedItemDelegate(this);
 	itemDelegate->setItemsRole(RDR_LABEL_ITEMS);
 	ui.trvReceivers->setItemDelegate(itemDelegate);
 
-	FModel = new AdvancedItemModel(this);
+	FModel = new ReceiversItemModel(this);
 	FModel->setRecursiveParentDataChangedSignals(true);
+	connect(FModel,SIGNAL(itemFetchRequested(QStandardItem *)),SLOT(onModelItemFetchRequested(QStandardItem *)));
 	connect(FModel,SIGNAL(itemInserted(QStandardItem *)),SLOT(onModelItemInserted(QStandardItem *)));
 	connect(FModel,SIGNAL(itemRemoving(QStandardItem *)),SLOT(onModelItemRemoving(QStandardItem *)));
 	connect(FModel,SIGNAL(itemDataChanged(QStandardItem *,int)),SLOT(onModelItemDataChanged(QStandardItem *,int)));
@@ -182,7 +212,7 @@ void ReceiversWidget::contextMenuForItems(QList<QStandardItem *> AItems, Menu *A
 {
 	bool allHasChildren = true;
 	foreach(QStandardItem *item, AItems)
-		if (!item->hasChildren())
+		if (!item->hasChildren() && !FModel->canFetchMore(item->index()))
 			allHasChildren = false;
 
 	if (allHasChildren)
@@ -284,6 +314,21 @@ void ReceiversWidget::setGroupSelection(const Jid &AStreamJid, const QString &AG
 void ReceiversWidget::setAddressSelection(const Jid &AStreamJid, const Jid &AContactJid, bool ASelected)
 {
 	QList<QStandardItem *> contactItems = findContactItems(AStreamJid,AContactJid);
+	if (ASelected && contactItems.isEmpty() && FStreamItems.contains(AStreamJid))
+	{
+		IRoster *roster = FRosterPlugin!=NULL ? FRosterPlugin->findRoster(AStreamJid) : NULL;
+		IRosterItem ritem = roster!=NULL ? roster->rosterItem(AContactJid) : IRosterItem();
+		if (ritem.isValid)
+		{
+			int groupOrder;
+			QList<QStandardItem *> groupItems;
+			foreach(const QString &group, rosterItemGroups(ritem,groupOrder))
+				if (FGroupItems.value(AStreamJid).contains(group))
+					groupItems.append(FGroupItems.value(AStreamJid).value(group));
+			fetchGroupItems(groupItems);
+			contactItems = findContactItems(AStreamJid,AContactJid);
+		}
+	}
 	if (ASelected && contactItems.isEmpty() && FStreamItems.contains(AStreamJid) && AContactJid.isValid())
 	{
 		QString group = FRostersModel!=NULL ? FRostersModel->singleGroupName(RIK_GROUP_NOT_IN_ROSTER) : tr("Not in Roster");
@@ -357,9 +402,22 @@ void ReceiversWidget::createStreamItems(const Jid &AStreamJid)
 {
 	if (getStreamItem(AStreamJid))
 	{
+		// Only group items are created here, contacts are fetched when group is expanded or selected
+		QMap<QString, int> groupOrders;
+		QHash<QString, int> &groupsCount = FGroupContactsCount[AStreamJid];
 		IRoster *roster = FRosterPlugin!=NULL ? FRosterPlugin->findRoster(AStreamJid) : NULL;
 		foreach(const IRosterItem &ritem, roster!=NULL ? roster->rosterItems() : QList<IRosterItem>())
-			onRosterItemReceived(roster,ritem,IRosterItem());
+		{
+			int groupOrder;
+			foreach(const QString &group, rosterItemGroups(ritem,groupOrder))
+			{
+				groupsCount[group]++;
+				groupOrders.insert(group,groupOrder);
+			}
+		}
+
+		for (QMap<QString, int>::const_iterator it=groupOrders.constBegin(); it!=groupOrders.constEnd(); ++it)
+			getGroupItem(AStreamJid,it.key(),it.value());
 	}
 }
 
@@ -379,6 +437,7 @@ void ReceiversWidget::destroyStreamItems(const Jid &AStreamJid)
 		FStreamItems.remove(AStreamJid);
 		FContactItems.remove(AStreamJid);
 		FGroupItems.remove(AStreamJid);
+		FGroupContactsCount.remove(AStreamJid);
 	}
 }
 
@@ -431,10 +490,11 @@ QStandardItem *ReceiversWidget::getGroupItem(const Jid &AStreamJid, const QStrin
 
 		groupItem->setForeground(ui.trvReceivers->palette().color(QPalette::Active, QPalette::Highlight));
 
+		groupItem->setData(true,RIDR_ITEM_COLLAPSED);
+		groupItem->setData(false,RIDR_ITEM_FETCHED);
+
 		QStandardItem *parentItem = groupPath.isEmpty() ? getStreamItem(AStreamJid) : getGroupItem(AStreamJid,groupPath.join(ROSTER_GROUP_DELIMITER),AGroupOrder);
 		parentItem->appendRow(groupItem);
-
-		ui.trvReceivers->expand(mapModelToView(groupItem));
 	}
 	return groupItem;
 }
@@ -474,6 +534,99 @@ QStandardItem *ReceiversWidget::getContactItem(const Jid &AStreamJid, const Jid
 	return contactItem;
 }
 
+QSet<QString> ReceiversWidget::rosterItemGroups(const IRosterItem &AItem, int &AGroupOrder) const
+{
+	QSet<QString> groups;
+	if (AItem.itemJid.node().isEmpty())
+	{
+		AGroupOrder = RIKO_GROUP_AGENTS;
+		groups += FRostersModel!=NULL ? FRostersModel->singleGroupName(RIK_GROUP_AGENTS) : tr("Agents");
+	}
+	else if (AItem.groups.isEmpty())
+	{
+		AGroupOrder = RIKO_GROUP_BLANK;
+		groups += FRostersModel!=NULL ? FRostersModel->singleGroupName(RIK_GROUP_BLANK) : tr("Without Groups");
+	}
+	else
+	{
+		AGroupOrder = RIKO_GROUP;
+		groups = AItem.groups;
+	}
+	return groups;
+}
+
+void ReceiversWidget::fetchGroupItems(const QList<QStandardItem *> &AGroupItems)
+{
+	QMap<Jid, QHash<QString, QStandardItem *> > fetchGroups;
+	foreach(QStandardItem *groupItem, AGroupItems)
+	{
+		if (groupItem!=NULL && groupItem->data(RDR_KIND).toInt()==RIK_GROUP && !groupItem->data(RIDR_ITEM_FETCHED).toBool())
+		{
+			groupItem->setData(true,RIDR_ITEM_FETCHED);
+
+			Jid streamJid = groupItem->data(RDR_STREAM_JID).toString();
+			QString group = groupItem->data(RDR_GROUP).toString();
+			if (FGroupContactsCount.value(streamJid).value(group) > 0)
+				fetchGroups[streamJid].insert(group,groupItem);
+		}
+	}
+
+	// One pass over roster for all requested groups of stream
+	FFetchingItems = true;
+	for (QMap<Jid, QHash<QString, QStandardItem *> >::const_iterator streamIt=fetchGroups.constBegin(); streamIt!=fetchGroups.constEnd(); ++streamIt)
+	{
+		IRoster *roster = FRosterPlugin!=NULL ? FRosterPlugin->findRoster(streamIt.key()) : NULL;
+		foreach(const IRosterItem &ritem, roster!=NULL ? roster->rosterItems() : QList<IRosterItem>())
+		{
+			int groupOrder;
+			foreach(const QString &group, rosterItemGroups(ritem,groupOrder))
+			{
+				QStandardItem *groupItem = streamIt->value(group);
+				if (groupItem!=NULL && findContactItem(streamIt.key(),ritem.itemJid,group)==NULL)
+				{
+					QList<QStandardItem *> contactItems = findContactItems(streamIt.key(),ritem.itemJid);
+					Qt::CheckState state = !contactItems.isEmpty() ? contactItems.first()->checkState() : (groupItem->checkState()==Qt::Checked ? Qt::Checked : Qt::Unchecked);
+
+					QStandardItem *contactItem = getContactItem(streamIt.key(),ritem.itemJid,ritem.name.isEmpty() ? ritem.itemJid.uBare() : ritem.name,group,groupOrder);
+					if (contactItem->checkState() != state)
+						contactItem->setCheckState(state);
+					updateContactItemsPresence(streamIt.key(),ritem.itemJid);
+				}
+			}
+		}
+	}
+	FFetchingItems = false;
+}
+
+void ReceiversWidget::fetchAllChilds(QList<QStandardItem *> AParents, QList<QStandardItem *> &AGroupItems) const
+{
+	foreach(QStandardItem *parentItem, AParents)
+	{
+		if (parentItem->data(RDR_KIND).toInt()==RIK_GROUP && !parentItem->data(RIDR_ITEM_FETCHED).toBool())
+			AGroupItems.append(parentItem);
+		for (int row=0; row<parentItem->rowCount(); row++)
+		{
+			QStandardItem *item = parentItem->child(row);
+			if (item->data(RDR_KIND).toInt() == RIK_GROUP)
+				fetchAllChilds(QList<QStandardItem *>() << item, AGroupItems);
+		}
+	}
+}
+
+void ReceiversWidget::fetchAllChilds(QList<QStandardItem *> AParents)
+{
+	QList<QStandardItem *> groupItems;
+	fetchAllChilds(AParents,groupItems);
+	fetchGroupItems(groupItems);
+}
+
+void ReceiversWidget::removeEmptyGroupItem(const Jid &AStreamJid, const QString &AGroup)
+{
+	QStandardItem *groupItem = FGroupItems.value(AStreamJid).value(AGroup);
+	if (groupItem && groupItem->rowCount()==0 && FGroupContactsCount.value(AStreamJid).value(AGroup)==0)
+		groupItem->parent()->removeRow(groupItem->row());
+}
+
 void ReceiversWidget::deleteItemLater(QStandardItem *AItem)
 {
 	if (AItem && !FDeleteDelayed.contains(AItem))
@@ -485,7 +638,7 @@ void ReceiversWidget::deleteItemLater(QStandardItem *AItem)
 
 void ReceiversWidget::updateCheckState(QStandardItem *AItem)
 {
-	if (AItem && AItem->hasChildren() && AItem!=FModel->invisibleRootItem())
+	if (!FFetchingItems && AItem && AItem->hasChildren() && AItem!=FModel->invisibleRootItem())
 	{
 		bool allChecked = true;
 		bool allUnchecked = true;
@@ -786,8 +939,10 @@ void ReceiversWidget::onModelItemRemoving(QStandardItem *AItem)
 	}
 	updateCheckState(AItem->parent());
 
-	if (AItem->parent() && AItem->parent()->rowCount()<2 && AItem->parent()->data(RDR_KIND).toInt()!=RIK_STREAM_ROOT)
-		deleteItemLater(AItem->parent());
+	QStandardItem *parentItem = AItem->parent();
+	if (parentItem && parentItem->rowCount()<2 && parentItem->data(RDR_KIND).toInt()!=RIK_STREAM_ROOT)
+		if (FGroupContactsCount.value(streamJid).value(parentItem->data(RDR_GROUP).toString()) == 0)
+			deleteItemLater(parentItem);
 	FDeleteDelayed.removeAll(AItem);
 }
 
@@ -820,8 +975,9 @@ void ReceiversWidget::onModelItemDataChanged(QStandardItem *AItem, int ARole)
 
 		bool updateSelfState = false;
 		Qt::CheckState state = AItem->checkState();
-		if (state != Qt::PartiallyChecked)
+		if (state!=Qt::PartiallyChecked && AItem->data(RDR_KIND).toInt()!=RIK_CONTACT)
 		{
+			fetchAllChilds(QList<QStandardItem *>() << AItem);
 			for (int row=0; row<AItem->rowCount(); row++)
 			{
 				QStandardItem *childItem = AItem->child(row);
@@ -838,9 +994,17 @@ void ReceiversWidget::onModelItemDataChanged(QStandardItem *AItem, int ARole)
 	}
 }
 
+void ReceiversWidget::onModelItemFetchRequested(QStandardItem *AItem)
+{
+	fetchGroupItems(QList<QStandardItem *>() << AItem);
+	updateCheckState(AItem);
+}
+
 void ReceiversWidget::onViewIndexExpanded(const QModelIndex &AIndex)
 {
 	QStandardItem *item = mapViewToModel(AIndex);
+	if (item && item->data(RDR_KIND).toInt()==RIK_GROUP && !item->data(RIDR_ITEM_FETCHED).toBool())
+		onModelItemFetchRequested(item);
 	if (item && FProxyModel->filterRegExp().isEmpty())
 		item->setData(false,RIDR_ITEM_COLLAPSED);
 }
@@ -923,7 +1087,19 @@ void ReceiversWidget::onRosterItemReceived(IRoster *ARoster, const IRosterItem &
 {
 	if (FStreamItems.contains(ARoster->streamJid()))
 	{
-		QList<QStandardItem *> contactItems = findContactItems(ARoster->streamJid(),AItem.itemJid);
+		Jid streamJid = ARoster->streamJid();
+		QList<QStandardItem *> contactItems = findContactItems(streamJid,AItem.itemJid);
+
+		int groupOrder;
+		QSet<QString> oldGroups = ABefore.isValid ? rosterItemGroups(ABefore,groupOrder) : QSet<QString>();
+		QSet<QString> newGroups = AItem.subscription!=SUBSCRIPTION_REMOVE ? rosterItemGroups(AItem,groupOrder) : QSet<QString>();
+
+		QHash<QString, int> &groupsCount = FGroupContactsCount[streamJid];
+		foreach(const QString &group, oldGroups-newGroups)
+			groupsCount[group]--;
+		foreach(const QString &group, newGroups-oldGroups)
+			groupsCount[group]++;
+
 		if (AItem.subscription == SUBSCRIPTION_REMOVE)
 		{
 			foreach(QStandardItem *contactItem, contactItems)
@@ -936,42 +1112,33 @@ void ReceiversWidget::onRosterItemReceived(IRoster *ARoster, const IRosterItem &
 
 			if (contactItems.isEmpty() || AItem.groups!=ABefore.groups)
 			{
-				QSet<QString> oldGroups;
+				QSet<QString> itemGroups;
 				foreach(QStandardItem *contactItem, contactItems)
-					oldGroups += contactItem->data(RDR_GROUP).toString();
+					itemGroups += contactItem->data(RDR_GROUP).toString();
 
-				int groupOrder;
-				QSet<QString> newGroups;
-				if (AItem.itemJid.node().isEmpty())
+				bool checked = !contactItems.isEmpty() && contactItems.first()->checkState()==Qt::Checked;
+				foreach(const QString &group, newGroups-itemGroups)
 				{
-					groupOrder = RIKO_GROUP_AGENTS;
-					newGroups << (FRostersModel!=NULL ? FRostersModel->singleGroupName(RIK_GROUP_AGENTS) : tr("Agents"));
-				}
-				else if (AItem.groups.isEmpty())
-				{
-					groupOrder = RIKO_GROUP_BLANK;
-					newGroups << (FRostersModel!=NULL ? FRostersModel->singleGroupName(RIK_GROUP_BLANK) : tr("Without Groups"));
-				}
-				else
-				{
-					groupOrder = RIKO_GROUP;
-					newGroups = AItem.groups;
-				}
-
-				foreach(const QString &group, newGroups-oldGroups)
-				{
-					QStandardItem *contactItem = getContactItem(ARoster->streamJid(),AItem.itemJid,name,group,groupOrder);
-					if (!contactItems.isEmpty())
-						contactItem->setCheckState(contactItems.first()->checkState());
-					contactItems.append(contactItem);
-					updatePresence = true;
+					// Contacts are added only to fetched groups or to keep selection
+					QStandardItem *groupItem = getGroupItem(streamJid,group,groupOrder);
+					if (checked || groupItem->data(RIDR_ITEM_FETCHED).toBool())
+					{
+						QStandardItem *contactItem = getContactItem(streamJid,AItem.itemJid,name,group,groupOrder);
+						if (!contactItems.isEmpty())
+							contactItem->setCheckState(contactItems.first()->checkState());
+						contactItems.append(contactItem);
+						updatePresence = true;
+					}
 				}
 
-				foreach(const QString &group, oldGroups-newGroups)
+				foreach(const QString &group, itemGroups-newGroups)
 				{
-					QStandardItem *contactItem = findContactItem(ARoster->streamJid(),AItem.itemJid,group);
+					QStandardItem *contactItem = findContactItem(streamJid,AItem.itemJid,group);
 					if (contactItem)
+					{
+						contactItems.removeAll(contactItem);
 						contactItem->parent()->removeRow(contactItem->row());
+					}
 				}
 			}
 
@@ -982,7 +1149,14 @@ void ReceiversWidget::onRosterItemReceived(IRoster *ARoster, const IRosterItem &
 			}
 
 			if (updatePresence)
-				updateContactItemsPresence(ARoster->streamJid(),AItem.itemJid);
+				updateContactItemsPresence(streamJid,AItem.itemJid);
+		}
+
+		foreach(const QString &group, oldGroups-newGroups)
+		{
+			if (groupsCount.value(group) <= 0)
+				groupsCount.remove(group);
+			removeEmptyGroupItem(streamJid,group);
 		}
 	}
 }
@@ -1006,35 +1180,55 @@ void ReceiversWidget::onSelectAllContacts()
 {
 	Action *action = qobject_cast<Action *>(sender());
 	if (action)
-		selectAllContacts(action->data(ADR_ITEMS).value< QList<QStandardItem *> >());
+	{
+		QList<QStandardItem *> items = action->data(ADR_ITEMS).value< QList<QStandardItem *> >();
+		fetchAllChilds(items);
+		selectAllContacts(items);
+	}
 }
 
 void ReceiversWidget::onSelectOnlineContacts()
 {
 	Action *action = qobject_cast<Action *>(sender());
 	if (action)
-		selectOnlineContacts(action->data(ADR_ITEMS).value< QList<QStandardItem *> >());
+	{
+		QList<QStandardItem *> items = action->data(ADR_ITEMS).value< QList<QStandardItem *> >();
+		fetchAllChilds(items);
+		selectOnlineContacts(items);
+	}
 }
 
 void ReceiversWidget::onSelectNotBusyContacts()
 {
 	Action *action = qobject_cast<Action *>(sender());
 	if (action)
-		selectNotBusyContacts(action->data(ADR_ITEMS).value< QList<QStandardItem *> >());
+	{
+		QList<QStandardItem *> items = action->data(ADR_ITEMS).value< QList<QStandardItem *> >();
+		fetchAllChilds(items);
+		selectNotBusyContacts(items);
+	}
 }
 
 void ReceiversWidget::onSelectNoneContacts()
 {
 	Action *action = qobject_cast<Action *>(sender());
 	if (action)
-		selectNoneContacts(action->data(ADR_ITEMS).value< QList<QStandardItem *> >());
+	{
+		QList<QStandardItem *> items = action->data(ADR_ITEMS).value< QList<QStandardItem *> >();
+		fetchAllChilds(items);
+		selectNoneContacts(items);
+	}
 }
 
 void ReceiversWidget::onExpandAllChilds()
 {
 	Action *action = qobject_cast<Action *>(sender());
 	if (action)
-		expandAllChilds(action->data(ADR_ITEMS).value< QList<QStandardItem *> >());
+	{
+		QList<QStandardItem *> items = action->data(ADR_ITEMS).value< QList<QStandardItem *> >();
+		fetchAllChilds(items);
+		expandAllChilds(items);
+	}
 }
 
 void ReceiversWidget::onCollapseAllChilds()
@@ -1066,6 +1260,9 @@ void ReceiversWidget::onDeleteDelayedItems()
 
 void ReceiversWidget::onStartSearchContacts()
 {
+	if (!ui.sleSearch->text().isEmpty())
+		fetchAllChilds(QList<QStandardItem *>() << FModel->invisibleRootItem());
+
 	FProxyModel->setFilterWildcard(ui.sleSearch->text());
 	if (!FProxyModel->filterRegExp().isEmpty())
 		ui.trvReceivers->expandAll();
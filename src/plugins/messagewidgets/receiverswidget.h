@@ -27,6 +27,19 @@ private:
 	bool FOfflineVisible;
 };
 
+class ReceiversItemModel :
+	public AdvancedItemModel
+{
+	Q_OBJECT;
+public:
+	ReceiversItemModel(QObject *AParent);
+	bool hasChildren(const QModelIndex &AParent = QModelIndex()) const;
+	bool canFetchMore(const QModelIndex &AParent) const;
+	void fetchMore(const QModelIndex &AParent);
+signals:
+	void itemFetchRequested(QStandardItem *AItem);
+};
+
 class ReceiversWidget :
 	public QWidget,
 	public IMessageReceiversWidget,
@@ -65,6 +78,11 @@ protected:
 	QList<QStandardItem *> findContactItems(const Jid &AStreamJid, const Jid &AContactJid) const;
 	QStandardItem *findContactItem(const Jid &AStreamJid, const Jid &AContactJid, const QString &AGroup) const;
 	QStandardItem *getContactItem(const Jid &AStreamJid, const Jid &AContactJid, const QString &AName, const QString &AGroup, int AGroupOrder);
+	QSet<QString> rosterItemGroups(const IRosterItem &AItem, int &AGroupOrder) const;
+	void fetchGroupItems(const QList<QStandardItem *> &AGroupItems);
+	void fetchAllChilds(QList<QStandardItem *> AParents, QList<QStandardItem *> &AGroupItems) const;
+	void fetchAllChilds(QList<QStandardItem *> AParents);
+	void removeEmptyGroupItem(const Jid &AStreamJid, const QString &AGroup);
 protected:
 	void deleteItemLater(QStandardItem *AItem);
 	void updateCheckState(QStandardItem *AItem);
@@ -84,6 +102,7 @@ protected slots:
 	void onModelItemInserted(QStandardItem *AItem);
 	void onModelItemRemoving(QStandardItem *AItem);
 	void onModelItemDataChanged(QStandardItem *AItem, int ARole);
+	void onModelItemFetchRequested(QStandardItem *AItem);
 protected slots:
 	void onViewIndexExpanded(const QModelIndex &AIndex);
 	void onViewIndexCollapsed(const QModelIndex &AIndex);
@@ -123,14 +142,16 @@ private:
 private:
 	QList<Jid> FReceivers;
 	IMessageWindow *FWindow;
-	AdvancedItemModel *FModel;
+	ReceiversItemModel *FModel;
 	ReceiversSortSearchProxyModel *FProxyModel;
 private:
+	bool FFetchingItems;
 	QTimer FSelectionSignalTimer;
 	QList<QStandardItem *> FDeleteDelayed;
 	QMap<Jid, QStandardItem *> FStreamItems;
 	QMap<Jid, QMap<QString, QStandardItem *> > FGroupItems;
 	QMap<Jid, QMultiHash<Jid, QStandardItem *> > FContactItems;
+	QMap<Jid, QHash<QString, int> > FGroupContactsCount;
 };
 
 #endif // RECEIVERSWIDGET_H
@@ -29,6 +29,11 @@
 
 #define UPDATE_META_TIMEOUT     0
 #define STORAGE_SAVE_TIMEOUT    100
+#define STORAGE_SAVE_MAX_DELAY  60000
+#define STORAGE_SAVE_RATE       16384
+#define STORAGE_META_SIZE       96
+#define STORAGE_ITEM_SIZE       48
+#define JOURNAL_COMPACT_COUNT   1000
 
 #define DIR_METACONTACTS        "metacontacts"
 
@@ -1310,6 +1315,12 @@ bool MetaContacts::updateMetaContact(const Jid &AStreamJid, const IMetaContact &
 			else
 				FMetaContacts[AStreamJid].remove(after.id);
 
+			if (after.id!=before.id || after.name!=before.name || after.items!=before.items)
+			{
+				FJournalMeta[AStreamJid] += after.id;
+				FSaveTimer.start(STORAGE_SAVE_TIMEOUT);
+			}
+
 			updateMetaIndexes(AStreamJid,after.id);
 			updateMetaWindows(AStreamJid,after.id);
 			updateMetaRecentItems(AStreamJid,after.id);
@@ -1522,16 +1533,25 @@ void MetaContacts::startSaveContactsToStorage(const Jid &AStreamJid)
 	}
 }
 
-bool MetaContacts::saveContactsToStorage(const Jid &AStreamJid) const
+bool MetaContacts::saveContactsToStorage(const Jid &AStreamJid)
 {
 	if (FPrivateStorage && isReady(AStreamJid))
 	{
+		QList<IMetaContact> contacts = FMetaContacts.value(AStreamJid).values();
+
 		QDomDocument doc;
 		QDomElement storageElem = doc.appendChild(doc.createElementNS(NS_STORAGE_METACONTACTS,"storage")).toElement();
-		saveMetaContactsToXML(storageElem,FMetaContacts.value(AStreamJid).values());
+		saveMetaContactsToXML(storageElem,contacts);
 		if (!FPrivateStorage->saveData(AStreamJid,storageElem).isEmpty())
 		{
-			LOG_STRM_INFO(AStreamJid,"Save metacontacts to storage request sent");
+			// Large documents are uploaded less often, estimate size without serializing it again
+			qint64 size = 0;
+			foreach(const IMetaContact &meta, contacts)
+				size += STORAGE_META_SIZE + meta.name.size() + meta.items.count()*STORAGE_ITEM_SIZE;
+			qint64 delay = qBound((qint64)STORAGE_SAVE_TIMEOUT, size*1000/STORAGE_SAVE_RATE, (qint64)STORAGE_SAVE_MAX_DELAY);
+			FStorageSaveAllowed.insert(AStreamJid,QDateTime::currentDateTime().addMSecs(delay));
+
+			LOG_STRM_INFO(AStreamJid,QString("Save metacontacts to storage request sent, size=%1, next-delay=%2").arg(size).arg(delay));
 			return true;
 		}
 		else
@@ -1555,6 +1575,15 @@ QString MetaContacts::metaContactsFileName(const Jid &AStreamJid) const
 	return dir.absoluteFilePath(Jid::encode(AStreamJid.pBare())+".xml");
 }
 
+QString MetaContacts::metaContactsJournalFileName(const Jid &AStreamJid) const
+{
+	QDir dir(FPluginManager->homePath());
+	if (!dir.exists(DIR_METACONTACTS))
+		dir.mkdir(DIR_METACONTACTS);
+	dir.cd(DIR_METACONTACTS);
+	return dir.absoluteFilePath(Jid::encode(AStreamJid.pBare())+".journal");
+}
+
 QList<IMetaContact> MetaContacts::loadMetaContactsFromXML(const QDomElement &AElement) const
 {
 	QList<IMetaContact> contacts;
@@ -1597,23 +1626,65 @@ void MetaContacts::saveMetaContactsToXML(QDomElement &AElement, const QList<IMet
 	}
 }
 
-QList<IMetaContact> MetaContacts::loadMetaContactsFromFile(const QString &AFileName) const
+int MetaContacts::loadMetaContactsFromReader(QXmlStreamReader &AReader, QHash<QUuid, IMetaContact> &AContacts) const
 {
-	QList<IMetaContact> contacts;
-
-	QFile file(AFileName);
-	if (file.open(QIODevice::ReadOnly))
+	int count = 0;
+	IMetaContact meta;
+	while (!AReader.atEnd())
 	{
-		QString xmlError;
-		QDomDocument doc;
-		if (doc.setContent(&file,true,&xmlError))
+		AReader.readNext();
+		if (AReader.isStartElement() && AReader.name()=="meta")
 		{
-			QDomElement storageElem = doc.firstChildElement("storage");
-			contacts = loadMetaContactsFromXML(storageElem);
+			meta = IMetaContact();
+			meta.id = AReader.attributes().value("id").toString();
+			meta.name = AReader.attributes().value("name").toString();
 		}
-		else
+		else if (AReader.isStartElement() && AReader.name()=="item")
+		{
+			meta.items.append(AReader.readElementText());
+		}
+		else if (AReader.isEndElement() && AReader.name()=="meta")
 		{
-			REPORT_ERROR(QString("Failed to load metacontacts from file content: %1").arg(xmlError));
+			// Metacontact without items is a removal record in journal
+			if (meta.isNull())
+				continue;
+			else if (!meta.isEmpty())
+				AContacts.insert(meta.id,meta);
+			else
+				AContacts.remove(meta.id);
+			count++;
+		}
+	}
+	return count;
+}
+
+void MetaContacts::saveMetaContactsToWriter(QXmlStreamWriter &AWriter, const QList<IMetaContact> &AContacts) const
+{
+	for (QList<IMetaContact>::const_iterator metaIt=AContacts.constBegin(); metaIt!=AContacts.constEnd(); ++metaIt)
+	{
+		AWriter.writeStartElement("meta");
+		AWriter.writeAttribute("id",metaIt->id.toString());
+		AWriter.writeAttribute("name",metaIt->name);
+		for (QList<Jid>::const_iterator itemIt=metaIt->items.constBegin(); itemIt!=metaIt->items.constEnd(); ++itemIt)
+			AWriter.writeTextElement("item",itemIt->pBare());
+		AWriter.writeEndElement();
+		AWriter.writeCharacters("\n");
+	}
+}
+
+QList<IMetaContact> MetaContacts::loadMetaContactsFromFile(const Jid &AStreamJid)
+{
+	QHash<QUuid, IMetaContact> contacts;
+
+	QFile file(metaContactsFileName(AStreamJid));
+	if (file.open(QIODevice::ReadOnly))
+	{
+		QXmlStreamReader reader(&file);
+		loadMetaContactsFromReader(reader,contacts);
+		if (reader.hasError())
+		{
+			REPORT_ERROR(QString("Failed to load metacontacts from file content: %1").arg(reader.errorString()));
+			contacts.clear();
 			file.remove();
 		}
 	}
@@ -1622,19 +1693,43 @@ QList<IMetaContact> MetaContacts::loadMetaContactsFromFile(const QString &AFileN
 		REPORT_ERROR(QString("Failed to load metacontacts from file: %1").arg(file.errorString()));
 	}
 
-	return contacts;
+	QFile journal(metaContactsJournalFileName(AStreamJid));
+	if (journal.open(QIODevice::ReadOnly))
+	{
+		// Journal is a sequence of top level elements, last record may be incomplete after crash
+		QXmlStreamReader reader;
+		reader.addData("<journal>");
+		reader.addData(journal.readAll());
+		reader.addData("</journal>");
+		int count = loadMetaContactsFromReader(reader,contacts);
+		if (reader.hasError())
+			LOG_STRM_WARNING(AStreamJid,QString("Metacontacts journal partially loaded, records=%1: %2").arg(count).arg(reader.errorString()));
+		FJournalCount[AStreamJid] = count;
+	}
+	else if (journal.exists())
+	{
+		REPORT_ERROR(QString("Failed to load metacontacts journal from file: %1").arg(journal.errorString()));
+	}
+
+	return contacts.values();
 }
 
-void MetaContacts::saveMetaContactsToFile(const QString &AFileName, const QList<IMetaContact> &AContacts) const
+void MetaContacts::saveMetaContactsToFile(const Jid &AStreamJid, const QList<IMetaContact> &AContacts)
 {
-	QFile file(AFileName);
+	QFile file(metaContactsFileName(AStreamJid));
 	if (file.open(QIODevice::WriteOnly|QIODevice::Truncate))
 	{
-		QDomDocument doc;
-		QDomElement storageElem = doc.appendChild(doc.createElementNS(NS_STORAGE_METACONTACTS,"storage")).toElement();
-		saveMetaContactsToXML(storageElem,AContacts);
-		file.write(doc.toByteArray());
+		QXmlStreamWriter writer(&file);
+		writer.writeStartDocument();
+		writer.writeStartElement("storage");
+		writer.writeDefaultNamespace(NS_STORAGE_METACONTACTS);
+		saveMetaContactsToWriter(writer,AContacts);
+		writer.writeEndElement();
+		writer.writeEndDocument();
 		file.flush();
+
+		QFile::remove(metaContactsJournalFileName(AStreamJid));
+		FJournalCount.remove(AStreamJid);
 	}
 	else
 	{
@@ -1642,6 +1737,31 @@ void MetaContacts::saveMetaContactsToFile(const QString &AFileName, const QList<
 	}
 }
 
+void MetaContacts::saveMetaContactsToJournal(const Jid &AStreamJid, const QList<IMetaContact> &AContacts)
+{
+	int count = FJournalCount.value(AStreamJid) + AContacts.count();
+	if (count > JOURNAL_COMPACT_COUNT && count > FMetaContacts.value(AStreamJid).count())
+	{
+		LOG_STRM_DEBUG(AStreamJid,QString("Compacting metacontacts journal, records=%1").arg(count));
+		saveMetaContactsToFile(AStreamJid,FMetaContacts.value(AStreamJid).values());
+	}
+	else
+	{
+		QFile file(metaContactsJournalFileName(AStreamJid));
+		if (file.open(QIODevice::WriteOnly|QIODevice::Append))
+		{
+			QXmlStreamWriter writer(&file);
+			saveMetaContactsToWriter(writer,AContacts);
+			file.flush();
+			FJournalCount[AStreamJid] = count;
+		}
+		else
+		{
+			REPORT_ERROR(QString("Failed to save metacontacts to journal: %1").arg(file.errorString()));
+		}
+	}
+}
+
 void MetaContacts::onRosterAdded(IRoster *ARoster)
 {
 	FLoadStreams += ARoster->streamJid();
@@ -1653,6 +1773,8 @@ void MetaContacts::onRosterRemoved(IRoster *ARoster)
 	FSaveStreams -= ARoster->streamJid();
 	FLoadStreams -= ARoster->streamJid();
 	FUpdateMeta.remove(ARoster->streamJid());
+	FJournalMeta.remove(ARoster->streamJid());
+	FStorageSaveAllowed.remove(ARoster->streamJid());
 
 	FItemMetaId.remove(ARoster->streamJid());
 
@@ -1663,7 +1785,7 @@ void MetaContacts::onRosterRemoved(IRoster *ARoster)
 		updateMetaRecentItems(ARoster->streamJid(),metaId);
 	}
 
-	saveMetaContactsToFile(metaContactsFileName(ARoster->streamJid()),metas.values());
+	saveMetaContactsToFile(ARoster->streamJid(),metas.values());
 }
 
 void MetaContacts::onRosterStreamJidChanged(IRoster *ARoster, const Jid &ABefore)
@@ -1679,6 +1801,9 @@ void MetaContacts::onRosterStreamJidChanged(IRoster *ARoster, const Jid &ABefore
 		FLoadStreams += ARoster->streamJid();
 	}
 	FUpdateMeta.insert(ARoster->streamJid(),FUpdateMeta.take(ABefore));
+	FJournalMeta.insert(ARoster->streamJid(),FJournalMeta.take(ABefore));
+	FJournalCount.insert(ARoster->streamJid(),FJournalCount.take(ABefore));
+	FStorageSaveAllowed.insert(ARoster->streamJid(),FStorageSaveAllowed.take(ABefore));
 	
 	for (QHash<const IRosterIndex *, QMap<Jid, QMap<Jid, IRosterIndex *> > >::iterator it=FMetaIndexItems.begin(); it!=FMetaIndexItems.constEnd(); ++it)
 		if (it->contains(ABefore))
@@ -2347,13 +2472,47 @@ void MetaContacts::onUpdateContactsTimerTimeout()
 void MetaContacts::onLoadContactsFromFileTimerTimeout()
 {
 	for (QSet<Jid>::iterator it=FLoadStreams.begin(); it!=FLoadStreams.end(); it=FLoadStreams.erase(it))
-		updateMetaContacts(*it,loadMetaContactsFromFile(metaContactsFileName(*it)));
+	{
+		updateMetaContacts(*it,loadMetaContactsFromFile(*it));
+		FJournalMeta.remove(*it);
+	}
 }
 
 void MetaContacts::onSaveContactsToStorageTimerTimeout()
 {
-	for (QSet<Jid>::iterator it=FSaveStreams.begin(); it!=FSaveStreams.end(); it=FSaveStreams.erase(it))
-		saveContactsToStorage(*it);
+	for (QMap<Jid, QSet<QUuid> >::iterator streamIt=FJournalMeta.begin(); streamIt!=FJournalMeta.end(); streamIt=FJournalMeta.erase(streamIt))
+	{
+		QList<IMetaContact> contacts;
+		const QHash<QUuid, IMetaContact> metas = FMetaContacts.value(streamIt.key());
+		foreach(const QUuid &metaId, streamIt.value())
+		{
+			IMetaContact meta = metas.value(metaId);
+			meta.id = metaId;
+			contacts.append(meta);
+		}
+		saveMetaContactsToJournal(streamIt.key(),contacts);
+	}
+
+	int nextDelay = -1;
+	QDateTime curTime = QDateTime::currentDateTime();
+	for (QSet<Jid>::iterator it=FSaveStreams.begin(); it!=FSaveStreams.end(); )
+	{
+		QDateTime allowed = FStorageSaveAllowed.value(*it);
+		if (!allowed.isValid() || allowed<=curTime)
+		{
+			saveContactsToStorage(*it);
+			it = FSaveStreams.erase(it);
+		}
+		else
+		{
+			int delay = curTime.msecsTo(allowed);
+			nextDelay = nextDelay<0 ? delay : qMin(nextDelay,delay);
+			++it;
+		}
+	}
+
+	if (nextDelay >= 0)
+		FSaveTimer.start(nextDelay);
 }
 
 void MetaContacts::onShortcutActivated(const QString &AId, QWidget *AWidget)
@@ -3,6 +3,9 @@
 
 #include <QMap>
 #include <QHash>
+#include <QDateTime>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
 #include <interfaces/ipluginmanager.h>
 #include <interfaces/imetacontacts.h>
 #include <interfaces/iprivatestorage.h>
@@ -127,12 +130,16 @@ protected:
 	void destroyMetaContacts(const QStringList &AStreams, const QStringList &AMetas);
 protected:
 	void startSaveContactsToStorage(const Jid &AStreamJid);
-	bool saveContactsToStorage(const Jid &AStreamJid) const;
+	bool saveContactsToStorage(const Jid &AStreamJid);
 	QString metaContactsFileName(const Jid &AStreamJid) const;
+	QString metaContactsJournalFileName(const Jid &AStreamJid) const;
 	QList<IMetaContact> loadMetaContactsFromXML(const QDomElement &AElement) const;
 	void saveMetaContactsToXML(QDomElement &AElement, const QList<IMetaContact> &AContacts) const;
-	QList<IMetaContact> loadMetaContactsFromFile(const QString &AFileName) const;
-	void saveMetaContactsToFile(const QString &AFileName, const QList<IMetaContact> &AContacts) const;
+	int loadMetaContactsFromReader(QXmlStreamReader &AReader, QHash<QUuid, IMetaContact> &AContacts) const;
+	void saveMetaContactsToWriter(QXmlStreamWriter &AWriter, const QList<IMetaContact> &AContacts) const;
+	QList<IMetaContact> loadMetaContactsFromFile(const Jid &AStreamJid);
+	void saveMetaContactsToFile(const Jid &AStreamJid, const QList<IMetaContact> &AContacts);
+	void saveMetaContactsToJournal(const Jid &AStreamJid, const QList<IMetaContact> &AContacts);
 protected slots:
 	void onRosterAdded(IRoster *ARoster);
 	void onRosterRemoved(IRoster *ARoster);
@@ -196,6 +203,9 @@ private:
 	QTimer FUpdateTimer;
 	QSet<Jid> FSaveStreams;
 	QSet<Jid> FLoadStreams;
+	QMap<Jid, int> FJournalCount;
+	QMap<Jid, QSet<QUuid> > FJournalMeta;
+	QMap<Jid, QDateTime> FStorageSaveAllowed;
 	QMap<Jid, QString> FLoadRequestId;
 	QMap<Jid, QSet<QUuid> > FUpdateMeta;
 private:
@@ -1,3 +1,3 @@
-set(SOURCES multiuserchat.cpp multiuserchatplugin.cpp edituserslistdialog.cpp inputtextdialog.cpp multiuser.cpp multiuserchatwindow.cpp usersproxymodel.cpp joinmultichatdialog.cpp )
-set(HEADERS multiuserchat.h inputtextdialog.h multiuserchatwindow.h usersproxymodel.h edituserslistdialog.h multiuserchatplugin.h joinmultichatdialog.h multiuser.h )
+set(SOURCES multiuserchat.cpp multiuserchatplugin.cpp edituserslistdialog.cpp inputtextdialog.cpp multiuser.cpp multiuserchatwindow.cpp usersmodel.cpp joinmultichatdialog.cpp )
+set(HEADERS multiuserchat.h inputtextdialog.h multiuserchatwindow.h usersmodel.h edituserslistdialog.h multiuserchatplugin.h joinmultichatdialog.h multiuser.h )
 set(UIS joinmultichatdialog.ui multiuserchatwindow.ui inputtextdialog.ui edituserslistdialog.ui )
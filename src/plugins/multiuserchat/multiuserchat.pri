@@ -10,7 +10,7 @@ HEADERS = multiuser.h \
           multiuserchatwindow.h \
           edituserslistdialog.h \
           inputtextdialog.h \
-          usersproxymodel.h
+          usersmodel.h
 
 SOURCES = multiuser.cpp \
           multiuserchat.cpp \
@@ -19,4 +19,4 @@ SOURCES = multiuser.cpp \
           multiuserchatwindow.cpp \
           edituserslistdialog.cpp \
           inputtextdialog.cpp \
-          usersproxymodel.cpp
+          usersmodel.cpp
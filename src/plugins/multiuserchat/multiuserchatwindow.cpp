@@ -91,16 +91,8 @@ MultiUserChatWindow::MultiUserChatWindow(IMultiUserChatPlugin *AChatPlugin, IMul
 	FStartCompletePos = 0;
 	FCompleteIt = FCompleteNicks.constEnd();
 
-	FUsersModel = new QStandardItemModel(0,1,ui.ltvUsers);
-
-	FUsersProxy = new UsersProxyModel(AMultiChat,FUsersModel);
-	FUsersProxy->setSortLocaleAware(true);
-	FUsersProxy->setDynamicSortFilter(true);
-	FUsersProxy->setSortCaseSensitivity(Qt::CaseInsensitive);
-	FUsersProxy->setSourceModel(FUsersModel);
-	FUsersProxy->sort(0, Qt::AscendingOrder);
-
-	ui.ltvUsers->setModel(FUsersProxy);
+	FUsersModel = new UsersModel(ui.ltvUsers);
+	ui.ltvUsers->setModel(FUsersModel);
 	ui.ltvUsers->viewport()->installEventFilter(this);
 	connect(ui.ltvUsers,SIGNAL(doubleClicked(const QModelIndex &)),SLOT(onMultiChatUserItemDoubleClicked(const QModelIndex &)));
 
@@ -665,7 +657,7 @@ void MultiUserChatWindow::contextMenuForRoom(Menu *AMenu)
 
 void MultiUserChatWindow::contextMenuForUser(IMultiUser *AUser, Menu *AMenu)
 {
-	if (FUsers.contains(AUser))
+	if (FUsersModel->contains(AUser))
 	{
 		if (FMultiChat->isOpen() && AUser!=FMultiChat->mainUser())
 		{
@@ -772,7 +764,7 @@ void MultiUserChatWindow::contextMenuForUser(IMultiUser *AUser, Menu *AMenu)
 
 void MultiUserChatWindow::toolTipsForUser(IMultiUser *AUser, QMap<int,QString> &AToolTips)
 {
-	if (FUsers.contains(AUser))
+	if (FUsersModel->contains(AUser))
 	{
 		AToolTips.insert(MUTTO_MUC_NICKNAME,QString("<big><b>%1</b></big>").arg(Qt::escape(AUser->nickName())));
 
@@ -1112,7 +1104,7 @@ void MultiUserChatWindow::loadWindowGeometry()
 void MultiUserChatWindow::refreshCompleteNicks()
 {
 	QMultiMap<QString,QString> sortedNicks;
-	foreach(IMultiUser *user, FUsers.keys())
+	foreach(IMultiUser *user, FUsersModel->users())
 	{
 		if (user != FMultiChat->mainUser())
 			if (FCompleteNickStarts.isEmpty() || user->nickName().toLower().startsWith(FCompleteNickStarts))
@@ -1127,14 +1119,13 @@ void MultiUserChatWindow::refreshCompleteNicks()
 void MultiUserChatWindow::updateListItem(const Jid &AContactJid)
 {
 	IMultiUser *user = FMultiChat->userByNick(AContactJid.resource());
-	QStandardItem *userItem = FUsers.value(user);
-	if (userItem)
+	if (FUsersModel->contains(user))
 	{
 		IMessageChatWindow *window = findChatWindow(AContactJid);
 		if (FActiveChatMessages.contains(window))
-			userItem->setIcon(IconStorage::staticStorage(RSR_STORAGE_MENUICONS)->getIcon(MNI_MUC_PRIVATE_MESSAGE));
+			FUsersModel->setUserIcon(user,IconStorage::staticStorage(RSR_STORAGE_MENUICONS)->getIcon(MNI_MUC_PRIVATE_MESSAGE));
 		else if (FStatusIcons)
-			userItem->setIcon(FStatusIcons->iconByJidStatus(AContactJid,user->data(MUDR_SHOW).toInt(),QString::null,false));
+			FUsersModel->setUserIcon(user,FStatusIcons->iconByJidStatus(AContactJid,user->data(MUDR_SHOW).toInt(),QString::null,false));
 	}
 }
 
@@ -1152,11 +1143,10 @@ void MultiUserChatWindow::updateRecentItemActiveTime()
 
 void MultiUserChatWindow::highlightUserRole(IMultiUser *AUser)
 {
-	QStandardItem *userItem = FUsers.value(AUser);
-	if (userItem)
+	if (FUsersModel->contains(AUser))
 	{
 		QColor itemColor;
-		QFont itemFont = userItem->font();
+		QFont itemFont = FUsersModel->userFont(AUser);
 		QString role = AUser->data(MUDR_ROLE).toString();
 		if (role == MUC_ROLE_MODERATOR)
 		{
@@ -1173,17 +1163,16 @@ void MultiUserChatWindow::highlightUserRole(IMultiUser *AUser)
 			itemFont.setBold(false);
 			itemColor = ui.ltvUsers->palette().color(QPalette::Disabled, QPalette::Text);
 		}
-		userItem->setFont(itemFont);
-		userItem->setForeground(itemColor);
+		FUsersModel->setUserFont(AUser,itemFont);
+		FUsersModel->setUserForeground(AUser,itemColor);
 	}
 }
 
 void MultiUserChatWindow::highlightUserAffiliation(IMultiUser *AUser)
 {
-	QStandardItem *userItem = FUsers.value(AUser);
-	if (userItem)
+	if (FUsersModel->contains(AUser))
 	{
-		QFont itemFont = userItem->font();
+		QFont itemFont = FUsersModel->userFont(AUser);
 		QString affilation = AUser->data(MUDR_AFFILIATION).toString();
 		if (affilation == MUC_AFFIL_OWNER)
 		{
@@ -1568,7 +1557,7 @@ void MultiUserChatWindow::updateMultiChatWindow()
 		tabIcon = tabPageNotifier()->notifyById(tabPageNotifier()->activeNotify()).icon;
 
 	setWindowIcon(tabIcon);
-	setWindowIconText(tr("%1 (%2)").arg(contactJid().uNode()).arg(FUsers.count()));
+	setWindowIconText(tr("%1 (%2)").arg(contactJid().uNode()).arg(FUsersModel->count()));
 	setWindowTitle(tr("%1 - Conference").arg(FMultiChat->roomName()));
 
 	emit tabPageChanged();
@@ -1850,8 +1839,7 @@ bool MultiUserChatWindow::eventFilter(QObject *AObject, QEvent *AEvent)
 		if (AEvent->type() == QEvent::ContextMenu)
 		{
 			QContextMenuEvent *menuEvent = static_cast<QContextMenuEvent *>(AEvent);
-			QStandardItem *userItem = FUsersModel->itemFromIndex(FUsersProxy->mapToSource(ui.ltvUsers->indexAt(menuEvent->pos())));
-			IMultiUser *user = FUsers.key(userItem,NULL);
+			IMultiUser *user = FUsersModel->userByIndex(ui.ltvUsers->indexAt(menuEvent->pos()));
 			if (user)
 			{
 				Menu *menu = new Menu(this);
@@ -1868,8 +1856,7 @@ bool MultiUserChatWindow::eventFilter(QObject *AObject, QEvent *AEvent)
 		else if (AEvent->type() == QEvent::ToolTip)
 		{
 			QHelpEvent *helpEvent = static_cast<QHelpEvent *>(AEvent);
-			QStandardItem *userItem = FUsersModel->itemFromIndex(FUsersProxy->mapToSource(ui.ltvUsers->indexAt(helpEvent->pos())));
-			IMultiUser *user = FUsers.key(userItem,NULL);
+			IMultiUser *user = FUsersModel->userByIndex(ui.ltvUsers->indexAt(helpEvent->pos()));
 			if (user)
 			{
 				QMap<int,QString> toolTips;
@@ -1887,16 +1874,16 @@ bool MultiUserChatWindow::eventFilter(QObject *AObject, QEvent *AEvent)
 			QMouseEvent *mouseEvent = static_cast<QMouseEvent *>(AEvent);
 			if (FEditWidget)
 			{
-				QStandardItem *userItem = FUsersModel->itemFromIndex(FUsersProxy->mapToSource(ui.ltvUsers->indexAt(mouseEvent->pos())));
-				if(mouseEvent->button()==Qt::MidButton && userItem)
+				IMultiUser *user = FUsersModel->userByIndex(ui.ltvUsers->indexAt(mouseEvent->pos()));
+				if(mouseEvent->button()==Qt::MidButton && user)
 				{
 					QString sufix = FEditWidget->textEdit()->textCursor().atBlockStart() ? Options::node(OPV_MUC_GROUPCHAT_NICKNAMESUFIX).value().toString() : " ";
-					FEditWidget->textEdit()->textCursor().insertText(userItem->text() + sufix);
+					FEditWidget->textEdit()->textCursor().insertText(user->nickName() + sufix);
 					FEditWidget->textEdit()->setFocus();
 					AEvent->accept();
 					return true;
 				}
-				else if (mouseEvent->button()==Qt::LeftButton && !userItem)
+				else if (mouseEvent->button()==Qt::LeftButton && !user)
 				{
 					ui.ltvUsers->selectionModel()->clearSelection();
 				}
@@ -2009,17 +1996,16 @@ void MultiUserChatWindow::onUserPresence(IMultiUser *AUser, int AShow, const QSt
 {
 	QString enterMessage;
 	QString statusMessage;
-	QStandardItem *userItem = FUsers.value(AUser);
+	bool isUserListed = FUsersModel->contains(AUser);
 	if (AShow!=IPresence::Offline && AShow!=IPresence::Error)
 	{
 		QString show = FStatusChanger ? FStatusChanger->nameByShow(AShow) : QString::null;
-		if (userItem == NULL)
+		if (!isUserListed)
 		{
-			userItem = new QStandardItem(AUser->nickName());
-			FUsersModel->appendRow(userItem);
-			FUsers.insert(AUser,userItem);
+			FUsersModel->insertUser(AUser);
 
-			refreshCompleteNicks();
+			if (FCompleteIt != FCompleteNicks.constEnd())
+				refreshCompleteNicks();
 			highlightUserRole(AUser);
 			highlightUserAffiliation(AUser);
 
@@ -2048,7 +2034,7 @@ void MultiUserChatWindow::onUserPresence(IMultiUser *AUser, int AShow, const QSt
 		showMultiChatStatusCodes(FMultiChat->statusCodes(),AUser->nickName());
 		updateListItem(AUser->contactJid());
 	}
-	else if (userItem)
+	else if (isUserListed)
 	{
 		if (!showMultiChatStatusCodes(FMultiChat->statusCodes(),AUser->nickName()))
 		{
@@ -2064,9 +2050,9 @@ void MultiUserChatWindow::onUserPresence(IMultiUser *AUser, int AShow, const QSt
 				showMultiChatStatusMessage(enterMessage,IMessageContentOptions::TypeEmpty,IMessageContentOptions::StatusLeft);
 			}
 		}
-		FUsers.remove(AUser);
-		refreshCompleteNicks();
-		qDeleteAll(FUsersModel->takeRow(userItem->row()));
+		FUsersModel->removeUser(AUser);
+		if (FCompleteIt != FCompleteNicks.constEnd())
+			refreshCompleteNicks();
 	}
 
 	if (FMultiChat->isConnected())
@@ -2078,7 +2064,7 @@ void MultiUserChatWindow::onUserPresence(IMultiUser *AUser, int AShow, const QSt
 	IMessageChatWindow *window = findChatWindow(AUser->contactJid());
 	if (window)
 	{
-		if (FUsers.contains(AUser) || !FDestroyTimers.contains(window))
+		if (FUsersModel->contains(AUser) || !FDestroyTimers.contains(window))
 		{
 			if (!enterMessage.isEmpty())
 				showPrivateChatStatusMessage(window,enterMessage,AShow!=IPresence::Offline && AShow!=IPresence::Error ? IMessageContentOptions::StatusJoined : IMessageContentOptions::StatusLeft);
@@ -2100,21 +2086,22 @@ void MultiUserChatWindow::onUserDataChanged(IMultiUser *AUser, int ARole, const
 		if (AAfter!=MUC_ROLE_NONE && ABefore!=MUC_ROLE_NONE)
 			showMultiChatStatusMessage(tr("%1 role changed from %2 to %3").arg(AUser->nickName()).arg(ABefore.toString()).arg(AAfter.toString()),IMessageContentOptions::TypeEvent);
 		highlightUserRole(AUser);
+		FUsersModel->updateUser(AUser);
 	}
 	else if (ARole == MUDR_AFFILIATION)
 	{
-		if (FUsers.contains(AUser))
+		if (FUsersModel->contains(AUser))
 			showMultiChatStatusMessage(tr("%1 affiliation changed from %2 to %3").arg(AUser->nickName()).arg(ABefore.toString()).arg(AAfter.toString()),IMessageContentOptions::TypeEvent);
 		highlightUserAffiliation(AUser);
+		FUsersModel->updateUser(AUser);
 	}
 }
 
 void MultiUserChatWindow::onUserNickChanged(IMultiUser *AUser, const QString &AOldNick, const QString &ANewNick)
 {
-	QStandardItem *userItem = FUsers.value(AUser);
-	if (userItem)
+	if (FUsersModel->contains(AUser))
 	{
-		userItem->setText(ANewNick);
+		FUsersModel->updateUser(AUser);
 		Jid userOldJid = AUser->contactJid();
 		userOldJid.setResource(AOldNick);
 		IMessageChatWindow *window = findChatWindow(userOldJid);
@@ -2125,7 +2112,8 @@ void MultiUserChatWindow::onUserNickChanged(IMultiUser *AUser, const QString &AO
 			window->address()->setAddress(streamJid(),AUser->contactJid());
 			updatePrivateChatWindow(window);
 		}
-		refreshCompleteNicks();
+		if (FCompleteIt != FCompleteNicks.constEnd())
+			refreshCompleteNicks();
 	}
 
 	if (AUser == FMultiChat->mainUser())
@@ -2272,7 +2260,7 @@ void MultiUserChatWindow::onMultiChatEditWidgetKeyEvent(QKeyEvent *AKeyEvent, bo
 					{
 						Action *action = new Action(nickMenu);
 						action->setText(user->nickName());
-						action->setIcon(FUsers.value(user)->icon());
+						action->setIcon(FUsersModel->userIcon(user));
 						action->setData(ADR_USER_NICK,user->nickName());
 						connect(action,SIGNAL(triggered(bool)),SLOT(onNickCompleteMenuActionTriggered(bool)));
 						nickMenu->addAction(action,AG_DEFAULT,true);
@@ -2311,7 +2299,7 @@ void MultiUserChatWindow::onMultiChatHorizontalSplitterMoved(int APos, int AInde
 
 void MultiUserChatWindow::onMultiChatUserItemDoubleClicked(const QModelIndex &AIndex)
 {
-	IMultiUser *user = FUsers.key(FUsersModel->itemFromIndex(FUsersProxy->mapToSource(AIndex)));
+	IMultiUser *user = FUsersModel->userByIndex(AIndex);
 	if (user)
 		openChatWindow(user->contactJid());
 }
@@ -2617,7 +2605,7 @@ void MultiUserChatWindow::onStatusIconsChanged()
 {
 	foreach(IMessageChatWindow *window, FChatWindows) {
 		updatePrivateChatWindow(window);	}
-	foreach(IMultiUser *user, FUsers.keys()) {
+	foreach(IMultiUser *user, FUsersModel->users()) {
 		updateListItem(user->contactJid());	}
 	updateMultiChatWindow();
 }
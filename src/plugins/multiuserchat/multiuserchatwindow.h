@@ -1,7 +1,6 @@
 #ifndef MULTIUSERCHATWINDOW_H
 #define MULTIUSERCHATWINDOW_H
 
-#include <QStandardItemModel>
 #include <interfaces/imultiuserchat.h>
 #include <interfaces/imessagewidgets.h>
 #include <interfaces/imessageprocessor.h>
@@ -17,7 +16,7 @@
 #include <interfaces/istanzaprocessor.h>
 #include "edituserslistdialog.h"
 #include "inputtextdialog.h"
-#include "usersproxymodel.h"
+#include "usersmodel.h"
 #include "ui_multiuserchatwindow.h"
 
 struct WindowStatus {
@@ -266,9 +265,7 @@ private:
 	QMap<IMessageChatWindow *, QList<Message> > FPendingMessages;
 	QMap<IMessageChatWindow *, QList<WindowContent> > FPendingContent;
 private:
-	UsersProxyModel *FUsersProxy;
-	QStandardItemModel *FUsersModel;
-	QHash<IMultiUser *, QStandardItem *> FUsers;
+	UsersModel *FUsersModel;
 private:
 	int FStartCompletePos;
 	QString FCompleteNickStarts;
@@ -0,0 +1,254 @@
+#include "usersmodel.h"
+
+#include <QtAlgorithms>
+#include <definitions/multiuserdataroles.h>
+
+#define FLUSH_TIMEOUT          0
+#define BATCH_RESET_COUNT      100
+
+static bool itemLessThan(const UsersModelItem *ALeft, const UsersModelItem *ARight)
+{
+	if (ALeft->bucket != ARight->bucket)
+		return ALeft->bucket < ARight->bucket;
+	return QString::localeAwareCompare(ALeft->sortKey,ARight->sortKey) < 0;
+}
+
+UsersModel::UsersModel(QObject *AParent) : QAbstractListModel(AParent)
+{
+	FFlushTimer.setSingleShot(true);
+	connect(&FFlushTimer,SIGNAL(timeout()),SLOT(onFlushTimerTimeout()));
+}
+
+UsersModel::~UsersModel()
+{
+	qDeleteAll(FUserItems);
+}
+
+int UsersModel::rowCount(const QModelIndex &AParent) const
+{
+	return !AParent.isValid() ? FItems.count() : 0;
+}
+
+QVariant UsersModel::data(const QModelIndex &AIndex, int ARole) const
+{
+	const UsersModelItem *item = AIndex.isValid() ? FItems.value(AIndex.row()) : NULL;
+	if (item)
+	{
+		switch (ARole)
+		{
+		case Qt::DisplayRole:
+			return item->user->nickName();
+		case Qt::DecorationRole:
+			return item->icon;
+		case Qt::FontRole:
+			return item->font;
+		case Qt::ForegroundRole:
+			return item->foreground;
+		}
+	}
+	return QVariant();
+}
+
+int UsersModel::count() const
+{
+	return FUserItems.count();
+}
+
+QList<IMultiUser *> UsersModel::users() const
+{
+	return FUserItems.keys();
+}
+
+bool UsersModel::contains(IMultiUser *AUser) const
+{
+	return FUserItems.contains(AUser);
+}
+
+IMultiUser *UsersModel::userByIndex(const QModelIndex &AIndex) const
+{
+	const UsersModelItem *item = AIndex.isValid() && AIndex.model()==this ? FItems.value(AIndex.row()) : NULL;
+	return item!=NULL ? item->user : NULL;
+}
+
+QModelIndex UsersModel::userIndex(IMultiUser *AUser) const
+{
+	const UsersModelItem *item = FUserItems.value(AUser);
+	int row = item!=NULL && !item->pending ? itemRow(item) : -1;
+	return row>=0 ? index(row) : QModelIndex();
+}
+
+void UsersModel::insertUser(IMultiUser *AUser)
+{
+	if (AUser!=NULL && !FUserItems.contains(AUser))
+	{
+		// Users are inserted in batches, presence flood on room join is merged at once
+		UsersModelItem *item = new UsersModelItem;
+		item->user = AUser;
+		item->pending = true;
+		updateItemSortKey(item);
+		FUserItems.insert(AUser,item);
+		FPending.append(item);
+		FFlushTimer.start(FLUSH_TIMEOUT);
+	}
+}
+
+void UsersModel::removeUser(IMultiUser *AUser)
+{
+	UsersModelItem *item = FUserItems.take(AUser);
+	if (item)
+	{
+		if (item->pending)
+		{
+			FPending.removeOne(item);
+		}
+		else
+		{
+			int row = itemRow(item);
+			beginRemoveRows(QModelIndex(),row,row);
+			FItems.removeAt(row);
+			endRemoveRows();
+		}
+		delete item;
+	}
+}
+
+void UsersModel::updateUser(IMultiUser *AUser)
+{
+	UsersModelItem *item = FUserItems.value(AUser);
+	if (item)
+	{
+		if (!item->pending)
+		{
+			int oldRow = itemRow(item);
+			FItems.removeAt(oldRow);
+			updateItemSortKey(item);
+			int newRow = insertRow(item);
+			FItems.insert(oldRow,item);
+
+			if (oldRow != newRow)
+			{
+				beginMoveRows(QModelIndex(),oldRow,oldRow,QModelIndex(),newRow>oldRow ? newRow+1 : newRow);
+				FItems.move(oldRow,newRow);
+				endMoveRows();
+			}
+			emitItemChanged(item);
+		}
+		else
+		{
+			updateItemSortKey(item);
+		}
+	}
+}
+
+QIcon UsersModel::userIcon(IMultiUser *AUser) const
+{
+	const UsersModelItem *item = FUserItems.value(AUser);
+	return item!=NULL ? item->icon : QIcon();
+}
+
+void UsersModel::setUserIcon(IMultiUser *AUser, const QIcon &AIcon)
+{
+	UsersModelItem *item = FUserItems.value(AUser);
+	if (item)
+	{
+		item->icon = AIcon;
+		emitItemChanged(item);
+	}
+}
+
+QFont UsersModel::userFont(IMultiUser *AUser) const
+{
+	const UsersModelItem *item = FUserItems.value(AUser);
+	return item!=NULL ? item->font : QFont();
+}
+
+void UsersModel::setUserFont(IMultiUser *AUser, const QFont &AFont)
+{
+	UsersModelItem *item = FUserItems.value(AUser);
+	if (item)
+	{
+		item->font = AFont;
+		emitItemChanged(item);
+	}
+}
+
+void UsersModel::setUserForeground(IMultiUser *AUser, const QBrush &ABrush)
+{
+	UsersModelItem *item = FUserItems.value(AUser);
+	if (item)
+	{
+		item->foreground = ABrush;
+		emitItemChanged(item);
+	}
+}
+
+int UsersModel::itemRow(const UsersModelItem *AItem) const
+{
+	QList<UsersModelItem *>::const_iterator it = qLowerBound(FItems.constBegin(),FItems.constEnd(),AItem,itemLessThan);
+	while (it!=FItems.constEnd() && *it!=AItem)
+		++it;
+	return it!=FItems.constEnd() ? it-FItems.constBegin() : -1;
+}
+
+int UsersModel::insertRow(const UsersModelItem *AItem) const
+{
+	return qUpperBound(FItems.constBegin(),FItems.constEnd(),AItem,itemLessThan) - FItems.constBegin();
+}
+
+void UsersModel::updateItemSortKey(UsersModelItem *AItem) const
+{
+	static const QList<QString> roles = QList<QString>() << MUC_ROLE_MODERATOR << MUC_ROLE_PARTICIPANT << MUC_ROLE_VISITOR << MUC_ROLE_NONE;
+	static const QList<QString> affiliations = QList<QString>() << MUC_AFFIL_OWNER << MUC_AFFIL_ADMIN << MUC_AFFIL_MEMBER << MUC_AFFIL_OUTCAST << MUC_AFFIL_NONE;
+
+	int affilIndex = affiliations.indexOf(AItem->user->data(MUDR_AFFILIATION).toString());
+	int roleIndex = roles.indexOf(AItem->user->data(MUDR_ROLE).toString());
+	AItem->bucket = (affilIndex+1)*(roles.count()+1) + roleIndex+1;
+	AItem->sortKey = AItem->user->nickName().toLower();
+}
+
+void UsersModel::emitItemChanged(const UsersModelItem *AItem)
+{
+	if (!AItem->pending)
+	{
+		QModelIndex itemIndex = index(itemRow(AItem));
+		emit dataChanged(itemIndex,itemIndex);
+	}
+}
+
+void UsersModel::onFlushTimerTimeout()
+{
+	if (!FPending.isEmpty())
+	{
+		qSort(FPending.begin(),FPending.end(),itemLessThan);
+		foreach(UsersModelItem *item, FPending)
+			item->pending = false;
+
+		if (FPending.count()>=BATCH_RESET_COUNT || FItems.isEmpty())
+		{
+			QList<UsersModelItem *> merged;
+			merged.reserve(FItems.count()+FPending.count());
+
+			QList<UsersModelItem *>::const_iterator itemIt = FItems.constBegin();
+			QList<UsersModelItem *>::const_iterator pendIt = FPending.constBegin();
+			while (itemIt!=FItems.constEnd() || pendIt!=FPending.constEnd())
+			{
+				if (pendIt==FPending.constEnd() || (itemIt!=FItems.constEnd() && !itemLessThan(*pendIt,*itemIt)))
+					merged.append(*itemIt++);
+				else
+					merged.append(*pendIt++);
+			}
+
+			beginResetModel();
+			FItems = merged;
+			endResetModel();
+		}
+		else foreach(UsersModelItem *item, FPending)
+		{
+			int row = insertRow(item);
+			beginInsertRows(QModelIndex(),row,row);
+			FItems.insert(row,item);
+			endInsertRows();
+		}
+		FPending.clear();
+	}
+}
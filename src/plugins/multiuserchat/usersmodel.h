@@ -0,0 +1,58 @@
+#ifndef USERSMODEL_H
+#define USERSMODEL_H
+
+#include <QFont>
+#include <QIcon>
+#include <QHash>
+#include <QBrush>
+#include <QTimer>
+#include <QAbstractListModel>
+#include <interfaces/imultiuserchat.h>
+
+struct UsersModelItem {
+	IMultiUser *user;
+	int bucket;
+	QString sortKey;
+	QIcon icon;
+	QFont font;
+	QBrush foreground;
+	bool pending;
+};
+
+class UsersModel :
+	public QAbstractListModel
+{
+	Q_OBJECT;
+public:
+	UsersModel(QObject *AParent);
+	~UsersModel();
+	virtual int rowCount(const QModelIndex &AParent = QModelIndex()) const;
+	virtual QVariant data(const QModelIndex &AIndex, int ARole = Qt::DisplayRole) const;
+	int count() const;
+	QList<IMultiUser *> users() const;
+	bool contains(IMultiUser *AUser) const;
+	IMultiUser *userByIndex(const QModelIndex &AIndex) const;
+	QModelIndex userIndex(IMultiUser *AUser) const;
+	void insertUser(IMultiUser *AUser);
+	void removeUser(IMultiUser *AUser);
+	void updateUser(IMultiUser *AUser);
+	QIcon userIcon(IMultiUser *AUser) const;
+	void setUserIcon(IMultiUser *AUser, const QIcon &AIcon);
+	QFont userFont(IMultiUser *AUser) const;
+	void setUserFont(IMultiUser *AUser, const QFont &AFont);
+	void setUserForeground(IMultiUser *AUser, const QBrush &ABrush);
+protected:
+	int itemRow(const UsersModelItem *AItem) const;
+	int insertRow(const UsersModelItem *AItem) const;
+	void updateItemSortKey(UsersModelItem *AItem) const;
+	void emitItemChanged(const UsersModelItem *AItem);
+protected slots:
+	void onFlushTimerTimeout();
+private:
+	QTimer FFlushTimer;
+	QList<UsersModelItem *> FItems;
+	QList<UsersModelItem *> FPending;
+	QHash<IMultiUser *, UsersModelItem *> FUserItems;
+};
+
+#endif // USERSMODEL_H
@@ -11,6 +11,7 @@
 #include <definitions/optionwidgetorders.h>
 #include <definitions/actiongroups.h>
 #include <definitions/toolbargroups.h>
+#include <definitions/namespaces.h>
 #include <definitions/messagedataroles.h>
 #include <definitions/messagehandlerorders.h>
 #include <definitions/messageeditsendhandlerorders.h>
@@ -24,6 +25,7 @@
 #include <definitions/notificationdataroles.h>
 #include <definitions/notificationtypeorders.h>
 #include <definitions/tabpagenotifypriorities.h>
+#include <definitions/archivehandlerorders.h>
 #include <utils/widgetmanager.h>
 #include <utils/textmanager.h>
 #include <utils/xmpperror.h>
@@ -37,6 +39,11 @@
 #define ADR_WINDOW                Action::DR_Parametr1
 #define ADR_ACTION_ID             Action::DR_Parametr2
 
+#define MULTICAST_MAX_ADDRESSES   100
+#define BROADCAST_SEND_BATCH      20
+#define BROADCAST_SEND_INTERVAL   100
+#define BROADCAST_ARCHIVE_RESOURCE "broadcast"
+
 static const QList<int> GroupRosterKinds = QList<int>() << RIK_GROUP << RIK_GROUP_BLANK << RIK_GROUP_NOT_IN_ROSTER;
 static const QList<int> ContactRosterKinds = QList<int>() << RIK_CONTACT << RIK_AGENT << RIK_MY_RESOURCE << RIK_METACONTACT << RIK_METACONTACT_ITEM;
 
@@ -54,6 +61,13 @@ NormalMessageHandler::NormalMessageHandler()
 	FXmppUriQueries = NULL;
 	FOptionsManager = NULL;
 	FRecentContacts = NULL;
+	FDiscovery = NULL;
+	FStanzaProcessor = NULL;
+	FMessageArchiver = NULL;
+
+	FBroadcastTimer.setSingleShot(false);
+	FBroadcastTimer.setInterval(BROADCAST_SEND_INTERVAL);
+	connect(&FBroadcastTimer,SIGNAL(timeout()),SLOT(onBroadcastTimerTimeout()));
 }
 
 NormalMessageHandler::~NormalMessageHandler()
@@ -173,6 +187,26 @@ bool NormalMessageHandler::initConnections(IPluginManager *APluginManager, int &
 		FRecentContacts = qobject_cast<IRecentContacts *>(plugin->instance());
 	}
 
+	plugin = APluginManager->pluginInterface("IServiceDiscovery").value(0,NULL);
+	if (plugin)
+	{
+		FDiscovery = qobject_cast<IServiceDiscovery *>(plugin->instance());
+		if (FDiscovery)
+			connect(FDiscovery->instance(),SIGNAL(discoItemsReceived(const IDiscoItems &)),SLOT(onDiscoItemsReceived(const IDiscoItems &)));
+	}
+
+	plugin = APluginManager->pluginInterface("IStanzaProcessor").value(0,NULL);
+	if (plugin)
+	{
+		FStanzaProcessor = qobject_cast<IStanzaProcessor *>(plugin->instance());
+	}
+
+	plugin = APluginManager->pluginInterface("IMessageArchiver").value(0,NULL);
+	if (plugin)
+	{
+		FMessageArchiver = qobject_cast<IMessageArchiver *>(plugin->instance());
+	}
+
 	connect(Shortcuts::instance(),SIGNAL(shortcutActivated(const QString &, QWidget *)),SLOT(onShortcutActivated(const QString &, QWidget *)));
 
 	return FMessageProcessor!=NULL && FMessageWidgets!=NULL && FMessageStyles!=NULL;
@@ -213,6 +247,10 @@ bool NormalMessageHandler::initObjects()
 	{
 		FMessageWidgets->insertEditSendHandler(MESHO_NORMALMESSAGEHANDLER,this);
 	}
+	if (FMessageArchiver)
+	{
+		FMessageArchiver->insertArchiveHandler(AHO_DEFAULT,this);
+	}
 	return true;
 }
 
@@ -242,12 +280,24 @@ bool NormalMessageHandler::messageEditSendProcesse(int AOrder, IMessageEditWidge
 			{
 				bool sent = false;
 				QMultiMap<Jid, Jid> addresses = window->receiversWidget()->selectedAddresses();
-				for (QMultiMap<Jid, Jid>::const_iterator it=addresses.constBegin(); it!=addresses.constEnd(); ++it)
+				foreach(const Jid &streamJid, addresses.uniqueKeys())
 				{
-					message.setTo(it->full());
-					if (!FMessageProcessor->sendMessage(it.key(),message,IMessageProcessor::DirectionOut))
-						LOG_STRM_WARNING(it.key(),QString("Failed to send message to=%1").arg(it->full()));
-					else
+					QList<Jid> receivers = addresses.values(streamJid);
+					if (receivers.count() == 1)
+					{
+						Message single = message;
+						single.setTo(receivers.first().full());
+						if (!FMessageProcessor->sendMessage(streamJid,single,IMessageProcessor::DirectionOut))
+							LOG_STRM_WARNING(streamJid,QString("Failed to send message to=%1").arg(receivers.first().full()));
+						else
+							sent = true;
+						continue;
+					}
+
+					Jid service = findMulticastService(streamJid);
+					if (service.isValid() && sendMulticastMessage(streamJid,service,message,receivers))
+						sent = true;
+					else if (sendBroadcastMessage(streamJid,message,receivers))
 						sent = true;
 				}
 				return sent;
@@ -435,6 +485,23 @@ bool NormalMessageHandler::rosterIndexDoubleClicked(int AOrder, IRosterIndex *AI
 	return false;
 }
 
+bool NormalMessageHandler::archiveMessageEdit(int AOrder, const Jid &AStreamJid, Message &AMessage, bool ADirectionIn)
+{
+	Q_UNUSED(AOrder);
+	// Broadcast copies are archived once by archiveBroadcastMessage()
+	if (!ADirectionIn)
+	{
+		QMap<Jid, QSet<QString> >::iterator it = FBroadcastIds.find(AStreamJid);
+		if (it!=FBroadcastIds.end() && it->remove(AMessage.id()))
+		{
+			if (it->isEmpty())
+				FBroadcastIds.erase(it);
+			return true;
+		}
+	}
+	return false;
+}
+
 bool NormalMessageHandler::xmppUriOpen(const Jid &AStreamJid, const Jid &AContactJid, const QString &AAction, const QMultiMap<QString, QString> &AParams)
 {
 	if (AAction == "message")
@@ -885,6 +952,139 @@ QMap<int,QStringList> NormalMessageHandler::indexesRolesMap(const QList<IRosterI
 	return rolesMap;
 }
 
+Jid NormalMessageHandler::findMulticastService(const Jid &AStreamJid) const
+{
+	if (FDiscovery)
+	{
+		Jid server = AStreamJid.domain();
+		if (FDiscovery->discoInfo(AStreamJid,server).features.contains(NS_ADDRESS))
+			return server;
+
+		foreach(const IDiscoInfo &info, FDiscovery->findDiscoInfo(AStreamJid,IDiscoIdentity(),QStringList()<<NS_ADDRESS,IDiscoItem()))
+		{
+			if (info.node.isEmpty() && info.contactJid.node().isEmpty() && info.contactJid.domain().endsWith("."+server.domain()))
+				return info.contactJid;
+		}
+	}
+	return Jid::null;
+}
+
+bool NormalMessageHandler::sendMulticastMessage(const Jid &AStreamJid, const Jid &AService, const Message &AMessage, const QList<Jid> &AReceivers)
+{
+	bool sent = false;
+	for (int index=0; index<AReceivers.count(); index+=MULTICAST_MAX_ADDRESSES)
+	{
+		Message message = AMessage;
+		message.detach();
+		message.setTo(AService.full());
+		message.setId(newBroadcastId(AStreamJid));
+
+		QDomElement addressesElem = message.stanza().addElement("addresses",NS_ADDRESS);
+		foreach(const Jid &receiver, AReceivers.mid(index,MULTICAST_MAX_ADDRESSES))
+		{
+			QDomElement addressElem = addressesElem.appendChild(message.stanza().createElement("address")).toElement();
+			addressElem.setAttribute("type","bcc");
+			addressElem.setAttribute("jid",receiver.full());
+		}
+
+		if (FMessageProcessor->sendMessage(AStreamJid,message,IMessageProcessor::DirectionOut))
+		{
+			sent = true;
+			releaseBroadcastId(AStreamJid,message.id(),false);
+		}
+		else
+		{
+			releaseBroadcastId(AStreamJid,message.id(),true);
+			LOG_STRM_WARNING(AStreamJid,QString("Failed to send multicast message to=%1, receivers=%2").arg(AService.full()).arg(AReceivers.mid(index,MULTICAST_MAX_ADDRESSES).count()));
+		}
+	}
+	if (sent)
+	{
+		archiveBroadcastMessage(AStreamJid,AMessage,AReceivers);
+		LOG_STRM_INFO(AStreamJid,QString("Multicast message sent to=%1, receivers=%2").arg(AService.full()).arg(AReceivers.count()));
+	}
+	return sent;
+}
+
+bool NormalMessageHandler::sendBroadcastMessage(const Jid &AStreamJid, const Message &AMessage, const QList<Jid> &AReceivers)
+{
+	if (FStanzaProcessor)
+	{
+		Message message = AMessage;
+		message.detach();
+		message.setTo(AReceivers.first().full());
+		if (FMessageProcessor->processMessage(AStreamJid,message,IMessageProcessor::DirectionOut))
+		{
+			archiveBroadcastMessage(AStreamJid,message,AReceivers);
+
+			BroadcastMessage broadcast;
+			broadcast.streamJid = AStreamJid;
+			broadcast.stanza = message.stanza();
+			broadcast.receivers = AReceivers;
+			FBroadcastQueue.append(broadcast);
+
+			if (!FBroadcastTimer.isActive())
+			{
+				FBroadcastTimer.start();
+				onBroadcastTimerTimeout();
+			}
+
+			LOG_STRM_INFO(AStreamJid,QString("Broadcast message queued, receivers=%1").arg(AReceivers.count()));
+			return true;
+		}
+		else
+		{
+			LOG_STRM_WARNING(AStreamJid,QString("Failed to send broadcast message: Message was rejected by editors"));
+		}
+	}
+	else
+	{
+		LOG_STRM_WARNING(AStreamJid,QString("Failed to send broadcast message: Stanza processor not found"));
+	}
+	return false;
+}
+
+QString NormalMessageHandler::newBroadcastId(const Jid &AStreamJid)
+{
+	QString id = FStanzaProcessor!=NULL ? FStanzaProcessor->newId() : QString::null;
+	if (!id.isEmpty() && FMessageArchiver!=NULL)
+		FBroadcastIds[AStreamJid] += id;
+	return id;
+}
+
+void NormalMessageHandler::releaseBroadcastId(const Jid &AStreamJid, const QString &AId, bool AFailed)
+{
+	// Sent messages are archived synchronously unless archiver queued them as pending
+	if (AFailed || FMessageArchiver==NULL || FMessageArchiver->isReady(AStreamJid))
+	{
+		QMap<Jid, QSet<QString> >::iterator it = FBroadcastIds.find(AStreamJid);
+		if (it!=FBroadcastIds.end() && it->remove(AId) && it->isEmpty())
+			FBroadcastIds.erase(it);
+	}
+}
+
+void NormalMessageHandler::archiveBroadcastMessage(const Jid &AStreamJid, const Message &AMessage, const QList<Jid> &AReceivers)
+{
+	if (FMessageArchiver)
+	{
+		// Broadcast is stored once under own resource dedicated to multi-recipient messages
+		Jid recordJid(AStreamJid.node(),AStreamJid.domain(),BROADCAST_ARCHIVE_RESOURCE);
+
+		Message record = AMessage;
+		record.detach();
+		record.setTo(recordJid.full());
+
+		QDomElement addressesElem = record.stanza().addElement("addresses",NS_ADDRESS);
+		foreach(const Jid &receiver, AReceivers)
+		{
+			QDomElement addressElem = addressesElem.appendChild(record.stanza().createElement("address")).toElement();
+			addressElem.setAttribute("type","bcc");
+			addressElem.setAttribute("jid",receiver.full());
+		}
+		FMessageArchiver->saveMessage(AStreamJid,recordJid,record);
+	}
+}
+
 void NormalMessageHandler::onWindowActivated()
 {
 	IMessageNormalWindow *window = qobject_cast<IMessageNormalWindow *>(sender());
@@ -1101,6 +1301,65 @@ void NormalMessageHandler::onActiveStreamRemoved(const Jid &AStreamJid)
 {
 	foreach(IMessageNormalWindow *window, FWindows)
 		window->address()->removeAddress(AStreamJid);
+
+	FBroadcastIds.remove(AStreamJid);
+	for (QList<BroadcastMessage>::iterator it=FBroadcastQueue.begin(); it!=FBroadcastQueue.end(); )
+	{
+		if (it->streamJid == AStreamJid)
+		{
+			LOG_STRM_WARNING(AStreamJid,QString("Broadcast message dropped, receivers left=%1").arg(it->receivers.count()));
+			it = FBroadcastQueue.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+void NormalMessageHandler::onDiscoItemsReceived(const IDiscoItems &ADiscoItems)
+{
+	if (ADiscoItems.node.isEmpty() && ADiscoItems.contactJid==ADiscoItems.streamJid.domain())
+	{
+		foreach(const IDiscoItem &item, ADiscoItems.items)
+		{
+			if (item.node.isEmpty() && !FDiscovery->hasDiscoInfo(ADiscoItems.streamJid,item.itemJid))
+				FDiscovery->requestDiscoInfo(ADiscoItems.streamJid,item.itemJid);
+		}
+	}
+}
+
+void NormalMessageHandler::onBroadcastTimerTimeout()
+{
+	int sent = 0;
+	while (!FBroadcastQueue.isEmpty() && sent<BROADCAST_SEND_BATCH)
+	{
+		BroadcastMessage &broadcast = FBroadcastQueue.first();
+		while (!broadcast.receivers.isEmpty() && sent<BROADCAST_SEND_BATCH)
+		{
+			Jid receiver = broadcast.receivers.takeFirst();
+
+			Stanza stanza = broadcast.stanza;
+			stanza.detach();
+			stanza.setTo(receiver.full());
+			stanza.setId(newBroadcastId(broadcast.streamJid));
+			if (FStanzaProcessor->sendStanzaOut(broadcast.streamJid,stanza))
+			{
+				releaseBroadcastId(broadcast.streamJid,stanza.id(),false);
+			}
+			else
+			{
+				releaseBroadcastId(broadcast.streamJid,stanza.id(),true);
+				LOG_STRM_WARNING(broadcast.streamJid,QString("Failed to send broadcast message to=%1").arg(receiver.full()));
+			}
+			sent++;
+		}
+		if (broadcast.receivers.isEmpty())
+			FBroadcastQueue.removeFirst();
+	}
+
+	if (FBroadcastQueue.isEmpty())
+		FBroadcastTimer.stop();
 }
 
 void NormalMessageHandler::onShortcutActivated(const QString &AId, QWidget *AWidget)
@@ -4,6 +4,7 @@
 #define NORMALMESSAGEHANDLER_UUID "{8592e3c3-ef5e-42a9-91c9-faf1ed9a91cc}"
 
 #include <QQueue>
+#include <QTimer>
 #include <QMultiMap>
 #include <interfaces/ipluginmanager.h>
 #include <interfaces/imessageprocessor.h>
@@ -17,6 +18,9 @@
 #include <interfaces/ixmppuriqueries.h>
 #include <interfaces/ioptionsmanager.h>
 #include <interfaces/irecentcontacts.h>
+#include <interfaces/iservicediscovery.h>
+#include <interfaces/istanzaprocessor.h>
+#include <interfaces/imessagearchiver.h>
 
 enum WindowMenuAction {
 	NextAction,
@@ -27,6 +31,12 @@ enum WindowMenuAction {
 	SendChatAction
 };
 
+struct BroadcastMessage {
+	Jid streamJid;
+	Stanza stanza;
+	QList<Jid> receivers;
+};
+
 class NormalMessageHandler :
 	public QObject,
 	public IPlugin,
@@ -34,10 +44,11 @@ class NormalMessageHandler :
 	public IXmppUriHandler,
 	public IMessageHandler,
 	public IRostersClickHooker,
-	public IMessageEditSendHandler
+	public IMessageEditSendHandler,
+	public IArchiveHandler
 {
 	Q_OBJECT;
-	Q_INTERFACES(IPlugin IOptionsHolder IXmppUriHandler IMessageHandler IRostersClickHooker IMessageEditSendHandler);
+	Q_INTERFACES(IPlugin IOptionsHolder IXmppUriHandler IMessageHandler IRostersClickHooker IMessageEditSendHandler IArchiveHandler);
 public:
 	NormalMessageHandler();
 	~NormalMessageHandler();
@@ -65,6 +76,8 @@ public:
 	virtual bool rosterIndexDoubleClicked(int AOrder, IRosterIndex *AIndex, const QMouseEvent *AEvent);
 	//IXmppUriHandler
 	virtual bool xmppUriOpen(const Jid &AStreamJid, const Jid &AContactJid, const QString &AAction, const QMultiMap<QString, QString> &AParams);
+	//IArchiveHandler
+	virtual bool archiveMessageEdit(int AOrder, const Jid &AStreamJid, Message &AMessage, bool ADirectionIn);
 protected:
 	IMessageNormalWindow *getWindow(const Jid &AStreamJid, const Jid &AContactJid, IMessageNormalWindow::Mode AMode);
 	IMessageNormalWindow *findWindow(const Jid &AStreamJid, const Jid &AContactJid) const;
@@ -87,6 +100,13 @@ protected:
 	bool isAnyPresenceOpened(const QStringList &AStreams) const;
 	bool isSelectionAccepted(const QList<IRosterIndex *> &ASelected) const;
 	QMap<int,QStringList> indexesRolesMap(const QList<IRosterIndex *> &AIndexes) const;
+protected:
+	Jid findMulticastService(const Jid &AStreamJid) const;
+	bool sendMulticastMessage(const Jid &AStreamJid, const Jid &AService, const Message &AMessage, const QList<Jid> &AReceivers);
+	bool sendBroadcastMessage(const Jid &AStreamJid, const Message &AMessage, const QList<Jid> &AReceivers);
+	QString newBroadcastId(const Jid &AStreamJid);
+	void releaseBroadcastId(const Jid &AStreamJid, const QString &AId, bool AFailed);
+	void archiveBroadcastMessage(const Jid &AStreamJid, const Message &AMessage, const QList<Jid> &AReceivers);
 protected slots:
 	void onWindowActivated();
 	void onWindowDestroyed();
@@ -114,6 +134,9 @@ protected slots:
 	void onRostersViewIndexMultiSelection(const QList<IRosterIndex *> &ASelected, bool &AAccepted);
 	void onRostersViewIndexContextMenu(const QList<IRosterIndex *> &AIndexes, quint32 ALabelId, Menu *AMenu);
 	void onStyleOptionsChanged(const IMessageStyleOptions &AOptions, int AMessageType, const QString &AContext);
+protected slots:
+	void onDiscoItemsReceived(const IDiscoItems &ADiscoItems);
+	void onBroadcastTimerTimeout();
 private:
 	IAvatars *FAvatars;
 	IMessageWidgets *FMessageWidgets;
@@ -127,6 +150,13 @@ private:
 	IXmppUriQueries *FXmppUriQueries;
 	IOptionsManager *FOptionsManager;
 	IRecentContacts *FRecentContacts;
+	IServiceDiscovery *FDiscovery;
+	IStanzaProcessor *FStanzaProcessor;
+	IMessageArchiver *FMessageArchiver;
+private:
+	QTimer FBroadcastTimer;
+	QMap<Jid, QSet<QString> > FBroadcastIds;
+	QList<BroadcastMessage> FBroadcastQueue;
 private:
 	QList<IMessageNormalWindow *> FWindows;
 	QMultiMap<IMessageNormalWindow *, int> FNotifiedMessages;
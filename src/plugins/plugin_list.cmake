@@ -9,6 +9,7 @@ add_subdirectory(captchaforms)
 add_subdirectory(chatmessagehandler)
 add_subdirectory(chatstates)
 add_subdirectory(clientinfo)
+add_subdirectory(clientstate)
 add_subdirectory(commands)
 add_subdirectory(compress)
 add_subdirectory(connectionmanager)
@@ -25,6 +26,7 @@ add_subdirectory(inbandstreams)
 add_subdirectory(iqauth)
 add_subdirectory(jabbersearch)
 add_subdirectory(mainwindow)
+add_subdirectory(mammessagearchive)
 add_subdirectory(messagearchiver)
 add_subdirectory(messagecarbons)
 add_subdirectory(messageprocessor)
@@ -42,6 +44,7 @@ add_subdirectory(privatestorage)
 add_subdirectory(recentcontacts)
 add_subdirectory(registration)
 add_subdirectory(remotecontrol)
+add_subdirectory(replayconnection)
 add_subdirectory(roster)
 add_subdirectory(rosterchanger)
 add_subdirectory(rosteritemexchange)
@@ -57,6 +60,7 @@ add_subdirectory(simplemessagestyle)
 add_subdirectory(socksstreams)
 add_subdirectory(spellchecker)
 add_subdirectory(stanzaprocessor)
+add_subdirectory(streammanagement)
 add_subdirectory(starttls)
 add_subdirectory(statistics)
 add_subdirectory(statuschanger)
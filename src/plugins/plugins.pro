@@ -22,6 +22,8 @@ SUBDIRS += simplemessagestyle
 SUBDIRS += normalmessagehandler
 SUBDIRS += chatmessagehandler
 SUBDIRS += compress
+SUBDIRS += clientstate
+SUBDIRS += streammanagement
 SUBDIRS += connectionmanager
 SUBDIRS += defaultconnection
 SUBDIRS += starttls
@@ -61,13 +63,15 @@ SUBDIRS += shortcutmanager
 SUBDIRS += birthdayreminder 
 SUBDIRS += urlprocessor
 SUBDIRS += filemessagearchive 
-SUBDIRS += servermessagearchive 
+SUBDIRS += servermessagearchive 
+SUBDIRS += mammessagearchive
 SUBDIRS += rosteritemexchange 
 SUBDIRS += spellchecker 
 SUBDIRS += messagecarbons
 SUBDIRS += recentcontacts 
 SUBDIRS += metacontacts 
-SUBDIRS += statistics 
+SUBDIRS += statistics 
+SUBDIRS += replayconnection
 
 contains(QT_CONFIG, webkit) {
   SUBDIRS += adiummessagestyle
@@ -0,0 +1,173 @@
+#include "privacylistindex.h"
+
+#include <QStringList>
+#include <QtAlgorithms>
+
+PrivacyListIndex::PrivacyListIndex()
+{
+
+}
+
+PrivacyListIndex::PrivacyListIndex(const IPrivacyList &AList)
+{
+	FList = AList;
+	FMasks.resize(FList.rules.count());
+	for (int i=0; i<FList.rules.count(); i++)
+	{
+		const IPrivacyRule &rule = FList.rules.at(i);
+		if (rule.type == PRIVACY_TYPE_ALWAYS)
+		{
+			FAlwaysRules.append(i);
+		}
+		else if (rule.type == PRIVACY_TYPE_GROUP)
+		{
+			FGroupRules[rule.value].append(i);
+		}
+		else if (rule.type == PRIVACY_TYPE_SUBSCRIPTION)
+		{
+			FSubscriptionRules[rule.value].append(i);
+		}
+		else if (rule.type == PRIVACY_TYPE_JID)
+		{
+			Jid mask = rule.value;
+			FMasks[i] = mask;
+			if (!mask.node().isEmpty() && mask.resource().isEmpty())
+				FJidRules[mask.pBare()].append(i);
+			else
+				FDomainRules[mask.pDomain()].append(i);
+		}
+	}
+}
+
+bool PrivacyListIndex::isEmpty() const
+{
+	return FList.rules.isEmpty();
+}
+
+IPrivacyList PrivacyListIndex::privacyList() const
+{
+	return FList;
+}
+
+int PrivacyListIndex::denyedStanzas(const IRosterItem &AItem) const
+{
+	QList<int> matched = FAlwaysRules;
+	matched += FSubscriptionRules.value(AItem.subscription);
+	matched += FJidRules.value(AItem.itemJid.pBare());
+	foreach(int index, FDomainRules.value(AItem.itemJid.pDomain()))
+		if (isMatchedJid(FMasks.at(index),AItem.itemJid))
+			matched.append(index);
+	foreach(const QString &group, AItem.groups)
+		matched += FGroupRules.value(group);
+
+	int denied = 0;
+	if (!matched.isEmpty())
+	{
+		qSort(matched);
+
+		int allowed = 0;
+		for (int i=0; i<matched.count() && (denied|allowed)!=IPrivacyRule::AnyStanza; i++)
+		{
+			const IPrivacyRule &rule = FList.rules.at(matched.at(i));
+			if (rule.action == PRIVACY_ACTION_DENY)
+				denied |= rule.stanzas & (~allowed);
+			else
+				allowed |= rule.stanzas & (~denied);
+		}
+	}
+	return denied;
+}
+
+QSet<Jid> PrivacyListIndex::changedContacts(const PrivacyListIndex &ABefore, const IRoster *ARoster) const
+{
+	QSet<Jid> contacts;
+	if (ARoster != NULL)
+	{
+		QHash<QString,int> beforeCount;
+		foreach(const IPrivacyRule &rule, ABefore.FList.rules)
+			beforeCount[ruleKey(rule)]++;
+
+		QStringList afterCommon;
+		QList<IPrivacyRule> changed;
+		QHash<QString,int> commonCount;
+		foreach(const IPrivacyRule &rule, FList.rules)
+		{
+			QString key = ruleKey(rule);
+			if (beforeCount.value(key) > commonCount.value(key))
+			{
+				commonCount[key]++;
+				afterCommon.append(key);
+			}
+			else
+			{
+				changed.append(rule);
+			}
+		}
+
+		QStringList beforeCommon;
+		foreach(const IPrivacyRule &rule, ABefore.FList.rules)
+		{
+			QString key = ruleKey(rule);
+			if (commonCount.value(key) > 0)
+			{
+				commonCount[key]--;
+				beforeCommon.append(key);
+			}
+			else
+			{
+				changed.append(rule);
+			}
+		}
+
+		// Contacts matched by none of the changed rules see the same rules in the same order
+		bool changedAll = beforeCommon!=afterCommon;
+		QSet<QString> changedDomains;
+		for (int i=0; !changedAll && i<changed.count(); i++)
+		{
+			const IPrivacyRule &rule = changed.at(i);
+			if (rule.type==PRIVACY_TYPE_ALWAYS || rule.type==PRIVACY_TYPE_SUBSCRIPTION)
+			{
+				changedAll = true;
+			}
+			else if (rule.type == PRIVACY_TYPE_GROUP)
+			{
+				foreach(const IRosterItem &ritem, ARoster->groupItems(rule.value))
+					contacts += ritem.itemJid;
+			}
+			else if (rule.type == PRIVACY_TYPE_JID)
+			{
+				Jid mask = rule.value;
+				if (!mask.node().isEmpty() && mask.resource().isEmpty())
+				{
+					IRosterItem ritem = ARoster->rosterItem(mask);
+					if (ritem.isValid)
+						contacts += ritem.itemJid;
+				}
+				else
+				{
+					changedDomains += mask.pDomain();
+				}
+			}
+		}
+
+		if (changedAll || !changedDomains.isEmpty())
+		{
+			foreach(const IRosterItem &ritem, ARoster->rosterItems())
+				if (changedAll || changedDomains.contains(ritem.itemJid.pDomain()))
+					contacts += ritem.itemJid;
+		}
+	}
+	return contacts;
+}
+
+bool PrivacyListIndex::isMatchedJid(const Jid &AMask, const Jid &AJid)
+{
+	return  ( (AMask.pDomain() == AJid.pDomain()) &&
+	          (AMask.node().isEmpty() || AMask.pNode()==AJid.pNode()) &&
+	          (AMask.resource().isEmpty() || AMask.pResource()==AJid.pResource()) );
+}
+
+QString PrivacyListIndex::ruleKey(const IPrivacyRule &ARule)
+{
+	return ARule.type + "\n" + ARule.value + "\n" + ARule.action + "\n" + QString::number(ARule.stanzas);
+}
@@ -0,0 +1,33 @@
+#ifndef PRIVACYLISTINDEX_H
+#define PRIVACYLISTINDEX_H
+
+#include <QSet>
+#include <QHash>
+#include <QVector>
+#include <interfaces/iroster.h>
+#include <interfaces/iprivacylists.h>
+
+class PrivacyListIndex
+{
+public:
+	PrivacyListIndex();
+	PrivacyListIndex(const IPrivacyList &AList);
+	bool isEmpty() const;
+	IPrivacyList privacyList() const;
+	int denyedStanzas(const IRosterItem &AItem) const;
+	QSet<Jid> changedContacts(const PrivacyListIndex &ABefore, const IRoster *ARoster) const;
+public:
+	static bool isMatchedJid(const Jid &AMask, const Jid &AJid);
+protected:
+	static QString ruleKey(const IPrivacyRule &ARule);
+private:
+	IPrivacyList FList;
+	QVector<Jid> FMasks;
+	QList<int> FAlwaysRules;
+	QHash<QString, QList<int> > FJidRules;
+	QHash<QString, QList<int> > FDomainRules;
+	QHash<QString, QList<int> > FGroupRules;
+	QHash<QString, QList<int> > FSubscriptionRules;
+};
+
+#endif // PRIVACYLISTINDEX_H
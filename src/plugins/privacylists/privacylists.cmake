@@ -1,3 +1,3 @@
-set(SOURCES editlistsdialog.cpp privacylists.cpp )
-set(HEADERS privacylists.h editlistsdialog.h )
+set(SOURCES editlistsdialog.cpp privacylistindex.cpp privacylists.cpp )
+set(HEADERS privacylists.h editlistsdialog.h privacylistindex.h )
 set(UIS editlistsdialog.ui )
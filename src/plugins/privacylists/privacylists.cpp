@@ -186,7 +186,7 @@ bool PrivacyLists::stanzaReadWrite(int AHandlerId, const Jid &AStreamJid, Stanza
 						groupElem = groupElem.nextSiblingElement("group");
 					}
 
-					int stanzas = denyedStanzas(ritem,privacyList(AStreamJid,activeList(AStreamJid)));
+					int stanzas = activeListIndex(AStreamJid).denyedStanzas(ritem);
 					bool denied = (stanzas & IPrivacyRule::PresencesOut)>0;
 					if (denied && !FOfflinePresences.value(AStreamJid).contains(ritem.itemJid))
 					{
@@ -661,11 +661,12 @@ int PrivacyLists::denyedStanzas(const IRosterItem &AItem, const IPrivacyList &AL
 QHash<Jid,int> PrivacyLists::denyedContacts(const Jid &AStreamJid, const IPrivacyList &AList, int AFilter) const
 {
 	QHash<Jid,int> denied;
+	PrivacyListIndex index(AList);
 	IRoster *roster = FRosterPlugin!=NULL ? FRosterPlugin->findRoster(AStreamJid) : NULL;
 	QList<IRosterItem> ritems = roster!=NULL ? roster->rosterItems() : QList<IRosterItem>();
 	foreach(const IRosterItem &ritem,ritems)
 	{
-		int stanzas = denyedStanzas(ritem,AList);
+		int stanzas = index.denyedStanzas(ritem);
 		if ((stanzas & AFilter) > 0)
 			denied[ritem.itemJid] = stanzas;
 	}
@@ -1192,19 +1193,39 @@ Menu *PrivacyLists::createSetDefaultMenu(const Jid &AStreamJid, const QList<IPri
 
 bool PrivacyLists::isMatchedJid(const Jid &AMask, const Jid &AJid) const
 {
-	return  ( (AMask.pDomain() == AJid.pDomain()) &&
-	          (AMask.node().isEmpty() || AMask.pNode()==AJid.pNode()) &&
-	          (AMask.resource().isEmpty() || AMask.pResource()==AJid.pResource()) );
+	return PrivacyListIndex::isMatchedJid(AMask,AJid);
 }
 
-void PrivacyLists::sendOnlinePresences(const Jid &AStreamJid, const IPrivacyList &AAutoList)
+QSet<Jid> PrivacyLists::rosterContacts(const Jid &AStreamJid) const
+{
+	QSet<Jid> contacts;
+	IRoster *roster = FRosterPlugin!=NULL ? FRosterPlugin->findRoster(AStreamJid) : NULL;
+	QList<IRosterItem> ritems = roster!=NULL ? roster->rosterItems() : QList<IRosterItem>();
+	foreach(const IRosterItem &ritem, ritems)
+		contacts += ritem.itemJid;
+	return contacts;
+}
+
+PrivacyListIndex PrivacyLists::activeListIndex(const Jid &AStreamJid) const
+{
+	return FActiveListIndexes.value(AStreamJid);
+}
+
+void PrivacyLists::sendOnlinePresences(const Jid &AStreamJid)
 {
 	IRoster *roster = FRosterPlugin!=NULL ? FRosterPlugin->findRoster(AStreamJid) : NULL;
 	IPresence *presence = FPresencePlugin!=NULL ? FPresencePlugin->findPresence(AStreamJid) : NULL;
 	if (presence)
 	{
-		QSet<Jid> denied = denyedContacts(AStreamJid,AAutoList,IPrivacyRule::PresencesOut).keys().toSet();
-		QSet<Jid> online = FOfflinePresences.value(AStreamJid) - denied;
+		QSet<Jid> online;
+		PrivacyListIndex index = activeListIndex(AStreamJid);
+		foreach(const Jid &contactJid, FOfflinePresences.value(AStreamJid))
+		{
+			IRosterItem ritem = roster!=NULL ? roster->rosterItem(contactJid) : IRosterItem();
+			if (!ritem.isValid || (index.denyedStanzas(ritem) & IPrivacyRule::PresencesOut)==0)
+				online += contactJid;
+		}
+
 		if (presence->isOpen())
 		{
 			LOG_STRM_INFO(AStreamJid,"Sending online presence to all not denied contacts");
@@ -1220,13 +1241,24 @@ void PrivacyLists::sendOnlinePresences(const Jid &AStreamJid, const IPrivacyList
 	}
 }
 
-void PrivacyLists::sendOfflinePresences(const Jid &AStreamJid, const IPrivacyList &AAutoList)
+void PrivacyLists::sendOfflinePresences(const Jid &AStreamJid, const PrivacyListIndex &AIndex, const QSet<Jid> &AContacts)
 {
+	IRoster *roster = FRosterPlugin!=NULL ? FRosterPlugin->findRoster(AStreamJid) : NULL;
 	IPresence *presence = FPresencePlugin!=NULL ? FPresencePlugin->findPresence(AStreamJid) : NULL;
-	if (presence)
+	if (presence && roster)
 	{
-		QSet<Jid> denied = denyedContacts(AStreamJid,AAutoList,IPrivacyRule::PresencesOut).keys().toSet();
-		QSet<Jid> offline = denied - FOfflinePresences.value(AStreamJid);
+		QSet<Jid> offline;
+		QSet<Jid> offlined = FOfflinePresences.value(AStreamJid);
+		foreach(const Jid &contactJid, AContacts)
+		{
+			if (!offlined.contains(contactJid))
+			{
+				IRosterItem ritem = roster->rosterItem(contactJid);
+				if (ritem.isValid && (AIndex.denyedStanzas(ritem) & IPrivacyRule::PresencesOut)>0)
+					offline += contactJid;
+			}
+		}
+
 		if (presence->isOpen())
 		{
 			LOG_STRM_INFO(AStreamJid,"Sending offline presence to all denied contacts");
@@ -1259,12 +1291,31 @@ void PrivacyLists::setPrivacyLabel(const Jid &AStreamJid, const Jid &AContactJid
 }
 
 void PrivacyLists::updatePrivacyLabels(const Jid &AStreamJid)
+{
+	updatePrivacyLabels(AStreamJid,rosterContacts(AStreamJid)+FLabeledContacts.value(AStreamJid));
+}
+
+void PrivacyLists::updatePrivacyLabels(const Jid &AStreamJid, const QSet<Jid> &AContacts)
 {
 	if (FRostersModel)
 	{
-		QSet<Jid> denied = denyedContacts(AStreamJid,privacyList(AStreamJid,activeList(AStreamJid))).keys().toSet();
-		QSet<Jid> deny = denied - FLabeledContacts.value(AStreamJid);
-		QSet<Jid> allow = FLabeledContacts.value(AStreamJid) - denied;
+		QSet<Jid> deny;
+		QSet<Jid> allow;
+		PrivacyListIndex listIndex = activeListIndex(AStreamJid);
+		IRoster *roster = FRosterPlugin!=NULL ? FRosterPlugin->findRoster(AStreamJid) : NULL;
+		QSet<Jid> labeled = FLabeledContacts.value(AStreamJid);
+		foreach(const Jid &contactJid, AContacts)
+		{
+			IRosterItem ritem = roster!=NULL ? roster->rosterItem(contactJid) : IRosterItem();
+			bool denied = ritem.isValid && (listIndex.denyedStanzas(ritem) & IPrivacyRule::AnyStanza)>0;
+			if (denied && !labeled.contains(contactJid))
+				deny += contactJid;
+			else if (!denied && labeled.contains(contactJid))
+				allow += contactJid;
+		}
+
+		if (!deny.isEmpty() || !allow.isEmpty())
+			LOG_STRM_DEBUG(AStreamJid,QString("Updating privacy labels, checked=%1, denied=%2, allowed=%3").arg(AContacts.count()).arg(deny.count()).arg(allow.count()));
 
 		foreach(const Jid &contactJid, deny)
 			setPrivacyLabel(AStreamJid,contactJid,true);
@@ -1283,7 +1334,7 @@ void PrivacyLists::updatePrivacyLabels(const Jid &AStreamJid)
 				{
 					IRosterItem ritem;
 					ritem.itemJid = index->data(RDR_PREP_BARE_JID).toString();
-					if ((denyedStanzas(ritem,privacyList(AStreamJid,activeList(AStreamJid))) & IPrivacyRule::AnyStanza)>0)
+					if ((listIndex.denyedStanzas(ritem) & IPrivacyRule::AnyStanza)>0)
 						FRostersView->insertLabel(FPrivacyLabelId,index);
 					else
 						FRostersView->removeLabel(FPrivacyLabelId,index);
@@ -1325,7 +1376,11 @@ bool PrivacyLists::isSelectionAccepted(const QList<IRosterIndex *> &ASelected) c
 void PrivacyLists::onListAboutToBeChanged(const Jid &AStreamJid, const IPrivacyList &AList)
 {
 	if (AList.name == activeList(AStreamJid))
-		sendOfflinePresences(AStreamJid,AList);
+	{
+		PrivacyListIndex listIndex(AList);
+		IRoster *roster = FRosterPlugin!=NULL ? FRosterPlugin->findRoster(AStreamJid) : NULL;
+		sendOfflinePresences(AStreamJid,listIndex,listIndex.changedContacts(activeListIndex(AStreamJid),roster));
+	}
 }
 
 void PrivacyLists::onListChanged(const Jid &AStreamJid, const QString &AList)
@@ -1337,19 +1392,25 @@ void PrivacyLists::onListChanged(const Jid &AStreamJid, const QString &AList)
 	}
 	else if (AList == activeList(AStreamJid))
 	{
-		sendOnlinePresences(AStreamJid,privacyList(AStreamJid,AList));
-		updatePrivacyLabels(AStreamJid);
+		PrivacyListIndex listIndex(privacyList(AStreamJid,AList));
+		IRoster *roster = FRosterPlugin!=NULL ? FRosterPlugin->findRoster(AStreamJid) : NULL;
+		QSet<Jid> changed = listIndex.changedContacts(activeListIndex(AStreamJid),roster);
+		FActiveListIndexes.insert(AStreamJid,listIndex);
+
+		sendOnlinePresences(AStreamJid);
+		updatePrivacyLabels(AStreamJid,changed);
 	}
 }
 
 void PrivacyLists::onActiveListAboutToBeChanged(const Jid &AStreamJid, const QString &AList)
 {
-	sendOfflinePresences(AStreamJid,privacyList(AStreamJid,AList));
+	sendOfflinePresences(AStreamJid,PrivacyListIndex(privacyList(AStreamJid,AList)),rosterContacts(AStreamJid));
 }
 
 void PrivacyLists::onActiveListChanged(const Jid &AStreamJid, const QString &AList)
 {
-	sendOnlinePresences(AStreamJid,privacyList(AStreamJid,AList));
+	FActiveListIndexes.insert(AStreamJid,PrivacyListIndex(privacyList(AStreamJid,AList)));
+	sendOnlinePresences(AStreamJid);
 	updatePrivacyLabels(AStreamJid);
 }
 
@@ -1442,6 +1503,7 @@ void PrivacyLists::onXmppStreamClosed(IXmppStream *AXmppStream)
 	FActiveLists.remove(AXmppStream->streamJid());
 	FDefaultLists.remove(AXmppStream->streamJid());
 	FPrivacyLists.remove(AXmppStream->streamJid());
+	FActiveListIndexes.remove(AXmppStream->streamJid());
 	FStreamRequests.remove(AXmppStream->streamJid());
 
 	updatePrivacyLabels(AXmppStream->streamJid());
@@ -1540,7 +1602,7 @@ void PrivacyLists::onRostersViewIndexToolTips(IRosterIndex *AIndex, quint32 ALab
 		IRoster *roster = FRosterPlugin!=NULL ? FRosterPlugin->findRoster(streamJid) : NULL;
 		IRosterItem ritem = roster!=NULL ? roster->rosterItem(contactJid) : IRosterItem();
 		ritem.itemJid = contactJid;
-		int stanzas = denyedStanzas(ritem,privacyList(streamJid,activeList(streamJid)));
+		int stanzas = activeListIndex(streamJid).denyedStanzas(ritem);
 		QString toolTip = tr("<b>Privacy settings:</b>") +"<br>";
 		toolTip += tr("- queries: %1").arg((stanzas & IPrivacyRule::Queries) >0             ? tr("<b>denied</b>") : tr("allowed")) + "<br>";
 		toolTip += tr("- messages: %1").arg((stanzas & IPrivacyRule::Messages) >0           ? tr("<b>denied</b>") : tr("allowed")) + "<br>";
@@ -1562,7 +1624,7 @@ void PrivacyLists::onUpdateNewRosterIndexes()
 			IRoster *roster = FRosterPlugin!=NULL ? FRosterPlugin->findRoster(streamJid) : NULL;
 			IRosterItem ritem = roster!=NULL ? roster->rosterItem(contactJid) : IRosterItem();
 			ritem.itemJid = contactJid;
-			if ((denyedStanzas(ritem,privacyList(streamJid,activeList(streamJid))) & IPrivacyRule::AnyStanza)>0)
+			if ((activeListIndex(streamJid).denyedStanzas(ritem) & IPrivacyRule::AnyStanza)>0)
 			{
 				if (ritem.isValid)
 					FLabeledContacts[streamJid]+=ritem.itemJid;
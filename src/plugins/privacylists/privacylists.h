@@ -10,6 +10,7 @@
 #include <interfaces/irostersview.h>
 #include <interfaces/imultiuserchat.h>
 #include "editlistsdialog.h"
+#include "privacylistindex.h"
 
 class PrivacyLists :
 	public QObject,
@@ -80,10 +81,13 @@ protected:
 	Menu *createSetActiveMenu(const Jid &AStreamJid, const QList<IPrivacyList> &ALists, Menu *AMenu) const;
 	Menu *createSetDefaultMenu(const Jid &AStreamJid, const QList<IPrivacyList> &ALists, Menu *AMenu) const;
 	bool isMatchedJid(const Jid &AMask, const Jid &AJid) const;
-	void sendOnlinePresences(const Jid &AStreamJid, const IPrivacyList &AAutoList);
-	void sendOfflinePresences(const Jid &AStreamJid, const IPrivacyList &AAutoList);
+	QSet<Jid> rosterContacts(const Jid &AStreamJid) const;
+	PrivacyListIndex activeListIndex(const Jid &AStreamJid) const;
+	void sendOnlinePresences(const Jid &AStreamJid);
+	void sendOfflinePresences(const Jid &AStreamJid, const PrivacyListIndex &AIndex, const QSet<Jid> &AContacts);
 	void setPrivacyLabel(const Jid &AStreamJid, const Jid &AContactJid, bool AVisible);
 	void updatePrivacyLabels(const Jid &AStreamJid);
+	void updatePrivacyLabels(const Jid &AStreamJid, const QSet<Jid> &AContacts);
 	bool isAllStreamsReady(const QStringList &AStreams) const;
 	bool isSelectionAccepted(const QList<IRosterIndex *> &ASelected) const;
 protected slots:
@@ -138,6 +142,7 @@ private:
 	QMap<Jid, QSet<Jid> > FOfflinePresences;
 	QMap<Jid, EditListsDialog *> FEditListsDialogs;
 	QMap<Jid, QMap<QString,IPrivacyList> > FPrivacyLists;
+	QMap<Jid, PrivacyListIndex> FActiveListIndexes;
 };
 
 #endif // PRIVACYLISTS_H
@@ -1,7 +1,9 @@
 FORMS = editlistsdialog.ui
 
 HEADERS = editlistsdialog.h \
+          privacylistindex.h \
           privacylists.h
 
 SOURCES = editlistsdialog.cpp \
+          privacylistindex.cpp \
           privacylists.cpp
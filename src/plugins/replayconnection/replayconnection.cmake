@@ -0,0 +1,3 @@
+set(SOURCES replayoptionswidget.cpp replayconnection.cpp replayconnectionplugin.cpp )
+set(HEADERS replayconnection.h replayconnectionplugin.h replayoptionswidget.h )
+set(UIS replayoptionswidget.ui )
@@ -0,0 +1,349 @@
+#include "replayconnection.h"
+
+#include <QFile>
+#include <utils/logger.h>
+
+#define STALL_TIMEOUT         5000
+
+ReplayConnection::ReplayConnection(IConnectionPlugin *APlugin, QObject *AParent) : QObject(AParent)
+{
+	FPlugin = APlugin;
+
+	FOpen = false;
+	FEncrypted = false;
+	FConnecting = false;
+	FFinished = false;
+
+	FNextRecord = 0;
+	FWrittenRecords = 0;
+	FWaitingClient = false;
+
+	FInBytes = 0;
+	FOutBytes = 0;
+	FLastEventTime = 0;
+	FFeedTime = 0;
+	FAwaitResponse = false;
+
+	FReplayTimer.setSingleShot(true);
+	connect(&FReplayTimer,SIGNAL(timeout()),SLOT(onReplayTimerTimeout()));
+}
+
+ReplayConnection::~ReplayConnection()
+{
+	disconnectFromHost();
+	emit connectionDestroyed();
+}
+
+bool ReplayConnection::isOpen() const
+{
+	return FOpen;
+}
+
+bool ReplayConnection::isEncrypted() const
+{
+	return FEncrypted;
+}
+
+bool ReplayConnection::isEncryptionSupported() const
+{
+	return true;
+}
+
+bool ReplayConnection::connectToHost()
+{
+	if (!FOpen && !FConnecting)
+	{
+		emit aboutToConnect();
+
+		if (loadCaptureFile())
+		{
+			FConnecting = true;
+			FEncrypted = false;
+			FFinished = false;
+			FNextRecord = 0;
+			FWrittenRecords = 0;
+			FWaitingClient = false;
+			FInBytes = 0;
+			FOutBytes = 0;
+			FAwaitResponse = false;
+			FReadBuffer.clear();
+			FHandleLatencies.clear();
+			FResponseLatencies.clear();
+			QTimer::singleShot(0,this,SLOT(onConnectTimeout()));
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ReplayConnection::startEncryption()
+{
+	if (FOpen && !FEncrypted)
+	{
+		QTimer::singleShot(0,this,SLOT(onEncryptTimeout()));
+		return true;
+	}
+	return false;
+}
+
+void ReplayConnection::disconnectFromHost()
+{
+	if (FOpen || FConnecting)
+	{
+		bool wasOpen = FOpen;
+		LOG_INFO(QString("Disconnecting replay connection, file=%1").arg(option(CaptureFile).toString()));
+
+		FReplayTimer.stop();
+		if (wasOpen)
+		{
+			emit aboutToDisconnect();
+			finishReplay();
+		}
+
+		FOpen = false;
+		FConnecting = false;
+		FEncrypted = false;
+		FReadBuffer.clear();
+		FRecords.clear();
+
+		if (wasOpen)
+			emit disconnected();
+	}
+}
+
+void ReplayConnection::abortConnection(const XmppError &AError)
+{
+	if (FOpen || FConnecting)
+	{
+		LOG_WARNING(QString("Aborting replay connection, file=%1: %2").arg(option(CaptureFile).toString(),AError.errorString()));
+		emit error(AError);
+		disconnectFromHost();
+	}
+}
+
+qint64 ReplayConnection::write(const QByteArray &AData)
+{
+	if (FOpen)
+	{
+		FWrittenRecords++;
+		FOutBytes += AData.size();
+		FLastEventTime = FReplayClock.elapsed();
+
+		if (FAwaitResponse)
+		{
+			FAwaitResponse = false;
+			FResponseLatencies.append((FReplayClock.nsecsElapsed()-FFeedTime)/1000);
+		}
+
+		// Client has caught up with the capture, release next inbound record
+		if (FWaitingClient && FNextRecord<FRecords.count() && FWrittenRecords>=FRecords.at(FNextRecord).outBefore)
+		{
+			FWaitingClient = false;
+			scheduleNextRecord();
+		}
+		return AData.size();
+	}
+	return -1;
+}
+
+QByteArray ReplayConnection::read(qint64 ABytes)
+{
+	QByteArray data = FReadBuffer.left(ABytes);
+	FReadBuffer.remove(0,data.size());
+	return data;
+}
+
+IConnectionPlugin *ReplayConnection::ownerPlugin() const
+{
+	return FPlugin;
+}
+
+QSslCertificate ReplayConnection::hostCertificate() const
+{
+	return QSslCertificate();
+}
+
+QVariant ReplayConnection::option(int ARole) const
+{
+	return FOptions.value(ARole);
+}
+
+void ReplayConnection::setOption(int ARole, const QVariant &AValue)
+{
+	FOptions.insert(ARole, AValue);
+}
+
+bool ReplayConnection::loadCaptureFile()
+{
+	FRecords.clear();
+
+	QFile file(option(CaptureFile).toString());
+	if (file.open(QFile::ReadOnly))
+	{
+		int outCount = 0;
+		while (!file.atEnd())
+		{
+			// <msecs> <in|out> <stream jid> <size>\n<data>\n
+			QString header = QString::fromUtf8(file.readLine()).trimmed();
+			if (header.isEmpty())
+				continue;
+			else if (header.startsWith('#'))
+			{
+				LOG_ERROR(QString("Failed to load replay capture file=%1: Not a traffic capture, header=%2").arg(file.fileName(),header));
+				FRecords.clear();
+				return false;
+			}
+
+			ReplayRecord record;
+			bool timeOk, sizeOk;
+			record.time = header.section(' ',0,0).toLongLong(&timeOk);
+			record.out = header.section(' ',1,1) == "out";
+			record.outBefore = outCount;
+			int size = header.section(' ',-1,-1).toInt(&sizeOk);
+			if (!timeOk || !sizeOk || size<0)
+			{
+				LOG_ERROR(QString("Failed to load replay capture file=%1: Invalid record header at pos=%2").arg(file.fileName()).arg(file.pos()));
+				FRecords.clear();
+				return false;
+			}
+
+			record.data = file.read(size);
+			file.read(1);
+			if (record.data.size() != size)
+			{
+				LOG_ERROR(QString("Failed to load replay capture file=%1: Record is truncated at pos=%2").arg(file.fileName()).arg(file.pos()));
+				FRecords.clear();
+				return false;
+			}
+
+			if (record.out)
+				outCount++;
+			FRecords.append(record);
+		}
+		LOG_INFO(QString("Replay capture file loaded, file=%1, records=%2").arg(file.fileName()).arg(FRecords.count()));
+		return true;
+	}
+	else
+	{
+		LOG_ERROR(QString("Failed to open replay capture file=%1: %2").arg(file.fileName(),file.errorString()));
+	}
+	return false;
+}
+
+void ReplayConnection::scheduleNextRecord()
+{
+	while (FNextRecord<FRecords.count() && FRecords.at(FNextRecord).out)
+		FNextRecord++;
+
+	if (FNextRecord < FRecords.count())
+	{
+		const ReplayRecord &record = FRecords.at(FNextRecord);
+		if (FWrittenRecords < record.outBefore)
+		{
+			FWaitingClient = true;
+			FReplayTimer.start(STALL_TIMEOUT);
+		}
+		else if (option(ReplaySpeed).toInt()==OriginalSpeed && FNextRecord>0)
+		{
+			qint64 pause = record.time - FRecords.at(FNextRecord-1).time;
+			qint64 passed = FReplayClock.elapsed() - FLastEventTime;
+			FReplayTimer.start(qMax<qint64>(pause-passed,0));
+		}
+		else
+		{
+			FReplayTimer.start(0);
+		}
+	}
+	else
+	{
+		finishReplay();
+	}
+}
+
+void ReplayConnection::feedNextRecord()
+{
+	const ReplayRecord &record = FRecords.at(FNextRecord++);
+	FInBytes += record.data.size();
+	FReadBuffer.append(record.data);
+
+	FLastEventTime = FReplayClock.elapsed();
+	FAwaitResponse = FNextRecord<FRecords.count() && FRecords.at(FNextRecord).out;
+	FFeedTime = FReplayClock.nsecsElapsed();
+
+	QElapsedTimer handleTimer;
+	handleTimer.start();
+	emit readyRead(FReadBuffer.size());
+	FHandleLatencies.append(handleTimer.nsecsElapsed()/1000);
+
+	if (FOpen && !FReplayTimer.isActive() && !FWaitingClient)
+		scheduleNextRecord();
+}
+
+void ReplayConnection::finishReplay()
+{
+	if (!FFinished)
+	{
+		FFinished = true;
+
+		qint64 elapsed = qMax<qint64>(FReplayClock.elapsed(),1);
+		int inRecords = FHandleLatencies.count();
+		LOG_INFO(QString("Replay finished, file=%1, records=%2/%3, in=%4 bytes, out=%5 bytes, time=%6 ms, rate=%7 records/s, %8 KB/s")
+			.arg(option(CaptureFile).toString()).arg(inRecords).arg(FWrittenRecords).arg(FInBytes).arg(FOutBytes).arg(elapsed)
+			.arg(inRecords*1000.0/elapsed,0,'f',1).arg(FInBytes*1000.0/1024/elapsed,0,'f',1));
+		LOG_INFO(QString("Replay handling latency, %1").arg(latencyReport(FHandleLatencies)));
+		LOG_INFO(QString("Replay response latency, %1").arg(latencyReport(FResponseLatencies)));
+
+		emit replayFinished();
+	}
+}
+
+QString ReplayConnection::latencyReport(QList<qint64> ALatencies) const
+{
+	if (!ALatencies.isEmpty())
+	{
+		qSort(ALatencies);
+		int last = ALatencies.count()-1;
+		return QString("samples=%1, p50=%2 us, p90=%3 us, p99=%4 us, max=%5 us").arg(ALatencies.count())
+			.arg(ALatencies.at(last*50/100)).arg(ALatencies.at(last*90/100)).arg(ALatencies.at(last*99/100)).arg(ALatencies.at(last));
+	}
+	return QString("samples=0");
+}
+
+void ReplayConnection::onConnectTimeout()
+{
+	if (FConnecting)
+	{
+		LOG_INFO(QString("Replay connection started, file=%1, speed=%2").arg(option(CaptureFile).toString()).arg(option(ReplaySpeed).toInt()));
+		FOpen = true;
+		FConnecting = false;
+		FReplayClock.start();
+		FLastEventTime = 0;
+		emit connected();
+
+		if (FOpen)
+			scheduleNextRecord();
+	}
+}
+
+void ReplayConnection::onEncryptTimeout()
+{
+	if (FOpen && !FEncrypted)
+	{
+		FEncrypted = true;
+		emit encrypted();
+	}
+}
+
+void ReplayConnection::onReplayTimerTimeout()
+{
+	if (FOpen && FNextRecord<FRecords.count())
+	{
+		if (FWaitingClient)
+		{
+			LOG_WARNING(QString("Replay stalled waiting for client data, record=%1, written=%2, expected=%3").arg(FNextRecord).arg(FWrittenRecords).arg(FRecords.at(FNextRecord).outBefore));
+			FWaitingClient = false;
+			FWrittenRecords = FRecords.at(FNextRecord).outBefore;
+		}
+		feedNextRecord();
+	}
+}
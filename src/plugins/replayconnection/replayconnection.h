@@ -0,0 +1,89 @@
+#ifndef REPLAYCONNECTION_H
+#define REPLAYCONNECTION_H
+
+#include <QTimer>
+#include <QElapsedTimer>
+#include <interfaces/ireplayconnection.h>
+#include <utils/xmpperror.h>
+
+struct ReplayRecord {
+	qint64 time;
+	bool out;
+	int outBefore;
+	QByteArray data;
+};
+
+class ReplayConnection :
+	public QObject,
+	public IReplayConnection
+{
+	Q_OBJECT;
+	Q_INTERFACES(IConnection IReplayConnection);
+public:
+	ReplayConnection(IConnectionPlugin *APlugin, QObject *AParent);
+	~ReplayConnection();
+	//IConnection
+	virtual QObject *instance() { return this; }
+	virtual bool isOpen() const;
+	virtual bool isEncrypted() const;
+	virtual bool isEncryptionSupported() const;
+	virtual bool connectToHost();
+	virtual bool startEncryption();
+	virtual void disconnectFromHost();
+	virtual void abortConnection(const XmppError &AError);
+	virtual qint64 write(const QByteArray &AData);
+	virtual QByteArray read(qint64 ABytes);
+	virtual IConnectionPlugin *ownerPlugin() const;
+	virtual QSslCertificate hostCertificate() const;
+	//IReplayConnection
+	virtual QVariant option(int ARole) const;
+	virtual void setOption(int ARole, const QVariant &AValue);
+signals:
+	//IConnection
+	void aboutToConnect();
+	void connected();
+	void encrypted();
+	void readyRead(qint64 ABytes);
+	void error(const XmppError &AError);
+	void aboutToDisconnect();
+	void disconnected();
+	void connectionDestroyed();
+	//IReplayConnection
+	void replayFinished();
+protected:
+	bool loadCaptureFile();
+	void scheduleNextRecord();
+	void feedNextRecord();
+	void finishReplay();
+	QString latencyReport(QList<qint64> ALatencies) const;
+protected slots:
+	void onConnectTimeout();
+	void onEncryptTimeout();
+	void onReplayTimerTimeout();
+private:
+	IConnectionPlugin *FPlugin;
+private:
+	bool FOpen;
+	bool FEncrypted;
+	bool FConnecting;
+	bool FFinished;
+	QByteArray FReadBuffer;
+	QMap<int, QVariant> FOptions;
+private:
+	int FNextRecord;
+	int FWrittenRecords;
+	bool FWaitingClient;
+	QTimer FReplayTimer;
+	QList<ReplayRecord> FRecords;
+private:
+	qint64 FInBytes;
+	qint64 FOutBytes;
+	qint64 FLastEventTime;
+	qint64 FFeedTime;
+	bool FAwaitResponse;
+	QElapsedTimer FReplayClock;
+	QList<qint64> FHandleLatencies;
+	QList<qint64> FResponseLatencies;
+};
+
+#endif // REPLAYCONNECTION_H
@@ -0,0 +1,9 @@
+FORMS = replayoptionswidget.ui
+
+HEADERS = replayconnection.h \
+          replayconnectionplugin.h \
+          replayoptionswidget.h
+
+SOURCES = replayconnection.cpp \
+          replayconnectionplugin.cpp \
+          replayoptionswidget.cpp
@@ -0,0 +1,3 @@
+TARGET = replayconnection 
+include(replayconnection.pri)
+include(../plugins.inc)
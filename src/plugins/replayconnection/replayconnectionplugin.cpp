@@ -0,0 +1,262 @@
+#include "replayconnectionplugin.h"
+
+#include <QDir>
+#include <QDateTime>
+#include <QApplication>
+#include <definitions/namespaces.h>
+#include <definitions/optionvalues.h>
+#include <definitions/commandline.h>
+#include <definitions/xmppdatahandlerorders.h>
+#include <definitions/xmppstanzahandlerorders.h>
+#include <utils/options.h>
+#include <utils/logger.h>
+
+#define FLUSH_TIMEOUT         1000
+
+ReplayConnectionPlugin::ReplayConnectionPlugin()
+{
+	FXmppStreams = NULL;
+
+	FFlushTimer.setInterval(FLUSH_TIMEOUT);
+	connect(&FFlushTimer,SIGNAL(timeout()),SLOT(onFlushTimerTimeout()));
+}
+
+ReplayConnectionPlugin::~ReplayConnectionPlugin()
+{
+	foreach(IXmppStream *xmppStream, FCaptureFiles.keys())
+		closeCaptureFile(xmppStream);
+	FCleanupHandler.clear();
+}
+
+void ReplayConnectionPlugin::pluginInfo(IPluginInfo *APluginInfo)
+{
+	APluginInfo->name = tr("Replay Connection");
+	APluginInfo->description = tr("Allows to capture XMPP traffic and replay it to the client without a server");
+	APluginInfo->version = "1.0";
+	APluginInfo->author = "Potapov S.A. aka Lion";
+	APluginInfo->homePage = "http://www.vacuum-im.org";
+}
+
+bool ReplayConnectionPlugin::initConnections(IPluginManager *APluginManager, int &AInitOrder)
+{
+	Q_UNUSED(AInitOrder);
+
+	QStringList args = qApp->arguments();
+	int index = args.indexOf(CLO_CAPTURE_DIR);
+	if (index >= 0)
+		FCaptureDir = args.value(index+1);
+
+	IPlugin *plugin = APluginManager->pluginInterface("IXmppStreams").value(0,NULL);
+	if (plugin)
+	{
+		FXmppStreams = qobject_cast<IXmppStreams *>(plugin->instance());
+		if (FXmppStreams && isCaptureEnabled())
+		{
+			connect(FXmppStreams->instance(),SIGNAL(created(IXmppStream *)),SLOT(onXmppStreamCreated(IXmppStream *)));
+			connect(FXmppStreams->instance(),SIGNAL(closed(IXmppStream *)),SLOT(onXmppStreamClosed(IXmppStream *)));
+			connect(FXmppStreams->instance(),SIGNAL(streamDestroyed(IXmppStream *)),SLOT(onXmppStreamDestroyed(IXmppStream *)));
+		}
+	}
+
+	if (isCaptureEnabled())
+	{
+		if (QDir::root().mkpath(FCaptureDir))
+			LOG_INFO(QString("XMPP traffic capture enabled, dir=%1").arg(FCaptureDir));
+		else
+			LOG_ERROR(QString("Failed to create XMPP traffic capture dir=%1").arg(FCaptureDir));
+	}
+
+	return true;
+}
+
+bool ReplayConnectionPlugin::initSettings()
+{
+	Options::setDefaultValue(OPV_ACCOUNT_CONNECTION_REPLAYFILE,QString());
+	Options::setDefaultValue(OPV_ACCOUNT_CONNECTION_REPLAYSPEED,IReplayConnection::OriginalSpeed);
+	return true;
+}
+
+QString ReplayConnectionPlugin::pluginId() const
+{
+	static const QString id = "ReplayConnection";
+	return id;
+}
+
+QString ReplayConnectionPlugin::pluginName() const
+{
+	return tr("Replay Connection");
+}
+
+IConnection *ReplayConnectionPlugin::newConnection(const OptionsNode &ANode, QObject *AParent)
+{
+	LOG_DEBUG("Replay connection created");
+	ReplayConnection *connection = new ReplayConnection(this,AParent);
+	connect(connection,SIGNAL(connectionDestroyed()),SLOT(onConnectionDestroyed()));
+	loadConnectionSettings(connection,ANode);
+	FCleanupHandler.add(connection);
+	emit connectionCreated(connection);
+	return connection;
+}
+
+IOptionsWidget *ReplayConnectionPlugin::connectionSettingsWidget(const OptionsNode &ANode, QWidget *AParent)
+{
+	return new ReplayOptionsWidget(ANode, AParent);
+}
+
+void ReplayConnectionPlugin::saveConnectionSettings(IOptionsWidget *AWidget, OptionsNode ANode)
+{
+	ReplayOptionsWidget *widget = qobject_cast<ReplayOptionsWidget *>(AWidget->instance());
+	if (widget)
+		widget->apply(ANode);
+}
+
+void ReplayConnectionPlugin::loadConnectionSettings(IConnection *AConnection, const OptionsNode &ANode)
+{
+	IReplayConnection *connection = qobject_cast<IReplayConnection *>(AConnection->instance());
+	if (connection)
+	{
+		connection->setOption(IReplayConnection::CaptureFile,ANode.value("replay-file").toString());
+		connection->setOption(IReplayConnection::ReplaySpeed,ANode.value("replay-speed").toInt());
+	}
+}
+
+bool ReplayConnectionPlugin::isCaptureEnabled() const
+{
+	return !FCaptureDir.isEmpty();
+}
+
+QString ReplayConnectionPlugin::captureDirectory() const
+{
+	return FCaptureDir;
+}
+
+bool ReplayConnectionPlugin::xmppDataIn(IXmppStream *AXmppStream, QByteArray &AData, int AOrder)
+{
+	if (AOrder == XDHO_REPLAY_CAPTURE)
+		writeCaptureRecord(AXmppStream,AData,false);
+	return false;
+}
+
+bool ReplayConnectionPlugin::xmppDataOut(IXmppStream *AXmppStream, QByteArray &AData, int AOrder)
+{
+	if (AOrder == XDHO_REPLAY_CAPTURE)
+		writeCaptureRecord(AXmppStream,AData,true);
+	return false;
+}
+
+bool ReplayConnectionPlugin::xmppStanzaIn(IXmppStream *AXmppStream, Stanza &AStanza, int AOrder)
+{
+	Q_UNUSED(AXmppStream); Q_UNUSED(AStanza); Q_UNUSED(AOrder);
+	return false;
+}
+
+bool ReplayConnectionPlugin::xmppStanzaOut(IXmppStream *AXmppStream, Stanza &AStanza, int AOrder)
+{
+	// Stanza is serialized and passed to data handlers right after the last stanza handler,
+	// data itself may be already compressed when it reaches capture
+	if (AOrder==XSHO_REPLAY_CAPTURE && FCaptureFiles.contains(AXmppStream))
+	{
+		QDomElement elem = AStanza.element();
+		if (elem.namespaceURI()==NS_FEATURE_SASL || elem.attribute("xmlns")==NS_FEATURE_SASL || !AStanza.firstElement("query",NS_JABBER_IQ_AUTH).isNull() || !AStanza.firstElement("query",NS_JABBER_REGISTER).isNull())
+			FCredentialStreams += AXmppStream;
+	}
+	return false;
+}
+
+void ReplayConnectionPlugin::writeCaptureRecord(IXmppStream *AXmppStream, const QByteArray &AData, bool AOut)
+{
+	// Replayed traffic is not captured again
+	if (AXmppStream->connection()==NULL || AXmppStream->connection()->ownerPlugin()==this)
+		return;
+
+	QFile *file = FCaptureFiles.value(AXmppStream);
+	if (file == NULL)
+	{
+		QString fileName = QString("%1-%2.xcap").arg(AXmppStream->streamJid().pBare(),QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss"));
+		fileName.replace(QRegExp("[\\\\/:*?\"<>|@]"),"_");
+
+		file = new QFile(QDir(FCaptureDir).absoluteFilePath(fileName),this);
+		if (file->open(QFile::WriteOnly|QFile::Truncate))
+		{
+			LOG_STRM_INFO(AXmppStream->streamJid(),QString("XMPP traffic capture started to file=%1").arg(file->fileName()));
+			FCaptureFiles.insert(AXmppStream,file);
+			FFlushTimer.start();
+		}
+		else
+		{
+			LOG_STRM_ERROR(AXmppStream->streamJid(),QString("Failed to start XMPP traffic capture to file=%1: %2").arg(file->fileName(),file->errorString()));
+			delete file;
+			return;
+		}
+	}
+
+	// Credentials are never written to capture files, server responses do not depend on them
+	QByteArray data = AData;
+	if (AOut && FCredentialStreams.contains(AXmppStream))
+	{
+		FCredentialStreams -= AXmppStream;
+		data = "<!-- hidden -->";
+	}
+	else if (AOut && (data.contains(NS_FEATURE_SASL) || data.contains(NS_JABBER_IQ_AUTH)))
+	{
+		data = "<!-- hidden -->";
+	}
+
+	// <msecs> <in|out> <stream jid> <size>\n<data>\n
+	QByteArray header = QString("%1 %2 %3 %4\n").arg(QDateTime::currentDateTime().toMSecsSinceEpoch()).arg(AOut ? "out" : "in").arg(AXmppStream->streamJid().pFull()).arg(data.size()).toUtf8();
+	if (file->write(header)<0 || file->write(data)<0 || file->write("\n")<0)
+	{
+		LOG_STRM_WARNING(AXmppStream->streamJid(),QString("Failed to write XMPP traffic capture to file=%1: %2").arg(file->fileName(),file->errorString()));
+		closeCaptureFile(AXmppStream);
+	}
+}
+
+void ReplayConnectionPlugin::closeCaptureFile(IXmppStream *AXmppStream)
+{
+	FCredentialStreams -= AXmppStream;
+	QFile *file = FCaptureFiles.take(AXmppStream);
+	if (file)
+	{
+		LOG_STRM_INFO(AXmppStream->streamJid(),QString("XMPP traffic capture stopped, file=%1, size=%2").arg(file->fileName()).arg(file->size()));
+		file->close();
+		delete file;
+	}
+	if (FCaptureFiles.isEmpty())
+		FFlushTimer.stop();
+}
+
+void ReplayConnectionPlugin::onXmppStreamCreated(IXmppStream *AXmppStream)
+{
+	AXmppStream->insertXmppDataHandler(XDHO_REPLAY_CAPTURE,this);
+	AXmppStream->insertXmppStanzaHandler(XSHO_REPLAY_CAPTURE,this);
+}
+
+void ReplayConnectionPlugin::onXmppStreamClosed(IXmppStream *AXmppStream)
+{
+	closeCaptureFile(AXmppStream);
+}
+
+void ReplayConnectionPlugin::onXmppStreamDestroyed(IXmppStream *AXmppStream)
+{
+	closeCaptureFile(AXmppStream);
+	AXmppStream->removeXmppDataHandler(XDHO_REPLAY_CAPTURE,this);
+	AXmppStream->removeXmppStanzaHandler(XSHO_REPLAY_CAPTURE,this);
+}
+
+void ReplayConnectionPlugin::onConnectionDestroyed()
+{
+	IReplayConnection *connection = qobject_cast<IReplayConnection *>(sender());
+	if (connection)
+	{
+		LOG_DEBUG("Replay connection destroyed");
+		emit connectionDestroyed(connection);
+	}
+}
+
+void ReplayConnectionPlugin::onFlushTimerTimeout()
+{
+	foreach(QFile *file, FCaptureFiles)
+		file->flush();
+}
+
+Q_EXPORT_PLUGIN2(plg_replayconnection, ReplayConnectionPlugin)
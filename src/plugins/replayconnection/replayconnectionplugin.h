@@ -0,0 +1,74 @@
+#ifndef REPLAYCONNECTIONPLUGIN_H
+#define REPLAYCONNECTIONPLUGIN_H
+
+#include <QSet>
+#include <QFile>
+#include <QTimer>
+#include <QObjectCleanupHandler>
+#include <interfaces/ipluginmanager.h>
+#include <interfaces/ireplayconnection.h>
+#include <interfaces/ixmppstreams.h>
+#include <interfaces/ioptionsmanager.h>
+#include "replayconnection.h"
+#include "replayoptionswidget.h"
+
+class ReplayConnectionPlugin :
+	public QObject,
+	public IPlugin,
+	public IConnectionPlugin,
+	public IReplayConnectionPlugin,
+	public IXmppDataHandler,
+	public IXmppStanzaHadler
+{
+	Q_OBJECT;
+	Q_INTERFACES(IPlugin IConnectionPlugin IReplayConnectionPlugin IXmppDataHandler IXmppStanzaHadler);
+public:
+	ReplayConnectionPlugin();
+	~ReplayConnectionPlugin();
+	virtual QObject *instance() { return this; }
+	//IPlugin
+	virtual QUuid pluginUuid() const { return REPLAYCONNECTION_UUID; }
+	virtual void pluginInfo(IPluginInfo *APluginInfo);
+	virtual bool initConnections(IPluginManager *APluginManager, int &AInitOrder);
+	virtual bool initObjects() { return true; }
+	virtual bool initSettings();
+	virtual bool startPlugin() { return true; }
+	//IConnectionPlugin
+	virtual QString pluginId() const;
+	virtual QString pluginName() const;
+	virtual IConnection *newConnection(const OptionsNode &ANode, QObject *AParent);
+	virtual IOptionsWidget *connectionSettingsWidget(const OptionsNode &ANode, QWidget *AParent);
+	virtual void saveConnectionSettings(IOptionsWidget *AWidget, OptionsNode ANode = OptionsNode::null);
+	virtual void loadConnectionSettings(IConnection *AConnection, const OptionsNode &ANode);
+	//IReplayConnectionPlugin
+	virtual bool isCaptureEnabled() const;
+	virtual QString captureDirectory() const;
+	//IXmppDataHandler
+	virtual bool xmppDataIn(IXmppStream *AXmppStream, QByteArray &AData, int AOrder);
+	virtual bool xmppDataOut(IXmppStream *AXmppStream, QByteArray &AData, int AOrder);
+	//IXmppStanzaHadler
+	virtual bool xmppStanzaIn(IXmppStream *AXmppStream, Stanza &AStanza, int AOrder);
+	virtual bool xmppStanzaOut(IXmppStream *AXmppStream, Stanza &AStanza, int AOrder);
+signals:
+	void connectionCreated(IConnection *AConnection);
+	void connectionDestroyed(IConnection *AConnection);
+protected:
+	void writeCaptureRecord(IXmppStream *AXmppStream, const QByteArray &AData, bool AOut);
+	void closeCaptureFile(IXmppStream *AXmppStream);
+protected slots:
+	void onXmppStreamCreated(IXmppStream *AXmppStream);
+	void onXmppStreamClosed(IXmppStream *AXmppStream);
+	void onXmppStreamDestroyed(IXmppStream *AXmppStream);
+	void onConnectionDestroyed();
+	void onFlushTimerTimeout();
+private:
+	IXmppStreams *FXmppStreams;
+private:
+	QString FCaptureDir;
+	QTimer FFlushTimer;
+	QMap<IXmppStream *, QFile *> FCaptureFiles;
+	QSet<IXmppStream *> FCredentialStreams;
+	QObjectCleanupHandler FCleanupHandler;
+};
+
+#endif // REPLAYCONNECTIONPLUGIN_H
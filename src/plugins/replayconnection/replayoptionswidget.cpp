@@ -0,0 +1,51 @@
+#include "replayoptionswidget.h"
+
+#include <QFileDialog>
+#include <utils/options.h>
+
+ReplayOptionsWidget::ReplayOptionsWidget(const OptionsNode &ANode, QWidget *AParent) : QWidget(AParent)
+{
+	ui.setupUi(this);
+	FOptions = ANode;
+
+	ui.cmbReplaySpeed->addItem(tr("Original speed"),IReplayConnection::OriginalSpeed);
+	ui.cmbReplaySpeed->addItem(tr("Maximum speed"),IReplayConnection::MaximumSpeed);
+
+	connect(ui.lneCaptureFile,SIGNAL(textChanged(const QString &)),SIGNAL(modified()));
+	connect(ui.tlbBrowse,SIGNAL(clicked()),SLOT(onBrowseButtonClicked()));
+	connect(ui.cmbReplaySpeed,SIGNAL(currentIndexChanged(int)),SIGNAL(modified()));
+
+	reset();
+}
+
+ReplayOptionsWidget::~ReplayOptionsWidget()
+{
+
+}
+
+void ReplayOptionsWidget::apply(OptionsNode ANode)
+{
+	OptionsNode node = !ANode.isNull() ? ANode : FOptions;
+	node.setValue(ui.lneCaptureFile->text(),"replay-file");
+	node.setValue(ui.cmbReplaySpeed->itemData(ui.cmbReplaySpeed->currentIndex()),"replay-speed");
+	emit childApply();
+}
+
+void ReplayOptionsWidget::apply()
+{
+	apply(FOptions);
+}
+
+void ReplayOptionsWidget::reset()
+{
+	ui.lneCaptureFile->setText(FOptions.value("replay-file").toString());
+	ui.cmbReplaySpeed->setCurrentIndex(ui.cmbReplaySpeed->findData(FOptions.value("replay-speed").toInt()));
+	emit childReset();
+}
+
+void ReplayOptionsWidget::onBrowseButtonClicked()
+{
+	QString fileName = QFileDialog::getOpenFileName(this,tr("Select Capture File"),ui.lneCaptureFile->text(),"*.xcap");
+	if (!fileName.isEmpty())
+		ui.lneCaptureFile->setText(fileName);
+}
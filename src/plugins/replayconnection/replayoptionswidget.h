@@ -0,0 +1,35 @@
+#ifndef REPLAYOPTIONSWIDGET_H
+#define REPLAYOPTIONSWIDGET_H
+
+#include <QWidget>
+#include <interfaces/ireplayconnection.h>
+#include <interfaces/ioptionsmanager.h>
+#include "ui_replayoptionswidget.h"
+
+class ReplayOptionsWidget :
+	public QWidget,
+	public IOptionsWidget
+{
+	Q_OBJECT;
+	Q_INTERFACES(IOptionsWidget);
+public:
+	ReplayOptionsWidget(const OptionsNode &ANode, QWidget *AParent = NULL);
+	~ReplayOptionsWidget();
+	virtual QWidget* instance() { return this; }
+public slots:
+	void apply(OptionsNode ANode);
+	void apply();
+	void reset();
+signals:
+	void modified();
+	void childApply();
+	void childReset();
+protected slots:
+	void onBrowseButtonClicked();
+private:
+	Ui::ReplayOptionsWidgetClass ui;
+private:
+	OptionsNode FOptions;
+};
+
+#endif // REPLAYOPTIONSWIDGET_H
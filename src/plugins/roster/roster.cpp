@@ -2,6 +2,9 @@
 
 #include <QSet>
 #include <QFile>
+#include <QBuffer>
+#include <QtEndian>
+#include <QDataStream>
 #include <definitions/namespaces.h>
 #include <definitions/optionvalues.h>
 #include <definitions/internalerrors.h>
@@ -13,6 +16,11 @@
 #define SHC_ROSTER            "/iq[@type='set']/query[@xmlns='" NS_JABBER_ROSTER "']"
 #define SHC_PRESENCE          "/presence[@type]"
 
+#define SNAPSHOT_MAGIC        0x56524F53
+#define SNAPSHOT_VERSION      1
+#define SNAPSHOT_RECORD_ITEM  1
+#define SNAPSHOT_RECORD_REMOVE 2
+
 Roster::Roster(IXmppStream *AXmppStream, IStanzaProcessor *AStanzaProcessor) : QObject(AXmppStream->instance())
 {
 	FXmppStream = AXmppStream;
@@ -62,7 +70,7 @@ bool Roster::stanzaReadWrite(int AHandlerId, const Jid &AStreamJid, Stanza &ASta
 		{
 			AAccept = true;
 			LOG_STRM_DEBUG(streamJid(),"Roster items push received");
-			processItemsElement(AStanza.firstElement("query",NS_JABBER_ROSTER),false);
+			appendRosterSnapshot(processItemsElement(AStanza.firstElement("query",NS_JABBER_ROSTER),false));
 
 			Stanza result = FStanzaProcessor->makeReplyResult(AStanza);
 			FStanzaProcessor->sendStanzaOut(AStreamJid,result);
@@ -147,8 +155,18 @@ void Roster::stanzaRequestResult(const Jid &AStreamJid, const Stanza &AStanza)
 		FOpenRequestId.clear();
 		if (AStanza.type() == "result")
 		{
-			LOG_STRM_INFO(streamJid(),"Roster items loaded");
-			processItemsElement(AStanza.firstElement("query",NS_JABBER_ROSTER),true);
+			QDomElement queryElem = AStanza.firstElement("query",NS_JABBER_ROSTER);
+			if (!queryElem.isNull())
+			{
+				LOG_STRM_INFO(streamJid(),"Roster items loaded");
+				processItemsElement(queryElem,true);
+				if (!FSnapshotFile.isEmpty())
+					saveRosterItems(FSnapshotFile);
+			}
+			else
+			{
+				LOG_STRM_INFO(streamJid(),QString("Roster items not changed, ver=%1").arg(FRosterVer));
+			}
 			FOpened = true;
 			emit opened();
 		}
@@ -414,31 +432,11 @@ void Roster::removeItems(const QList<IRosterItem> &AItems)
 
 void Roster::saveRosterItems(const QString &AFileName) const
 {
-	QDomDocument xml;
-	QDomElement elem = xml.appendChild(xml.createElement("roster")).toElement();
-	elem.setAttribute("ver",FRosterVer);
-	elem.setAttribute("streamJid",streamJid().pBare());
-	elem.setAttribute("groupDelimiter",FGroupDelim);
-	foreach(const IRosterItem &ritem, FRosterItems)
-	{
-		QDomElement itemElem = elem.appendChild(xml.createElement("item")).toElement();
-		itemElem.setAttribute("jid",ritem.itemJid.bare());
-		itemElem.setAttribute("name",ritem.name);
-		itemElem.setAttribute("subscription",ritem.subscription);
-		itemElem.setAttribute("ask",ritem.ask);
-		foreach(QString group, ritem.groups)
-		{
-			group = replaceGroupDelimiter(group,ROSTER_GROUP_DELIMITER,FGroupDelim);
-			if (!group.isEmpty())
-				itemElem.appendChild(xml.createElement("group")).appendChild(xml.createTextNode(group));
-		}
-	}
-
 	QFile file(AFileName);
 	if (file.open(QIODevice::WriteOnly | QIODevice::Truncate))
 	{
 		LOG_STRM_INFO(streamJid(),QString("Roster items saved to file=%1").arg(AFileName));
-		file.write(xml.toByteArray());
+		saveRosterSnapshot(&file);
 		file.flush();
 	}
 	else
@@ -451,29 +449,47 @@ void Roster::loadRosterItems(const QString &AFileName)
 {
 	if (!isOpen())
 	{
+		bool convert = false;
+		FSnapshotFile = AFileName;
+
 		QFile file(AFileName);
 		if (file.open(QIODevice::ReadOnly))
 		{
-			QString xmlError;
-			QDomDocument doc;
-			if (doc.setContent(&file,true,&xmlError))
+			QByteArray snapshot;
+			QBuffer buffer(&snapshot);
+			uchar *data = file.size()>0 ? file.map(0,file.size()) : NULL;
+			if (data != NULL)
 			{
-				QDomElement itemsElem = doc.firstChildElement("roster");
-				if (!itemsElem.isNull() && itemsElem.attribute("streamJid")==streamJid().pBare())
-				{
-					LOG_STRM_INFO(streamJid(),QString("Roster items loaded from file=%1").arg(AFileName));
-					setGroupDelimiter(itemsElem.attribute("groupDelimiter"));
-					processItemsElement(itemsElem,true);
-				}
-				else if (!itemsElem.isNull())
-				{
-					REPORT_ERROR("Failed to load roster items from file content: Invalid stream JID");
-					file.remove();
-				}
+				snapshot = QByteArray::fromRawData((const char *)data,file.size());
+				buffer.open(QIODevice::ReadOnly);
+			}
+
+			bool loaded = false;
+			QIODevice *device = data!=NULL ? (QIODevice *)&buffer : (QIODevice *)&file;
+			QByteArray magic = device->peek(sizeof(quint32));
+			bool isSnapshot = magic.size()==sizeof(quint32) && qFromBigEndian<quint32>((const uchar *)magic.constData())==SNAPSHOT_MAGIC;
+			if (isSnapshot)
+				loaded = loadRosterSnapshot(device);
+
+			// Mapped file can not be removed or truncated on Windows
+			buffer.close();
+			snapshot.clear();
+			if (data != NULL)
+				file.unmap(data);
+
+			if (!isSnapshot)
+			{
+				loadLegacyRosterItems(&file);
+				convert = file.exists();
+				file.close();
+			}
+			else if (loaded)
+			{
+				LOG_STRM_INFO(streamJid(),QString("Roster items loaded from file=%1, ver=%2").arg(AFileName,FRosterVer));
 			}
 			else
 			{
-				REPORT_ERROR(QString("Failed to load roster items from file content: %1").arg(xmlError));
+				REPORT_ERROR("Failed to load roster items from file content: Invalid snapshot");
 				file.remove();
 			}
 		}
@@ -481,6 +497,9 @@ void Roster::loadRosterItems(const QString &AFileName)
 		{
 			REPORT_ERROR(QString("Failed to load roster items from file: %1").arg(file.errorString()));
 		}
+
+		if (convert)
+			saveRosterItems(AFileName);
 	}
 	else
 	{
@@ -692,8 +711,9 @@ void Roster::setGroupDelimiter(const QString &ADelimiter)
 	}
 }
 
-void Roster::processItemsElement(const QDomElement &AItemsElem, bool ACompleteRoster)
+QList<IRosterItem> Roster::processItemsElement(const QDomElement &AItemsElem, bool ACompleteRoster)
 {
+	QList<IRosterItem> changed;
 	if (!AItemsElem.isNull())
 	{
 		FRosterVer = AItemsElem.attribute("ver");
@@ -731,6 +751,7 @@ void Roster::processItemsElement(const QDomElement &AItemsElem, bool ACompleteRo
 					if (ritem != before)
 					{
 						LOG_STRM_DEBUG(streamJid(),QString("Roster item updated, jid=%1, name=%2, groups=%3, subscr=%4").arg(ritem.itemJid.bare(),ritem.name,QStringList(ritem.groups.toList()).join("; "),ritem.subscription));
+						changed.append(ritem);
 						emit itemReceived(ritem,before);
 					}
 				}
@@ -748,9 +769,157 @@ void Roster::processItemsElement(const QDomElement &AItemsElem, bool ACompleteRo
 			IRosterItem before = ritem;
 			ritem.subscription = SUBSCRIPTION_REMOVE;
 			LOG_STRM_DEBUG(streamJid(),QString("Roster item removed, jid=%1").arg(ritem.itemJid.bare()));
+			changed.append(ritem);
 			emit itemReceived(ritem,before);
 		}
 	}
+	return changed;
+}
+
+void Roster::insertRosterItem(const IRosterItem &AItem)
+{
+	IRosterItem &ritem = FRosterItems[AItem.itemJid];
+	IRosterItem before = ritem;
+	ritem = AItem;
+	ritem.isValid = true;
+	if (ritem != before)
+		emit itemReceived(ritem,before);
+}
+
+void Roster::removeRosterItem(const Jid &AItemJid)
+{
+	if (FRosterItems.contains(AItemJid))
+	{
+		IRosterItem ritem = FRosterItems.take(AItemJid);
+		IRosterItem before = ritem;
+		ritem.subscription = SUBSCRIPTION_REMOVE;
+		emit itemReceived(ritem,before);
+	}
+}
+
+bool Roster::loadRosterSnapshot(QIODevice *ADevice)
+{
+	QDataStream stream(ADevice);
+	stream.setVersion(QDataStream::Qt_4_6);
+
+	quint32 magic, version;
+	stream >> magic >> version;
+	if (magic!=SNAPSHOT_MAGIC || version!=SNAPSHOT_VERSION)
+		return false;
+
+	QString streamBare, groupDelim, rosterVer;
+	quint32 count;
+	stream >> streamBare >> groupDelim >> rosterVer >> count;
+	if (stream.status()!=QDataStream::Ok || streamBare!=streamJid().pBare())
+		return false;
+
+	setGroupDelimiter(groupDelim);
+
+	QSet<Jid> oldItems = FRosterItems.keys().toSet();
+	for (quint32 i=0; i<count && stream.status()==QDataStream::Ok; i++)
+	{
+		QString itemJid;
+		IRosterItem ritem;
+		stream >> itemJid >> ritem.name >> ritem.subscription >> ritem.ask >> ritem.groups;
+		if (stream.status() == QDataStream::Ok)
+		{
+			ritem.itemJid = itemJid;
+			oldItems -= ritem.itemJid;
+			insertRosterItem(ritem);
+		}
+	}
+	if (stream.status() != QDataStream::Ok)
+		return false;
+
+	// Roster pushes appended after snapshot, last record may be incomplete
+	while (!stream.atEnd())
+	{
+		quint8 type;
+		QString itemVer, itemJid;
+		IRosterItem ritem;
+		stream >> type >> itemVer >> itemJid;
+		if (type == SNAPSHOT_RECORD_ITEM)
+			stream >> ritem.name >> ritem.subscription >> ritem.ask >> ritem.groups;
+		if (stream.status() != QDataStream::Ok)
+			break;
+
+		ritem.itemJid = itemJid;
+		if (type == SNAPSHOT_RECORD_ITEM)
+		{
+			oldItems -= ritem.itemJid;
+			insertRosterItem(ritem);
+		}
+		else if (type == SNAPSHOT_RECORD_REMOVE)
+		{
+			oldItems += ritem.itemJid;
+		}
+		rosterVer = itemVer;
+	}
+
+	foreach(const Jid &itemJid, oldItems)
+		removeRosterItem(itemJid);
+	FRosterVer = rosterVer;
+
+	return true;
+}
+
+void Roster::saveRosterSnapshot(QIODevice *ADevice) const
+{
+	QDataStream stream(ADevice);
+	stream.setVersion(QDataStream::Qt_4_6);
+
+	stream << (quint32)SNAPSHOT_MAGIC << (quint32)SNAPSHOT_VERSION;
+	stream << streamJid().pBare() << FGroupDelim << FRosterVer << (quint32)FRosterItems.count();
+	for (QHash<Jid, IRosterItem>::const_iterator it=FRosterItems.constBegin(); it!=FRosterItems.constEnd(); ++it)
+		stream << it->itemJid.bare() << it->name << it->subscription << it->ask << it->groups;
+}
+
+void Roster::appendRosterSnapshot(const QList<IRosterItem> &AItems) const
+{
+	QFile file(FSnapshotFile);
+	if (!AItems.isEmpty() && file.exists() && file.open(QIODevice::WriteOnly | QIODevice::Append))
+	{
+		QDataStream stream(&file);
+		stream.setVersion(QDataStream::Qt_4_6);
+		foreach(const IRosterItem &ritem, AItems)
+		{
+			if (ritem.subscription != SUBSCRIPTION_REMOVE)
+				stream << (quint8)SNAPSHOT_RECORD_ITEM << FRosterVer << ritem.itemJid.bare() << ritem.name << ritem.subscription << ritem.ask << ritem.groups;
+			else
+				stream << (quint8)SNAPSHOT_RECORD_REMOVE << FRosterVer << ritem.itemJid.bare();
+		}
+		file.flush();
+	}
+	else if (!AItems.isEmpty() && file.exists())
+	{
+		LOG_STRM_WARNING(streamJid(),QString("Failed to append roster items to file=%1: %2").arg(FSnapshotFile,file.errorString()));
+	}
+}
+
+void Roster::loadLegacyRosterItems(QFile *AFile)
+{
+	QString xmlError;
+	QDomDocument doc;
+	if (doc.setContent(AFile,true,&xmlError))
+	{
+		QDomElement itemsElem = doc.firstChildElement("roster");
+		if (!itemsElem.isNull() && itemsElem.attribute("streamJid")==streamJid().pBare())
+		{
+			LOG_STRM_INFO(streamJid(),QString("Roster items loaded from legacy file=%1").arg(AFile->fileName()));
+			setGroupDelimiter(itemsElem.attribute("groupDelimiter"));
+			processItemsElement(itemsElem,true);
+		}
+		else if (!itemsElem.isNull())
+		{
+			REPORT_ERROR("Failed to load roster items from file content: Invalid stream JID");
+			AFile->remove();
+		}
+	}
+	else
+	{
+		REPORT_ERROR(QString("Failed to load roster items from file content: %1").arg(xmlError));
+		AFile->remove();
+	}
 }
 
 QString Roster::replaceGroupDelimiter(const QString &AGroup, const QString &AFrom, const QString &ATo) const
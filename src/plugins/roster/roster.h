@@ -1,6 +1,7 @@
 #ifndef ROSTER_H
 #define ROSTER_H
 
+#include <QFile>
 #include <interfaces/iroster.h>
 #include <interfaces/istanzaprocessor.h>
 #include <interfaces/ixmppstreams.h>
@@ -69,7 +70,13 @@ protected:
 	void requestRosterItems();
 	void requestGroupDelimiter();
 	void setGroupDelimiter(const QString &ADelimiter);
-	void processItemsElement(const QDomElement &AItemsElem, bool ACompleteRoster);
+	QList<IRosterItem> processItemsElement(const QDomElement &AItemsElem, bool ACompleteRoster);
+	void insertRosterItem(const IRosterItem &AItem);
+	void removeRosterItem(const Jid &AItemJid);
+	bool loadRosterSnapshot(QIODevice *ADevice);
+	void saveRosterSnapshot(QIODevice *ADevice) const;
+	void appendRosterSnapshot(const QList<IRosterItem> &AItems) const;
+	void loadLegacyRosterItems(QFile *AFile);
 	QString replaceGroupDelimiter(const QString &AGroup, const QString &AFrom, const QString &ATo) const;
 protected slots:
 	void onStreamOpened();
@@ -89,6 +96,7 @@ private:
 	bool FVerSupported;
 	QString FRosterVer;
 	QString FGroupDelim;
+	QString FSnapshotFile;
 	QSet<Jid> FSubscriptionRequests;
 	QHash<Jid, IRosterItem> FRosterItems;
 };
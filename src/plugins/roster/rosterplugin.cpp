@@ -96,7 +96,14 @@ QString RosterPlugin::rosterFileName(const Jid &AStreamJid) const
 	if (!dir.exists("rosters"))
 		dir.mkdir("rosters");
 	dir.cd("rosters");
-	return dir.absoluteFilePath(Jid::encode(AStreamJid.pBare())+".xml");
+
+	// Roster loads legacy XML files too and converts them to binary snapshots
+	QString fileName = dir.absoluteFilePath(Jid::encode(AStreamJid.pBare())+".dat");
+	QString xmlFileName = dir.absoluteFilePath(Jid::encode(AStreamJid.pBare())+".xml");
+	if (!QFile::exists(fileName) && QFile::exists(xmlFileName))
+		QFile::rename(xmlFileName,fileName);
+
+	return fileName;
 }
 
 void RosterPlugin::removeRoster(IXmppStream *AXmppStream)
@@ -15,6 +15,7 @@ RostersModel::RostersModel()
 	FRosterPlugin = NULL;
 	FPresencePlugin = NULL;
 	FAccountManager = NULL;
+	FClientState = NULL;
 
 	FLayout = LayoutSeparately;
 
@@ -85,6 +86,14 @@ bool RostersModel::initConnections(IPluginManager *APluginManager, int &AInitOrd
 		}
 	}
 
+	plugin = APluginManager->pluginInterface("IClientState").value(0,NULL);
+	if (plugin)
+	{
+		FClientState = qobject_cast<IClientState *>(plugin->instance());
+		if (FClientState)
+			connect(FClientState->instance(),SIGNAL(streamActiveChanged(const Jid &, bool)),SLOT(onClientStateStreamActiveChanged(const Jid &, bool)));
+	}
+
 	return true;
 }
 
@@ -249,6 +258,7 @@ void RostersModel::removeStream(const Jid &AStreamJid)
 
 		FContactsCache.remove(sindex);
 		FStreamIndexes.remove(AStreamJid);
+		FDeferredPresence.remove(AStreamJid);
 		emit rosterDataChanged(FContactsRoot,RDR_STREAMS);
 
 		if (FLayout==LayoutMerged && FStreamIndexes.isEmpty())
@@ -854,6 +864,8 @@ void RostersModel::onRosterStreamJidChanged(IRoster *ARoster, const Jid &ABefore
 
 		FStreamIndexes.remove(ABefore);
 		FStreamIndexes.insert(after,sindex);
+		if (FDeferredPresence.contains(ABefore))
+			FDeferredPresence.insert(after,FDeferredPresence.take(ABefore));
 		emit rosterDataChanged(FContactsRoot,RDR_STREAMS);
 
 		emit streamJidChanged(ABefore,after);
@@ -877,6 +889,13 @@ void RostersModel::onPresenceChanged(IPresence *APresence, int AShow, const QStr
 void RostersModel::onPresenceItemReceived(IPresence *APresence, const IPresenceItem &AItem, const IPresenceItem &ABefore)
 {
 	Q_UNUSED(ABefore);
+	if (FClientState!=NULL && !FClientState->isStreamActive(APresence->streamJid()))
+	{
+		// Server was told the roster is not watched, only the last presence of each item will be applied
+		FDeferredPresence[APresence->streamJid()].insert(AItem.itemJid,AItem);
+		return;
+	}
+
 	IRosterIndex *sroot = streamRoot(APresence->streamJid());
 	if (sroot)
 	{
@@ -950,4 +969,33 @@ void RostersModel::onPresenceItemReceived(IPresence *APresence, const IPresenceI
 	}
 }
 
+void RostersModel::onClientStateStreamActiveChanged(const Jid &AStreamJid, bool AActive)
+{
+	if (AActive && FDeferredPresence.contains(AStreamJid))
+	{
+		QHash<Jid, IPresenceItem> deferred = FDeferredPresence.take(AStreamJid);
+		IPresence *presence = FPresencePlugin!=NULL ? FPresencePlugin->findPresence(AStreamJid) : NULL;
+		if (presence)
+		{
+			LOG_STRM_DEBUG(AStreamJid,QString("Applying deferred presence items, count=%1").arg(deferred.count()));
+			foreach(IPresenceItem item, deferred)
+			{
+				// Items missing in presence went offline or were cleared with the stream
+				IPresenceItem current = presence->findItem(item.itemJid);
+				if (current.isValid)
+				{
+					item = current;
+				}
+				else
+				{
+					item.show = IPresence::Offline;
+					item.priority = 0;
+					item.status = QString::null;
+				}
+				onPresenceItemReceived(presence,item,IPresenceItem());
+			}
+		}
+	}
+}
+
 Q_EXPORT_PLUGIN2(plg_rostersmodel, RostersModel)
@@ -6,6 +6,7 @@
 #include <interfaces/iroster.h>
 #include <interfaces/ipresence.h>
 #include <interfaces/iaccountmanager.h>
+#include <interfaces/iclientstate.h>
 #include "rootindex.h"
 #include "rosterindex.h"
 #include "dataholder.h"
@@ -91,12 +92,14 @@ protected slots:
 	void onRosterStreamJidChanged(IRoster *ARoster, const Jid &ABefore);
 	void onPresenceChanged(IPresence *APresence, int AShow, const QString &AStatus, int APriority);
 	void onPresenceItemReceived(IPresence *APresence, const IPresenceItem &AItem, const IPresenceItem &ABefore);
+	void onClientStateStreamActiveChanged(const Jid &AStreamJid, bool AActive);
 private:
 	friend class RosterIndex;
 private:
 	IRosterPlugin *FRosterPlugin;
 	IPresencePlugin *FPresencePlugin;
 	IAccountManager *FAccountManager;
+	IClientState *FClientState;
 private:
 	StreamsLayout FLayout;
 	RootIndex *FRootIndex;
@@ -108,6 +111,8 @@ private:
 private:
 	// streamRoot->bareJid->index
 	QHash<IRosterIndex *, QMultiHash<Jid, IRosterIndex *> > FContactsCache;
+	// streamJid->itemJid->item
+	QMap<Jid, QHash<Jid, IPresenceItem> > FDeferredPresence;
 	// parent->name->index
 	QHash<IRosterIndex *, QMultiHash<QString, IRosterIndex *> > FGroupsCache;
 };
@@ -13,6 +13,13 @@
 #define MAX_MESSAGE_ITEMS         25
 #define MAX_MODIFICATION_ITEMS    50
 
+#define MAX_HEADER_PAGE           400
+#define MAX_MESSAGE_PAGE          200
+#define MAX_MODIFICATION_PAGE     400
+
+#define PAGE_FAST_TIME            2000
+#define PAGE_SLOW_TIME            10000
+
 #define ARCHIVE_REQUEST_TIMEOUT   30000
 
 ServerMessageArchive::ServerMessageArchive()
@@ -80,6 +87,7 @@ bool ServerMessageArchive::initObjects()
 bool ServerMessageArchive::initSettings()
 {
 	Options::setDefaultValue(OPV_SERVERARCHIVE_MAXUPLOADSIZE,4096);
+	Options::setDefaultValue(OPV_SERVERARCHIVE_MAXPIPELINEDREQUESTS,4);
 	return true;
 }
 
@@ -109,6 +117,8 @@ void ServerMessageArchive::stanzaRequestResult(const Jid &AStreamJid, const Stan
 				chatElem = chatElem.nextSiblingElement("chat");
 			}
 
+			updateResultSetPageSize(AStreamJid,"list",AStanza.id(),headers.count(),MAX_HEADER_ITEMS,MAX_HEADER_PAGE);
+
 			if (request.order == Qt::AscendingOrder)
 				qSort(headers.begin(),headers.end(),qLess<IArchiveHeader>());
 			else
@@ -157,6 +167,7 @@ void ServerMessageArchive::stanzaRequestResult(const Jid &AStreamJid, const Stan
 			QDomElement chatElem = AStanza.firstElement("chat");
 			FArchiver->elementToCollection(AStreamJid,chatElem,collection);
 			collection.header.engineId = engineId();
+			updateResultSetPageSize(AStreamJid,"retrieve",AStanza.id(),collection.body.messages.count()+collection.body.notes.count(),MAX_MESSAGE_ITEMS,MAX_MESSAGE_PAGE);
 
 			QString nextRef = getNextRef(readResultSetAnswer(chatElem),collection.body.messages.count()+collection.body.notes.count(),MAX_MESSAGE_ITEMS);
 			emit serverCollectionLoaded(AStanza.id(),collection,nextRef);
@@ -215,6 +226,8 @@ void ServerMessageArchive::stanzaRequestResult(const Jid &AStreamJid, const Stan
 				changeElem = changeElem.nextSiblingElement();
 			}
 
+			updateResultSetPageSize(AStreamJid,"modified",AStanza.id(),modifications.items.count(),MAX_MODIFICATION_ITEMS,MAX_MODIFICATION_PAGE);
+
 			ResultSet resultSet = readResultSetAnswer(modifsElem);
 			QString nextRef = getNextRef(resultSet,modifications.items.count(),MAX_MODIFICATION_ITEMS,request.count);
 			modifications.next = resultSet.last;
@@ -229,6 +242,7 @@ void ServerMessageArchive::stanzaRequestResult(const Jid &AStreamJid, const Stan
 			emit requestFailed(AStanza.id(),err);
 		}
 	}
+	FResultSetPages.remove(AStanza.id());
 }
 
 QUuid ServerMessageArchive::engineId() const
@@ -312,11 +326,20 @@ QString ServerMessageArchive::saveCollection(const Jid &AStreamJid, const IArchi
 	QString id = saveServerCollection(AStreamJid,ACollection);
 	if (!id.isEmpty())
 	{
-		LocalCollectionRequest request;
+		LocalSaveCollectionRequest request;
 		request.id = QUuid::createUuid().toString();
 		request.streamJid = AStreamJid;
 		request.collection = ACollection;
-		FLocalSaveCollectionRequests.insert(id,request);
+		request.nextRef = FServerSaveCollectionRequests.value(id).nextRef;
+		request.serverIds.append(id);
+		FLocalSaveCollectionIds.insert(id,request.id);
+		FLocalSaveCollectionRequests.insert(request.id,request);
+
+		if (!sendSaveCollectionRequests(request.id))
+		{
+			removeSaveCollectionRequest(request.id);
+			return QString::null;
+		}
 		return request.id;
 	}
 	return QString::null;
@@ -421,11 +444,14 @@ QString ServerMessageArchive::loadServerHeaders(const Jid &AStreamJid, const IAr
 			listElem.setAttribute("start",DateTime(ARequest.start).toX85UTC());
 		if (ARequest.end.isValid())
 			listElem.setAttribute("end",DateTime(ARequest.end).toX85UTC());
-		insertResultSetRequest(listElem,ANextRef,MAX_HEADER_ITEMS,ARequest.maxItems,ARequest.order);
+		quint32 pageSize = resultSetPageSize(AStreamJid,"list",MAX_HEADER_ITEMS);
+		insertResultSetRequest(listElem,ANextRef,pageSize,ARequest.maxItems,ARequest.order);
 		
 		if (FStanzaProcessor->sendStanzaRequest(this,AStreamJid,stanza,ARCHIVE_REQUEST_TIMEOUT))
 		{
 			LOG_STRM_DEBUG(AStreamJid,QString("Load headers request sent, id=%1, nextref=%2").arg(stanza.id(),ANextRef));
+			ResultSetPage page = { QDateTime::currentDateTime(), qMin(pageSize,ARequest.maxItems) };
+			FResultSetPages.insert(stanza.id(),page);
 			FServerLoadHeadersRequests.insert(stanza.id(),ARequest);
 			return stanza.id();
 		}
@@ -537,11 +563,14 @@ QString ServerMessageArchive::loadServerCollection(const Jid &AStreamJid, const
 		QDomElement retrieveElem = stanza.addElement("retrieve",FNamespaces.value(AStreamJid));
 		retrieveElem.setAttribute("with",AHeader.with.full());
 		retrieveElem.setAttribute("start",DateTime(AHeader.start).toX85UTC());
-		insertResultSetRequest(retrieveElem,ANextRef,MAX_MESSAGE_ITEMS);
+		quint32 pageSize = resultSetPageSize(AStreamJid,"retrieve",MAX_MESSAGE_ITEMS);
+		insertResultSetRequest(retrieveElem,ANextRef,pageSize);
 
 		if (FStanzaProcessor->sendStanzaRequest(this,AStreamJid,stanza,ARCHIVE_REQUEST_TIMEOUT))
 		{
 			LOG_STRM_DEBUG(AStreamJid,QString("Load collection request sent, id=%1").arg(stanza.id()));
+			ResultSetPage page = { QDateTime::currentDateTime(), pageSize };
+			FResultSetPages.insert(stanza.id(),page);
 			FServerLoadCollectionRequests.insert(stanza.id(),AHeader);
 			return stanza.id();
 		}
@@ -570,11 +599,14 @@ QString ServerMessageArchive::loadServerModifications(const Jid &AStreamJid, con
 
 		QDomElement modifyElem = stanza.addElement("modified",FNamespaces.value(AStreamJid));
 		modifyElem.setAttribute("start",DateTime(AStart).toX85UTC());
-		insertResultSetRequest(modifyElem,ANextRef,MAX_MODIFICATION_ITEMS,ACount);
+		quint32 pageSize = resultSetPageSize(AStreamJid,"modified",MAX_MODIFICATION_ITEMS);
+		insertResultSetRequest(modifyElem,ANextRef,pageSize,ACount);
 		
 		if (FStanzaProcessor->sendStanzaRequest(this,AStreamJid,stanza,ARCHIVE_REQUEST_TIMEOUT))
 		{
 			LOG_STRM_DEBUG(AStreamJid,QString("Load server modifications request sent, id=%1, nextref=%2").arg(stanza.id(),ANextRef));
+			ResultSetPage page = { QDateTime::currentDateTime(), qMin(pageSize,(quint32)ACount) };
+			FResultSetPages.insert(stanza.id(),page);
 			ServerModificationsRequest request = { AStart, (quint32)ACount };
 			FServerLoadModificationsRequests.insert(stanza.id(),request);
 			return stanza.id();
@@ -650,6 +682,58 @@ QString ServerMessageArchive::getNextRef(const ResultSet &AResultSet, quint32 AC
 	return nextRef;
 }
 
+quint32 ServerMessageArchive::resultSetPageSize(const Jid &AStreamJid, const QString &AElement, quint32 ABaseSize) const
+{
+	return FResultSetPageSizes.value(AStreamJid).value(AElement,ABaseSize);
+}
+
+void ServerMessageArchive::updateResultSetPageSize(const Jid &AStreamJid, const QString &AElement, const QString &AId, quint32 AReceived, quint32 ABaseSize, quint32 AMaxSize)
+{
+	// Paging continues while pages are not shorter than the base size, so the page may grow past a server limit safely
+	if (FResultSetPages.contains(AId))
+	{
+		ResultSetPage page = FResultSetPages.take(AId);
+		qint64 elapsed = page.sent.msecsTo(QDateTime::currentDateTime());
+
+		quint32 curSize = resultSetPageSize(AStreamJid,AElement,ABaseSize);
+		quint32 newSize = curSize;
+		if (elapsed > PAGE_SLOW_TIME)
+			newSize = qMax(curSize/2,ABaseSize);
+		else if (elapsed<PAGE_FAST_TIME && page.limit>=curSize && AReceived>=page.limit)
+			newSize = qMin(curSize*2,AMaxSize);
+
+		if (newSize != curSize)
+		{
+			LOG_STRM_DEBUG(AStreamJid,QString("Result set page size changed, element=%1, size=%2").arg(AElement).arg(newSize));
+			FResultSetPageSizes[AStreamJid].insert(AElement,newSize);
+		}
+	}
+}
+
+bool ServerMessageArchive::sendSaveCollectionRequests(const QString &ALocalId)
+{
+	// Each part of the collection is selected by item index, so next parts can be sent without waiting for answers
+	LocalSaveCollectionRequest &request = FLocalSaveCollectionRequests[ALocalId];
+	int maxRequests = qMax(Options::node(OPV_SERVERARCHIVE_MAXPIPELINEDREQUESTS).value().toInt(),1);
+	while (!request.nextRef.isEmpty() && request.serverIds.count()<maxRequests)
+	{
+		QString id = saveServerCollection(request.streamJid,request.collection,request.nextRef);
+		if (id.isEmpty())
+			return false;
+		request.nextRef = FServerSaveCollectionRequests.value(id).nextRef;
+		request.serverIds.append(id);
+		FLocalSaveCollectionIds.insert(id,ALocalId);
+	}
+	return true;
+}
+
+void ServerMessageArchive::removeSaveCollectionRequest(const QString &ALocalId)
+{
+	LocalSaveCollectionRequest request = FLocalSaveCollectionRequests.take(ALocalId);
+	foreach(const QString &id, request.serverIds)
+		FLocalSaveCollectionIds.remove(id);
+}
+
 void ServerMessageArchive::onArchivePrefsOpened(const Jid &AStreamJid)
 {
 	FNamespaces.insert(AStreamJid,FArchiver->prefsNamespace(AStreamJid));
@@ -659,6 +743,7 @@ void ServerMessageArchive::onArchivePrefsOpened(const Jid &AStreamJid)
 void ServerMessageArchive::onArchivePrefsClosed(const Jid &AStreamJid)
 {
 	FNamespaces.remove(AStreamJid);
+	FResultSetPageSizes.remove(AStreamJid);
 	emit capabilitiesChanged(AStreamJid);
 }
 
@@ -669,10 +754,11 @@ void ServerMessageArchive::onServerRequestFailed(const QString &AId, const XmppE
 		LocalHeadersRequest request = FLocalLoadHeadersRequests.take(AId);
 		emit requestFailed(request.id,AError);
 	}
-	else if (FLocalSaveCollectionRequests.contains(AId))
+	else if (FLocalSaveCollectionIds.contains(AId))
 	{
-		LocalCollectionRequest request = FLocalSaveCollectionRequests.take(AId);
-		emit requestFailed(request.id,AError);
+		QString localId = FLocalSaveCollectionIds.value(AId);
+		removeSaveCollectionRequest(localId);
+		emit requestFailed(localId,AError);
 	}
 	else if (FLocalLoadCollectionRequests.contains(AId))
 	{
@@ -713,20 +799,20 @@ void ServerMessageArchive::onServerHeadersLoaded(const QString &AId, const QList
 
 void ServerMessageArchive::onServerCollectionSaved(const QString &AId, const IArchiveCollection &ACollection, const QString &ANextRef)
 {
-	if (FLocalSaveCollectionRequests.contains(AId))
+	Q_UNUSED(ANextRef);
+	if (FLocalSaveCollectionIds.contains(AId))
 	{
-		LocalCollectionRequest request = FLocalSaveCollectionRequests.take(AId);
-		if (!ANextRef.isEmpty())
+		QString localId = FLocalSaveCollectionIds.take(AId);
+		FLocalSaveCollectionRequests[localId].serverIds.removeAll(AId);
+		if (!sendSaveCollectionRequests(localId))
 		{
-			QString id = saveServerCollection(request.streamJid,request.collection,ANextRef);
-			if (!id.isEmpty())
-				FLocalSaveCollectionRequests.insert(id,request);
-			else
-				emit requestFailed(request.id,XmppError(IERR_HISTORY_CONVERSATION_SAVE_ERROR));
+			removeSaveCollectionRequest(localId);
+			emit requestFailed(localId,XmppError(IERR_HISTORY_CONVERSATION_SAVE_ERROR));
 		}
-		else
+		else if (FLocalSaveCollectionRequests.value(localId).serverIds.isEmpty())
 		{
-			emit collectionSaved(request.id,ACollection);
+			removeSaveCollectionRequest(localId);
+			emit collectionSaved(localId,ACollection);
 		}
 	}
 }
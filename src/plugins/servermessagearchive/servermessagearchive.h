@@ -19,6 +19,11 @@ struct ResultSet {
 	QString last;
 };
 
+struct ResultSetPage {
+	QDateTime sent;
+	quint32 limit;
+};
+
 struct ServerCollectionRequest {
 	QString nextRef;
 	IArchiveCollection collection;
@@ -42,6 +47,14 @@ struct LocalCollectionRequest {
 	IArchiveCollection collection;
 };
 
+struct LocalSaveCollectionRequest {
+	QString id;
+	Jid streamJid;
+	QString nextRef;
+	QList<QString> serverIds;
+	IArchiveCollection collection;
+};
+
 struct LocalModificationsRequest {
 	QString id;
 	Jid streamJid;
@@ -109,6 +122,10 @@ protected:
 	ResultSet readResultSetAnswer(const QDomElement &AElem) const;
 	void insertResultSetRequest(QDomElement &AElem, const QString &ANextRef, quint32 ALimit, quint32 AMax=0xFFFFFFFF, Qt::SortOrder AOrder=Qt::AscendingOrder) const;
 	QString getNextRef(const ResultSet &AResultSet, quint32 ACount, quint32 ALimit, quint32 AMax=0xFFFFFFFF, Qt::SortOrder AOrder=Qt::AscendingOrder) const;
+	quint32 resultSetPageSize(const Jid &AStreamJid, const QString &AElement, quint32 ABaseSize) const;
+	void updateResultSetPageSize(const Jid &AStreamJid, const QString &AElement, const QString &AId, quint32 AReceived, quint32 ABaseSize, quint32 AMaxSize);
+	bool sendSaveCollectionRequests(const QString &ALocalId);
+	void removeSaveCollectionRequest(const QString &ALocalId);
 protected slots:
 	void onArchivePrefsOpened(const Jid &AStreamJid);
 	void onArchivePrefsClosed(const Jid &AStreamJid);
@@ -123,6 +140,8 @@ private:
 	IStanzaProcessor *FStanzaProcessor;
 private:
 	QMap<Jid, QString> FNamespaces;
+	QMap<QString, ResultSetPage> FResultSetPages;
+	QMap<Jid, QMap<QString, quint32> > FResultSetPageSizes;
 private:
 	QMap<QString,IArchiveRequest> FServerLoadHeadersRequests;
 	QMap<QString,IArchiveHeader> FServerLoadCollectionRequests;
@@ -131,7 +150,8 @@ private:
 	QMap<QString,ServerModificationsRequest> FServerLoadModificationsRequests;
 private:
 	QMap<QString,LocalHeadersRequest> FLocalLoadHeadersRequests;
-	QMap<QString,LocalCollectionRequest> FLocalSaveCollectionRequests;
+	QMap<QString,QString> FLocalSaveCollectionIds;
+	QMap<QString,LocalSaveCollectionRequest> FLocalSaveCollectionRequests;
 	QMap<QString,LocalCollectionRequest> FLocalLoadCollectionRequests;
 	QMap<QString,LocalModificationsRequest> FLocalLoadModificationsRequests;
 };
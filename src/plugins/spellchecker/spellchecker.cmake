@@ -1,2 +1,2 @@
-set(SOURCES spellchecker.cpp spellbackend.cpp spellhighlighter.cpp) 
-set(HEADERS spellchecker.h spellbackend.h spellhighlighter.h) 
\ No newline at end of file
+set(SOURCES spellchecker.cpp spellbackend.cpp spellhighlighter.cpp spellworker.cpp) 
+set(HEADERS spellchecker.h spellbackend.h spellhighlighter.h spellworker.h) 
\ No newline at end of file
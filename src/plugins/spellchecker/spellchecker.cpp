@@ -2,6 +2,7 @@
 #include <QObject>
 #include <QMessageBox>
 #include <QApplication>
+#include <QMutexLocker>
 #include <QActionGroup>
 
 #include <definitions/actiongroups.h>
@@ -23,10 +24,13 @@ SpellChecker::SpellChecker()
 
 	FCurrentTextEdit = NULL;
 	FCurrentCursorPosition = 0;
+
+	FSpellWorker = new SpellWorker(this);
 }
 
 SpellChecker::~SpellChecker()
 {
+	delete FSpellWorker;
 	SpellBackend::destroyInstance();
 }
 
@@ -121,23 +125,43 @@ void SpellChecker::setCurrentDictionary(const QString &ADict)
 
 bool SpellChecker::isCorrectWord(const QString &AWord) const
 {
-	return AWord.trimmed().isEmpty() || SpellBackend::instance()->isCorrect(AWord);
+	if (!AWord.trimmed().isEmpty())
+	{
+		SpellWorker::Verdict verdict = FSpellWorker->wordVerdict(AWord);
+		if (verdict == SpellWorker::Unknown)
+		{
+			QMutexLocker locker(FSpellWorker->backendMutex());
+			bool correct = SpellBackend::instance()->isCorrect(AWord);
+			locker.unlock();
+			FSpellWorker->setWordVerdict(AWord,correct);
+			return correct;
+		}
+		return verdict == SpellWorker::Correct;
+	}
+	return true;
 }
 
 QList<QString> SpellChecker::wordSuggestions(const QString &AWord) const
 {
+	QMutexLocker locker(FSpellWorker->backendMutex());
 	return SpellBackend::instance()->suggestions(AWord);
 }
 
 bool SpellChecker::canAddWordToPersonalDict(const QString &AWord) const
 {
+	QMutexLocker locker(FSpellWorker->backendMutex());
 	return SpellBackend::instance()->writable() && SpellBackend::instance()->canAdd(AWord);
 }
 
 void SpellChecker::addWordToPersonalDict(const QString &AWord)
 {
-	if (SpellBackend::instance()->add(AWord))
+	QMutexLocker locker(FSpellWorker->backendMutex());
+	bool added = SpellBackend::instance()->add(AWord);
+	locker.unlock();
+
+	if (added)
 	{
+		FSpellWorker->setWordVerdict(AWord,true);
 		rehightlightAll();
 		emit wordAddedToPersonalDict(AWord);
 	}
@@ -229,7 +253,7 @@ void SpellChecker::onEditWidgetCreated(IMessageEditWidget *AWidget)
 		mucWindow = qobject_cast<IMultiUserChatWindow *>(parent);
 		parent = parent->parentWidget();
 	}
-	SpellHighlighter *liter = new SpellHighlighter(AWidget->document(), mucWindow!=NULL ? mucWindow->multiUserChat() : NULL);
+	SpellHighlighter *liter = new SpellHighlighter(AWidget->document(), mucWindow!=NULL ? mucWindow->multiUserChat() : NULL, FSpellWorker);
 	liter->setEnabled(isSpellEnabled() && isSpellAvailable());
 	FSpellHighlighters.insert(textEdit, liter);
 }
@@ -332,7 +356,10 @@ void SpellChecker::onOptionsChanged(const OptionsNode &ANode)
 		if (availDicts.contains(dict))
 		{
 			LOG_INFO(QString("Spell check language changed to=%1").arg(dict));
+			QMutexLocker locker(FSpellWorker->backendMutex());
 			SpellBackend::instance()->setLang(dict);
+			FSpellWorker->clearLangVerdicts(SpellBackend::instance()->actuallLang());
+			locker.unlock();
 			emit currentDictionaryChanged(currentDictionary());
 			rehightlightAll();
 		}
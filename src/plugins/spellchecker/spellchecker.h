@@ -6,6 +6,7 @@
 #include <interfaces/imessagewidgets.h>
 #include <interfaces/imultiuserchat.h>
 #include "spellhighlighter.h"
+#include "spellworker.h"
 
 class SpellChecker : 
 	public QObject,
@@ -56,6 +57,8 @@ protected slots:
 private:
 	IPluginManager *FPluginManager;
 	IMessageWidgets *FMessageWidgets;
+private:
+	SpellWorker *FSpellWorker;
 private:
 	QTextEdit *FCurrentTextEdit;
 	int FCurrentCursorPosition;
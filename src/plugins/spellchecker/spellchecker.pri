@@ -1,7 +1,9 @@
 HEADERS += spellchecker.h \
            spellbackend.h \
-           spellhighlighter.h
+           spellhighlighter.h \
+           spellworker.h
 
 SOURCES += spellchecker.cpp \
            spellbackend.cpp \
-           spellhighlighter.cpp
+           spellhighlighter.cpp \
+           spellworker.cpp
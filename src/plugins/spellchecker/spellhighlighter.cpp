@@ -1,14 +1,26 @@
 #include "spellhighlighter.h"
 
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QTextBlockUserData>
 #include "spellchecker.h"
-#include "spellbackend.h"
 
-SpellHighlighter::SpellHighlighter(QTextDocument *ADocument, IMultiUserChat *AMultiUserChat) : QSyntaxHighlighter(ADocument)
+class SpellBlockData :
+	public QTextBlockUserData
+{
+public:
+	SpellBlockData() { pending = false; }
+	bool pending;
+};
+
+SpellHighlighter::SpellHighlighter(QTextDocument *ADocument, IMultiUserChat *AMultiUserChat, SpellWorker *AWorker) : QSyntaxHighlighter(ADocument)
 {
 	FEnabled = true;
+	FWorker = AWorker;
 	FMultiUserChat = AMultiUserChat;
 	FCharFormat.setUnderlineColor(Qt::red);
 	FCharFormat.setUnderlineStyle(QTextCharFormat::SpellCheckUnderline);
+	connect(FWorker,SIGNAL(wordsChecked()),SLOT(onWordsChecked()));
 }
 
 void SpellHighlighter::setEnabled(bool AEnabled)
@@ -22,6 +34,7 @@ void SpellHighlighter::setEnabled(bool AEnabled)
 
 void SpellHighlighter::highlightBlock(const QString &AText)
 {
+	bool pending = false;
 	if (FEnabled)
 	{
 		// Match words (minimally) excluding digits within a word
@@ -31,17 +44,38 @@ void SpellHighlighter::highlightBlock(const QString &AText)
 		while ((index = expression.indexIn(AText, index)) != -1)
 		{
 			int length = expression.matchedLength();
-			if (!isUserNickName(expression.cap()))
-			{
-				if (!SpellBackend::instance()->isCorrect(expression.cap()))
-					setFormat(index, length, FCharFormat);
-			}
+			SpellWorker::Verdict verdict = FWorker->wordVerdict(expression.cap());
+			if (verdict == SpellWorker::Unknown)
+				pending = true;
+			else if (verdict==SpellWorker::Incorrect && !isUserNickName(expression.cap()))
+				setFormat(index, length, FCharFormat);
 			index += length;
 		}
 	}
+
+	SpellBlockData *data = static_cast<SpellBlockData *>(currentBlockUserData());
+	if (data == NULL)
+	{
+		data = new SpellBlockData;
+		setCurrentBlockUserData(data);
+	}
+	data->pending = pending;
 }
 
 bool SpellHighlighter::isUserNickName(const QString &AText)
 {
 	return FMultiUserChat!=NULL && FMultiUserChat->userByNick(AText)!=NULL;
 }
+
+void SpellHighlighter::onWordsChecked()
+{
+	if (FEnabled)
+	{
+		for (QTextBlock block=document()->begin(); block.isValid(); block=block.next())
+		{
+			SpellBlockData *data = static_cast<SpellBlockData *>(block.userData());
+			if (data!=NULL && data->pending)
+				rehighlightBlock(block);
+		}
+	}
+}
@@ -4,18 +4,23 @@
 #include <QString>
 #include <QSyntaxHighlighter>
 #include <interfaces/imultiuserchat.h>
+#include "spellworker.h"
 
 class SpellHighlighter : 
 	public QSyntaxHighlighter
 {
+	Q_OBJECT;
 public:
-	SpellHighlighter(QTextDocument *ADocument, IMultiUserChat *AMultiUserChat);
+	SpellHighlighter(QTextDocument *ADocument, IMultiUserChat *AMultiUserChat, SpellWorker *AWorker);
 	void setEnabled(bool AEnabled);
 	virtual void highlightBlock(const QString &AText);
 protected:
 	inline bool isUserNickName(const QString &AText);
+protected slots:
+	void onWordsChecked();
 private:
 	bool FEnabled;
+	SpellWorker *FWorker;
 	IMultiUserChat *FMultiUserChat;
 	QTextCharFormat FCharFormat;
 };
@@ -0,0 +1,117 @@
+#include "spellworker.h"
+
+#include <QMetaObject>
+#include <QMutexLocker>
+#include "spellbackend.h"
+
+#define THREAD_WAIT_TIME      10000
+#define MAX_BATCH_WORDS       50
+#define MAX_LANG_VERDICTS     50000
+
+SpellWorker::SpellWorker(QObject *AParent) : QThread(AParent)
+{
+	FQuit = false;
+	connect(this,SIGNAL(finished()),SLOT(onThreadFinished()));
+}
+
+SpellWorker::~SpellWorker()
+{
+	quit();
+	wait();
+}
+
+void SpellWorker::quit()
+{
+	QMutexLocker locker(&FMutex);
+	FQuit = true;
+	FWordReady.wakeAll();
+}
+
+QMutex *SpellWorker::backendMutex()
+{
+	return &FBackendMutex;
+}
+
+SpellWorker::Verdict SpellWorker::wordVerdict(const QString &AWord)
+{
+	QMutexLocker locker(&FMutex);
+	if (!FQuit)
+	{
+		QHash<QString,bool> &verdicts = FVerdicts[FActualLang];
+		QHash<QString,bool>::const_iterator it = verdicts.constFind(AWord);
+		if (it != verdicts.constEnd())
+			return it.value() ? Correct : Incorrect;
+
+		if (!FPending.contains(AWord))
+		{
+			FPending += AWord;
+			FQueue.enqueue(AWord);
+			FWordReady.wakeAll();
+			start();
+		}
+	}
+	return Unknown;
+}
+
+void SpellWorker::setWordVerdict(const QString &AWord, bool ACorrect)
+{
+	QMutexLocker locker(&FMutex);
+	FVerdicts[FActualLang].insert(AWord,ACorrect);
+}
+
+void SpellWorker::clearLangVerdicts(const QString &ALang)
+{
+	QMutexLocker locker(&FMutex);
+	FActualLang = ALang;
+	FVerdicts.remove(ALang);
+	FPending.clear();
+	FQueue.clear();
+}
+
+void SpellWorker::run()
+{
+	QMutexLocker locker(&FMutex);
+	while (!FQuit)
+	{
+		if (!FQueue.isEmpty())
+		{
+			QString lang = FActualLang;
+			QList<QString> words;
+			while (!FQueue.isEmpty() && words.count()<MAX_BATCH_WORDS)
+				words.append(FQueue.dequeue());
+			locker.unlock();
+
+			QHash<QString,bool> checked;
+			FBackendMutex.lock();
+			foreach(const QString &word, words)
+				checked.insert(word,SpellBackend::instance()->isCorrect(word));
+			FBackendMutex.unlock();
+
+			locker.relock();
+			if (FActualLang == lang)
+			{
+				QHash<QString,bool> &verdicts = FVerdicts[lang];
+				if (verdicts.count() > MAX_LANG_VERDICTS)
+					verdicts.clear();
+				for (QHash<QString,bool>::const_iterator it=checked.constBegin(); it!=checked.constEnd(); ++it)
+					verdicts.insert(it.key(),it.value());
+				foreach(const QString &word, words)
+					FPending -= word;
+				if (!checked.isEmpty() && FQueue.isEmpty())
+					QMetaObject::invokeMethod(this,"wordsChecked",Qt::QueuedConnection);
+			}
+		}
+		else if (!FWordReady.wait(locker.mutex(),THREAD_WAIT_TIME) && FQueue.isEmpty())
+		{
+			break;
+		}
+	}
+}
+
+void SpellWorker::onThreadFinished()
+{
+	// Words queued while the idle thread was exiting were not picked up by start()
+	QMutexLocker locker(&FMutex);
+	if (!FQuit && !FQueue.isEmpty())
+		start();
+}
@@ -0,0 +1,46 @@
+#ifndef SPELLWORKER_H
+#define SPELLWORKER_H
+
+#include <QSet>
+#include <QHash>
+#include <QQueue>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+class SpellWorker :
+	public QThread
+{
+	Q_OBJECT;
+public:
+	enum Verdict {
+		Unknown,
+		Correct,
+		Incorrect
+	};
+public:
+	SpellWorker(QObject *AParent);
+	~SpellWorker();
+	void quit();
+	QMutex *backendMutex();
+	Verdict wordVerdict(const QString &AWord);
+	void setWordVerdict(const QString &AWord, bool ACorrect);
+	void clearLangVerdicts(const QString &ALang);
+signals:
+	void wordsChecked();
+protected:
+	void run();
+protected slots:
+	void onThreadFinished();
+private:
+	bool FQuit;
+	QMutex FMutex;
+	QMutex FBackendMutex;
+	QWaitCondition FWordReady;
+	QString FActualLang;
+	QSet<QString> FPending;
+	QQueue<QString> FQueue;
+	QHash<QString, QHash<QString,bool> > FVerdicts;
+};
+
+#endif // SPELLWORKER_H
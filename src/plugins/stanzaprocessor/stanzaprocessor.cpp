@@ -4,9 +4,20 @@
 #include <definitions/xmppstanzahandlerorders.h>
 #include <utils/logger.h>
 
+#define WHEEL_TICK_INTERVAL       100
+#define WHEEL_SLOTS_COUNT         512
+
 StanzaProcessor::StanzaProcessor()
 {
 	FXmppStreams = NULL;
+
+	FWheelTick = 0;
+	FWheelRequests = 0;
+	FWheelSlots.resize(WHEEL_SLOTS_COUNT);
+	FWheelClock.start();
+
+	FWheelTimer.setInterval(WHEEL_TICK_INTERVAL);
+	connect(&FWheelTimer,SIGNAL(timeout()),SLOT(onRequestWheelTimeout()));
 }
 
 StanzaProcessor::~StanzaProcessor()
@@ -106,17 +117,31 @@ bool StanzaProcessor::sendStanzaRequest(IStanzaRequestOwner *AIqOwner, const Jid
 		{
 			StanzaRequest request;
 			request.owner = AIqOwner;
+			request.ownerObject = AIqOwner->instance();
 			request.streamJid = AStreamJid;
 			request.contactJid = AStanza.to();
+			request.ns = AStanza.firstElement().namespaceURI();
+			request.sendTime = FWheelClock.elapsed();
+
 			if (ATimeout > 0)
 			{
-				request.timer = new QTimer;
-				request.timer->setSingleShot(true);
-				connect(request.timer,SIGNAL(timeout()),SLOT(onStanzaRequestTimeout()));
-				request.timer->start(ATimeout);
+				if (FWheelRequests == 0)
+				{
+					FWheelTick = request.sendTime/WHEEL_TICK_INTERVAL;
+					FWheelTimer.start();
+				}
+				request.deadlineTick = (request.sendTime+ATimeout+WHEEL_TICK_INTERVAL-1)/WHEEL_TICK_INTERVAL;
+				FWheelSlots[request.deadlineTick % WHEEL_SLOTS_COUNT].insert(AStanza.id());
+				FWheelRequests++;
 			}
+
+			connect(request.ownerObject,SIGNAL(destroyed(QObject *)),SLOT(onStanzaRequestOwnerDestroyed(QObject *)),Qt::UniqueConnection);
+			FOwnerRequests.insertMulti(request.ownerObject,AStanza.id());
 			FRequests.insert(AStanza.id(),request);
-			connect(AIqOwner->instance(),SIGNAL(destroyed(QObject *)),SLOT(onStanzaRequestOwnerDestroyed(QObject *)));
+
+			StanzaRequestCounters &counters = FRequestCounters[request.ns];
+			counters.sent++;
+			counters.inFlight++;
 			return true;
 		}
 	}
@@ -329,7 +354,14 @@ bool StanzaProcessor::processStanzaRequest(const Jid &AStreamJid, const Stanza &
 {
 	if (AStanza.tagName()=="iq" && FRequests.contains(AStanza.id()) && (AStanza.type()=="result" || AStanza.type()=="error"))
 	{
-		const StanzaRequest &request = FRequests.value(AStanza.id());
+		const StanzaRequest request = FRequests.value(AStanza.id());
+
+		qint64 latency = FWheelClock.elapsed() - request.sendTime;
+		StanzaRequestCounters &counters = FRequestCounters[request.ns];
+		counters.replies++;
+		counters.latencySum += latency;
+		counters.latencyMax = qMax(counters.latencyMax,latency);
+
 		request.owner->stanzaRequestResult(AStreamJid,AStanza);
 		removeStanzaRequest(AStanza.id());
 		return true;
@@ -353,8 +385,27 @@ void StanzaProcessor::processRequestTimeout(const QString &AStanzaId) const
 
 void StanzaProcessor::removeStanzaRequest(const QString &AStanzaId)
 {
-	StanzaRequest request = FRequests.take(AStanzaId);
-	delete request.timer;
+	if (FRequests.contains(AStanzaId))
+	{
+		StanzaRequest request = FRequests.take(AStanzaId);
+		FOwnerRequests.remove(request.ownerObject,AStanzaId);
+		if (request.deadlineTick >= 0)
+		{
+			FWheelSlots[request.deadlineTick % WHEEL_SLOTS_COUNT].remove(AStanzaId);
+			if (--FWheelRequests == 0)
+				FWheelTimer.stop();
+		}
+		FRequestCounters[request.ns].inFlight--;
+	}
+}
+
+void StanzaProcessor::reportRequestCounters(const Jid &AStreamJid) const
+{
+	for (QHash<QString,StanzaRequestCounters>::const_iterator it=FRequestCounters.constBegin(); it!=FRequestCounters.constEnd(); ++it)
+	{
+		qint64 latencyAvg = it->replies>0 ? it->latencySum/it->replies : 0;
+		LOG_STRM_DEBUG(AStreamJid,QString("Stanza requests statistics, ns=%1, sent=%2, in-flight=%3, timeouts=%4, avg-latency=%5, max-latency=%6").arg(it.key()).arg(it->sent).arg(it->inFlight).arg(it->timeouts).arg(latencyAvg).arg(it->latencyMax));
+	}
 }
 
 void StanzaProcessor::insertErrorElement(Stanza &AStanza, const XmppStanzaError &AError) const
@@ -390,14 +441,14 @@ void StanzaProcessor::onStreamClosed(IXmppStream *AXmppStream)
 {
 	foreach(const QString &stanzaId, FRequests.keys())
 	{
-		const StanzaRequest &request = FRequests.value(stanzaId);
-		if (request.streamJid == AXmppStream->streamJid())
+		if (FRequests.value(stanzaId).streamJid == AXmppStream->streamJid())
 		{
 			LOG_STRM_WARNING(AXmppStream->streamJid(),QString("Failed to receive request reply, id=%1: Stream is closed").arg(stanzaId));
 			processRequestTimeout(stanzaId);
 			removeStanzaRequest(stanzaId);
 		}
 	}
+	reportRequestCounters(AXmppStream->streamJid());
 }
 
 void StanzaProcessor::onStreamDestroyed(IXmppStream *AXmppStream)
@@ -405,28 +456,37 @@ void StanzaProcessor::onStreamDestroyed(IXmppStream *AXmppStream)
 	AXmppStream->removeXmppStanzaHandler(XSHO_STANZAPROCESSOR,this);
 }
 
-void StanzaProcessor::onStanzaRequestTimeout()
+void StanzaProcessor::onRequestWheelTimeout()
 {
-	QTimer *timer = qobject_cast<QTimer *>(sender());
-	if (timer != NULL)
+	QStringList expired;
+	qint64 curTick = FWheelClock.elapsed()/WHEEL_TICK_INTERVAL;
+	qint64 firstTick = qMax(FWheelTick+1, curTick-WHEEL_SLOTS_COUNT+1);
+	for (qint64 tick=firstTick; tick<=curTick; tick++)
+	{
+		// Slot also holds requests from the next wheel rounds
+		foreach(const QString &stanzaId, FWheelSlots.at(tick % WHEEL_SLOTS_COUNT))
+			if (FRequests.value(stanzaId).deadlineTick <= curTick)
+				expired.append(stanzaId);
+	}
+	FWheelTick = curTick;
+
+	foreach(const QString &stanzaId, expired)
 	{
-		for(QMap<QString,StanzaRequest>::const_iterator it=FRequests.constBegin(); it!=FRequests.constEnd(); ++it)
+		if (FRequests.contains(stanzaId))
 		{
-			if (it->timer == timer)
-			{
-				processRequestTimeout(it.key());
-				removeStanzaRequest(it.key());
-				break;
-			}
+			const StanzaRequest &request = FRequests.value(stanzaId);
+			LOG_STRM_DEBUG(request.streamJid,QString("Stanza request timed out, id=%1, ns=%2").arg(stanzaId,request.ns));
+			FRequestCounters[request.ns].timeouts++;
+			processRequestTimeout(stanzaId);
+			removeStanzaRequest(stanzaId);
 		}
 	}
 }
 
 void StanzaProcessor::onStanzaRequestOwnerDestroyed(QObject *AOwner)
 {
-	foreach(const QString &stanzaId, FRequests.keys())
-		if (FRequests.value(stanzaId).owner->instance() == AOwner)
-			removeStanzaRequest(stanzaId);
+	foreach(const QString &stanzaId, FOwnerRequests.values(AOwner))
+		removeStanzaRequest(stanzaId);
 }
 
 void StanzaProcessor::onStanzaHandlerDestroyed(QObject *AHandler)
@@ -1,24 +1,51 @@
 #ifndef STANZAPROCESSOR_H
 #define STANZAPROCESSOR_H
 
+#include <QSet>
+#include <QHash>
 #include <QTimer>
+#include <QVector>
 #include <QMultiMap>
+#include <QMultiHash>
 #include <QDomDocument>
+#include <QElapsedTimer>
 #include <interfaces/ipluginmanager.h>
 #include <interfaces/istanzaprocessor.h>
 #include <interfaces/ixmppstreams.h>
 
 struct StanzaRequest {
 	StanzaRequest() {
-		timer=NULL;
 		owner=NULL;
+		ownerObject=NULL;
+		sendTime=0;
+		deadlineTick=-1;
 	}
 	Jid streamJid;
 	Jid contactJid;
-	QTimer *timer;
+	QString ns;
+	qint64 sendTime;
+	qint64 deadlineTick;
+	QObject *ownerObject;
 	IStanzaRequestOwner *owner;
 };
 
+struct StanzaRequestCounters {
+	StanzaRequestCounters() {
+		sent=0;
+		inFlight=0;
+		replies=0;
+		timeouts=0;
+		latencySum=0;
+		latencyMax=0;
+	}
+	int sent;
+	int inFlight;
+	int replies;
+	int timeouts;
+	qint64 latencySum;
+	qint64 latencyMax;
+};
+
 class StanzaProcessor :
 	public QObject,
 	public IPlugin,
@@ -64,20 +91,29 @@ protected:
 	bool processStanzaRequest(const Jid &AStreamJid, const Stanza &AStanza);
 	void processRequestTimeout(const QString &AStanzaId) const;
 	void removeStanzaRequest(const QString &AStanzaId);
+	void reportRequestCounters(const Jid &AStreamJid) const;
 	void insertErrorElement(Stanza &AStanza, const XmppStanzaError &AError) const;
 protected slots:
 	void onStreamCreated(IXmppStream *AXmppStream);
 	void onStreamJidChanged(IXmppStream *AXmppStream, const Jid &ABefore);
 	void onStreamClosed(IXmppStream *AXmppStream);
 	void onStreamDestroyed(IXmppStream *AXmppStream);
-	void onStanzaRequestTimeout();
+	void onRequestWheelTimeout();
 	void onStanzaRequestOwnerDestroyed(QObject *AOwner);
 	void onStanzaHandlerDestroyed(QObject *AHandler);
 private:
 	IXmppStreams *FXmppStreams;
 private:
 	QMap<int, IStanzaHandle> FHandles;
-	QMap<QString, StanzaRequest> FRequests;
+	QHash<QString, StanzaRequest> FRequests;
+	QMultiHash<QObject *, QString> FOwnerRequests;
+	QHash<QString, StanzaRequestCounters> FRequestCounters;
+private:
+	int FWheelRequests;
+	qint64 FWheelTick;
+	QTimer FWheelTimer;
+	QElapsedTimer FWheelClock;
+	QVector< QSet<QString> > FWheelSlots;
 	QMultiMap<int, int> FHandleIdByOrder;
 };
 
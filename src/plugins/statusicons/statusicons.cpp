@@ -20,6 +20,116 @@
 
 #define STATUSICONS_STORAGE_PATTERN      "pattern"
 
+#define JID_STORAGE_CACHE_SIZE           1000
+
+// Returns the longest substring that must be present in any string matched by pattern
+static QString requiredRuleLiteral(const QString &APattern, bool *ALiteralOnly)
+{
+	QString literal, run;
+	bool literalOnly = true;
+	bool lastLiteral = false;
+
+	int i = 0;
+	while (i < APattern.length())
+	{
+		QChar ch = APattern.at(i);
+		bool endRun = true;
+		bool atomLiteral = false;
+
+		if (ch == '\\')
+		{
+			QChar next = i+1<APattern.length() ? APattern.at(i+1) : QChar();
+			if (!next.isNull() && !next.isLetterOrNumber())
+			{
+				run.append(next);
+				endRun = false;
+				atomLiteral = true;
+			}
+			i += 2;
+		}
+		else if (ch == '(')
+		{
+			int depth = 0;
+			for (; i<APattern.length(); i++)
+			{
+				QChar gch = APattern.at(i);
+				if (gch == '\\')
+					i++;
+				else if (gch == '[')
+				{
+					while (i+1<APattern.length() && APattern.at(i+1)!=']')
+						i++;
+				}
+				else if (gch == '(')
+					depth++;
+				else if (gch==')' && --depth==0)
+					break;
+			}
+			i++;
+		}
+		else if (ch == '[')
+		{
+			i++;
+			if (i<APattern.length() && APattern.at(i)=='^')
+				i++;
+			if (i<APattern.length() && APattern.at(i)==']')
+				i++;
+			for (; i<APattern.length() && APattern.at(i)!=']'; i++)
+			{
+				if (APattern.at(i) == '\\')
+					i++;
+			}
+			i++;
+		}
+		else if (ch=='*' || ch=='?' || ch=='{')
+		{
+			// Previous literal char may be absent
+			if (lastLiteral)
+				run.chop(1);
+			if (ch == '{')
+			{
+				while (i<APattern.length() && APattern.at(i)!='}')
+					i++;
+			}
+			i++;
+		}
+		else if (ch == '|')
+		{
+			// Alternation at top level, nothing is required
+			if (ALiteralOnly)
+				*ALiteralOnly = false;
+			return QString::null;
+		}
+		else if (ch=='+' || ch=='.' || ch=='^' || ch=='$' || ch==')')
+		{
+			i++;
+		}
+		else
+		{
+			run.append(ch);
+			endRun = false;
+			atomLiteral = true;
+			i++;
+		}
+
+		if (endRun)
+		{
+			if (run.length() > literal.length())
+				literal = run;
+			run.clear();
+			literalOnly = false;
+		}
+		lastLiteral = atomLiteral;
+	}
+
+	if (run.length() > literal.length())
+		literal = run;
+
+	if (ALiteralOnly)
+		*ALiteralOnly = literalOnly && !literal.isEmpty();
+	return literal;
+}
+
 StatusIcons::StatusIcons()
 {
 	FPresencePlugin = NULL;
@@ -33,6 +143,8 @@ StatusIcons::StatusIcons()
 	FCustomIconMenu = NULL;
 	FDefaultIconAction = NULL;
 	FStatusIconsChangedStarted = false;
+
+	FJid2Storage.setMaxCost(JID_STORAGE_CACHE_SIZE);
 }
 
 StatusIcons::~StatusIcons()
@@ -235,7 +347,7 @@ void StatusIcons::insertRule(const QString &APattern, const QString &ASubStorage
 			break;
 		}
 
-		FJid2Storage.clear();
+		updateCompiledRules();
 		emit ruleInserted(APattern,ASubStorage,ARuleType);
 
 		startStatusIconsChanged();
@@ -262,7 +374,7 @@ void StatusIcons::removeRule(const QString &APattern, RuleType ARuleType)
 			break;
 		}
 
-		FJid2Storage.clear();
+		updateCompiledRules();
 		emit ruleRemoved(APattern,ARuleType);
 
 		startStatusIconsChanged();
@@ -293,44 +405,31 @@ QIcon StatusIcons::iconByJidStatus(const Jid &AContactJid, int AShow, const QStr
 
 QString StatusIcons::iconsetByJid(const Jid &AContactJid) const
 {
-	if (!FJid2Storage.contains(AContactJid))
+	QString *cached = FJid2Storage.object(AContactJid);
+	if (cached == NULL)
 	{
-		QRegExp regExp;
-		regExp.setCaseSensitivity(Qt::CaseInsensitive);
-
 		QString substorage;
-		foreach (const QString &pattern, FUserRules.keys())
+		QString contactJid = AContactJid.pFull();
+		for (QList<StatusIconsRule>::const_iterator it=FCompiledRules.constBegin(); it!=FCompiledRules.constEnd(); ++it)
 		{
-			regExp.setPattern(pattern);
-			if (AContactJid.pFull().contains(regExp))
+			if (!it->literal.isEmpty() && !contactJid.contains(it->literal,Qt::CaseInsensitive))
+				continue;
+			if (it->literalOnly || contactJid.contains(it->regExp))
 			{
-				substorage = FUserRules.value(pattern);
+				substorage = it->substorage;
 				break;
 			}
 		}
 
-		if (substorage.isEmpty())
-		{
-			foreach (const QString &pattern, FDefaultRules.keys())
-			{
-				regExp.setPattern(pattern);
-				if (AContactJid.pFull().contains(regExp))
-				{
-					substorage = FDefaultRules.value(pattern);
-					break;
-				}
-			}
-		}
-
 		if (substorage.isEmpty())
 		{
 			substorage = FDefaultStorage!=NULL ? FDefaultStorage->subStorage() : FILE_STORAGE_SHARED_DIR;
 		}
 
-		FJid2Storage.insert(AContactJid,substorage);
+		FJid2Storage.insert(AContactJid,new QString(substorage));
 		return substorage;
 	}
-	return FJid2Storage.value(AContactJid);
+	return *cached;
 }
 
 QString StatusIcons::iconKeyByJid(const Jid &AStreamJid, const Jid &AContactJid) const
@@ -442,6 +541,29 @@ void StatusIcons::clearStorages()
 	qDeleteAll(FCustomIconMenu->groupActions(AG_DEFAULT));
 }
 
+void StatusIcons::updateCompiledRules()
+{
+	FCompiledRules.clear();
+
+	// User rules take precedence over default ones
+	QList< QMap<QString,QString> > rulesList = QList< QMap<QString,QString> >() << FUserRules << FDefaultRules;
+	foreach(const QMap<QString,QString> &rules, rulesList)
+	{
+		for (QMap<QString,QString>::const_iterator it=rules.constBegin(); it!=rules.constEnd(); ++it)
+		{
+			StatusIconsRule rule;
+			rule.pattern = it.key();
+			rule.substorage = it.value();
+			rule.literal = requiredRuleLiteral(rule.pattern,&rule.literalOnly);
+			if (!rule.literalOnly)
+				rule.regExp = QRegExp(rule.pattern,Qt::CaseInsensitive);
+			FCompiledRules.append(rule);
+		}
+	}
+
+	FJid2Storage.clear();
+}
+
 void StatusIcons::startStatusIconsChanged()
 {
 	if (!FStatusIconsChangedStarted)
@@ -1,6 +1,7 @@
 #ifndef STATUSICONS_H
 #define STATUSICONS_H
 
+#include <QCache>
 #include <QRegExp>
 #include <interfaces/ipluginmanager.h>
 #include <interfaces/istatusicons.h>
@@ -12,6 +13,15 @@
 #include <interfaces/ioptionsmanager.h>
 #include "iconsoptionswidget.h"
 
+struct StatusIconsRule
+{
+	QString pattern;
+	QString substorage;
+	QString literal;
+	bool literalOnly;
+	QRegExp regExp;
+};
+
 class StatusIcons :
 	public QObject,
 	public IPlugin,
@@ -62,6 +72,7 @@ signals:
 protected:
 	void loadStorages();
 	void clearStorages();
+	void updateCompiledRules();
 	void startStatusIconsChanged();
 	void updateCustomIconMenu(const QStringList &APatterns);
 	bool isSelectionAccepted(const QList<IRosterIndex *> &ASelected) const;
@@ -97,7 +108,8 @@ private:
 	QMap<QString, QString> FUserRules;
 	QMap<QString, QString> FDefaultRules;
 	QMap<QString, IconStorage *> FStorages;
-	mutable QHash<Jid, QString> FJid2Storage;
+	QList<StatusIconsRule> FCompiledRules;
+	mutable QCache<Jid, QString> FJid2Storage;
 };
 
 #endif // STATUSICONS_H
@@ -0,0 +1,2 @@
+set(SOURCES streammanagement.cpp streammanagementplugin.cpp streamresumption.cpp )
+set(HEADERS streammanagement.h streammanagementplugin.h streamresumption.h )
@@ -0,0 +1,292 @@
+#include "streammanagement.h"
+
+#include <definitions/namespaces.h>
+#include <definitions/xmppstanzahandlerorders.h>
+#include <utils/stanza.h>
+#include <utils/xmpperror.h>
+#include <utils/logger.h>
+
+#define ACK_REQUEST_DELAY          2000
+#define ACK_REQUEST_STANZAS        10
+#define DEFAULT_RESUME_TIMEOUT     300000
+#define MAX_RESUME_TIMEOUT         600000
+
+static bool isSessionStanza(const Stanza &AStanza)
+{
+	QString tagName = AStanza.tagName();
+	return tagName=="message" || tagName=="presence" || tagName=="iq";
+}
+
+StreamManagement::StreamManagement(IXmppStream *AXmppStream, IStanzaProcessor *AStanzaProcessor) : QObject(AXmppStream->instance())
+{
+	FXmppStream = AXmppStream;
+	FStanzaProcessor = AStanzaProcessor;
+
+	FAvailable = false;
+	FEnabled = false;
+	FCounting = false;
+	FAckRequested = false;
+	FInHandled = 0;
+	FOutHandled = 0;
+
+	FAckTimer.setSingleShot(true);
+	FAckTimer.setInterval(ACK_REQUEST_DELAY);
+	connect(&FAckTimer,SIGNAL(timeout()),SLOT(onAckRequestTimeout()));
+
+	connect(FXmppStream->instance(),SIGNAL(opened()),SLOT(onXmppStreamOpened()));
+	connect(FXmppStream->instance(),SIGNAL(resumed()),SLOT(onXmppStreamResumed()));
+	connect(FXmppStream->instance(),SIGNAL(closed()),SLOT(onXmppStreamClosed()));
+
+	FXmppStream->insertXmppStanzaHandler(XSHO_STREAMMANAGEMENT,this);
+}
+
+StreamManagement::~StreamManagement()
+{
+	FXmppStream->removeXmppStanzaHandler(XSHO_STREAMMANAGEMENT,this);
+}
+
+bool StreamManagement::xmppStanzaIn(IXmppStream *AXmppStream, Stanza &AStanza, int AOrder)
+{
+	if (AXmppStream==FXmppStream && AOrder==XSHO_STREAMMANAGEMENT)
+	{
+		if (AStanza.element().namespaceURI() == NS_FEATURE_SM)
+		{
+			if (AStanza.tagName() == "r")
+			{
+				sendAcknowledgement();
+			}
+			else if (AStanza.tagName() == "a")
+			{
+				processAcknowledgement(AStanza.attribute("h").toUInt());
+			}
+			else if (AStanza.tagName() == "enabled")
+			{
+				FEnabled = true;
+				FInHandled = 0;
+
+				QString resume = AStanza.attribute("resume");
+				if ((resume=="true" || resume=="1") && !AStanza.id().isEmpty())
+				{
+					int max = AStanza.attribute("max").toInt();
+					int timeout = max>0 ? qMin(max*1000,MAX_RESUME_TIMEOUT) : DEFAULT_RESUME_TIMEOUT;
+					FSessionId = AStanza.id();
+					FXmppStream->setResumeTimeout(timeout);
+					LOG_STRM_INFO(FXmppStream->streamJid(),QString("Stream management enabled, id=%1, resume-timeout=%2").arg(FSessionId).arg(timeout));
+				}
+				else
+				{
+					LOG_STRM_INFO(FXmppStream->streamJid(),"Stream management enabled without resumption");
+				}
+			}
+			else if (AStanza.tagName() == "failed")
+			{
+				LOG_STRM_WARNING(FXmppStream->streamJid(),QString("Failed to enable stream management: %1").arg(AStanza.firstElement().tagName()));
+				resetSession();
+			}
+			return true;
+		}
+		else if (FEnabled && isSessionStanza(AStanza))
+		{
+			FInHandled++;
+		}
+	}
+	return false;
+}
+
+bool StreamManagement::xmppStanzaOut(IXmppStream *AXmppStream, Stanza &AStanza, int AOrder)
+{
+	if (AXmppStream==FXmppStream && AOrder==XSHO_STREAMMANAGEMENT && FCounting && isSessionStanza(AStanza))
+	{
+		Stanza stanza = AStanza;
+		stanza.detach();
+		FUnacked.append(stanza);
+
+		if (FUnacked.count() >= ACK_REQUEST_STANZAS)
+			requestAcknowledgement();
+		else if (!FAckTimer.isActive())
+			FAckTimer.start();
+	}
+	return false;
+}
+
+IXmppStream *StreamManagement::xmppStream() const
+{
+	return FXmppStream;
+}
+
+bool StreamManagement::isEnabled() const
+{
+	return FEnabled;
+}
+
+bool StreamManagement::isResumable() const
+{
+	return FEnabled && !FSessionId.isEmpty();
+}
+
+QString StreamManagement::sessionId() const
+{
+	return FSessionId;
+}
+
+quint32 StreamManagement::handledCount() const
+{
+	return FInHandled;
+}
+
+void StreamManagement::setFeatureAvailable(bool AAvailable)
+{
+	FAvailable = AAvailable;
+}
+
+void StreamManagement::processAcknowledgement(quint32 AHandled)
+{
+	quint32 acked = AHandled - FOutHandled;
+	if (acked > (quint32)FUnacked.count())
+	{
+		LOG_STRM_WARNING(FXmppStream->streamJid(),QString("Invalid stream management acknowledgement, h=%1, unacked=%2").arg(AHandled).arg(FUnacked.count()));
+		acked = FUnacked.count();
+	}
+
+	FUnacked.erase(FUnacked.begin(),FUnacked.begin()+acked);
+	FOutHandled = AHandled;
+	FAckRequested = false;
+
+	if (FUnacked.isEmpty())
+		FAckTimer.stop();
+	else if (!FAckTimer.isActive())
+		FAckTimer.start();
+}
+
+void StreamManagement::resetSession()
+{
+	// Resumption was refused, unacknowledged messages are sent again in the new session
+	if (FXmppStream->isSuspended())
+		FResendStanzas += sessionMessages(FUnacked);
+
+	FEnabled = false;
+	FCounting = false;
+	FAckRequested = false;
+	FSessionId.clear();
+	FInHandled = 0;
+	FOutHandled = 0;
+	FUnacked.clear();
+	FAckTimer.stop();
+	FXmppStream->setResumeTimeout(0);
+}
+
+QList<Stanza> StreamManagement::sessionMessages(const QList<Stanza> &AStanzas) const
+{
+	QList<Stanza> messages;
+	foreach(const Stanza &stanza, AStanzas)
+		if (stanza.tagName() == "message")
+			messages.append(stanza);
+	return messages;
+}
+
+void StreamManagement::bounceMessages(const QList<Stanza> &AMessages)
+{
+	if (!AMessages.isEmpty())
+	{
+		LOG_STRM_WARNING(FXmppStream->streamJid(),QString("Failed to deliver unacknowledged messages, count=%1").arg(AMessages.count()));
+		if (FStanzaProcessor)
+		{
+			foreach(const Stanza &message, AMessages)
+			{
+				Stanza stanza = message;
+				stanza.detach();
+				Stanza error = FStanzaProcessor->makeReplyError(stanza,XmppStanzaError(XmppStanzaError::EC_RECIPIENT_UNAVAILABLE));
+				error.setFrom(message.to()).setTo(FXmppStream->streamJid().full());
+				FStanzaProcessor->sendStanzaIn(FXmppStream->streamJid(),error);
+			}
+		}
+	}
+}
+
+void StreamManagement::sendAcknowledgement()
+{
+	if (FEnabled)
+	{
+		Stanza ack("a");
+		ack.setAttribute("xmlns",NS_FEATURE_SM);
+		ack.setAttribute("h",QString::number(FInHandled));
+		FXmppStream->sendStanza(ack);
+	}
+}
+
+void StreamManagement::requestAcknowledgement()
+{
+	if (FCounting && !FAckRequested && FXmppStream->isOpen() && !FXmppStream->isSuspended())
+	{
+		Stanza request("r");
+		request.setAttribute("xmlns",NS_FEATURE_SM);
+		if (FXmppStream->sendStanza(request) >= 0)
+			FAckRequested = true;
+	}
+}
+
+void StreamManagement::onXmppStreamOpened()
+{
+	if (FAvailable && !FCounting)
+	{
+		Stanza enable("enable");
+		enable.setAttribute("xmlns",NS_FEATURE_SM);
+		enable.setAttribute("resume","true");
+		if (FXmppStream->sendStanza(enable) >= 0)
+		{
+			FCounting = true;
+			FOutHandled = 0;
+			FUnacked.clear();
+			LOG_STRM_INFO(FXmppStream->streamJid(),"Stream management enable request sent");
+		}
+	}
+
+	if (!FResendStanzas.isEmpty())
+	{
+		LOG_STRM_INFO(FXmppStream->streamJid(),QString("Resending messages unacknowledged in previous session, count=%1").arg(FResendStanzas.count()));
+
+		QList<Stanza> stanzas = FResendStanzas;
+		FResendStanzas.clear();
+		for (int i=0; i<stanzas.count(); i++)
+			FXmppStream->sendStanza(stanzas[i]);
+	}
+}
+
+void StreamManagement::onXmppStreamResumed()
+{
+	FAckRequested = false;
+	if (!FUnacked.isEmpty())
+	{
+		LOG_STRM_INFO(FXmppStream->streamJid(),QString("Resending unacknowledged stanzas, count=%1").arg(FUnacked.count()));
+
+		QList<Stanza> stanzas = FUnacked;
+		FUnacked.clear();
+		for (int i=0; i<stanzas.count(); i++)
+			FXmppStream->sendStanza(stanzas[i]);
+	}
+}
+
+void StreamManagement::onXmppStreamClosed()
+{
+	FAvailable = false;
+	if (FXmppStream->isConnected())
+	{
+		// New session is started on the same connection
+		FResendStanzas += sessionMessages(FUnacked);
+	}
+	else
+	{
+		QList<Stanza> messages = FResendStanzas;
+		if (!FXmppStream->error().isNull())
+			messages += sessionMessages(FUnacked);
+		FResendStanzas.clear();
+		bounceMessages(messages);
+	}
+	resetSession();
+}
+
+void StreamManagement::onAckRequestTimeout()
+{
+	if (!FUnacked.isEmpty())
+		requestAcknowledgement();
+}
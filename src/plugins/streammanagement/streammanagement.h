@@ -0,0 +1,55 @@
+#ifndef STREAMMANAGEMENT_H
+#define STREAMMANAGEMENT_H
+
+#include <QTimer>
+#include <interfaces/ixmppstreams.h>
+#include <interfaces/istanzaprocessor.h>
+
+class StreamManagement :
+	public QObject,
+	public IXmppStanzaHadler
+{
+	Q_OBJECT;
+	Q_INTERFACES(IXmppStanzaHadler);
+public:
+	StreamManagement(IXmppStream *AXmppStream, IStanzaProcessor *AStanzaProcessor);
+	~StreamManagement();
+	//IXmppStanzaHadler
+	virtual bool xmppStanzaIn(IXmppStream *AXmppStream, Stanza &AStanza, int AOrder);
+	virtual bool xmppStanzaOut(IXmppStream *AXmppStream, Stanza &AStanza, int AOrder);
+	//StreamManagement
+	IXmppStream *xmppStream() const;
+	bool isEnabled() const;
+	bool isResumable() const;
+	QString sessionId() const;
+	quint32 handledCount() const;
+	void setFeatureAvailable(bool AAvailable);
+	void processAcknowledgement(quint32 AHandled);
+	void resetSession();
+protected:
+	void sendAcknowledgement();
+	void requestAcknowledgement();
+	QList<Stanza> sessionMessages(const QList<Stanza> &AStanzas) const;
+	void bounceMessages(const QList<Stanza> &AMessages);
+protected slots:
+	void onXmppStreamOpened();
+	void onXmppStreamResumed();
+	void onXmppStreamClosed();
+	void onAckRequestTimeout();
+private:
+	IXmppStream *FXmppStream;
+	IStanzaProcessor *FStanzaProcessor;
+private:
+	bool FAvailable;
+	bool FEnabled;
+	bool FCounting;
+	bool FAckRequested;
+	QString FSessionId;
+	quint32 FInHandled;
+	quint32 FOutHandled;
+	QTimer FAckTimer;
+	QList<Stanza> FUnacked;
+	QList<Stanza> FResendStanzas;
+};
+
+#endif // STREAMMANAGEMENT_H
@@ -0,0 +1,7 @@
+HEADERS = streammanagement.h \
+          streammanagementplugin.h \
+          streamresumption.h
+
+SOURCES = streammanagement.cpp \
+          streammanagementplugin.cpp \
+          streamresumption.cpp
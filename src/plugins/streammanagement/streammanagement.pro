@@ -0,0 +1,3 @@
+TARGET = streammanagement
+include(streammanagement.pri)
+include(../plugins.inc)
@@ -0,0 +1,158 @@
+#include "streammanagementplugin.h"
+
+#include <definitions/namespaces.h>
+#include <definitions/optionnodes.h>
+#include <definitions/optionvalues.h>
+#include <definitions/optionwidgetorders.h>
+#include <definitions/internalerrors.h>
+#include <definitions/xmppfeatureorders.h>
+#include <definitions/xmppfeaturepluginorders.h>
+#include <utils/xmpperror.h>
+#include <utils/options.h>
+#include <utils/logger.h>
+
+StreamManagementPlugin::StreamManagementPlugin()
+{
+	FXmppStreams = NULL;
+	FOptionsManager = NULL;
+	FAccountManager = NULL;
+	FStanzaProcessor = NULL;
+}
+
+StreamManagementPlugin::~StreamManagementPlugin()
+{
+
+}
+
+void StreamManagementPlugin::pluginInfo(IPluginInfo *APluginInfo)
+{
+	APluginInfo->name = tr("Stream Management");
+	APluginInfo->description = tr("Allows to acknowledge sent stanzas and to resume the stream after a short connection loss");
+	APluginInfo->version = "1.0";
+	APluginInfo->author = "Potapov S.A. aka Lion";
+	APluginInfo->homePage = "http://www.vacuum-im.org";
+	APluginInfo->dependences.append(XMPPSTREAMS_UUID);
+}
+
+bool StreamManagementPlugin::initConnections(IPluginManager *APluginManager, int &AInitOrder)
+{
+	Q_UNUSED(AInitOrder);
+	IPlugin *plugin = APluginManager->pluginInterface("IXmppStreams").value(0,NULL);
+	if (plugin)
+	{
+		FXmppStreams = qobject_cast<IXmppStreams *>(plugin->instance());
+		if (FXmppStreams)
+		{
+			connect(FXmppStreams->instance(),SIGNAL(created(IXmppStream *)),SLOT(onXmppStreamCreated(IXmppStream *)));
+			connect(FXmppStreams->instance(),SIGNAL(streamDestroyed(IXmppStream *)),SLOT(onXmppStreamDestroyed(IXmppStream *)));
+		}
+	}
+
+	plugin = APluginManager->pluginInterface("IOptionsManager").value(0,NULL);
+	if (plugin)
+	{
+		FOptionsManager = qobject_cast<IOptionsManager *>(plugin->instance());
+	}
+
+	plugin = APluginManager->pluginInterface("IAccountManager").value(0,NULL);
+	if (plugin)
+	{
+		FAccountManager = qobject_cast<IAccountManager *>(plugin->instance());
+	}
+
+	plugin = APluginManager->pluginInterface("IStanzaProcessor").value(0,NULL);
+	if (plugin)
+	{
+		FStanzaProcessor = qobject_cast<IStanzaProcessor *>(plugin->instance());
+	}
+
+	return FXmppStreams!=NULL;
+}
+
+bool StreamManagementPlugin::initObjects()
+{
+	XmppError::registerError(NS_INTERNAL_ERROR,IERR_SM_RESUME_FAILED,tr("Failed to resume the stream"));
+
+	if (FXmppStreams)
+	{
+		FXmppStreams->registerXmppFeature(XFO_SM,NS_FEATURE_SM);
+		FXmppStreams->registerXmppFeaturePlugin(XFPO_DEFAULT,NS_FEATURE_SM,this);
+	}
+
+	if (FOptionsManager)
+	{
+		FOptionsManager->insertOptionsHolder(this);
+	}
+	return true;
+}
+
+bool StreamManagementPlugin::initSettings()
+{
+	Options::setDefaultValue(OPV_ACCOUNT_STREAMMANAGEMENT,true);
+	return true;
+}
+
+QMultiMap<int, IOptionsWidget *> StreamManagementPlugin::optionsWidgets(const QString &ANodeId, QWidget *AParent)
+{
+	QMultiMap<int, IOptionsWidget *> widgets;
+	if (FOptionsManager)
+	{
+		QStringList nodeTree = ANodeId.split(".",QString::SkipEmptyParts);
+		if (nodeTree.count()==2 && nodeTree.at(0)==OPN_ACCOUNTS)
+		{
+			OptionsNode aoptions = Options::node(OPV_ACCOUNT_ITEM,nodeTree.at(1));
+			widgets.insertMulti(OWO_ACCOUNT_STREAMMANAGEMENT, FOptionsManager->optionsNodeWidget(aoptions.node("stream-management"),tr("Resume the session after a short connection loss if supported by server"),AParent));
+		}
+	}
+	return widgets;
+}
+
+QList<QString> StreamManagementPlugin::xmppFeatures() const
+{
+	return QList<QString>() << NS_FEATURE_SM;
+}
+
+IXmppFeature *StreamManagementPlugin::newXmppFeature(const QString &AFeatureNS, IXmppStream *AXmppStream)
+{
+	StreamManagement *management = FManagements.value(AXmppStream);
+	if (management!=NULL && AFeatureNS==NS_FEATURE_SM)
+	{
+		IAccount *account = FAccountManager!=NULL ? FAccountManager->accountByStream(AXmppStream->streamJid()) : NULL;
+		if (account==NULL || account->optionsNode().value("stream-management").toBool())
+		{
+			if (AXmppStream->isSuspended() && management->isResumable())
+			{
+				LOG_STRM_INFO(AXmppStream->streamJid(),"Stream resumption XMPP stream feature created");
+				IXmppFeature *feature = new StreamResumption(management);
+				connect(feature->instance(),SIGNAL(featureDestroyed()),SLOT(onFeatureDestroyed()));
+				emit featureCreated(feature);
+				return feature;
+			}
+			// Stream management is enabled after resource binding
+			management->setFeatureAvailable(true);
+		}
+	}
+	return NULL;
+}
+
+void StreamManagementPlugin::onFeatureDestroyed()
+{
+	IXmppFeature *feature = qobject_cast<IXmppFeature *>(sender());
+	if (feature)
+	{
+		LOG_STRM_INFO(feature->xmppStream()->streamJid(),"Stream resumption XMPP stream feature destroyed");
+		emit featureDestroyed(feature);
+	}
+}
+
+void StreamManagementPlugin::onXmppStreamCreated(IXmppStream *AXmppStream)
+{
+	FManagements.insert(AXmppStream,new StreamManagement(AXmppStream,FStanzaProcessor));
+}
+
+void StreamManagementPlugin::onXmppStreamDestroyed(IXmppStream *AXmppStream)
+{
+	delete FManagements.take(AXmppStream);
+}
+
+Q_EXPORT_PLUGIN2(plg_streammanagement, StreamManagementPlugin)
@@ -0,0 +1,54 @@
+#ifndef STREAMMANAGEMENTPLUGIN_H
+#define STREAMMANAGEMENTPLUGIN_H
+
+#include <interfaces/ipluginmanager.h>
+#include <interfaces/ixmppstreams.h>
+#include <interfaces/ioptionsmanager.h>
+#include <interfaces/iaccountmanager.h>
+#include <interfaces/istanzaprocessor.h>
+#include "streammanagement.h"
+#include "streamresumption.h"
+
+#define STREAMMANAGEMENT_UUID "{5B6C3F1E-8A2D-4C7B-9E41-2F0D6A8B3C95}"
+
+class StreamManagementPlugin :
+	public QObject,
+	public IPlugin,
+	public IOptionsHolder,
+	public IXmppFeaturesPlugin
+{
+	Q_OBJECT;
+	Q_INTERFACES(IPlugin IOptionsHolder IXmppFeaturesPlugin);
+public:
+	StreamManagementPlugin();
+	~StreamManagementPlugin();
+	//IPlugin
+	virtual QObject *instance() { return this; }
+	virtual QUuid pluginUuid() const { return STREAMMANAGEMENT_UUID; }
+	virtual void pluginInfo(IPluginInfo *APluginInfo);
+	virtual bool initConnections(IPluginManager *APluginManager, int &AInitOrder);
+	virtual bool initObjects();
+	virtual bool initSettings();
+	virtual bool startPlugin() { return true; }
+	//IOptionsHolder
+	virtual QMultiMap<int, IOptionsWidget *> optionsWidgets(const QString &ANodeId, QWidget *AParent);
+	//IXmppFeaturesPlugin
+	virtual QList<QString> xmppFeatures() const;
+	virtual IXmppFeature *newXmppFeature(const QString &AFeatureNS, IXmppStream *AXmppStream);
+signals:
+	void featureCreated(IXmppFeature *AFeature);
+	void featureDestroyed(IXmppFeature *AFeature);
+protected slots:
+	void onFeatureDestroyed();
+	void onXmppStreamCreated(IXmppStream *AXmppStream);
+	void onXmppStreamDestroyed(IXmppStream *AXmppStream);
+private:
+	IXmppStreams *FXmppStreams;
+	IOptionsManager *FOptionsManager;
+	IAccountManager *FAccountManager;
+	IStanzaProcessor *FStanzaProcessor;
+private:
+	QMap<IXmppStream *, StreamManagement *> FManagements;
+};
+
+#endif // STREAMMANAGEMENTPLUGIN_H
@@ -0,0 +1,91 @@
+#include "streamresumption.h"
+
+#include <definitions/namespaces.h>
+#include <definitions/internalerrors.h>
+#include <definitions/xmppstanzahandlerorders.h>
+#include <utils/stanza.h>
+#include <utils/logger.h>
+
+StreamResumption::StreamResumption(StreamManagement *AManagement) : QObject(AManagement->xmppStream()->instance())
+{
+	FManagement = AManagement;
+	FXmppStream = AManagement->xmppStream();
+}
+
+StreamResumption::~StreamResumption()
+{
+	FXmppStream->removeXmppStanzaHandler(XSHO_XMPP_FEATURE,this);
+	emit featureDestroyed();
+}
+
+bool StreamResumption::xmppStanzaIn(IXmppStream *AXmppStream, Stanza &AStanza, int AOrder)
+{
+	if (AXmppStream==FXmppStream && AOrder==XSHO_XMPP_FEATURE)
+	{
+		FXmppStream->removeXmppStanzaHandler(XSHO_XMPP_FEATURE,this);
+		if (AStanza.tagName() == "resumed")
+		{
+			LOG_STRM_INFO(FXmppStream->streamJid(),QString("Stream resumption accepted, id=%1, h=%2").arg(FManagement->sessionId(),AStanza.attribute("h")));
+			FManagement->processAcknowledgement(AStanza.attribute("h").toUInt());
+			deleteLater();
+			FXmppStream->completeResume();
+		}
+		else if (AStanza.tagName() == "failed")
+		{
+			// Fall back to resource binding on the same connection
+			LOG_STRM_WARNING(FXmppStream->streamJid(),QString("Failed to resume stream, binding new session: %1").arg(AStanza.firstElement().tagName()));
+			FManagement->resetSession();
+			deleteLater();
+			emit finished(false);
+
+			// New session closed the previous one and reset the management state
+			if (FXmppStream->isConnected())
+				FManagement->setFeatureAvailable(true);
+		}
+		else
+		{
+			LOG_STRM_WARNING(FXmppStream->streamJid(),QString("Failed to resume stream: Invalid response=%1").arg(AStanza.tagName()));
+			FManagement->resetSession();
+			emit error(XmppError(IERR_SM_RESUME_FAILED));
+		}
+		return true;
+	}
+	return false;
+}
+
+bool StreamResumption::xmppStanzaOut(IXmppStream *AXmppStream, Stanza &AStanza, int AOrder)
+{
+	Q_UNUSED(AXmppStream); Q_UNUSED(AStanza); Q_UNUSED(AOrder);
+	return false;
+}
+
+QString StreamResumption::featureNS() const
+{
+	return NS_FEATURE_SM;
+}
+
+IXmppStream *StreamResumption::xmppStream() const
+{
+	return FXmppStream;
+}
+
+bool StreamResumption::start(const QDomElement &AElem)
+{
+	if (AElem.tagName()=="sm" && FManagement->isResumable())
+	{
+		Stanza resume("resume");
+		resume.setAttribute("xmlns",NS_FEATURE_SM);
+		resume.setAttribute("previd",FManagement->sessionId());
+		resume.setAttribute("h",QString::number(FManagement->handledCount()));
+		FXmppStream->insertXmppStanzaHandler(XSHO_XMPP_FEATURE,this);
+		FXmppStream->sendStanza(resume);
+		LOG_STRM_INFO(FXmppStream->streamJid(),QString("Stream resumption request sent, id=%1, h=%2").arg(FManagement->sessionId()).arg(FManagement->handledCount()));
+		return true;
+	}
+	else if (AElem.tagName() != "sm")
+	{
+		LOG_STRM_ERROR(FXmppStream->streamJid(),QString("Failed to send stream resumption request: Invalid element=%1").arg(AElem.tagName()));
+	}
+	deleteLater();
+	return false;
+}
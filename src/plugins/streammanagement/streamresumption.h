@@ -0,0 +1,34 @@
+#ifndef STREAMRESUMPTION_H
+#define STREAMRESUMPTION_H
+
+#include <interfaces/ixmppstreams.h>
+#include "streammanagement.h"
+
+class StreamResumption :
+	public QObject,
+	public IXmppFeature,
+	public IXmppStanzaHadler
+{
+	Q_OBJECT;
+	Q_INTERFACES(IXmppFeature IXmppStanzaHadler);
+public:
+	StreamResumption(StreamManagement *AManagement);
+	~StreamResumption();
+	virtual QObject *instance() { return this; }
+	//IXmppStanzaHadler
+	virtual bool xmppStanzaIn(IXmppStream *AXmppStream, Stanza &AStanza, int AOrder);
+	virtual bool xmppStanzaOut(IXmppStream *AXmppStream, Stanza &AStanza, int AOrder);
+	//IXmppFeature
+	virtual QString featureNS() const;
+	virtual IXmppStream *xmppStream() const;
+	virtual bool start(const QDomElement &AElem);
+signals:
+	void finished(bool ARestart);
+	void error(const XmppError &AError);
+	void featureDestroyed();
+private:
+	IXmppStream *FXmppStream;
+	StreamManagement *FManagement;
+};
+
+#endif // STREAMRESUMPTION_H
@@ -1,3 +1,3 @@
-set(SOURCES vcardplugin.cpp vcarddialog.cpp vcard.cpp edititemdialog.cpp prixmapframe.cpp)
-set(HEADERS vcarddialog.h vcard.h vcardplugin.h edititemdialog.h prixmapframe.h)
+set(SOURCES vcardplugin.cpp vcarddialog.cpp vcard.cpp edititemdialog.cpp prixmapframe.cpp vcardstore.cpp)
+set(HEADERS vcarddialog.h vcard.h vcardplugin.h edititemdialog.h prixmapframe.h vcardstore.h)
 set(UIS edititemdialog.ui vcarddialog.ui )
@@ -181,19 +181,16 @@ void VCard::unlock()
 
 void VCard::loadVCardFile()
 {
-	QFile file(FVCardPlugin->vcardFileName(FContactJid));
-	if (file.open(QIODevice::ReadOnly))
+	QByteArray data = FVCardPlugin->loadVCardData(FContactJid);
+	if (!data.isEmpty())
 	{
 		QString xmlError;
-		if (!FDoc.setContent(&file,true,&xmlError))
-		{
-			REPORT_ERROR(QString("Failed to load vCard from file content: %1").arg(xmlError));
-			file.remove();
-		}
+		if (!FDoc.setContent(data,true,&xmlError))
+			REPORT_ERROR(QString("Failed to load vCard from store content: %1").arg(xmlError));
 	}
-	else if (file.exists())
+	else if (FVCardPlugin->hasVCard(FContactJid))
 	{
-		REPORT_ERROR(QString("Failed to load vCard from file: %1").arg(file.errorString()));
+		REPORT_ERROR("Failed to load vCard from store: Empty data");
 	}
 
 	if (vcardElem().isNull())
@@ -5,10 +5,12 @@ HEADERS = vcardplugin.h \
           vcard.h \
           prixmapframe.h \
           vcarddialog.h \
-          edititemdialog.h
+          edititemdialog.h \
+          vcardstore.h
 
 SOURCES = vcardplugin.cpp \
           vcard.cpp \
           prixmapframe.cpp \
           vcarddialog.cpp \
-          edititemdialog.cpp
+          edititemdialog.cpp \
+          vcardstore.cpp
@@ -38,6 +38,12 @@
 #define UPDATE_VCARD_DAYS         7
 #define UPDATE_REQUEST_TIMEOUT    5000
 
+#define FETCH_WINDOW_MIN          1
+#define FETCH_WINDOW_START        4
+#define FETCH_WINDOW_MAX          8
+#define FETCH_RETRY_DELAY         5000
+#define FETCH_MAX_ATTEMPTS        3
+
 #define ADR_STREAM_JID            Action::DR_StreamJid
 #define ADR_CONTACT_JID           Action::DR_Parametr1
 #define ADR_CLIPBOARD_DATA        Action::DR_Parametr1
@@ -60,9 +66,20 @@ VCardPlugin::VCardPlugin()
 	FRosterSearch = NULL;
 	FOptionsManager = NULL;
 
+	FVCardStore = new VCardStore(this);
+
 	FUpdateTimer.setSingleShot(false);
 	FUpdateTimer.start(UPDATE_REQUEST_TIMEOUT);
 	connect(&FUpdateTimer,SIGNAL(timeout()),SLOT(onUpdateTimerTimeout()));
+
+	FFetchWindow = FETCH_WINDOW_START;
+	FFetchWaitSum = 0;
+	FFetchLatencySum = 0;
+	FFetchReplies = 0;
+	FFetchClock.start();
+
+	FFetchTimer.setSingleShot(true);
+	connect(&FFetchTimer,SIGNAL(timeout()),SLOT(onFetchTimerTimeout()));
 }
 
 VCardPlugin::~VCardPlugin()
@@ -192,6 +209,9 @@ bool VCardPlugin::initObjects()
 		FVCardFilesDir.mkdir(DIR_VCARDS);
 	FVCardFilesDir.cd(DIR_VCARDS);
 
+	if (FVCardStore->open(FVCardFilesDir))
+		FVCardStore->importVCardFiles(FVCardFilesDir);
+
 	if (FRostersView)
 	{
 		Shortcuts::insertWidgetShortcut(SCT_ROSTERVIEW_SHOWVCARD,FRostersView->instance());
@@ -241,9 +261,9 @@ QVariant VCardPlugin::rosterData(int AOrder, const IRosterIndex *AIndex, int ARo
 	if (AOrder==RDHO_VCARD_SEARCH && ARole==RDR_VCARD_SEARCH)
 	{
 		Jid contactJid = AIndex->data(RDR_PREP_BARE_JID).toString();
-		if (FSearchStrings.contains(contactJid))
+		if (FVCardStore->hasSearchStrings(contactJid))
 		{
-			return FSearchStrings.value(contactJid);
+			return FVCardStore->searchStrings(contactJid);
 		}
 		else if (hasVCard(contactJid))
 		{
@@ -282,7 +302,7 @@ QVariant VCardPlugin::rosterData(int AOrder, const IRosterIndex *AIndex, int ARo
 			delete vcard;
 
 			strings.removeAll(QString::null);
-			FSearchStrings.insert(contactJid, strings);
+			FVCardStore->setSearchStrings(contactJid, strings);
 
 			return strings;
 		}
@@ -302,22 +322,43 @@ void VCardPlugin::stanzaRequestResult(const Jid &AStreamJid, const Stanza &AStan
 	if (FVCardRequestId.contains(AStanza.id()))
 	{
 		Jid fromJid = FVCardRequestId.take(AStanza.id());
+		VCardFetch fetch = FFetches.take(fromJid);
 		QDomElement elem = AStanza.firstElement(VCARD_TAGNAME,NS_VCARD_TEMP);
 		if (AStanza.type() == "result")
 		{
 			LOG_STRM_INFO(AStreamJid,QString("User vCard loaded, jid=%1, id=%2").arg(fromJid.full(),AStanza.id()));
-			FSearchStrings.remove(fromJid);
+			finishFetchRequest(fetch,true);
 			saveVCardFile(fromJid,elem);
 			emit vcardReceived(fromJid);
 		}
 		else
 		{
 			XmppStanzaError err(AStanza);
-			LOG_STRM_WARNING(AStreamJid,QString("Failed to load user vCard, jid=%1, id=%2: %3").arg(fromJid.full(),AStanza.id(),err.condition()));
-			FSearchStrings.remove(fromJid);
-			saveVCardFile(fromJid,QDomElement());
-			emit vcardError(fromJid,err);
+			IXmppStream *xmppStream = FXmppStreams!=NULL ? FXmppStreams->xmppStream(AStreamJid) : NULL;
+			// Unreachable remote domain is not a load of own server and will not answer on retry either
+			bool remoteFailed = fromJid.pDomain()!=AStreamJid.pDomain() && (err.conditionCode()==XmppStanzaError::EC_REMOTE_SERVER_TIMEOUT || err.conditionCode()==XmppStanzaError::EC_REMOTE_SERVER_NOT_FOUND);
+			bool overloaded = !remoteFailed && xmppStream!=NULL && xmppStream->isOpen() && (err.errorTypeCode()==XmppStanzaError::ET_WAIT 
+				|| err.conditionCode()==XmppStanzaError::EC_REMOTE_SERVER_TIMEOUT || err.conditionCode()==XmppStanzaError::EC_RESOURCE_CONSTRAINT);
+			finishFetchRequest(fetch,!overloaded);
+			if (overloaded && fetch.attempts<FETCH_MAX_ATTEMPTS)
+			{
+				fetch.attempts++;
+				fetch.queued = FFetchClock.elapsed();
+				fetch.notBefore = fetch.queued + FETCH_RETRY_DELAY*(1<<(fetch.attempts-1));
+				FFetches.insert(fromJid,fetch);
+				FFetchQueue.append(fromJid);
+				FFetchCounters.retried++;
+				LOG_STRM_WARNING(AStreamJid,QString("Failed to load user vCard, jid=%1, id=%2: %3, retrying in %4 ms").arg(fromJid.full(),AStanza.id(),err.condition()).arg(fetch.notBefore-fetch.queued));
+			}
+			else
+			{
+				FFetchCounters.failed++;
+				LOG_STRM_WARNING(AStreamJid,QString("Failed to load user vCard, jid=%1, id=%2: %3").arg(fromJid.full(),AStanza.id(),err.condition()));
+				saveVCardFile(fromJid,QDomElement());
+				emit vcardError(fromJid,err);
+			}
 		}
+		FFetchTimer.start(0);
 	}
 	else if (FVCardPublishId.contains(AStanza.id()))
 	{
@@ -326,7 +367,6 @@ void VCardPlugin::stanzaRequestResult(const Jid &AStreamJid, const Stanza &AStan
 		if (AStanza.type() == "result")
 		{
 			LOG_STRM_INFO(AStreamJid,QString("Self vCard published, id=%1").arg(AStanza.id()));
-			FSearchStrings.remove(streamJid);
 			saveVCardFile(streamJid,stanza.element().firstChildElement(VCARD_TAGNAME));
 			emit vcardPublished(streamJid);
 		}
@@ -360,14 +400,9 @@ bool VCardPlugin::xmppUriOpen(const Jid &AStreamJid, const Jid &AContactJid, con
 	return false;
 }
 
-QString VCardPlugin::vcardFileName(const Jid &AContactJid) const
-{
-	return FVCardFilesDir.absoluteFilePath(Jid::encode(AContactJid.pFull())+".xml");
-}
-
 bool VCardPlugin::hasVCard(const Jid &AContactJid) const
 {
-	return QFile::exists(vcardFileName(AContactJid));
+	return FVCardStore->contains(AContactJid);
 }
 
 IVCard *VCardPlugin::getVCard(const Jid &AContactJid)
@@ -381,30 +416,41 @@ IVCard *VCardPlugin::getVCard(const Jid &AContactJid)
 
 bool VCardPlugin::requestVCard(const Jid &AStreamJid, const Jid &AContactJid)
 {
-	if (FStanzaProcessor)
+	IXmppStream *xmppStream = FXmppStreams!=NULL ? FXmppStreams->xmppStream(AStreamJid) : NULL;
+	if (FXmppStreams!=NULL && (xmppStream==NULL || !xmppStream->isOpen()))
+	{
+		LOG_STRM_WARNING(AStreamJid,QString("Failed to request user vCard, jid=%1: Stream is not opened").arg(AContactJid.full()));
+	}
+	else if (FStanzaProcessor && AContactJid.isValid())
 	{
-		if (FVCardRequestId.key(AContactJid).isEmpty())
+		// Requests for the same contact from several accounts are merged into one
+		VCardFetch &fetch = FFetches[AContactJid];
+		if (fetch.streams.isEmpty())
 		{
-			Stanza stanza("iq");
-			stanza.setTo(AContactJid.full()).setType("get").setId(FStanzaProcessor->newId());
-			stanza.addElement(VCARD_TAGNAME,NS_VCARD_TEMP);
-			if (FStanzaProcessor->sendStanzaRequest(this,AStreamJid,stanza,VCARD_TIMEOUT))
-			{
-				LOG_STRM_INFO(AStreamJid,QString("User vCard load request sent to=%1, id=%2").arg(stanza.to(),stanza.id()));
-				FVCardRequestId.insert(stanza.id(),AContactJid);
-				return true;
-			}
-			else
-			{
-				LOG_STRM_WARNING(AStreamJid,QString("Failed to send user vCard load request to=%1").arg(stanza.to()));
-			}
-			return false;
+			fetch.contactJid = AContactJid;
+			fetch.queued = FFetchClock.elapsed();
+			FFetchQueue.append(AContactJid);
+			LOG_STRM_DEBUG(AStreamJid,QString("User vCard load request queued, jid=%1").arg(AContactJid.full()));
 		}
+		if (!fetch.streams.contains(AStreamJid))
+			fetch.streams.append(AStreamJid);
+		FFetchTimer.start(0);
 		return true;
 	}
 	return false;
 }
 
+IVCardFetchCounters VCardPlugin::vcardFetchCounters() const
+{
+	IVCardFetchCounters counters = FFetchCounters;
+	counters.queued = FFetchQueue.count();
+	counters.inFlight = FVCardRequestId.count();
+	counters.window = FFetchWindow;
+	counters.waitAvg = counters.sent>0 ? FFetchWaitSum/counters.sent : 0;
+	counters.latencyAvg = FFetchReplies>0 ? FFetchLatencySum/FFetchReplies : 0;
+	return counters;
+}
+
 bool VCardPlugin::publishVCard(IVCard *AVCard, const Jid &AStreamJid)
 {
 	if (FStanzaProcessor && AVCard->isValid() && FVCardPublishId.key(AStreamJid.pBare()).isEmpty())
@@ -503,6 +549,11 @@ void VCardPlugin::restrictVCardImagesSize(IVCard *AVCard)
 	}
 }
 
+QByteArray VCardPlugin::loadVCardData(const Jid &AContactJid) const
+{
+	return FVCardStore->loadVCard(AContactJid);
+}
+
 void VCardPlugin::saveVCardFile(const Jid &AContactJid,const QDomElement &AElem) const
 {
 	if (AContactJid.isValid())
@@ -512,31 +563,18 @@ void VCardPlugin::saveVCardFile(const Jid &AContactJid,const QDomElement &AElem)
 		rootElem.setAttribute("jid",AContactJid.full());
 		rootElem.setAttribute("dateTime",QDateTime::currentDateTime().toString(Qt::ISODate));
 
-		QFile file(vcardFileName(AContactJid));
-		if (!AElem.isNull() && file.open(QIODevice::WriteOnly|QIODevice::Truncate))
+		if (!AElem.isNull())
 		{
 			rootElem.appendChild(AElem.cloneNode(true));
-			file.write(doc.toByteArray());
-			file.flush();
-		}
-		else if (AElem.isNull() && !file.exists() && file.open(QIODevice::WriteOnly|QIODevice::Truncate))
-		{
-			file.write(doc.toByteArray());
-			file.flush();
+			FVCardStore->saveVCard(AContactJid,doc.toByteArray());
 		}
-		else if (AElem.isNull() && file.exists() && file.open(QIODevice::ReadWrite))
+		else if (!FVCardStore->contains(AContactJid))
 		{
-			char data;
-			if (file.getChar(&data))
-			{
-				file.seek(0);
-				file.putChar(data);
-			}
-			file.flush();
+			FVCardStore->saveVCard(AContactJid,doc.toByteArray());
 		}
 		else
 		{
-			REPORT_ERROR(QString("Failed to save vCard to file: %1").arg(file.errorString()));
+			FVCardStore->touchVCard(AContactJid);
 		}
 	}
 	else
@@ -592,6 +630,97 @@ QList<Action *> VCardPlugin::createClipboardActions(const QSet<QString> &AString
 	return actions;
 }
 
+QSet<Jid> VCardPlugin::urgentFetchContacts() const
+{
+	QSet<Jid> contacts;
+	foreach(const Jid &contactJid, FVCardDialogs.keys())
+		contacts += contactJid;
+
+	if (FXmppStreams)
+	{
+		foreach(IXmppStream *xmppStream, FXmppStreams->xmppStreams())
+			contacts += xmppStream->streamJid().bare();
+	}
+
+	if (FMessageWidgets)
+	{
+		foreach(IMessageChatWindow *window, FMessageWidgets->chatWindows())
+		{
+			contacts += window->contactJid();
+			contacts += window->contactJid().bare();
+		}
+	}
+
+	if (FRostersView && FRostersView->instance()->isVisible())
+	{
+		QTreeView *view = FRostersView->instance();
+		int viewHeight = view->viewport()->height();
+		QModelIndex index = view->indexAt(QPoint(0,0));
+		while (index.isValid() && view->visualRect(index).top()<viewHeight)
+		{
+			QString bareJid = index.data(RDR_PREP_BARE_JID).toString();
+			if (!bareJid.isEmpty())
+				contacts += bareJid;
+			index = view->indexBelow(index);
+		}
+	}
+
+	return contacts;
+}
+
+bool VCardPlugin::sendFetchRequest(VCardFetch &AFetch)
+{
+	while (!AFetch.streams.isEmpty())
+	{
+		Jid streamJid = AFetch.streams.first();
+		IXmppStream *xmppStream = FXmppStreams!=NULL ? FXmppStreams->xmppStream(streamJid) : NULL;
+		if (FXmppStreams==NULL || (xmppStream!=NULL && xmppStream->isOpen()))
+		{
+			Stanza stanza("iq");
+			stanza.setTo(AFetch.contactJid.full()).setType("get").setId(FStanzaProcessor->newId());
+			stanza.addElement(VCARD_TAGNAME,NS_VCARD_TEMP);
+			if (FStanzaProcessor->sendStanzaRequest(this,streamJid,stanza,VCARD_TIMEOUT))
+			{
+				LOG_STRM_INFO(streamJid,QString("User vCard load request sent to=%1, id=%2").arg(stanza.to(),stanza.id()));
+				AFetch.sent = FFetchClock.elapsed();
+				FFetchWaitSum += AFetch.sent-AFetch.queued;
+				FFetchCounters.sent++;
+				FVCardRequestId.insert(stanza.id(),AFetch.contactJid);
+				return true;
+			}
+			else
+			{
+				LOG_STRM_WARNING(streamJid,QString("Failed to send user vCard load request to=%1").arg(stanza.to()));
+			}
+		}
+		AFetch.streams.removeFirst();
+	}
+	return false;
+}
+
+void VCardPlugin::finishFetchRequest(const VCardFetch &AFetch, bool ASucceeded)
+{
+	qint64 latency = FFetchClock.elapsed()-AFetch.sent;
+	FFetchReplies++;
+	FFetchLatencySum += latency;
+	FFetchCounters.latencyMax = qMax(FFetchCounters.latencyMax,latency);
+
+	// Additive increase while the server keeps up, multiplicative decrease when it asks to wait
+	int window = ASucceeded ? qMin(FFetchWindow+1,FETCH_WINDOW_MAX) : qMax(FFetchWindow/2,FETCH_WINDOW_MIN);
+	if (window != FFetchWindow)
+	{
+		LOG_DEBUG(QString("User vCard fetch window changed, window=%1").arg(window));
+		FFetchWindow = window;
+	}
+
+	if (FFetchQueue.isEmpty() && FVCardRequestId.isEmpty())
+	{
+		IVCardFetchCounters counters = vcardFetchCounters();
+		LOG_DEBUG(QString("User vCard fetch queue drained, sent=%1, retried=%2, failed=%3, avg-wait=%4, avg-latency=%5, max-latency=%6")
+			.arg(counters.sent).arg(counters.retried).arg(counters.failed).arg(counters.waitAvg).arg(counters.latencyAvg).arg(counters.latencyMax));
+	}
+}
+
 void VCardPlugin::onCopyToClipboardActionTriggered(bool)
 {
 	Action *action = qobject_cast<Action *>(sender());
@@ -753,13 +882,65 @@ void VCardPlugin::onUpdateTimerTimeout()
 	QMultiMap<Jid,Jid>::iterator it=FUpdateQueue.begin();
 	while(!requestSent && it!=FUpdateQueue.end())
 	{
-		QFileInfo info(vcardFileName(it.value()));
-		if (!info.exists() || info.lastModified().daysTo(QDateTime::currentDateTime())>UPDATE_VCARD_DAYS)
+		QDateTime updated = FVCardStore->updateDateTime(it.value());
+		if (!updated.isValid() || updated.daysTo(QDateTime::currentDateTime())>UPDATE_VCARD_DAYS)
 			requestSent = requestVCard(it.key(),it.value());
 		it = FUpdateQueue.erase(it);
 	}
 }
 
+void VCardPlugin::onFetchTimerTimeout()
+{
+	QSet<Jid> urgent;
+	bool urgentLoaded = false;
+
+	qint64 curTime = FFetchClock.elapsed();
+	qint64 nextRetry = -1;
+	while (FVCardRequestId.count()<FFetchWindow && !FFetchQueue.isEmpty())
+	{
+		if (!urgentLoaded)
+		{
+			urgent = urgentFetchContacts();
+			urgentLoaded = true;
+		}
+
+		// Contacts visible to the user go first, the rest are sent in the order of requests
+		int selected = -1;
+		for (int i=0; i<FFetchQueue.count(); i++)
+		{
+			const VCardFetch &fetch = FFetches[FFetchQueue.at(i)];
+			if (fetch.notBefore > curTime)
+			{
+				nextRetry = nextRetry<0 ? fetch.notBefore : qMin(nextRetry,fetch.notBefore);
+			}
+			else if (urgent.contains(fetch.contactJid))
+			{
+				selected = i;
+				break;
+			}
+			else if (selected < 0)
+			{
+				selected = i;
+			}
+		}
+		if (selected < 0)
+			break;
+
+		Jid contactJid = FFetchQueue.takeAt(selected);
+		if (!sendFetchRequest(FFetches[contactJid]))
+		{
+			// All requesting streams were closed while the fetch was queued
+			FFetches.remove(contactJid);
+			FFetchCounters.failed++;
+			LOG_WARNING(QString("Failed to load user vCard, jid=%1: No opened streams left").arg(contactJid.full()));
+			emit vcardError(contactJid,XmppStanzaError(XmppStanzaError::EC_SERVICE_UNAVAILABLE));
+		}
+	}
+
+	if (nextRetry>=0 && FVCardRequestId.count()<FFetchWindow)
+		FFetchTimer.start(qMax(nextRetry-curTime,(qint64)0));
+}
+
 void VCardPlugin::onRosterOpened(IRoster *ARoster)
 {
 	IRosterItem emptyItem;
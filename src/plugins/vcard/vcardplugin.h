@@ -3,6 +3,7 @@
 
 #include <QDir>
 #include <QTimer>
+#include <QElapsedTimer>
 #include <QObjectCleanupHandler>
 #include <interfaces/ipluginmanager.h>
 #include <interfaces/ivcard.h>
@@ -19,6 +20,7 @@
 #include <interfaces/ioptionsmanager.h>
 #include "vcard.h"
 #include "vcarddialog.h"
+#include "vcardstore.h"
 
 struct VCardItem {
 	VCardItem() {
@@ -29,6 +31,21 @@ struct VCardItem {
 	int locks;
 };
 
+struct VCardFetch {
+	VCardFetch() {
+		attempts = 0;
+		queued = 0;
+		sent = 0;
+		notBefore = 0;
+	}
+	Jid contactJid;
+	QList<Jid> streams;
+	int attempts;
+	qint64 queued;
+	qint64 sent;
+	qint64 notBefore;
+};
+
 class VCardPlugin :
 	public QObject,
 	public IPlugin,
@@ -63,10 +80,10 @@ public:
 	//IXmppUriHandler
 	virtual bool xmppUriOpen(const Jid &AStreamJid, const Jid &AContactJid, const QString &AAction, const QMultiMap<QString, QString> &AParams);
 	//IVCardPlugin
-	virtual QString vcardFileName(const Jid &AContactJid) const;
 	virtual bool hasVCard(const Jid &AContactJid) const;
 	virtual IVCard *getVCard(const Jid &AContactJid);
 	virtual bool requestVCard(const Jid &AStreamJid, const Jid &AContactJid);
+	virtual IVCardFetchCounters vcardFetchCounters() const;
 	virtual bool publishVCard(IVCard *AVCard, const Jid &AStreamJid);
 	virtual void showVCardDialog(const Jid &AStreamJid, const Jid &AContactJid);
 signals:
@@ -79,10 +96,15 @@ protected:
 	void registerDiscoFeatures();
 	void unlockVCard(const Jid &AContactJid);
 	void restrictVCardImagesSize(IVCard *AVCard);
+	QByteArray loadVCardData(const Jid &AContactJid) const;
 	void saveVCardFile(const Jid &AContactJid, const QDomElement &AElem) const;
 	void removeEmptyChildElements(QDomElement &AElem) const;
 	void insertMessageToolBarAction(IMessageToolBarWidget *AWidget);
 	QList<Action *> createClipboardActions(const QSet<QString> &AStrings, QObject *AParent) const;
+protected:
+	QSet<Jid> urgentFetchContacts() const;
+	bool sendFetchRequest(VCardFetch &AFetch);
+	void finishFetchRequest(const VCardFetch &AFetch, bool ASucceeded);
 protected slots:
 	void onCopyToClipboardActionTriggered(bool);
 	void onShortcutActivated(const QString &AId, QWidget *AWidget);
@@ -97,6 +119,7 @@ protected slots:
 	void onMessageChatWindowCreated(IMessageChatWindow *AWindow);
 protected slots:
 	void onUpdateTimerTimeout();
+	void onFetchTimerTimeout();
 	void onRosterOpened(IRoster *ARoster);
 	void onRosterClosed(IRoster *ARoster);
 	void onRosterItemReceived(IRoster *ARoster, const IRosterItem &AItem, const IRosterItem &ABefore);
@@ -116,6 +139,7 @@ private:
 	IOptionsManager *FOptionsManager;
 private:
 	QDir FVCardFilesDir;
+	VCardStore *FVCardStore;
 	QTimer FUpdateTimer;
 	QMap<Jid,VCardItem> FVCards;
 	QMultiMap<Jid,Jid> FUpdateQueue;
@@ -123,7 +147,16 @@ private:
 	QMap<QString,Jid> FVCardPublishId;
 	QMap<QString,Stanza> FVCardPublishStanza;
 	QMap<Jid,VCardDialog *> FVCardDialogs;
-	mutable QHash<Jid,QStringList> FSearchStrings;
+private:
+	int FFetchWindow;
+	QTimer FFetchTimer;
+	QElapsedTimer FFetchClock;
+	QList<Jid> FFetchQueue;
+	QHash<Jid,VCardFetch> FFetches;
+	IVCardFetchCounters FFetchCounters;
+	qint64 FFetchWaitSum;
+	qint64 FFetchLatencySum;
+	quint32 FFetchReplies;
 };
 
 #endif // VCARDPLUGIN_H
@@ -0,0 +1,300 @@
+#include "vcardstore.h"
+
+#include <QDataStream>
+#include <QDomDocument>
+#include <utils/logger.h>
+
+#define DATA_FILE_NAME            "vcards.dat"
+#define INDEX_FILE_NAME           "vcards.idx"
+
+#define INDEX_MAGIC               0x56434958
+#define INDEX_VERSION             1
+#define RECORD_MAGIC              0x56435244
+
+#define COMPACT_MIN_DEAD_SIZE     1048576
+
+VCardStore::VCardStore(QObject *AParent) : QObject(AParent)
+{
+	FDeadSize = 0;
+}
+
+VCardStore::~VCardStore()
+{
+	close();
+}
+
+bool VCardStore::isOpen() const
+{
+	return FData.isOpen();
+}
+
+bool VCardStore::open(const QDir &ADir)
+{
+	close();
+
+	FDir = ADir;
+	FData.setFileName(FDir.absoluteFilePath(DATA_FILE_NAME));
+	if (FData.open(QIODevice::ReadWrite))
+	{
+		if (!loadIndex())
+		{
+			LOG_INFO(QString("Rebuilding vCard store index, data size=%1").arg(FData.size()));
+			scanData();
+		}
+		LOG_INFO(QString("vCard store opened, items=%1, data size=%2").arg(FItems.count()).arg(FData.size()));
+		return true;
+	}
+	else
+	{
+		REPORT_ERROR(QString("Failed to open vCard store: %1").arg(FData.errorString()));
+	}
+	return false;
+}
+
+void VCardStore::close()
+{
+	if (FData.isOpen())
+	{
+		if (FDeadSize>COMPACT_MIN_DEAD_SIZE && FDeadSize>FData.size()/2)
+			compactData();
+		saveIndex();
+		FData.close();
+	}
+	FItems.clear();
+	FDeadSize = 0;
+}
+
+bool VCardStore::contains(const Jid &AContactJid) const
+{
+	return FItems.contains(AContactJid);
+}
+
+QDateTime VCardStore::updateDateTime(const Jid &AContactJid) const
+{
+	return FItems.value(AContactJid).updated;
+}
+
+QByteArray VCardStore::loadVCard(const Jid &AContactJid)
+{
+	QHash<Jid, VCardStoreItem>::const_iterator it = FItems.constFind(AContactJid);
+	if (it!=FItems.constEnd() && FData.seek(it->offset))
+	{
+		QDataStream stream(&FData);
+		stream.setVersion(QDataStream::Qt_4_6);
+
+		quint32 magic;
+		QString contactJid;
+		QDateTime updated;
+		QByteArray data;
+		stream >> magic >> contactJid >> updated >> data;
+		if (stream.status()==QDataStream::Ok && magic==RECORD_MAGIC)
+			return qUncompress(data);
+		REPORT_ERROR("Failed to load vCard from store: Invalid record");
+	}
+	return QByteArray();
+}
+
+bool VCardStore::saveVCard(const Jid &AContactJid, const QByteArray &AData)
+{
+	if (FData.isOpen() && FData.seek(FData.size()))
+	{
+		VCardStoreItem &item = FItems[AContactJid];
+		FDeadSize += item.size;
+
+		item.offset = FData.pos();
+		item.updated = QDateTime::currentDateTime();
+		item.hasSearch = false;
+		item.search.clear();
+
+		QDataStream stream(&FData);
+		stream.setVersion(QDataStream::Qt_4_6);
+		stream << (quint32)RECORD_MAGIC << AContactJid.full() << item.updated << qCompress(AData);
+		FData.flush();
+
+		item.size = FData.pos() - item.offset;
+		return stream.status()==QDataStream::Ok;
+	}
+	else if (FData.isOpen())
+	{
+		REPORT_ERROR(QString("Failed to save vCard to store: %1").arg(FData.errorString()));
+	}
+	return false;
+}
+
+void VCardStore::touchVCard(const Jid &AContactJid)
+{
+	QHash<Jid, VCardStoreItem>::iterator it = FItems.find(AContactJid);
+	if (it != FItems.end())
+		it->updated = QDateTime::currentDateTime();
+}
+
+bool VCardStore::hasSearchStrings(const Jid &AContactJid) const
+{
+	return FItems.value(AContactJid).hasSearch;
+}
+
+QStringList VCardStore::searchStrings(const Jid &AContactJid) const
+{
+	return FItems.value(AContactJid).search;
+}
+
+void VCardStore::setSearchStrings(const Jid &AContactJid, const QStringList &AStrings)
+{
+	QHash<Jid, VCardStoreItem>::iterator it = FItems.find(AContactJid);
+	if (it != FItems.end())
+	{
+		it->hasSearch = true;
+		it->search = AStrings;
+	}
+}
+
+int VCardStore::importVCardFiles(const QDir &ADir)
+{
+	int count = 0;
+	foreach(const QString &fileName, ADir.entryList(QStringList() << "*.xml", QDir::Files))
+	{
+		QFile file(ADir.absoluteFilePath(fileName));
+		if (file.open(QIODevice::ReadOnly))
+		{
+			QDomDocument doc;
+			QByteArray data = file.readAll();
+			if (doc.setContent(data,true))
+			{
+				Jid contactJid = doc.documentElement().attribute("jid");
+				if (contactJid.isValid() && !FItems.contains(contactJid) && saveVCard(contactJid,data))
+				{
+					FItems[contactJid].updated = QDateTime::fromString(doc.documentElement().attribute("dateTime"),Qt::ISODate);
+					count++;
+				}
+			}
+			file.close();
+		}
+		file.remove();
+	}
+	if (count > 0)
+	{
+		LOG_INFO(QString("vCard files imported to store, count=%1").arg(count));
+		saveIndex();
+	}
+	return count;
+}
+
+bool VCardStore::loadIndex()
+{
+	QFile file(FDir.absoluteFilePath(INDEX_FILE_NAME));
+	if (file.open(QIODevice::ReadOnly))
+	{
+		QDataStream stream(&file);
+		stream.setVersion(QDataStream::Qt_4_6);
+
+		quint32 magic, version, count;
+		qint64 dataSize, deadSize;
+		stream >> magic >> version >> dataSize >> deadSize >> count;
+		if (stream.status()==QDataStream::Ok && magic==INDEX_MAGIC && version==INDEX_VERSION && dataSize==FData.size())
+		{
+			FItems.reserve(count);
+			for (quint32 i=0; i<count && stream.status()==QDataStream::Ok; i++)
+			{
+				QString contactJid;
+				VCardStoreItem item;
+				stream >> contactJid >> item.offset >> item.size >> item.updated >> item.hasSearch >> item.search;
+				FItems.insert(contactJid,item);
+			}
+
+			if (stream.status() == QDataStream::Ok)
+			{
+				FDeadSize = deadSize;
+				return true;
+			}
+			FItems.clear();
+		}
+	}
+	return false;
+}
+
+void VCardStore::saveIndex() const
+{
+	QFile file(FDir.absoluteFilePath(INDEX_FILE_NAME));
+	if (file.open(QIODevice::WriteOnly|QIODevice::Truncate))
+	{
+		QDataStream stream(&file);
+		stream.setVersion(QDataStream::Qt_4_6);
+		stream << (quint32)INDEX_MAGIC << (quint32)INDEX_VERSION << FData.size() << FDeadSize << (quint32)FItems.count();
+		for (QHash<Jid, VCardStoreItem>::const_iterator it=FItems.constBegin(); it!=FItems.constEnd(); ++it)
+			stream << it.key().full() << it->offset << it->size << it->updated << it->hasSearch << it->search;
+		file.flush();
+	}
+	else
+	{
+		REPORT_ERROR(QString("Failed to save vCard store index: %1").arg(file.errorString()));
+	}
+}
+
+void VCardStore::scanData()
+{
+	FItems.clear();
+	FDeadSize = 0;
+
+	if (FData.seek(0))
+	{
+		QDataStream stream(&FData);
+		stream.setVersion(QDataStream::Qt_4_6);
+		while (!stream.atEnd())
+		{
+			quint32 magic;
+			QString contactJid;
+			QDateTime updated;
+			QByteArray data;
+
+			qint64 offset = FData.pos();
+			stream >> magic >> contactJid >> updated >> data;
+			if (stream.status()!=QDataStream::Ok || magic!=RECORD_MAGIC)
+			{
+				LOG_WARNING(QString("Truncating vCard store at invalid record, offset=%1").arg(offset));
+				FData.resize(offset);
+				break;
+			}
+
+			VCardStoreItem &item = FItems[contactJid];
+			FDeadSize += item.size;
+			item.offset = offset;
+			item.size = FData.pos() - offset;
+			item.updated = updated;
+		}
+	}
+}
+
+void VCardStore::compactData()
+{
+	QFile compact(FDir.absoluteFilePath(DATA_FILE_NAME ".new"));
+	if (compact.open(QIODevice::WriteOnly|QIODevice::Truncate))
+	{
+		QHash<Jid, VCardStoreItem> items = FItems;
+		for (QHash<Jid, VCardStoreItem>::iterator it=items.begin(); it!=items.end(); ++it)
+		{
+			if (FData.seek(it->offset))
+			{
+				qint64 offset = compact.pos();
+				compact.write(FData.read(it->size));
+				it->offset = offset;
+			}
+		}
+		compact.close();
+
+		FData.close();
+		if (QFile::remove(FData.fileName()) && compact.rename(FData.fileName()))
+		{
+			LOG_INFO(QString("vCard store compacted, removed size=%1").arg(FDeadSize));
+			FItems = items;
+			FDeadSize = 0;
+		}
+		else
+		{
+			REPORT_ERROR("Failed to compact vCard store: Data file not replaced");
+			FItems.clear();
+		}
+		FData.open(QIODevice::ReadWrite);
+		if (FItems.isEmpty())
+			scanData();
+	}
+}
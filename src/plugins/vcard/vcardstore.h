@@ -0,0 +1,55 @@
+#ifndef VCARDSTORE_H
+#define VCARDSTORE_H
+
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QDateTime>
+#include <QStringList>
+#include <utils/jid.h>
+
+struct VCardStoreItem {
+	VCardStoreItem() {
+		offset = -1;
+		size = 0;
+		hasSearch = false;
+	}
+	qint64 offset;
+	qint64 size;
+	QDateTime updated;
+	bool hasSearch;
+	QStringList search;
+};
+
+class VCardStore :
+	public QObject
+{
+	Q_OBJECT;
+public:
+	VCardStore(QObject *AParent);
+	~VCardStore();
+	bool isOpen() const;
+	bool open(const QDir &ADir);
+	void close();
+	bool contains(const Jid &AContactJid) const;
+	QDateTime updateDateTime(const Jid &AContactJid) const;
+	QByteArray loadVCard(const Jid &AContactJid);
+	bool saveVCard(const Jid &AContactJid, const QByteArray &AData);
+	void touchVCard(const Jid &AContactJid);
+	bool hasSearchStrings(const Jid &AContactJid) const;
+	QStringList searchStrings(const Jid &AContactJid) const;
+	void setSearchStrings(const Jid &AContactJid, const QStringList &AStrings);
+	int importVCardFiles(const QDir &ADir);
+protected:
+	bool loadIndex();
+	void saveIndex() const;
+	void scanData();
+	void compactData();
+private:
+	QDir FDir;
+	QFile FData;
+	qint64 FDeadSize;
+	QHash<Jid, VCardStoreItem> FItems;
+};
+
+#endif // VCARDSTORE_H
@@ -9,6 +9,30 @@
 #include <utils/options.h>
 #include <utils/logger.h>
 
+#define RESUME_RECONNECT_INTERVAL   5000
+
+static bool isSessionStanza(const Stanza &AStanza)
+{
+	QString tagName = AStanza.tagName();
+	return tagName=="message" || tagName=="presence" || tagName=="iq";
+}
+
+static bool isSessionFeature(const QString &AFeatureNS)
+{
+	return AFeatureNS==NS_FEATURE_IQAUTH || AFeatureNS==NS_FEATURE_BIND || AFeatureNS==NS_FEATURE_SESSION;
+}
+
+static Stanza makeDeliveryError(const Stanza &AStanza)
+{
+	Stanza error(AStanza);
+	error.detach();
+	error.setType("error").setFrom(AStanza.to()).setTo(QString::null);
+	QDomElement errElem = error.addElement("error");
+	errElem.setAttribute("type","wait");
+	errElem.appendChild(error.createElement("recipient-unavailable",NS_XMPP_STANZA_ERROR));
+	return error;
+}
+
 XmppStream::XmppStream(IXmppStreams *AXmppStreams, const Jid &AStreamJid) : QObject(AXmppStreams->instance())
 {
 	FXmppStreams = AXmppStreams;
@@ -22,6 +46,11 @@ XmppStream::XmppStream(IXmppStreams *AXmppStreams, const Jid &AStreamJid) : QObj
 	FStreamState = SS_OFFLINE;
 	FPasswordDialog = NULL;
 
+	FSuspended = false;
+	FResumeTimeout = 0;
+	FResumeBytesIn = 0;
+	FResumeBytesOut = 0;
+
 	FStreamJid = AStreamJid;
 	FOfflineJid = FStreamJid;
 
@@ -32,6 +61,12 @@ XmppStream::XmppStream(IXmppStreams *AXmppStreams, const Jid &AStreamJid) : QObj
 
 	FKeepAliveTimer.setSingleShot(false);
 	connect(&FKeepAliveTimer,SIGNAL(timeout()),SLOT(onKeepAliveTimeout()));
+
+	FResumeTimer.setSingleShot(true);
+	connect(&FResumeTimer,SIGNAL(timeout()),SLOT(onResumeTimeout()));
+
+	FReconnectTimer.setSingleShot(true);
+	connect(&FReconnectTimer,SIGNAL(timeout()),SLOT(onReconnectTimeout()));
 }
 
 XmppStream::~XmppStream()
@@ -82,7 +117,7 @@ bool XmppStream::xmppStanzaOut(IXmppStream *AXmppStream, Stanza &AStanza, int AO
 
 bool XmppStream::isOpen() const
 {
-	return FReady && !FClosed;
+	return FReady && (FSuspended || !FClosed);
 }
 
 bool XmppStream::isConnected() const
@@ -123,8 +158,14 @@ void XmppStream::close()
 	if (FConnection && FStreamState!=SS_OFFLINE && FStreamState!=SS_ERROR && FStreamState!=SS_DISCONNECTING)
 	{
 		LOG_STRM_INFO(streamJid(),"Closing XMPP stream");
+		bool disconnected = FStreamState==SS_SUSPENDED;
 		setStreamState(SS_DISCONNECTING);
-		if (FConnection->isOpen())
+		if (disconnected)
+		{
+			FClosed = true;
+			onConnectionDisconnected();
+		}
+		else if (FConnection->isOpen())
 		{
 			emit aboutToClose();
 			sendData("</stream:stream>");
@@ -147,6 +188,7 @@ void XmppStream::abort(const XmppError &AError)
 	{
 		LOG_STRM_WARNING(streamJid(),QString("Aborting XMPP stream: %1").arg(AError.condition()));
 
+		bool disconnected = FStreamState==SS_SUSPENDED;
 		if (FStreamState != SS_DISCONNECTING)
 		{
 			setStreamState(SS_ERROR);
@@ -155,7 +197,10 @@ void XmppStream::abort(const XmppError &AError)
 		}
 
 		FClosed = true;
-		FConnection->disconnectFromHost();
+		if (disconnected)
+			onConnectionDisconnected();
+		else
+			FConnection->disconnectFromHost();
 	}
 }
 
@@ -329,6 +374,7 @@ void XmppStream::setKeepAliveTimerActive(bool AActive)
 		{
 		case SS_OFFLINE:
 		case SS_CONNECTING:
+		case SS_SUSPENDED:
 			FKeepAliveTimer.stop();
 			break;
 		case SS_INITIALIZE:
@@ -352,7 +398,16 @@ void XmppStream::setKeepAliveTimerActive(bool AActive)
 
 qint64 XmppStream::sendStanza(Stanza &AStanza)
 {
-	if (FStreamState!=SS_OFFLINE && FStreamState!=SS_ERROR)
+	if (FSuspended && FStreamState!=SS_ERROR && FStreamState!=SS_DISCONNECTING && isSessionStanza(AStanza))
+	{
+		// Session stanzas wait for resumption, nonzas are used to negotiate it
+		Stanza stanza = AStanza;
+		stanza.detach();
+		FSuspendedStanzas.append(stanza);
+		LOG_STRM_DEBUG(streamJid(),QString("XMPP stream stanza deferred until resumption, queued=%1").arg(FSuspendedStanzas.count()));
+		return 0;
+	}
+	else if (FStreamState!=SS_OFFLINE && FStreamState!=SS_ERROR)
 	{
 		if (!FClosed && !processStanzaHandlers(AStanza,true))
 		{
@@ -386,6 +441,48 @@ qint64 XmppStream::sendStanza(Stanza &AStanza)
 	return -1;
 }
 
+bool XmppStream::isSuspended() const
+{
+	return FSuspended;
+}
+
+int XmppStream::resumeTimeout() const
+{
+	return FResumeTimeout;
+}
+
+void XmppStream::setResumeTimeout(int ATimeout)
+{
+	if (FResumeTimeout != ATimeout)
+	{
+		LOG_STRM_DEBUG(streamJid(),QString("XMPP stream resume timeout changed to=%1").arg(ATimeout));
+		FResumeTimeout = qMax(ATimeout,0);
+	}
+}
+
+bool XmppStream::completeResume()
+{
+	if (FSuspended && FStreamState==SS_FEATURES)
+	{
+		FSuspended = false;
+		FResumeTimer.stop();
+		FAvailFeatures.clear();
+
+		setStreamState(SS_ONLINE);
+		setKeepAliveTimerActive(true);
+		LOG_STRM_INFO(streamJid(),QString("XMPP stream resumed, time=%1 ms, sent=%2 bytes, received=%3 bytes").arg(FResumeTime.elapsed()).arg(FResumeBytesOut).arg(FResumeBytesIn));
+		emit resumed();
+
+		sendSuspendedStanzas();
+		return true;
+	}
+	else
+	{
+		LOG_STRM_WARNING(streamJid(),"Failed to complete XMPP stream resumption: Stream is not suspended");
+	}
+	return false;
+}
+
 void XmppStream::insertXmppDataHandler(int AOrder, IXmppDataHandler *AHandler)
 {
 	if (AHandler && !FDataHandlers.contains(AOrder, AHandler))
@@ -460,16 +557,25 @@ void XmppStream::processFeatures()
 		QDomElement featureElem = FServerFeatures.firstChildElement();
 		while (!featureElem.isNull() && featureElem.namespaceURI()!=featureNS)
 			featureElem = featureElem.nextSiblingElement();
-		started = featureElem.namespaceURI()==featureNS ? startFeature(featureNS, featureElem) : false;
+		if (featureElem.namespaceURI() == featureNS)
+		{
+			// New session is requested only if resumption was not started or was refused
+			if (FSuspended && isSessionFeature(featureNS))
+				startNewSession();
+			started = startFeature(featureNS, featureElem);
+		}
 	}
 	if (!started)
 	{
+		if (FSuspended)
+			startNewSession();
 		if (!isEncryptionRequired() || connection()->isEncrypted())
 		{
 			FReady = true;
 			setStreamState(SS_ONLINE);
 			LOG_STRM_INFO(streamJid(),"XMPP stream opened");
 			emit opened();
+			sendSuspendedStanzas();
 		}
 		else
 		{
@@ -519,6 +625,84 @@ bool XmppStream::startFeature(const QString &AFeatureNS, const QDomElement &AFea
 	return false;
 }
 
+bool XmppStream::suspendStream(const XmppError &AError)
+{
+	if (!FSuspended && FStreamState==SS_ONLINE && FResumeTimeout>0)
+	{
+		LOG_STRM_WARNING(streamJid(),QString("Suspending XMPP stream: %1").arg(AError.condition()));
+		FSuspended = true;
+		FSuspendError = AError;
+		FResumeTimer.start(FResumeTimeout);
+		emit suspended();
+		return true;
+	}
+	return false;
+}
+
+void XmppStream::finishSuspension()
+{
+	FSuspended = false;
+	FResumeTimer.stop();
+	FReconnectTimer.stop();
+}
+
+void XmppStream::startNewSession()
+{
+	LOG_STRM_WARNING(streamJid(),QString("Failed to resume XMPP stream, starting new session: %1").arg(FSuspendError.condition()));
+	finishSuspension();
+
+	// Presences and requests belong to the previous session, messages are sent again once the new one is opened
+	int dropped = 0;
+	for (QList<Stanza>::iterator it=FSuspendedStanzas.begin(); it!=FSuspendedStanzas.end(); )
+	{
+		if (it->tagName() != "message")
+		{
+			it = FSuspendedStanzas.erase(it);
+			dropped++;
+		}
+		else
+		{
+			++it;
+		}
+	}
+	if (dropped > 0)
+		LOG_STRM_WARNING(streamJid(),QString("Deferred stanzas of previous XMPP stream session dropped=%1").arg(dropped));
+
+	FReady = false;
+	emit error(FSuspendError);
+	emit closed();
+}
+
+void XmppStream::sendSuspendedStanzas()
+{
+	if (!FSuspendedStanzas.isEmpty())
+	{
+		LOG_STRM_INFO(streamJid(),QString("Sending deferred XMPP stream stanzas, count=%1").arg(FSuspendedStanzas.count()));
+		QList<Stanza> stanzas = FSuspendedStanzas;
+		FSuspendedStanzas.clear();
+		for (int i=0; i<stanzas.count(); i++)
+			sendStanza(stanzas[i]);
+	}
+}
+
+void XmppStream::bounceSuspendedStanzas()
+{
+	if (!FSuspendedStanzas.isEmpty())
+	{
+		LOG_STRM_WARNING(streamJid(),QString("Failed to send deferred XMPP stream stanzas, count=%1").arg(FSuspendedStanzas.count()));
+		QList<Stanza> stanzas = FSuspendedStanzas;
+		FSuspendedStanzas.clear();
+		foreach(const Stanza &stanza, stanzas)
+		{
+			if (stanza.tagName() == "message")
+			{
+				Stanza error = makeDeliveryError(stanza);
+				processStanzaHandlers(error,false);
+			}
+		}
+	}
+}
+
 bool XmppStream::processDataHandlers(QByteArray &AData, bool ADataOut)
 {
 	bool hooked = false;
@@ -578,6 +762,8 @@ qint64 XmppStream::sendData(QByteArray AData)
 	if (!processDataHandlers(AData,true))
 	{
 		setKeepAliveTimerActive(true);
+		if (FSuspended)
+			FResumeBytesOut += AData.size();
 		return FConnection->write(AData);
 	}
 	return 0;
@@ -585,7 +771,10 @@ qint64 XmppStream::sendData(QByteArray AData)
 
 QByteArray XmppStream::receiveData(qint64 ABytes)
 {
-	return FConnection->read(ABytes);
+	QByteArray data = FConnection->read(ABytes);
+	if (FSuspended)
+		FResumeBytesIn += data.size();
+	return data;
 }
 
 void XmppStream::onConnectionConnected()
@@ -611,21 +800,48 @@ void XmppStream::onConnectionReadyRead(qint64 ABytes)
 
 void XmppStream::onConnectionError(const XmppError &AError)
 {
-	abort(AError);
+	if (FSuspended && FStreamState!=SS_ERROR && FStreamState!=SS_DISCONNECTING)
+	{
+		LOG_STRM_WARNING(streamJid(),QString("Failed to reconnect suspended XMPP stream: %1").arg(AError.condition()));
+		FConnection->disconnectFromHost();
+	}
+	else if (suspendStream(AError))
+	{
+		FConnection->disconnectFromHost();
+	}
+	else
+	{
+		abort(AError);
+	}
 }
 
 void XmppStream::onConnectionDisconnected()
 {
-	if (FStreamState != SS_OFFLINE)
+	if (FStreamState!=SS_OFFLINE && (FSuspended || suspendStream(XmppError(IERR_XMPPSTREAM_CLOSED_UNEXPECTEDLY))) && FStreamState!=SS_ERROR && FStreamState!=SS_DISCONNECTING)
+	{
+		bool wasOnline = FStreamState==SS_ONLINE;
+		FClosed = true;
+		setStreamState(SS_SUSPENDED);
+		setKeepAliveTimerActive(false);
+		clearActiveFeatures();
+
+		LOG_STRM_INFO(streamJid(),"XMPP stream connection lost, waiting for resumption");
+		FReconnectTimer.start(wasOnline ? 0 : RESUME_RECONNECT_INTERVAL);
+	}
+	else if (FStreamState != SS_OFFLINE)
 	{
 		FReady = false;
 		FClosed = true;
 
+		if (FSuspended)
+			finishSuspension();
+
 		if (FStreamState != SS_DISCONNECTING)
 			abort(XmppError(IERR_XMPPSTREAM_CLOSED_UNEXPECTEDLY));
 
 		setStreamState(SS_OFFLINE);
 		setKeepAliveTimerActive(false);
+		bounceSuspendedStanzas();
 		removeXmppStanzaHandler(XSHO_XMPP_STREAM,this);
 
 		LOG_STRM_INFO(streamJid(),"XMPP stream closed");
@@ -700,8 +916,38 @@ void XmppStream::onKeepAliveTimeout()
 	static const QByteArray space(1,' ');
 	if (FStreamState == SS_DISCONNECTING)
 		FConnection->disconnectFromHost();
+	else if (FSuspended && FStreamState!=SS_ONLINE)
+		FConnection->disconnectFromHost();
 	else if (FStreamState != SS_ONLINE)
 		abort(XmppStreamError(XmppStreamError::EC_CONNECTION_TIMEOUT));
 	else
 		sendData(space);
 }
+
+void XmppStream::onReconnectTimeout()
+{
+	if (FSuspended && FStreamState==SS_SUSPENDED)
+	{
+		LOG_STRM_INFO(streamJid(),"Reconnecting suspended XMPP stream");
+		if (FConnection->connectToHost())
+		{
+			FResumeTime.start();
+			FResumeBytesIn = 0;
+			FResumeBytesOut = 0;
+			setStreamState(SS_CONNECTING);
+		}
+		else
+		{
+			FReconnectTimer.start(RESUME_RECONNECT_INTERVAL);
+		}
+	}
+}
+
+void XmppStream::onResumeTimeout()
+{
+	if (FSuspended)
+	{
+		LOG_STRM_WARNING(streamJid(),"Failed to resume XMPP stream: Resume timeout");
+		abort(FSuspendError);
+	}
+}
@@ -1,6 +1,7 @@
 #ifndef XMPPSTREAM_H
 #define XMPPSTREAM_H
 
+#include <QTime>
 #include <QTimer>
 #include <QMutex>
 #include <QMultiMap>
@@ -17,7 +18,8 @@ enum StreamState {
 	SS_FEATURES,
 	SS_ONLINE,
 	SS_DISCONNECTING,
-	SS_ERROR
+	SS_ERROR,
+	SS_SUSPENDED
 };
 
 class XmppStream :
@@ -56,6 +58,10 @@ public:
 	virtual bool isKeepAliveTimerActive() const;
 	virtual void setKeepAliveTimerActive(bool AActive);
 	virtual qint64 sendStanza(Stanza &AStanza);
+	virtual bool isSuspended() const;
+	virtual int resumeTimeout() const;
+	virtual void setResumeTimeout(int ATimeout);
+	virtual bool completeResume();
 	virtual void insertXmppDataHandler(int AOrder, IXmppDataHandler *AHandler);
 	virtual void removeXmppDataHandler(int AOrder, IXmppDataHandler *AHandler);
 	virtual void insertXmppStanzaHandler(int AOrder, IXmppStanzaHadler *AHandler);
@@ -65,6 +71,8 @@ signals:
 	void aboutToClose();
 	void closed();
 	void error(const XmppError &AError);
+	void suspended();
+	void resumed();
 	void jidAboutToBeChanged(const Jid &AAfter);
 	void jidChanged(const Jid &ABefore);
 	void connectionChanged(IConnection *AConnection);
@@ -79,6 +87,11 @@ protected:
 	void clearActiveFeatures();
 	void setStreamState(StreamState AState);
 	bool startFeature(const QString &AFeatureNS, const QDomElement &AFeatureElem);
+	bool suspendStream(const XmppError &AError);
+	void finishSuspension();
+	void startNewSession();
+	void sendSuspendedStanzas();
+	void bounceSuspendedStanzas();
 	bool processDataHandlers(QByteArray &AData, bool ADataOut);
 	bool processStanzaHandlers(Stanza &AStanza, bool AStanzaOut);
 	qint64 sendData(QByteArray AData);
@@ -100,6 +113,9 @@ protected slots:
 	void onFeatureDestroyed();
 	//KeepAlive
 	void onKeepAliveTimeout();
+	//Resume
+	void onReconnectTimeout();
+	void onResumeTimeout();
 private:
 	IConnection *FConnection;
 	IXmppStreams *FXmppStreams;
@@ -119,6 +135,16 @@ private:
 	StreamParser FParser;
 	QTimer FKeepAliveTimer;
 	StreamState FStreamState;
+private:
+	bool FSuspended;
+	int FResumeTimeout;
+	XmppError FSuspendError;
+	QTime FResumeTime;
+	qint64 FResumeBytesIn;
+	qint64 FResumeBytesOut;
+	QTimer FResumeTimer;
+	QTimer FReconnectTimer;
+	QList<Stanza> FSuspendedStanzas;
 private:
 	QMutex FPasswordMutex;
 	QString FSessionPassword;
@@ -20,6 +20,10 @@ static const int BlinkStepsCount = sizeof(BlinkHideSteps)/sizeof(BlinkHideSteps[
 static const int BlinkStepsTime = 1000;
 #define BLINK_STEP ((QDateTime::currentMSecsSinceEpoch() % BlinkStepsTime) * BlinkStepsCount / BlinkStepsTime)
 
+static const int LayoutCacheSize = 256;
+static const int SizeHintCacheSize = 10000;
+static const quint64 LayoutKeySeed = Q_UINT64_C(14695981039346656037);
+
 const quint32 AdvancedDelegateItem::NullId        = 0;
 const quint32 AdvancedDelegateItem::BranchId      = AdvancedDelegateItem::makeId(AdvancedDelegateItem::MiddleLeft,128,10);
 const quint32 AdvancedDelegateItem::CheckStateId  = AdvancedDelegateItem::makeId(AdvancedDelegateItem::MiddleLeft,128,100);
@@ -68,6 +72,47 @@ QString getSingleLineText(const QString &AText)
 	return text.trimmed();
 }
 
+quint64 combineLayoutKey(quint64 AKey, uint AValue)
+{
+	return (AKey ^ AValue) * Q_UINT64_C(1099511628211);
+}
+
+quint64 combineLayoutKey(quint64 AKey, const void *APointer)
+{
+	return combineLayoutKey(AKey,qHash((quint64)(quintptr)APointer));
+}
+
+uint variantLayoutHash(const QVariant &AValue)
+{
+	switch (AValue.type())
+	{
+	case QVariant::Invalid:
+		return 0;
+	case QVariant::Pixmap:
+		return qHash(qvariant_cast<QPixmap>(AValue).cacheKey());
+	case QVariant::Image:
+		return qHash(qvariant_cast<QImage>(AValue).cacheKey());
+	case QVariant::Icon:
+		return qHash(qvariant_cast<QIcon>(AValue).cacheKey());
+	case QVariant::Color:
+		return qvariant_cast<QColor>(AValue).rgba();
+	case QVariant::Brush:
+		{
+			QBrush brush = qvariant_cast<QBrush>(AValue);
+			return brush.color().rgba() ^ ((uint)brush.style() << 24);
+		}
+	case QVariant::Size:
+		{
+			QSize size = AValue.toSize();
+			return ((uint)size.width() << 16) ^ (uint)size.height();
+		}
+	default:
+		if (AValue.canConvert<QString>())
+			return qHash(AValue.toString()) ^ AValue.userType();
+		return AValue.userType();
+	}
+}
+
 /*********************
  AdvancedDelegateItem
 **********************/
@@ -401,6 +446,11 @@ bool AdvancedDelegateEditProxy::updateEditorGeometry(const AdvancedItemDelegate
 **********************/
 struct AdvancedItemDelegate::ItemsLayout
 {
+	~ItemsLayout()
+	{
+		destroyLayoutRecursive(mainLayout);
+	}
+	quint64 cacheKey;
 	QBoxLayout *mainLayout;
 	QBoxLayout *middleLayout;
 	QStyleOptionViewItemV4 indexOption;
@@ -421,6 +471,8 @@ AdvancedItemDelegate::AdvancedItemDelegate(QObject *AParent) : QStyledItemDelega
 	FEditProxy = NULL;
 	FEditRole = Qt::EditRole;
 	FEditItemId = AdvancedDelegateItem::NullId;
+
+	FLayoutCache.setMaxCost(LayoutCacheSize);
 	
 	FBlinkOpacity = 1.0;
 	FBlinkMode = BlinkHide;
@@ -443,6 +495,7 @@ int AdvancedItemDelegate::itemsRole() const
 void AdvancedItemDelegate::setItemsRole(int ARole)
 {
 	FItemsRole = ARole;
+	clearLayoutCache();
 }
 
 int AdvancedItemDelegate::verticalSpacing() const
@@ -453,6 +506,7 @@ int AdvancedItemDelegate::verticalSpacing() const
 void AdvancedItemDelegate::setVertialSpacing(int ASpacing)
 {
 	FVerticalSpacing = ASpacing;
+	clearLayoutCache();
 }
 
 int AdvancedItemDelegate::horizontalSpacing() const
@@ -463,6 +517,7 @@ int AdvancedItemDelegate::horizontalSpacing() const
 void AdvancedItemDelegate::setHorizontalSpacing(int ASpacing)
 {
 	FHorizontalSpacing = ASpacing;
+	clearLayoutCache();
 }
 
 bool AdvancedItemDelegate::focusRectVisible() const
@@ -483,6 +538,7 @@ bool AdvancedItemDelegate::defaultBranchItemEnabled() const
 void AdvancedItemDelegate::setDefaultBranchItemEnabled(bool AEnabled)
 {
 	FDefaultBranchEnabled = AEnabled;
+	clearLayoutCache();
 }
 
 QMargins AdvancedItemDelegate::contentsMargins() const
@@ -493,6 +549,7 @@ QMargins AdvancedItemDelegate::contentsMargins() const
 void AdvancedItemDelegate::setContentsMargings(const QMargins &AMargins)
 {
 	FMargins = AMargins;
+	clearLayoutCache();
 }
 
 AdvancedItemDelegate::BlinkMode AdvancedItemDelegate::blinkMode() const
@@ -559,11 +616,13 @@ void AdvancedItemDelegate::paint(QPainter *APainter, const QStyleOptionViewItem
 
 	drawBackground(APainter,indexOption);
 
-	ItemsLayout *layout = createItemsLayout(getIndexItems(AIndex,indexOption),indexOption);
-	layout->mainLayout->setGeometry(indexOption.rect.adjusted(FMargins.left(),FMargins.top(),-FMargins.right(),-FMargins.bottom()));
+	ItemsLayout *layout = cachedItemsLayout(getIndexItems(AIndex,indexOption),indexOption);
+	QRect geometry = indexOption.rect.adjusted(FMargins.left(),FMargins.top(),-FMargins.right(),-FMargins.bottom());
+	if (layout->mainLayout->geometry() != geometry)
+		layout->mainLayout->setGeometry(geometry);
 	for (QMap<int, AdvancedDelegateLayoutItem *>::const_iterator it=layout->items.constBegin(); it!=layout->items.constEnd(); ++it)
 		it.value()->drawItem(APainter);
-	destroyItemsLayout(layout);
+	releaseItemsLayout(layout);
 
 	drawFocusRect(APainter,indexOption,indexOption.rect);
 
@@ -577,10 +636,24 @@ QSize AdvancedItemDelegate::sizeHint(const QStyleOptionViewItem &AOption, const
 		return qvariant_cast<QSize>(hint);
 
 	QStyleOptionViewItemV4 indexOption = indexStyleOption(AOption,AIndex,true);
-	ItemsLayout *layout = createItemsLayout(getIndexItems(AIndex,indexOption),indexOption);
+	AdvancedDelegateItems items = getIndexItems(AIndex,indexOption);
+
+	quint64 key = itemsLayoutKey(items,indexOption);
+	QHash<quint64, QSize>::const_iterator it = key>0 ? FSizeHintCache.constFind(key) : FSizeHintCache.constEnd();
+	if (it != FSizeHintCache.constEnd())
+		return it.value();
+
+	ItemsLayout *layout = createItemsLayout(items,indexOption);
 	QSize size = layout->mainLayout->sizeHint() + QSize(FMargins.left()+FMargins.right(),FMargins.top()+FMargins.bottom());
 	destroyItemsLayout(layout);
 
+	if (key > 0)
+	{
+		if (FSizeHintCache.count() >= SizeHintCacheSize)
+			FSizeHintCache.clear();
+		FSizeHintCache.insert(key,size);
+	}
+
 	return size;
 }
 
@@ -862,6 +935,7 @@ AdvancedItemDelegate::ItemsLayout *AdvancedItemDelegate::createItemsLayout(const
 	const int hSpacing = FHorizontalSpacing<0 ? style->proxy()->pixelMetric(QStyle::PM_FocusFrameHMargin)+1 : FHorizontalSpacing;
 
 	ItemsLayout *layout = new ItemsLayout;
+	layout->cacheKey = 0;
 	layout->middleLayout = NULL;
 	layout->indexOption = AIndexOption;
 
@@ -939,7 +1013,6 @@ AdvancedItemDelegate::ItemsLayout *AdvancedItemDelegate::createItemsLayout(const
 
 void AdvancedItemDelegate::destroyItemsLayout(ItemsLayout *ALayout) const
 {
-	destroyLayoutRecursive(ALayout->mainLayout);
 	delete ALayout;
 }
 
@@ -948,8 +1021,9 @@ QRect AdvancedItemDelegate::itemRect(quint32 AItemId, const ItemsLayout *ALayout
 	QRect rect;
 	if (ALayout->items.contains(AItemId))
 	{
-		if (ALayout->mainLayout->geometry() != AGeometry)
-			ALayout->mainLayout->setGeometry(AGeometry.adjusted(FMargins.left(),FMargins.top(),-FMargins.right(),-FMargins.bottom()));
+		QRect geometry = AGeometry.adjusted(FMargins.left(),FMargins.top(),-FMargins.right(),-FMargins.bottom());
+		if (ALayout->mainLayout->geometry() != geometry)
+			ALayout->mainLayout->setGeometry(geometry);
 		rect = ALayout->items.value(AItemId)->geometry();
 	}
 	return rect;
@@ -961,9 +1035,9 @@ QRect AdvancedItemDelegate::itemRect(quint32 AItemId, const QStyleOptionViewItem
 	if (AIndex.isValid() && !AOption.rect.isEmpty())
 	{
 		QStyleOptionViewItemV4 indexOption = indexStyleOption(AOption,AIndex);
-		ItemsLayout *layout = createItemsLayout(getIndexItems(AIndex,indexOption),indexOption);
+		ItemsLayout *layout = cachedItemsLayout(getIndexItems(AIndex,indexOption),indexOption);
 		rect = itemRect(AItemId,layout,indexOption.rect);
-		destroyItemsLayout(layout);
+		releaseItemsLayout(layout);
 	}
 	return rect;
 }
@@ -972,8 +1046,9 @@ quint32 AdvancedItemDelegate::itemAt(const QPoint &APoint, const ItemsLayout *AL
 {
 	if (AGeometry.contains(APoint))
 	{
-		if (ALayout->mainLayout->geometry() != AGeometry)
-			ALayout->mainLayout->setGeometry(AGeometry.adjusted(FMargins.left(),FMargins.top(),-FMargins.right(),-FMargins.bottom()));
+		QRect geometry = AGeometry.adjusted(FMargins.left(),FMargins.top(),-FMargins.right(),-FMargins.bottom());
+		if (ALayout->mainLayout->geometry() != geometry)
+			ALayout->mainLayout->setGeometry(geometry);
 
 		for (QMap<int,AdvancedDelegateLayoutItem *>::const_iterator it=ALayout->items.constBegin(); it!=ALayout->items.constEnd(); ++it)
 		{
@@ -990,9 +1065,9 @@ quint32 AdvancedItemDelegate::itemAt(const QPoint &APoint, const QStyleOptionVie
 	if (AIndex.isValid() && !AOption.rect.isEmpty())
 	{
 		QStyleOptionViewItemV4 indexOption = indexStyleOption(AOption,AIndex);
-		ItemsLayout *layout = createItemsLayout(getIndexItems(AIndex,indexOption),indexOption);
+		ItemsLayout *layout = cachedItemsLayout(getIndexItems(AIndex,indexOption),indexOption);
 		itemId = itemAt(APoint,layout,indexOption.rect);
-		destroyItemsLayout(layout);
+		releaseItemsLayout(layout);
 	}
 	return itemId;
 }
@@ -1115,6 +1190,82 @@ void AdvancedItemDelegate::drawFocusRect(QPainter *APainter, const QStyleOptionV
 	}
 }
 
+quint64 AdvancedItemDelegate::itemsLayoutKey(const AdvancedDelegateItems &AItems, const QStyleOptionViewItemV4 &AIndexOption) const
+{
+	// Everything that affects visibility, size or look of the items, except geometry
+	quint64 key = LayoutKeySeed;
+	key = combineLayoutKey(key,AIndexOption.widget);
+	key = combineLayoutKey(key,AIndexOption.widget ? AIndexOption.widget->style() : QApplication::style());
+	key = combineLayoutKey(key,(uint)AIndexOption.state);
+	key = combineLayoutKey(key,(uint)AIndexOption.features);
+	key = combineLayoutKey(key,(uint)AIndexOption.direction);
+	key = combineLayoutKey(key,(uint)AIndexOption.displayAlignment);
+	key = combineLayoutKey(key,(uint)AIndexOption.decorationAlignment);
+	key = combineLayoutKey(key,(uint)AIndexOption.textElideMode);
+	key = combineLayoutKey(key,((uint)AIndexOption.decorationSize.width()<<16) ^ (uint)AIndexOption.decorationSize.height());
+	key = combineLayoutKey(key,qHash(AIndexOption.font.key()));
+
+	static const QPalette::ColorGroup colorGroups[] = { QPalette::Active, QPalette::Inactive, QPalette::Disabled };
+	for (int i=0; i<3; i++)
+	{
+		key = combineLayoutKey(key,AIndexOption.palette.color(colorGroups[i],QPalette::Text).rgba());
+		key = combineLayoutKey(key,AIndexOption.palette.color(colorGroups[i],QPalette::HighlightedText).rgba());
+	}
+
+	for (AdvancedDelegateItems::const_iterator it=AItems.constBegin(); it!=AItems.constEnd(); ++it)
+	{
+		const AdvancedDelegateItem::ExplicitData *itd = it->d;
+		
+		// Size hint of custom widget can change at any moment
+		if (itd->kind == AdvancedDelegateItem::CustomWidget)
+			return 0;
+
+		key = combineLayoutKey(key,it.key());
+		key = combineLayoutKey(key,itd->kind);
+		key = combineLayoutKey(key,itd->flags);
+		key = combineLayoutKey(key,(uint)itd->showStates);
+		key = combineLayoutKey(key,(uint)itd->hideStates);
+		key = combineLayoutKey(key,((uint)itd->sizePolicy.horizontalPolicy()<<16) ^ (uint)itd->sizePolicy.verticalPolicy());
+		for (QMap<int,QVariant>::const_iterator hint_it=itd->hints.constBegin(); hint_it!=itd->hints.constEnd(); ++hint_it)
+		{
+			key = combineLayoutKey(key,hint_it.key());
+			key = combineLayoutKey(key,variantLayoutHash(hint_it.value()));
+		}
+		key = combineLayoutKey(key,variantLayoutHash(it->c->value));
+		key = combineLayoutKey(key,qRound(it->c->blinkOpacity*100));
+	}
+
+	return key>0 ? key : 1;
+}
+
+AdvancedItemDelegate::ItemsLayout *AdvancedItemDelegate::cachedItemsLayout(const AdvancedDelegateItems &AItems, const QStyleOptionViewItemV4 &AIndexOption) const
+{
+	quint64 key = itemsLayoutKey(AItems,AIndexOption);
+	ItemsLayout *layout = key>0 ? FLayoutCache.object(key) : NULL;
+	if (layout == NULL)
+	{
+		layout = createItemsLayout(AItems,AIndexOption);
+		if (key > 0)
+		{
+			layout->cacheKey = key;
+			FLayoutCache.insert(key,layout);
+		}
+	}
+	return layout;
+}
+
+void AdvancedItemDelegate::releaseItemsLayout(ItemsLayout *ALayout) const
+{
+	if (ALayout->cacheKey == 0)
+		destroyItemsLayout(ALayout);
+}
+
+void AdvancedItemDelegate::clearLayoutCache()
+{
+	FLayoutCache.clear();
+	FSizeHintCache.clear();
+}
+
 bool AdvancedItemDelegate::editorEvent(QEvent *AEvent, QAbstractItemModel *AModel, const QStyleOptionViewItem &AOption, const QModelIndex &AIndex)
 {
 	Qt::ItemFlags flags = AModel->flags(AIndex);
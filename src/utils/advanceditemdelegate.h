@@ -2,6 +2,8 @@
 #define ADVANCEDITEMDELEGATE_H
 
 #include <QMap>
+#include <QHash>
+#include <QCache>
 #include <QTimer>
 #include <QWidget>
 #include <QMargins>
@@ -166,6 +168,11 @@ public:
 protected:
 	void drawBackground(QPainter *APainter, const QStyleOptionViewItemV4 &AIndexOption) const;
 	void drawFocusRect(QPainter *APainter, const QStyleOptionViewItemV4 &AIndexOption, const QRect &ARect) const;
+protected:
+	quint64 itemsLayoutKey(const AdvancedDelegateItems &AItems, const QStyleOptionViewItemV4 &AIndexOption) const;
+	ItemsLayout *cachedItemsLayout(const AdvancedDelegateItems &AItems, const QStyleOptionViewItemV4 &AIndexOption) const;
+	void releaseItemsLayout(ItemsLayout *ALayout) const;
+	void clearLayoutCache();
 protected:
 	bool editorEvent(QEvent *AEvent, QAbstractItemModel *AModel, const QStyleOptionViewItem &AOption, const QModelIndex &AIndex);
 protected slots:
@@ -185,6 +192,9 @@ private:
 	int FEditRole;
 	quint32 FEditItemId;
 	AdvancedDelegateEditProxy *FEditProxy;
+private:
+	mutable QHash<quint64, QSize> FSizeHintCache;
+	mutable QCache<quint64, ItemsLayout> FLayoutCache;
 };
 
 UTILS_EXPORT QDataStream &operator>>(QDataStream &AStream, AdvancedDelegateItem &AItem);
@@ -1,5 +1,8 @@
 #include "jid.h"
 
+#include <QMutex>
+#include <QMutexLocker>
+
 #ifdef USE_SYSTEM_IDN
 #	include <stringprep.h>
 #else
@@ -12,6 +15,7 @@ static const QList<QChar> EscChars =     QList<QChar>()   << 0x5c << 0x20 << 0x2
 static const QList<QString> EscStrings = QList<QString>() <<"\\5c"<<"\\20"<<"\\22"<<"\\26"<<"\\27"<<"\\2f"<<"\\3a"<<"\\3c"<<"\\3e"<<"\\40";
 
 QHash<QString,Jid> Jid::FJidCache;
+static QMutex JidCacheMutex;
 const Jid Jid::null;
 
 void registerJidStreamOperators()
@@ -389,6 +393,8 @@ QString Jid::resourcePrepare(const QString &AResource)
 
 Jid &Jid::parseFromString(const QString &AJidStr)
 {
+	// Jids are also parsed in archive worker threads
+	QMutexLocker locker(&JidCacheMutex);
 	if (!FJidCache.contains(AJidStr))
 	{
 		if (!d)